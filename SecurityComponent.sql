@@ -3,6 +3,8 @@ USE SecurityComponent;
 DROP TABLE IF EXISTS `T_USER_ROLES`;
 DROP TABLE IF EXISTS `T_USERS`;
 DROP TABLE IF EXISTS `T_ROLES`;
+DROP TABLE IF EXISTS `T_SEQUENCES`;
+DROP TABLE IF EXISTS `T_CHANGE_LOG`;
 
 /*!40101 SET @saved_cs_client     = @@character_set_client */;
 /*!40101 SET character_set_client = utf8 */;
@@ -33,7 +35,7 @@ UNLOCK TABLES;
 CREATE TABLE `T_USERS` (
   `IdUser` int(11) NOT NULL,
   `Login` varchar(50) NOT NULL,
-  `Password` varchar(50) NOT NULL,
+  `Password` varchar(128) NOT NULL,
   `ConnectionNumber` int(11) NOT NULL DEFAULT 0,
   `LastConnection` int(11) DEFAULT NULL,
   `ConsecutiveError` int(11) DEFAULT 0,
@@ -83,6 +85,45 @@ LOCK TABLES `T_USER_ROLES` WRITE;
 INSERT INTO `T_USER_ROLES` VALUES (1,1);
 /*!40000 ALTER TABLE `T_USER_ROLES` ENABLE KEYS */;
 UNLOCK TABLES;
+
+--
+-- Table structure for table `T_SEQUENCES`
+--
+
+/*!40101 SET @saved_cs_client     = @@character_set_client */;
+/*!40101 SET character_set_client = utf8 */;
+CREATE TABLE `T_SEQUENCES` (
+  `SequenceName` varchar(50) NOT NULL,
+  `NextValue` int(11) NOT NULL,
+  PRIMARY KEY (`SequenceName`)
+) ENGINE=InnoDB DEFAULT CHARSET=latin1;
+/*!40101 SET character_set_client = @saved_cs_client */;
+
+--
+-- Dumping data for table `T_SEQUENCES`
+--
+
+LOCK TABLES `T_SEQUENCES` WRITE;
+/*!40000 ALTER TABLE `T_SEQUENCES` DISABLE KEYS */;
+INSERT INTO `T_SEQUENCES` VALUES ('T_ROLES',3),('T_USERS',4);
+/*!40000 ALTER TABLE `T_SEQUENCES` ENABLE KEYS */;
+UNLOCK TABLES;
+
+--
+-- Table structure for table `T_CHANGE_LOG`
+--
+
+/*!40101 SET @saved_cs_client     = @@character_set_client */;
+/*!40101 SET character_set_client = utf8 */;
+CREATE TABLE `T_CHANGE_LOG` (
+  `Version` bigint(20) NOT NULL AUTO_INCREMENT,
+  `EntityType` char(1) NOT NULL,
+  `EntityId` int(11) NOT NULL,
+  `ChangedAt` bigint(20) NOT NULL,
+  PRIMARY KEY (`Version`),
+  KEY `ChangedAt` (`ChangedAt`)
+) ENGINE=InnoDB DEFAULT CHARSET=latin1;
+/*!40101 SET character_set_client = @saved_cs_client */;
 /*!40103 SET TIME_ZONE=@OLD_TIME_ZONE */;
 
 /*!40101 SET SQL_MODE=@OLD_SQL_MODE */;
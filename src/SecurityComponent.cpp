@@ -1,7 +1,20 @@
+#include <fstream>
+#include <future>
 #include <gtest/gtest.h>
 #include <iostream>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <vector>
 #include <QtSql/QSqlQuery>
 
+#include "impl/InMemorySecurityManager.h"
+#include "impl/Pbkdf2PasswordHasher.h"
+#include "impl/RoleRegistry.h"
+#include "impl/Sha256.h"
+#include "impl/Sha256MultiBuffer.h"
+#include "impl/SnapshotCompiler.h"
+#include "impl/SnapshotSecurityManager.h"
 #include "impl/SqlSecurityManager.h"
 
 using namespace std;
@@ -10,13 +23,14 @@ using namespace fr::koor::security;
 
 class SecurityComponent : public ::testing::Test {
 protected:
-	SecurityManagerPtr securityManager;
+	std::shared_ptr<SqlSecurityManager> securityManager;
 
 	void SetUp() override {
-		securityManager = SecurityManagerPtr( new SqlSecurityManager( "localhost", "SecurityComponent", "webuser", "password" ) );
+		securityManager = std::shared_ptr<SqlSecurityManager>( new SqlSecurityManager( "localhost", "SecurityComponent", "webuser", "password" ) );
 		securityManager->openSession();
 
-		QSqlQuery query = QSqlQuery();
+		PooledConnection connection = securityManager->getConnectionPool().acquire();
+		QSqlQuery query = QSqlQuery( connection.database() );
 		query.exec( "UPDATE T_USERS SET ConsecutiveError = 0, isDisabled=0" );
 	}
 
@@ -36,6 +50,18 @@ TEST_F( SecurityComponent, LoginSuccess ) {
     EXPECT_EQ( user->getRoles().size(), 0 );
 }
 
+TEST_F( SecurityComponent, LoginSuccessRoundTrips ) {
+	// On lance le scénario
+	UserManagerPtr userManager = securityManager->getUserManager();
+	unsigned long long queryCount = securityManager->getExecutedQueryCount();
+	UserPtr user = userManager->checkCredentials( "root", "password" );
+
+	// On vérifie les résultats : un SELECT joint et un UPDATE, quel que soit le nombre de rôles
+    EXPECT_EQ( securityManager->getExecutedQueryCount() - queryCount, 2 );
+    EXPECT_EQ( user->getRoles().size(), 1 );
+    EXPECT_EQ( user->isMemberOfRole( Role( 1, "admin" ) ), true );
+}
+
 TEST_F( SecurityComponent, LoginSuccessWithErrors ) {
 	// On lance le scénario
 	UserManagerPtr userManager = securityManager->getUserManager();
@@ -71,6 +97,766 @@ TEST_F( SecurityComponent, LoginFail ) {
     }, BadCredentialsException );
 }
 
+TEST_F( SecurityComponent, ConcurrentLogins ) {
+	// On lance le scénario
+	UserManagerPtr userManager = securityManager->getUserManager();
+	SqlConnectionPool & connectionPool = securityManager->getConnectionPool();
+	std::vector<std::thread> threads;
+	std::vector<int> loginCounts( 4, 0 );
+	for( int i=0; i<4; i++ ) {
+		threads.push_back( std::thread( [ userManager, &connectionPool, &loginCounts, i ] {
+			for( int j=0; j<10; j++ ) {
+				UserPtr user = userManager->checkCredentials( "bond", "007" );
+				if ( user->getLogin() == "bond" ) loginCounts[i]++;
+			}
+			connectionPool.closeThreadConnection();
+		} ) );
+	}
+	for( std::thread & thread : threads ) thread.join();
+
+	// On vérifie les résultats
+	for( int count : loginCounts ) EXPECT_EQ( count, 10 );
+	EXPECT_LE( connectionPool.getOpenConnectionCount(), SqlConnectionPool::DEFAULT_MAXIMUM_SIZE );
+}
+
+TEST_F( SecurityComponent, ConnectionPoolExhausted ) {
+	// On lance le scénario
+	SqlConnectionPool & connectionPool = securityManager->getConnectionPool();
+	connectionPool.setMaximumSize( 1 );
+	connectionPool.setAcquireTimeout( std::chrono::milliseconds( 50 ) );
+	PooledConnection connection = connectionPool.acquire();
+
+	// On vérifie les résultats
+	bool timeoutReached = false;
+	std::thread thread( [ &connectionPool, &timeoutReached ] {
+		try { connectionPool.acquire(); } catch( SecurityManagerException & e ) { timeoutReached = true; }
+	} );
+	thread.join();
+	EXPECT_TRUE( timeoutReached );
+}
+
+TEST_F( SecurityComponent, CloseAllConnections ) {
+	// On lance le scénario : la connexion d'un autre thread est fermée par ce thread
+	SqlConnectionPool & connectionPool = securityManager->getConnectionPool();
+	std::promise<void> firstQueryDone;
+	std::promise<void> poolClosed;
+	bool secondQueryDone = false;
+	std::thread thread( [ &connectionPool, &firstQueryDone, &poolClosed, &secondQueryDone ] {
+		{
+			PooledConnection connection = connectionPool.acquire();
+			QSqlQuery( connection.database() ).exec( "SELECT 1" );
+		}
+		firstQueryDone.set_value();
+		poolClosed.get_future().wait();
+		{
+			PooledConnection connection = connectionPool.acquire();
+			secondQueryDone = QSqlQuery( connection.database() ).exec( "SELECT 1" );
+		}
+		connectionPool.closeThreadConnection();
+	} );
+	firstQueryDone.get_future().wait();
+	connectionPool.closeAll();
+	poolClosed.set_value();
+	thread.join();
+
+	// On vérifie les résultats
+	EXPECT_TRUE( secondQueryDone );
+}
+
+TEST_F( SecurityComponent, RoleCatalogCache ) {
+	// On lance le scénario
+	RoleManagerPtr roleManager = securityManager->getRoleManager();
+	unsigned long long queryCount = securityManager->getExecutedQueryCount();
+	RolePtr roleById = roleManager->selectRoleById( 1 );
+	RolePtr roleByName = roleManager->selectRoleByName( "admin" );
+
+	// On vérifie les résultats : le catalogue est chargé à l'ouverture de la session
+	EXPECT_EQ( securityManager->getExecutedQueryCount() - queryCount, 0 );
+	EXPECT_EQ( roleById, roleByName );
+	EXPECT_EQ( roleById->getRoleName(), "admin" );
+	EXPECT_THROW( roleManager->selectRoleById( 9999 ), SecurityManagerException );
+}
+
+TEST_F( SecurityComponent, UserCache ) {
+	// On lance le scénario
+	UserManagerPtr userManager = securityManager->getUserManager();
+	UserPtr user = userManager->getUserByLogin( "ripley" );
+	unsigned long long queryCount = securityManager->getExecutedQueryCount();
+	UserPtr cachedUser = userManager->getUserById( user->getIdentifier() );
+
+	// On vérifie les résultats
+	EXPECT_EQ( securityManager->getExecutedQueryCount() - queryCount, 0 );
+	EXPECT_EQ( cachedUser->getLogin(), "ripley" );
+	EXPECT_EQ( securityManager->getUserCache().getStatistics().hits, 1 );
+
+	// Une mise à jour invalide l'entrée du cache
+	cachedUser->setFirstName( "Ellen" );
+	userManager->updateUser( cachedUser );
+	EXPECT_EQ( userManager->getUserById( user->getIdentifier() )->getFirstName(), "Ellen" );
+	userManager->updateUser( user );
+	EXPECT_EQ( userManager->getUserById( user->getIdentifier() )->getFirstName(), "Ripley" );
+	EXPECT_THROW( userManager->getUserByLogin( "nobody" ), SecurityManagerException );
+}
+
+TEST_F( SecurityComponent, WriteBehindLogins ) {
+	// On lance le scénario
+	securityManager->enableWriteBehind( 100, std::chrono::seconds( 60 ) );
+	UserManagerPtr userManager = securityManager->getUserManager();
+	UserPtr firstLogin = userManager->checkCredentials( "bond", "007" );
+	unsigned long long queryCount = securityManager->getExecutedQueryCount();
+	UserPtr secondLogin = userManager->checkCredentials( "bond", "007" );
+
+	// On vérifie les résultats : seul le SELECT est exécuté, les compteurs restent cohérents
+	EXPECT_EQ( securityManager->getExecutedQueryCount() - queryCount, 1 );
+	EXPECT_EQ( secondLogin->getConnectionNumber(), firstLogin->getConnectionNumber() + 1 );
+
+	securityManager->flushLoginUpdates();
+	EXPECT_EQ( userManager->getUserByLogin( "bond" )->getConnectionNumber(), secondLogin->getConnectionNumber() );
+	securityManager->disableWriteBehind();
+}
+
+TEST_F( SecurityComponent, Pbkdf2PasswordHasher ) {
+	// On lance le scénario
+	Pbkdf2PasswordHasher hasher( 1000 );
+	string firstHash = hasher.hash( "007" );
+	string secondHash = hasher.hash( "007" );
+
+	// On vérifie les résultats : sels différents, anciens mots de passe en clair toujours acceptés
+	EXPECT_EQ( firstHash.compare( 0, Pbkdf2PasswordHasher::PREFIX.size(), Pbkdf2PasswordHasher::PREFIX ), 0 );
+	EXPECT_NE( firstHash, secondHash );
+	EXPECT_EQ( hasher.verify( "007", firstHash ), true );
+	EXPECT_EQ( hasher.verify( "008", firstHash ), false );
+	EXPECT_EQ( hasher.needsRehash( firstHash ), false );
+	EXPECT_EQ( Pbkdf2PasswordHasher( 2000 ).needsRehash( firstHash ), true );
+	EXPECT_EQ( hasher.verify( "007", "007" ), true );
+	EXPECT_EQ( hasher.needsRehash( "007" ), true );
+}
+
+TEST_F( SecurityComponent, LegacyPasswordStartingWithDollar ) {
+	// On lance le scénario
+	Pbkdf2PasswordHasher hasher( 1000 );
+	vector<bool> results = hasher.verifyBatch( { "$ecret", "secret", "$ecret" }, { "$ecret", "$ecret", hasher.hash( "$ecret" ) } );
+
+	// On vérifie les résultats : un mot de passe en clair commençant par un '$' n'est pas un hash
+	EXPECT_EQ( hasher.isEncoded( "$ecret" ), false );
+	EXPECT_EQ( hasher.isEncoded( Pbkdf2PasswordHasher::PREFIX + "x" ), false );
+	EXPECT_EQ( hasher.isEncoded( hasher.hash( "$ecret" ) ), true );
+	EXPECT_EQ( hasher.verify( "$ecret", "$ecret" ), true );
+	EXPECT_EQ( hasher.verify( "secret", "$ecret" ), false );
+	EXPECT_EQ( hasher.needsRehash( "$ecret" ), true );
+	EXPECT_EQ( results, vector<bool>( { true, false, true } ) );
+}
+
+TEST_F( SecurityComponent, PasswordRehashedAtLogin ) {
+	// On lance le scénario
+	securityManager->setPasswordHasher( PasswordHasherPtr( new Pbkdf2PasswordHasher( 1000 ) ) );
+	UserManagerPtr userManager = securityManager->getUserManager();
+	userManager->checkCredentials( "bond", "007" );
+	UserPtr user = userManager->getUserByLogin( "bond" );
+
+	// On vérifie les résultats : le mot de passe est stocké haché et reste utilisable
+	EXPECT_EQ( securityManager->getPasswordHasher()->needsRehash( user->getEncryptedPassword() ), false );
+	EXPECT_EQ( user->isSamePassword( "007" ), true );
+	EXPECT_EQ( user->isSamePassword( "008" ), false );
+	EXPECT_EQ( userManager->checkCredentials( "bond", "007" )->getLogin(), "bond" );
+}
+
+TEST_F( SecurityComponent, MultiBufferPbkdf2 ) {
+	// On lance le scénario
+	vector<Pbkdf2Input> inputs;
+	for( uint i=0; i<21; i++ ) {
+		inputs.push_back( Pbkdf2Input { "password" + to_string( i ), vector<uint8_t>( i % 5 + 1, (uint8_t) i ), 1 + ( i % 3 ) * 10 } );
+	}
+
+	// On vérifie les résultats : chaque largeur de noyau donne le résultat de l'implémentation scalaire
+	for( size_t laneCount : { 4, 8, 16 } ) {
+		vector<vector<uint8_t>> derivedKeys = Sha256MultiBuffer::pbkdf2HmacSha256( inputs, 40, laneCount );
+		for( size_t i=0; i<inputs.size(); i++ ) {
+			EXPECT_EQ( derivedKeys[i], pbkdf2HmacSha256( inputs[i].password, inputs[i].salt, inputs[i].iterations, 40 ) );
+		}
+	}
+}
+
+TEST_F( SecurityComponent, RehashLegacyPasswords ) {
+	// On lance le scénario
+	securityManager->setPasswordHasher( PasswordHasherPtr( new Pbkdf2PasswordHasher( 1000 ) ) );
+	{
+		PooledConnection connection = securityManager->getConnectionPool().acquire();
+		QSqlQuery query( connection.database() );
+		query.exec( "UPDATE T_USERS SET Password='007' WHERE Login='bond'" );
+	}
+	size_t hashedCount = securityManager->rehashLegacyPasswords( 2 );
+
+	// On vérifie les résultats
+	UserPtr user = securityManager->getUserManager()->getUserByLogin( "bond" );
+	EXPECT_GE( hashedCount, 1 );
+	EXPECT_EQ( user->getEncryptedPassword().compare( 0, Pbkdf2PasswordHasher::PREFIX.size(), Pbkdf2PasswordHasher::PREFIX ), 0 );
+	EXPECT_EQ( securityManager->getUserManager()->checkCredentials( "bond", "007" )->getLogin(), "bond" );
+	EXPECT_EQ( securityManager->rehashLegacyPasswords( 2 ), 0 );
+}
+
+TEST_F( SecurityComponent, RoleMembership ) {
+	// On lance le scénario
+	User user( *securityManager, 1, "ash", "" );
+	user.addRole( RolePtr( new Role( 1, "admin" ) ) );
+	user.addRole( RolePtr( new Role( 100000, "auditor" ) ) );
+	user.addRole( RolePtr( new Role( 1, "admin" ) ) );
+
+	// On vérifie les résultats : identifiants denses et épars, doublons ignorés
+	EXPECT_EQ( user.getRoles().size(), 2 );
+	EXPECT_EQ( user.isMemberOfRole( Role( 1, "admin" ) ), true );
+	EXPECT_EQ( user.isMemberOfRole( Role( 100000, "auditor" ) ), true );
+	EXPECT_EQ( user.isMemberOfRole( Role( 2, "other" ) ), false );
+	EXPECT_EQ( user.isMemberOfRole( Role( 99999, "other" ) ), false );
+
+	user.removeRole( RolePtr( new Role( 100000, "auditor" ) ) );
+	EXPECT_EQ( user.getRoles().size(), 1 );
+	EXPECT_EQ( user.isMemberOfRole( Role( 100000, "auditor" ) ), false );
+}
+
+TEST_F( SecurityComponent, RoleInterning ) {
+	// On lance le scénario
+	RoleRegistry registry;
+	RolePtr role = registry.intern( 7, "auditor" );
+	RolePtr replacedRole;
+	RolePtr sameRole = registry.intern( 7, "auditor", &replacedRole );
+	RolePtr renamedRole = registry.intern( 7, "reviewer", &replacedRole );
+	UserManagerPtr userManager = securityManager->getUserManager();
+	UserPtr firstLogin = userManager->checkCredentials( "root", "password" );
+	UserPtr secondLogin = userManager->checkCredentials( "root", "password" );
+
+	// On vérifie les résultats : une seule instance par identifiant de rôle, jamais modifiée
+	EXPECT_EQ( role, sameRole );
+	EXPECT_NE( role, renamedRole );
+	EXPECT_EQ( replacedRole, role );
+	EXPECT_EQ( role->getRoleName(), "auditor" );
+	EXPECT_EQ( renamedRole->getRoleName(), "reviewer" );
+	EXPECT_EQ( registry.findById( 7 ), renamedRole );
+	EXPECT_EQ( registry.findByName( "auditor" ), nullptr );
+	EXPECT_EQ( registry.findByName( "reviewer" ), renamedRole );
+	registry.remove( 7 );
+	EXPECT_EQ( registry.findById( 7 ), nullptr );
+	EXPECT_EQ( *firstLogin->getRoles().begin(), *secondLogin->getRoles().begin() );
+	EXPECT_EQ( *firstLogin->getRoles().begin(), securityManager->getRoleManager()->selectRoleById( 1 ) );
+}
+
+TEST_F( SecurityComponent, UsersByRole ) {
+	// On lance le scénario
+	UserManagerPtr userManager = securityManager->getUserManager();
+	RolePtr admin = securityManager->getRoleManager()->selectRoleById( 1 );
+	vector<UserPtr> users = userManager->getUsersByRole( admin );
+	size_t visitedCount = 0;
+	userManager->forEachUserInRole( admin, [&visitedCount, &admin]( UserPtr user ) {
+		EXPECT_EQ( user->isMemberOfRole( admin ), true );
+		visitedCount++;
+		return true;
+	}, 1 );
+	size_t stoppedCount = 0;
+	userManager->forEachUserInRole( admin, [&stoppedCount]( UserPtr user ) { stoppedCount++; return false; } );
+
+	// On vérifie les résultats : pagination d'un utilisateur par page, arrêt demandé par le visiteur
+	EXPECT_GE( users.size(), 1 );
+	EXPECT_EQ( visitedCount, users.size() );
+	EXPECT_EQ( stoppedCount, 1 );
+	EXPECT_EQ( users[0]->getLogin(), "root" );
+}
+
+TEST_F( SecurityComponent, InsertUser ) {
+	// On lance le scénario
+	securityManager->setPasswordHasher( PasswordHasherPtr( new Pbkdf2PasswordHasher( 1000 ) ) );
+	UserManagerPtr userManager = securityManager->getUserManager();
+	UserPtr user = userManager->insertUser( "moneypenny", "secret" );
+
+	// On vérifie les résultats
+	EXPECT_EQ( userManager->checkCredentials( "moneypenny", "secret" )->getIdentifier(), user->getIdentifier() );
+	EXPECT_THROW({
+		userManager->insertUser( "moneypenny", "other" );
+	}, UserAlreadyRegisteredException );
+	userManager->deleteUser( user );
+}
+
+TEST_F( SecurityComponent, RoleRenamed ) {
+	// On lance le scénario
+	RoleManagerPtr roleManager = securityManager->getRoleManager();
+	UserManagerPtr userManager = securityManager->getUserManager();
+	RolePtr role = roleManager->insertRole( "auditor" );
+	UserPtr user = userManager->getUserByLogin( "bond" );
+	user->addRole( role );
+	userManager->updateUser( user );
+	userManager->getUserByLogin( "bond" );
+	RolePtr renamedRole = roleManager->updateRole( role, "reviewer" );
+	UserPtr reloadedUser = userManager->getUserByLogin( "bond" );
+
+	// On vérifie les résultats : le rôle partagé n'est pas modifié, les utilisateurs en cache sont rechargés
+	EXPECT_EQ( roleManager->selectRoleById( role->getIdentifier() ), renamedRole );
+	EXPECT_EQ( role->getRoleName(), "auditor" );
+	EXPECT_EQ( renamedRole->getRoleName(), "reviewer" );
+	EXPECT_EQ( reloadedUser->getRoles().count( renamedRole ), 1 );
+	reloadedUser->removeRole( renamedRole );
+	userManager->updateUser( reloadedUser );
+	roleManager->deleteRole( renamedRole );
+}
+
+TEST_F( SecurityComponent, RoleCaseVariant ) {
+	// On lance le scénario
+	RoleManagerPtr roleManager = securityManager->getRoleManager();
+	RolePtr admin = roleManager->selectRoleById( 1 );
+	RolePtr upperCaseAdmin = roleManager->selectRoleByName( "ADMIN" );
+
+	// On vérifie les résultats : la casse demandée ne renomme pas le rôle partagé
+	EXPECT_EQ( upperCaseAdmin, admin );
+	EXPECT_EQ( upperCaseAdmin->getRoleName(), "admin" );
+	EXPECT_EQ( roleManager->selectRoleByName( "admin" ), admin );
+	EXPECT_EQ( roleManager->selectRoleById( 1 ), admin );
+}
+
+TEST_F( SecurityComponent, ImportUsers ) {
+	// On lance le scénario
+	securityManager->setPasswordHasher( PasswordHasherPtr( new Pbkdf2PasswordHasher( 1000 ) ) );
+	istringstream csv( "login,password,firstName,lastName,email,roles\n"
+					   "import-1,secret,\"Jean, Paul\",Dupont,jp@koor.fr,admin\n"
+					   "import-2,$ecret,,,,\n"
+					   "import-2,secret,,,,\n"
+					   "import-3,secret,,,,unknown\n"
+					   "bond,secret,,,,\n" );
+	UserImporter importer( *securityManager, 2 );
+	size_t batchCount = 0;
+	importer.setProgressHandler( [&batchCount]( const UserImporter::Progress & progress ) { batchCount++; } );
+	UserImporter::Progress progress = importer.importCsv( csv );
+
+	// On vérifie les résultats : doublons, rôles inconnus et logins existants sont rejetés
+	UserManagerPtr userManager = securityManager->getUserManager();
+	UserPtr firstUser = userManager->checkCredentials( "import-1", "secret" );
+	UserPtr secondUser = userManager->checkCredentials( "import-2", "$ecret" );
+	EXPECT_EQ( progress.readCount, 5 );
+	EXPECT_EQ( progress.importedCount, 2 );
+	EXPECT_EQ( progress.rejectedCount, 3 );
+	EXPECT_EQ( importer.getRejections().size(), 3 );
+	EXPECT_EQ( batchCount, 3 );
+	EXPECT_EQ( firstUser->getFirstName(), "Jean, Paul" );
+	EXPECT_EQ( firstUser->isMemberOfRole( Role( 1, "admin" ) ), true );
+	EXPECT_EQ( secondUser->getRoles().size(), 0 );
+	EXPECT_EQ( securityManager->getPasswordHasher()->isEncoded( secondUser->getEncryptedPassword() ), true );
+	userManager->deleteUser( firstUser );
+	userManager->deleteUser( secondUser );
+}
+
+TEST_F( SecurityComponent, ImportUsersCaseVariants ) {
+	// On lance le scénario : des variantes de casse et d'espaces finaux dans un même lot, et d'un login existant
+	securityManager->setPasswordHasher( PasswordHasherPtr( new Pbkdf2PasswordHasher( 1000 ) ) );
+	istringstream csv( "login,password,firstName,lastName,email,roles\n"
+					   "Import-Case,secret,,,,ADMIN\n"
+					   "import-case ,secret,,,,\n"
+					   "BOND,secret,,,,\n" );
+	UserImporter importer( *securityManager, 10 );
+	UserImporter::Progress progress = importer.importCsv( csv );
+
+	// On vérifie les résultats : les doublons sont rejetés sans annuler le lot
+	UserManagerPtr userManager = securityManager->getUserManager();
+	UserPtr user = userManager->checkCredentials( "Import-Case", "secret" );
+	EXPECT_EQ( progress.importedCount, 1 );
+	EXPECT_EQ( progress.rejectedCount, 2 );
+	EXPECT_EQ( user->isMemberOfRole( Role( 1, "admin" ) ), true );
+	EXPECT_EQ( securityManager->getRoleManager()->selectRoleById( 1 )->getRoleName(), "admin" );
+	userManager->deleteUser( user );
+}
+
+TEST_F( SecurityComponent, IdAllocator ) {
+	// On lance le scénario : deux allocateurs simulent deux processus partageant la séquence
+	IdAllocator firstAllocator( *securityManager, "T_ROLES", "IdRole", 10 );
+	IdAllocator secondAllocator( *securityManager, "T_ROLES", "IdRole", 10 );
+	PooledConnection connection = securityManager->getConnectionPool().acquire();
+	set<uint> identifiers;
+	for( int i=0; i<25; i++ ) {
+		identifiers.insert( firstAllocator.allocate( connection.database() ) );
+		identifiers.insert( secondAllocator.allocate( connection.database() ) );
+	}
+	uint rangeStart = firstAllocator.allocate( connection.database(), 30 );
+
+	// On vérifie les résultats : aucun identifiant distribué deux fois
+	EXPECT_EQ( identifiers.size(), 50 );
+	EXPECT_GT( *identifiers.begin(), 2 );
+	EXPECT_GT( rangeStart, *identifiers.rbegin() );
+}
+
+TEST_F( SecurityComponent, InsertRoleWithoutKeyQuery ) {
+	// On lance le scénario
+	RoleManagerPtr roleManager = securityManager->getRoleManager();
+	RolePtr firstRole = roleManager->insertRole( "auditor" );
+	unsigned long long queryCount = securityManager->getExecutedQueryCount();
+	RolePtr secondRole = roleManager->insertRole( "reviewer" );
+
+	// On vérifie les résultats : un SELECT d'existence et l'INSERT, l'identifiant venant du bloc réservé
+	EXPECT_EQ( securityManager->getExecutedQueryCount() - queryCount, 2 );
+	EXPECT_GT( secondRole->getIdentifier(), firstRole->getIdentifier() );
+	roleManager->deleteRole( firstRole );
+	roleManager->deleteRole( secondRole );
+}
+
+TEST_F( SecurityComponent, StatementCache ) {
+	// On lance le scénario
+	UserManagerPtr userManager = securityManager->getUserManager();
+	userManager->checkCredentials( "root", "password" );		// Le mot de passe peut être re-haché ici
+	userManager->checkCredentials( "root", "password" );
+	StatementCache::Statistics before = securityManager->getConnectionPool().getStatementCacheStatistics();
+	userManager->checkCredentials( "root", "password" );
+	StatementCache::Statistics after = securityManager->getConnectionPool().getStatementCacheStatistics();
+
+	// On vérifie les résultats : la seconde connexion réutilise le SELECT et l'UPDATE déjà préparés
+	EXPECT_EQ( after.hits - before.hits, 2 );
+	EXPECT_EQ( after.misses, before.misses );
+	EXPECT_GT( after.getHitRate(), 0 );
+}
+
+TEST_F( SecurityComponent, SessionToken ) {
+	// On lance le scénario
+	UserManagerPtr userManager = securityManager->getUserManager();
+	UserPtr user = userManager->checkCredentials( "root", "password" );
+	string token = userManager->issueToken( user, chrono::minutes( 5 ) );
+	unsigned long long queryCount = securityManager->getExecutedQueryCount();
+	TokenClaims claims = userManager->verifyToken( token );
+
+	// On vérifie les résultats : aucune requête SQL pour vérifier le jeton
+	EXPECT_EQ( securityManager->getExecutedQueryCount(), queryCount );
+	EXPECT_EQ( claims.getUserIdentifier(), user->getIdentifier() );
+	EXPECT_EQ( claims.isMemberOfRole( Role( 1, "admin" ) ), true );
+	EXPECT_EQ( claims.isMemberOfRole( Role( 2, "demo" ) ), false );
+
+	string forgedToken = token;
+	forgedToken[ 10 ] = forgedToken[ 10 ] == 'A' ? 'B' : 'A';
+	EXPECT_THROW({ userManager->verifyToken( forgedToken ); }, InvalidTokenException );
+	EXPECT_THROW({ userManager->verifyToken( userManager->issueToken( user, chrono::seconds( -1 ) ) ); }, InvalidTokenException );
+}
+
+TEST_F( SecurityComponent, SessionTokenKeyRotation ) {
+	// On lance le scénario
+	UserManagerPtr userManager = securityManager->getUserManager();
+	TokenSigner & tokenSigner = securityManager->getTokenSigner();
+	UserPtr user = userManager->checkCredentials( "bond", "007" );
+	tokenSigner.addKey( 1, "first shared secret for all the nodes" );
+	tokenSigner.setActiveKey( 1 );
+	string oldToken = userManager->issueToken( user );
+	tokenSigner.addKey( 2, "second shared secret for all the nodes" );
+	tokenSigner.setActiveKey( 2 );
+	string newToken = userManager->issueToken( user );
+
+	// On vérifie les résultats : les anciens jetons restent valides tant que leur clé n'est pas retirée
+	EXPECT_EQ( userManager->verifyToken( oldToken ).getUserIdentifier(), user->getIdentifier() );
+	EXPECT_EQ( userManager->verifyToken( newToken ).getUserIdentifier(), user->getIdentifier() );
+	tokenSigner.removeKey( 1 );
+	EXPECT_THROW({ userManager->verifyToken( oldToken ); }, InvalidTokenException );
+	EXPECT_THROW({ tokenSigner.removeKey( 2 ); }, SecurityManagerException );
+	EXPECT_THROW({ tokenSigner.addKey( 3, "short" ); }, SecurityManagerException );
+}
+
+TEST_F( SecurityComponent, SessionStore ) {
+	// On lance le scénario
+	SessionStore & sessionStore = securityManager->getSessionStore();
+	UserPtr user = securityManager->getUserManager()->checkCredentials( "bond", "007" );
+	string firstSession = sessionStore.create( *user );
+	string secondSession = sessionStore.create( *user );
+	unsigned long long queryCount = securityManager->getExecutedQueryCount();
+	shared_ptr<const User> sessionUser = sessionStore.find( firstSession );
+
+	// On vérifie les résultats : aucune requête SQL pour retrouver une session
+	EXPECT_EQ( securityManager->getExecutedQueryCount(), queryCount );
+	ASSERT_NE( sessionUser, nullptr );
+	EXPECT_EQ( sessionUser->getLogin(), "bond" );
+	EXPECT_NE( firstSession, secondSession );
+	EXPECT_EQ( sessionStore.find( "unknown" ), nullptr );
+	EXPECT_EQ( sessionStore.revoke( firstSession ), true );
+	EXPECT_EQ( sessionStore.find( firstSession ), nullptr );
+	EXPECT_EQ( sessionStore.revokeUser( user->getIdentifier() ), 1 );
+	EXPECT_EQ( sessionStore.size(), 0 );
+}
+
+TEST_F( SecurityComponent, SessionStoreExpiry ) {
+	// On lance le scénario
+	SessionStore sessionStore( chrono::milliseconds( 10 ) );
+	UserPtr user = securityManager->getUserManager()->checkCredentials( "bond", "007" );
+	string idleSession = sessionStore.create( *user, chrono::seconds( 1 ) );
+	string activeSession = sessionStore.create( *user, chrono::seconds( 1 ) );
+	sessionStore.startExpiryThread();
+	for( int i=0; i<6; i++ ) {
+		this_thread::sleep_for( chrono::milliseconds( 250 ) );
+		sessionStore.find( activeSession );
+	}
+
+	// On vérifie les résultats : seule la session renouvelée a survécu
+	EXPECT_EQ( sessionStore.find( idleSession ), nullptr );
+	EXPECT_NE( sessionStore.find( activeSession ), nullptr );
+	EXPECT_EQ( sessionStore.size(), 1 );
+}
+
+TEST_F( SecurityComponent, UnknownLoginFilter ) {
+	// On lance le scénario : le filtre n'est fiable que si le journal des modifications est suivi
+	securityManager->close();
+	securityManager->enableChangeFeed( chrono::hours( 1 ) );
+	securityManager->openSession();
+	securityManager->setPasswordHasher( PasswordHasherPtr( new Pbkdf2PasswordHasher( 1000 ) ) );
+	UserManagerPtr userManager = securityManager->getUserManager();
+	unsigned long long queryCount = securityManager->getExecutedQueryCount();
+	for( int i=0; i<100; i++ ) {
+		EXPECT_THROW({ userManager->checkCredentials( "stuffing-" + to_string( i ), "password" ); }, BadCredentialsException );
+	}
+
+	// On vérifie les résultats : les logins inconnus sont presque tous rejetés sans requête SQL
+	EXPECT_LT( securityManager->getExecutedQueryCount() - queryCount, 10 );
+	LoginFilter & loginFilter = securityManager->getLoginFilter();
+	EXPECT_EQ( loginFilter.mightContain( "bond" ), true );
+	EXPECT_EQ( loginFilter.mightContain( "BOND  " ), true );
+
+	UserPtr user = userManager->insertUser( "stuffing-new", "secret" );
+	EXPECT_EQ( userManager->checkCredentials( "stuffing-new", "secret" )->getIdentifier(), user->getIdentifier() );
+	userManager->deleteUser( user );
+	EXPECT_EQ( loginFilter.getStaleCount(), 1 );
+}
+
+TEST_F( SecurityComponent, LoginStoredByAnotherProcess ) {
+	// On lance le scénario : un utilisateur est inséré directement en base, après l'ouverture de la session
+	{
+		PooledConnection connection = securityManager->getConnectionPool().acquire();
+		QSqlQuery query( connection.database() );
+		query.exec( "INSERT INTO T_USERS (IdUser, Login, Password) VALUES ( 9999, 'outsider', 'secret' )" );
+	}
+	UserManagerPtr userManager = securityManager->getUserManager();
+	UserPtr user = userManager->checkCredentials( "outsider", "secret" );
+	UserPtr sameUser = userManager->getUserByLogin( "outsider" );
+	userManager->deleteUser( user );
+
+	// On vérifie les résultats : sans journal des modifications, le filtre ne rejette aucun login
+	EXPECT_EQ( user->getIdentifier(), 9999u );
+	EXPECT_EQ( sameUser->getIdentifier(), 9999u );
+}
+
+TEST_F( SecurityComponent, LoginRateLimit ) {
+	// On lance le scénario
+	UserManagerPtr userManager = securityManager->getUserManager();
+	securityManager->getLoginRateLimiter().setLimit( 2, chrono::minutes( 1 ) );
+	securityManager->getSourceRateLimiter().setLimit( 3, chrono::minutes( 1 ) );
+	userManager->checkCredentials( "bond", "007", "10.0.0.1" );
+	EXPECT_THROW({ userManager->checkCredentials( "root", "bad", "10.0.0.2" ); }, BadCredentialsException );
+	EXPECT_THROW({ userManager->checkCredentials( "ROOT", "bad", "10.0.0.2" ); }, BadCredentialsException );
+	unsigned long long queryCount = securityManager->getExecutedQueryCount();
+
+	// On vérifie les résultats : les tentatives refusées n'exécutent aucune requête SQL
+	try {
+		userManager->checkCredentials( "root", "password", "10.0.0.2" );
+		FAIL() << "Login attempt should be rate limited";
+	} catch ( const RateLimitedException & exception ) {
+		EXPECT_GT( exception.getRetryAfter().count(), 0 );
+	}
+	EXPECT_EQ( securityManager->getExecutedQueryCount(), queryCount );
+
+	// Les connexions réussies ne sont limitées que par source
+	userManager->checkCredentials( "bond", "007", "10.0.0.1" );
+	userManager->checkCredentials( "bond", "007", "10.0.0.1" );
+	queryCount = securityManager->getExecutedQueryCount();
+	EXPECT_THROW({ userManager->checkCredentials( "bond", "007", "10.0.0.1" ); }, RateLimitedException );
+	EXPECT_EQ( securityManager->getExecutedQueryCount(), queryCount );
+}
+
+TEST_F( SecurityComponent, AsynchronousCalls ) {
+	// On lance le scénario
+	UserManagerPtr userManager = securityManager->getUserManager();
+	RoleManagerPtr roleManager = securityManager->getRoleManager();
+	vector<future<UserPtr>> logins;
+	for( int i=0; i<20; i++ ) logins.push_back( userManager->checkCredentialsAsync( "bond", "007" ) );
+	future<UserPtr> rejectedLogin = userManager->checkCredentialsAsync( "bond", "bad" );
+	future<RolePtr> role = roleManager->selectRoleByIdAsync( 1 );
+	promise<string> completedLogin;
+	userManager->checkCredentialsAsync( "root", "password", "10.0.0.1", [&completedLogin]( future<UserPtr> result ) {
+		completedLogin.set_value( result.get()->getLogin() );
+	} );
+	// Un gestionnaire de fin qui laisse échapper l'exception ne doit pas arrêter le thread du pool
+	userManager->checkCredentialsAsync( "nobody", "password", "10.0.0.1", []( future<UserPtr> result ) { result.get(); } );
+	future<RolePtr> laterRole = roleManager->selectRoleByIdAsync( 1 );
+
+	// On vérifie les résultats
+	for( future<UserPtr> & login : logins ) EXPECT_EQ( login.get()->getLogin(), "bond" );
+	EXPECT_THROW({ rejectedLogin.get(); }, BadCredentialsException );
+	EXPECT_EQ( role.get()->getRoleName(), "admin" );
+	EXPECT_EQ( completedLogin.get_future().get(), "root" );
+	EXPECT_EQ( laterRole.get()->getRoleName(), "admin" );
+}
+
+TEST_F( SecurityComponent, SqliteBackend ) {
+	// On lance le scénario : une base SQLite vierge reçoit le schéma à l'ouverture
+	const string databaseFile = "/tmp/SecurityComponentTest.db";
+	for( const char * suffix : { "", "-wal", "-shm" } ) remove( ( databaseFile + suffix ).c_str() );
+	SqlSecurityManager sqliteManager( SqlSecurityManager::SQLITE_DRIVER, "", databaseFile, "", "" );
+	sqliteManager.openSession();
+	sqliteManager.setPasswordHasher( PasswordHasherPtr( new Pbkdf2PasswordHasher( 1000 ) ) );
+	UserManagerPtr userManager = sqliteManager.getUserManager();
+	UserPtr user = userManager->insertUser( "moneypenny", "secret" );
+	user->addRole( sqliteManager.getRoleManager()->selectRoleByName( "admin" ) );
+	userManager->updateUser( user );
+
+	// On vérifie les résultats
+	UserPtr loggedUser = userManager->checkCredentials( "MoneyPenny", "secret" );
+	EXPECT_EQ( loggedUser->getIdentifier(), user->getIdentifier() );
+	EXPECT_EQ( loggedUser->isMemberOfRole( Role( 1, "admin" ) ), true );
+	EXPECT_THROW({ userManager->checkCredentials( "moneypenny", "bad" ); }, BadCredentialsException );
+	PooledConnection connection = sqliteManager.getConnectionPool().acquire();
+	QSqlQuery query( connection.database() );
+	ASSERT_EQ( query.exec( "PRAGMA journal_mode" ) && query.next(), true );
+	EXPECT_EQ( query.value( 0 ).toString().toStdString(), "wal" );
+}
+
+TEST_F( SecurityComponent, InMemoryBackend ) {
+	// On lance le scénario : un instantané au format de SecurityComponent.sql, puis des mutations journalisées
+	const string snapshotFile = "/tmp/SecurityComponentTest.sql";
+	remove( snapshotFile.c_str() );
+	remove( ( snapshotFile + ".journal" ).c_str() );
+	{
+		ofstream snapshot( snapshotFile );
+		snapshot << "INSERT INTO `T_ROLES` VALUES (1,'admin'),(2,'demo');\n"
+				 << "INSERT INTO `T_USERS` VALUES (3,'bond','007',0,0,0,0,'James','Bond','007@mi6.uk');\n"
+				 << "INSERT INTO `T_USER_ROLES` VALUES (3,1);\n"
+				 << "INSERT INTO `T_SEQUENCES` VALUES ('T_ROLES',3),('T_USERS',4);\n";
+	}
+	{
+		InMemorySecurityManager inMemoryManager( snapshotFile );
+		inMemoryManager.setPasswordHasher( PasswordHasherPtr( new Pbkdf2PasswordHasher( 1000 ) ) );
+		inMemoryManager.openSession();
+		UserManagerPtr userManager = inMemoryManager.getUserManager();
+		EXPECT_EQ( userManager->checkCredentials( "Bond", "007" )->isMemberOfRole( Role( 1, "admin" ) ), true );
+		UserPtr user = userManager->insertUser( "moneypenny", "secret" );
+		user->addRole( inMemoryManager.getRoleManager()->selectRoleByName( "demo" ) );
+		userManager->updateUser( user );
+		inMemoryManager.close();
+	}
+
+	// On vérifie les résultats : le journal est rejoué sur l'instantané, puis intégré à un nouvel instantané
+	InMemorySecurityManager inMemoryManager( snapshotFile );
+	inMemoryManager.setPasswordHasher( PasswordHasherPtr( new Pbkdf2PasswordHasher( 1000 ) ) );
+	inMemoryManager.openSession();
+	UserManagerPtr userManager = inMemoryManager.getUserManager();
+	EXPECT_EQ( inMemoryManager.getUserCount(), 2u );
+	EXPECT_EQ( userManager->getUserByLogin( "bond" )->getConnectionNumber(), 1u );
+	UserPtr loggedUser = userManager->checkCredentials( "moneypenny", "secret" );
+	EXPECT_EQ( loggedUser->getIdentifier(), 4 );
+	EXPECT_EQ( loggedUser->isMemberOfRole( Role( 2, "demo" ) ), true );
+	EXPECT_THROW({ userManager->checkCredentials( "moneypenny", "bad" ); }, BadCredentialsException );
+	RoleManagerPtr roleManager = inMemoryManager.getRoleManager();
+	EXPECT_THROW({ roleManager->updateRole( roleManager->selectRoleByName( "demo" ), "admin" ); }, RoleAlreadyRegisteredException );
+	EXPECT_EQ( roleManager->selectRoleById( 2 )->getRoleName(), "demo" );
+	inMemoryManager.compact();
+	EXPECT_EQ( ifstream( snapshotFile + ".journal" ).peek(), EOF );
+	inMemoryManager.close();
+}
+
+TEST_F( SecurityComponent, CompiledSnapshot ) {
+	// On lance le scénario : les tables sont compilées dans un instantané, servi en lecture seule
+	const string snapshotFile = "/tmp/SecurityComponentTest.snapshot";
+	SnapshotCompiler compiler;
+	compiler.load( *securityManager );
+	compiler.write( snapshotFile );
+
+	SnapshotSecurityManager snapshotManager( snapshotFile );
+	snapshotManager.openSession();
+	UserManagerPtr userManager = snapshotManager.getUserManager();
+	UserPtr user = userManager->checkCredentials( "root", "password" );
+
+	// On vérifie les résultats
+	EXPECT_EQ( snapshotManager.getUserCount(), compiler.getUserCount() );
+	EXPECT_EQ( user->getIdentifier(), securityManager->getUserManager()->getUserByLogin( "root" )->getIdentifier() );
+	EXPECT_EQ( user->isMemberOfRole( Role( 1, "admin" ) ), true );
+	EXPECT_EQ( userManager->getUsersByRole( snapshotManager.getRoleManager()->selectRoleByName( "admin" ) ).size(),
+			   securityManager->getUserManager()->getUsersByRole( securityManager->getRoleManager()->selectRoleById( 1 ) ).size() );
+	EXPECT_EQ( userManager->getUserByLogin( "BOND" )->getLogin(), "bond" );
+	EXPECT_THROW({ userManager->checkCredentials( "bond", "008" ); }, BadCredentialsException );
+	EXPECT_THROW({ userManager->insertUser( "moneypenny", "secret" ); }, SecurityManagerException );
+	snapshotManager.close();
+}
+
+TEST_F( SecurityComponent, ChangeFeed ) {
+	// On lance le scénario : un second nœud, dont le cache contient déjà l'utilisateur, voit la modification
+	securityManager->close();
+	securityManager->enableChangeFeed( chrono::hours( 1 ) );
+	securityManager->openSession();
+	SqlSecurityManager otherNode( "localhost", "SecurityComponent", "webuser", "password" );
+	otherNode.enableChangeFeed( chrono::hours( 1 ) );
+	otherNode.openSession();
+	EXPECT_EQ( otherNode.getUserManager()->getUserByLogin( "bond" )->getFirstName(), "James" );
+
+	UserPtr user = securityManager->getUserManager()->getUserByLogin( "bond" );
+	user->setFirstName( "Jimmy" );
+	securityManager->getUserManager()->updateUser( user );
+	size_t appliedCount = otherNode.pollChanges();
+	UserPtr changedUser = otherNode.getUserManager()->getUserByLogin( "bond" );
+	user->setFirstName( "James" );
+	securityManager->getUserManager()->updateUser( user );
+
+	// On vérifie les résultats
+	EXPECT_GE( appliedCount, 1u );
+	EXPECT_EQ( changedUser->getFirstName(), "Jimmy" );
+	EXPECT_EQ( otherNode.pollChanges(), 1u );
+	otherNode.close();
+}
+
+TEST_F( SecurityComponent, ChangeLoggedWithoutFeed ) {
+	// On lance le scénario : un outil d'import, sans flux de modifications, insère un utilisateur
+	SqlSecurityManager feedNode( "localhost", "SecurityComponent", "webuser", "password" );
+	feedNode.enableChangeFeed( chrono::hours( 1 ) );
+	feedNode.openSession();
+	feedNode.setPasswordHasher( PasswordHasherPtr( new Pbkdf2PasswordHasher( 1000 ) ) );
+	securityManager->setPasswordHasher( PasswordHasherPtr( new Pbkdf2PasswordHasher( 1000 ) ) );
+	UserPtr user = securityManager->getUserManager()->insertUser( "imported", "secret" );
+	size_t appliedCount = feedNode.pollChanges();
+
+	// On vérifie les résultats : le nœud qui suit le flux accepte le nouveau login
+	EXPECT_GE( appliedCount, 1u );
+	EXPECT_EQ( feedNode.getUserManager()->checkCredentials( "imported", "secret" )->getIdentifier(), user->getIdentifier() );
+	securityManager->getUserManager()->deleteUser( user );
+	feedNode.close();
+}
+
+TEST_F( SecurityComponent, OperationMetrics ) {
+	// On lance le scénario
+	UserManagerPtr userManager = securityManager->getUserManager();
+	userManager->checkCredentials( "root", "password" );
+	EXPECT_THROW({ userManager->checkCredentials( "bond", "008" ); }, BadCredentialsException );
+	securityManager->getRoleManager()->selectRoleById( 1 );
+	OperationMetrics::Snapshot metrics = securityManager->getMetrics();
+	string prometheusText = securityManager->dumpMetrics();
+
+	// On vérifie les résultats : un SELECT joint et un UPDATE par connexion
+	const OperationMetrics::OperationSnapshot * checkCredentials = metrics.findOperation( "check_credentials" );
+	ASSERT_NE( checkCredentials, nullptr );
+	EXPECT_EQ( checkCredentials->count, 2u );
+	EXPECT_EQ( checkCredentials->exceptions, 1u );
+	EXPECT_EQ( checkCredentials->queries, 4u );
+	EXPECT_GT( checkCredentials->getPercentile( 99 ).count(), 0 );
+	EXPECT_LE( checkCredentials->getPercentile( 50 ), checkCredentials->getPercentile( 99 ) );
+	EXPECT_GE( metrics.findCache( "role" )->hits, 1u );
+	EXPECT_NE( prometheusText.find( "security_operation_duration_seconds{operation=\"check_credentials\",quantile=\"0.99\"}" ), string::npos );
+	EXPECT_NE( prometheusText.find( "security_cache_hits_total{cache=\"statement\"}" ), string::npos );
+}
+
+TEST_F( SecurityComponent, SlowQueryLog ) {
+	// On lance le scénario : toutes les requêtes sont lentes et échantillonnées
+	SlowQueryLog & slowQueryLog = securityManager->getSlowQueryLog();
+	slowQueryLog.setThreshold( chrono::nanoseconds( 0 ) );
+	slowQueryLog.setSampleInterval( 1 );
+	slowQueryLog.clear();
+	securityManager->getUserManager()->checkCredentials( "bond", "007" );
+	vector<SlowQueryLog::Execution> slowExecutions = slowQueryLog.getSlowExecutions();
+	vector<SlowQueryLog::StatementStatistics> statistics = slowQueryLog.getStatementStatistics();
+	slowQueryLog.setThreshold( SlowQueryLog::DEFAULT_THRESHOLD );
+	slowQueryLog.setSampleInterval( SlowQueryLog::DEFAULT_SAMPLE_INTERVAL );
+
+	// On vérifie les résultats : le SELECT de l'utilisateur, puis l'UPDATE de la connexion
+	ASSERT_EQ( slowExecutions.size(), 2u );
+	EXPECT_EQ( slowExecutions[0].statement.find( "SELECT" ), 0u );
+	EXPECT_EQ( slowExecutions[0].boundValueCount, 1 );
+	EXPECT_EQ( slowExecutions[0].succeeded, true );
+	EXPECT_EQ( slowExecutions[1].statement.find( "UPDATE T_USERS" ), 0u );
+	EXPECT_EQ( slowExecutions[1].rowCount, 1 );
+	EXPECT_GT( slowExecutions[1].duration.count(), 0 );
+	EXPECT_EQ( statistics.size(), 2u );
+}
+
 int main( int argc, char * argv[] ) {
     testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
@@ -0,0 +1,112 @@
+/*
+ * Executor.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef API_EXECUTOR_H_
+#define API_EXECUTOR_H_
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <type_traits>
+
+#include "Common.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * The completion handler of an asynchronous call: it receives a ready future, whose get method returns
+	 * the result of the call or throws its exception.
+	 */
+	template <typename Result>
+	using Completion = std::function<void( std::future<Result> )>;
+
+
+	/**
+	 * This interface defines the service that runs the asynchronous methods of the user and role managers
+	 * (checkCredentialsAsync, selectRoleByIdAsync, ...) on threads of its own.
+	 *
+	 * @see fr.koor.security.UserManager
+	 * @see fr.koor.security.RoleManager
+	 *
+	 * @author KooR.fr
+	 */
+	class Executor {
+	public:
+		/**
+		 * Class constructor
+		 */
+		Executor() {}
+
+		/**
+		 * Class destructor
+		 */
+		virtual ~Executor() {}
+
+		/**
+		 * Copies are forbidden
+		 */
+		Executor( const Executor & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		Executor & operator=( const Executor & original ) = delete;
+
+		/**
+		 * Schedules a task.
+		 *
+		 * @param task	The task to execute.
+		 *
+		 * @throws SecurityManagerException	Thrown if the task cannot be scheduled.
+		 */
+		virtual void execute( std::function<void()> task ) = 0;
+
+		/**
+		 * Schedules a task and returns a future receiving its result.
+		 *
+		 * @param task	The task to execute.
+		 * @return A future receiving the task result (or its exception).
+		 *
+		 * @throws SecurityManagerException	Thrown if the task cannot be scheduled.
+		 */
+		template <typename Task>
+		auto submit( Task task ) -> std::future<decltype( task() )> {
+			typedef decltype( task() ) Result;
+			auto packagedTask = std::make_shared<std::packaged_task<Result()>>( std::move( task ) );
+			std::future<Result> result = packagedTask->get_future();
+			this->execute( [packagedTask] { ( *packagedTask )(); } );
+			return result;
+		}
+
+		/**
+		 * Schedules a task and calls a completion handler, on the executing thread, when it terminates. The
+		 * exceptions thrown by the handler are ignored: they must not stop the executing thread.
+		 *
+		 * @param task			The task to execute.
+		 * @param completion	The handler receiving the task result (or its exception).
+		 *
+		 * @throws SecurityManagerException	Thrown if the task cannot be scheduled.
+		 */
+		template <typename Task>
+		void submit( Task task, Completion<std::invoke_result_t<Task &>> completion ) {
+			typedef std::invoke_result_t<Task &> Result;
+			this->execute( [task, completion] {
+				std::packaged_task<Result()> packagedTask( task );
+				std::future<Result> result = packagedTask.get_future();
+				packagedTask();
+				try {
+					completion( std::move( result ) );
+				} catch ( ... ) {
+					// Nobody is left to receive it
+				}
+			} );
+		}
+	};
+
+}
+
+#endif /* API_EXECUTOR_H_ */
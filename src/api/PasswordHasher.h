@@ -0,0 +1,125 @@
+/*
+ * PasswordHasher.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef API_PASSWORDHASHER_H_
+#define API_PASSWORDHASHER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Common.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * <p>
+	 *     This interface defines the algorithm used by a UserManager to store passwords. A hasher produces
+	 *     self-describing encoded hashes: each one embeds the algorithm, its cost parameters and its salt,
+	 *     so that the cost can be raised without invalidating the passwords already stored.
+	 * </p>
+	 *
+	 * @see fr.koor.security.UserManager
+	 *
+	 * @author KooR.fr
+	 */
+	class PasswordHasher {
+	public:
+		/**
+		 * Class constructor
+		 */
+		PasswordHasher() {}
+
+		/**
+		 * Class destructor
+		 */
+		virtual ~PasswordHasher() {}
+
+		/**
+		 * Copies are forbidden
+		 */
+		PasswordHasher( const PasswordHasher & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		PasswordHasher & operator=( const PasswordHasher & original ) = delete;
+
+		/**
+		 * Computes the encoded hash of a password, with a new random salt.
+		 *
+		 * @param clearPassword		The password (in clear).
+		 * @return The encoded hash.
+		 *
+		 * @throws SecurityManagerException	Thrown if the password cannot be hashed.
+		 */
+		virtual std::string hash( const std::string & clearPassword ) const = 0;
+
+		/**
+		 * Checks a password against an encoded hash.
+		 *
+		 * @param clearPassword		The password (in clear) to check.
+		 * @param encodedPassword	The encoded hash, as produced by the hash method.
+		 * @return true if the password matches the encoded hash, false otherwise.
+		 */
+		virtual bool verify( const std::string & clearPassword, const std::string & encodedPassword ) const = 0;
+
+		/**
+		 * Checks if an encoded hash must be recomputed, because it uses another algorithm or a lower cost
+		 * than the current settings of this hasher.
+		 *
+		 * @param encodedPassword	The encoded hash.
+		 * @return true if the password should be hashed again, false otherwise.
+		 */
+		virtual bool needsRehash( const std::string & encodedPassword ) const = 0;
+
+		/**
+		 * Checks if a stored password is an encoded hash produced by this hasher, rather than a legacy
+		 * password stored in clear (which may start with any character).
+		 *
+		 * @param storedPassword	The password, as stored.
+		 * @return true if the password is a valid encoded hash, false otherwise.
+		 */
+		virtual bool isEncoded( const std::string & storedPassword ) const = 0;
+
+		/**
+		 * Computes the encoded hashes of several passwords. Hashers able to compute independent hashes
+		 * together (with SIMD instructions, for instance) override this method: it is used by the bulk
+		 * operations on the users.
+		 *
+		 * @param clearPasswords	The passwords (in clear).
+		 * @return The encoded hashes, in the order of the passwords.
+		 *
+		 * @throws SecurityManagerException	Thrown if the passwords cannot be hashed.
+		 */
+		virtual std::vector<std::string> hashBatch( const std::vector<std::string> & clearPasswords ) const {
+			std::vector<std::string> encodedPasswords;
+			encodedPasswords.reserve( clearPasswords.size() );
+			for( const std::string & clearPassword : clearPasswords ) encodedPasswords.push_back( this->hash( clearPassword ) );
+			return encodedPasswords;
+		}
+
+		/**
+		 * Checks several passwords against their encoded hashes.
+		 *
+		 * @param clearPasswords	The passwords (in clear) to check.
+		 * @param encodedPasswords	The encoded hashes, in the order of the passwords.
+		 * @return For each password, true if it matches its encoded hash, false otherwise.
+		 */
+		virtual std::vector<bool> verifyBatch( const std::vector<std::string> & clearPasswords,
+											   const std::vector<std::string> & encodedPasswords ) const {
+			std::vector<bool> results( clearPasswords.size() );
+			for( size_t i=0; i<clearPasswords.size(); i++ ) results[i] = this->verify( clearPasswords[i], encodedPasswords[i] );
+			return results;
+		}
+	};
+
+	typedef std::shared_ptr<PasswordHasher> PasswordHasherPtr;
+
+}
+
+#endif /* API_PASSWORDHASHER_H_ */
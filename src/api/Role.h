@@ -18,13 +18,15 @@ namespace fr::koor::security {
 
 	/**
 	 * This class represents the concept of role. A role is associated with a or more users
-	 * (eg the user John Doe who has an administrator role).
+	 * (eg the user John Doe who has an administrator role). A role instance is immutable: security
+	 * managers share one instance per role identifier between all their users, and renaming a role
+	 * (see RoleManager::updateRole) publishes a new instance.
 	 *
 	 * @author KooR.fr
 	 */
 	class Role {
-		uint identifier;
-		std::string roleName;
+		const uint identifier;
+		const std::string roleName;
 	public:
 
 		/**
@@ -47,46 +49,20 @@ namespace fr::koor::security {
 		 * Returns the unique identifier for this role.
 		 *
 		 * @return The unique identifier.
-		 *
-		 * @see fr.koor.security.impl.RoleImpl#setIdentifier
 		 */
 		uint getIdentifier() const {
 			return this->identifier;
 		}
 
-		/**
-		 * Changes the identifier for this user. Only classes of the <code>fr.koor.security</code> package can use this method.
-		 *
-		 * @param newIdentifier		The new identifier for this role.
-		 *
-		 * @see fr.koor.security.Role#getIdentifier
-		 */
-		void setIdentifier( uint newIdentifier ) {
-			this->identifier = newIdentifier;
-		}
-
 		/**
 		 * Returns the name of this role.
 		 *
 		 * @return Role name.
-		 *
-		 * @see fr.koor.security.impl.RoleImpl#setRoleName
 		 */
 		const std::string & getRoleName() const {
 			return this->roleName;
 		}
 
-		/**
-		 * Changes the name of this role.
-		 *
-		 * @param newRoleName	The new name of the role.
-		 *
-		 * @see fr.koor.security.Role#getRoleName
-		 */
-		void setRoleName( const std::string & newRoleName ) {
-			this->roleName = newRoleName;
-		}
-
 		/**
 		 * Compare two role instances.
 		 * @param otherRole The second role object to compare.
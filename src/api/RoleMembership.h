@@ -0,0 +1,103 @@
+/*
+ * RoleMembership.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef API_ROLEMEMBERSHIP_H_
+#define API_ROLEMEMBERSHIP_H_
+
+#include <algorithm>
+#include <bitset>
+#include <vector>
+
+#include "Common.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * <p>
+	 *     The set of the role identifiers of a user, tuned for membership checks. Role identifiers are
+	 *     allocated densely from 1: the small ones are stored in a fixed size bitset, so that a check is a
+	 *     single bit test. Larger identifiers are kept in a sorted vector and found by binary search.
+	 *     Checks never allocate.
+	 * </p>
+	 *
+	 * @see fr.koor.security.User
+	 *
+	 * @author KooR.fr
+	 */
+	class RoleMembership {
+	public:
+		/**
+		 * Identifiers below this limit are stored in the bitset.
+		 */
+		static const uint DENSE_LIMIT = 256;
+
+	private:
+		std::bitset<DENSE_LIMIT> denseRoles;
+		std::vector<uint> sparseRoles;
+
+	public:
+
+		/**
+		 * Checks if a role identifier belongs to this set.
+		 *
+		 * @param roleIdentifier	The role identifier.
+		 * @return true if the identifier belongs to this set, false otherwise.
+		 */
+		bool contains( uint roleIdentifier ) const {
+			if ( roleIdentifier < DENSE_LIMIT ) return this->denseRoles.test( roleIdentifier );
+			return std::binary_search( this->sparseRoles.begin(), this->sparseRoles.end(), roleIdentifier );
+		}
+
+		/**
+		 * Adds a role identifier to this set.
+		 *
+		 * @param roleIdentifier	The role identifier.
+		 * @return true if the identifier was added, false if it already belonged to this set.
+		 */
+		bool add( uint roleIdentifier ) {
+			if ( roleIdentifier < DENSE_LIMIT ) {
+				if ( this->denseRoles.test( roleIdentifier ) ) return false;
+				this->denseRoles.set( roleIdentifier );
+				return true;
+			}
+			auto position = std::lower_bound( this->sparseRoles.begin(), this->sparseRoles.end(), roleIdentifier );
+			if ( position != this->sparseRoles.end() && *position == roleIdentifier ) return false;
+			this->sparseRoles.insert( position, roleIdentifier );
+			return true;
+		}
+
+		/**
+		 * Removes a role identifier from this set.
+		 *
+		 * @param roleIdentifier	The role identifier.
+		 * @return true if the identifier was removed, false if it didn't belong to this set.
+		 */
+		bool remove( uint roleIdentifier ) {
+			if ( roleIdentifier < DENSE_LIMIT ) {
+				if ( ! this->denseRoles.test( roleIdentifier ) ) return false;
+				this->denseRoles.reset( roleIdentifier );
+				return true;
+			}
+			auto position = std::lower_bound( this->sparseRoles.begin(), this->sparseRoles.end(), roleIdentifier );
+			if ( position == this->sparseRoles.end() || *position != roleIdentifier ) return false;
+			this->sparseRoles.erase( position );
+			return true;
+		}
+
+		/**
+		 * Returns the number of role identifiers of this set.
+		 * @return The identifier count.
+		 */
+		size_t size() const {
+			return this->denseRoles.count() + this->sparseRoles.size();
+		}
+	};
+
+}
+
+#endif /* API_ROLEMEMBERSHIP_H_ */
@@ -8,12 +8,17 @@
 #ifndef API_SECURITYMANAGER_H_
 #define API_SECURITYMANAGER_H_
 
+#include <chrono>
+#include <functional>
+#include <future>
 #include <stdexcept>
 #include <string>
 #include <vector>
 
 #include "Common.h"
+#include "Executor.h"
 #include "Role.h"
+#include "TokenClaims.h"
 #include "User.h"
 
 
@@ -112,6 +117,52 @@ namespace fr::koor::security {
 		UserAlreadyRegisteredException( const std::string & errorMessage ) : SecurityManagerException( errorMessage ) {}
 	};
 
+	/**
+	 * This type of exceptions is thrown when a session token is malformed, forged, signed with an unknown
+	 * key or expired.
+	 *
+	 * @see fr.koor.security.SecurityManagerException
+	 *
+	 * @author KooR.fr
+	 */
+	class InvalidTokenException : public SecurityManagerException {
+	public:
+		/**
+		 * Class constructor
+		 * @param errorMessage	The exception message
+		 */
+		InvalidTokenException( const std::string & errorMessage ) : SecurityManagerException( errorMessage ) {}
+	};
+
+	/**
+	 * This type of exceptions is thrown when too many login attempts are made for the same login, or from
+	 * the same source, in a short time. The credentials are not checked.
+	 *
+	 * @see fr.koor.security.SecurityManagerException
+	 *
+	 * @author KooR.fr
+	 */
+	class RateLimitedException : public SecurityManagerException {
+		std::chrono::milliseconds retryAfter;
+
+	public:
+		/**
+		 * Class constructor
+		 * @param errorMessage	The exception message
+		 * @param retryAfter	The delay after which a new attempt will be accepted
+		 */
+		RateLimitedException( const std::string & errorMessage, std::chrono::milliseconds retryAfter )
+			: SecurityManagerException( errorMessage ), retryAfter( retryAfter ) {}
+
+		/**
+		 * Returns the delay after which a new attempt will be accepted.
+		 * @return The retry delay.
+		 */
+		std::chrono::milliseconds getRetryAfter() const {
+			return this->retryAfter;
+		}
+	};
+
 
 	/**
 	 * This interface defines the methods used to manage User instances.
@@ -155,9 +206,25 @@ namespace fr::koor::security {
 		 *
 		 * @throws AccountDisabledException  Thrown when the provided account informations there invalid.
 		 * @throws BadCredentialsException   Thrown if the identity is rejected.
+		 * @throws RateLimitedException      Thrown if too many attempts were made for this login.
 		 */
 		 virtual UserPtr checkCredentials( const std::string & userLogin, const std::string & userPassword ) = 0;
 
+		/**
+		 * Check if the pair login/password represents an autorized user, like the previous method, but the
+		 * attempts are also limited per source.
+		 *
+		 * @param userLogin     The login for the considered user.
+		 * @param userPassword  The password for the considered user.
+		 * @param source		The origin of the attempt, supplied by the caller (a client address for instance).
+		 * @return              The considered user instance.
+		 *
+		 * @throws AccountDisabledException  Thrown when the provided account informations there invalid.
+		 * @throws BadCredentialsException   Thrown if the identity is rejected.
+		 * @throws RateLimitedException      Thrown if too many attempts were made for this login or from this source.
+		 */
+		virtual UserPtr checkCredentials( const std::string & userLogin, const std::string & userPassword, const std::string & source ) = 0;
+
 		/**
 		 * Retreive the user instance that have the desired identifier.
 		 *
@@ -186,8 +253,29 @@ namespace fr::koor::security {
 		 */
 		virtual UserPtr getUserByLogin( const std::string & login ) const = 0;
 
+		/**
+		 * Receives the users visited by forEachUserInRole. Returns false to stop the visit.
+		 */
+		typedef std::function<bool( UserPtr user )> UserVisitor;
+
+		/**
+		 * Visits all the users associated to the specified role, ordered by identifier. Users are read by
+		 * pages, so that the memory used doesn't depend on the number of members of the role.
+		 *
+		 * @param role		The role that contains expected users.
+		 * @param visitor	The function called for each user. It returns false to stop the visit.
+		 * @param pageSize	The maximum number of users read at once.
+
+		 * @exception SecurityManagerException
+		 *            Thrown when the search can't finish.
+		 *
+		 * @see #getUsersByRole(RolePtr) const
+		 */
+		virtual void forEachUserInRole( RolePtr role, const UserVisitor & visitor, size_t pageSize = 500 ) const = 0;
+
 		/**
 		 * Retreive all user instances associated to the specified role.
+		 * For roles with many members, prefer forEachUserInRole.
 		 *
 		 * @param role		The role that contains expected users.
 		 * @return A list of users member of this role.
@@ -198,8 +286,16 @@ namespace fr::koor::security {
 		 * @see #checkCredentials(const std::string &,const std::string &)
 		 * @see #getUserById(uint) const
 		 * @see #getUserByLogin(const std::string &) const
+		 * @see #forEachUserInRole(RolePtr, const UserVisitor &, size_t) const
 		 */
-		virtual std::vector<UserPtr> getUsersByRole( RolePtr role ) const = 0;
+		virtual std::vector<UserPtr> getUsersByRole( RolePtr role ) const {
+			std::vector<UserPtr> users;
+			this->forEachUserInRole( role, [&users]( UserPtr user ) {
+				users.push_back( user );
+				return true;
+			} );
+			return users;
+		}
 
 		/**
 		 * Insert a new user in the security system. The new used has the specified
@@ -249,6 +345,124 @@ namespace fr::koor::security {
 		 */
 		virtual std::string encryptPassword( const std::string & clearPassword ) const = 0;
 
+		/**
+		 * Checks a password against an encoded password. The default implementation encodes the password
+		 * and compares the results: implementations using salted hashes must override it.
+		 *
+		 * @param clearPassword       A password (in clear).
+		 * @param encryptedPassword   The encoded password, as stored by this manager.
+		 * @return                    true if the password matches, false otherwise.
+		 *
+		 * @throws SecurityManagerException
+		 *         Thrown if password verification failed.
+		 */
+		virtual bool verifyPassword( const std::string & clearPassword, const std::string & encryptedPassword ) const {
+			return this->encryptPassword( clearPassword ) == encryptedPassword;
+		}
+
+		/**
+		 * Issues a signed session token for a user authenticated with checkCredentials. The token carries
+		 * the user identifier, its role identifiers and an expiry date: it can then be checked with
+		 * verifyToken instead of the credentials, without any access to the security storage.
+		 *
+		 * @param user          The authenticated user.
+		 * @param timeToLive    The validity duration of the token.
+		 * @return              The token, a URL safe string.
+		 *
+		 * @throws AccountDisabledException
+		 *         Thrown if the user account is disabled.
+		 */
+		virtual std::string issueToken( UserPtr user, std::chrono::seconds timeToLive = std::chrono::minutes( 15 ) ) = 0;
+
+		/**
+		 * Checks the signature and the expiry date of a session token, in memory. Changes made to the user
+		 * after the token was issued (roles, disabling) are not seen before the token expires.
+		 *
+		 * @param token         The token returned by issueToken.
+		 * @return              The informations carried by the token.
+		 *
+		 * @throws InvalidTokenException
+		 *         Thrown if the token is malformed, forged, signed with an unknown key or expired.
+		 */
+		virtual TokenClaims verifyToken( const std::string & token ) const = 0;
+
+		/**
+		 * Returns the executor that runs the asynchronous methods of this manager. Its threads block on the
+		 * security storage in place of the callers.
+		 *
+		 * @return The executor.
+		 */
+		virtual Executor & getExecutor() const = 0;
+
+		/**
+		 * Asynchronous version of checkCredentials.
+		 *
+		 * @param userLogin     The login for the considered user.
+		 * @param userPassword  The password for the considered user.
+		 * @param source		The origin of the attempt, or an empty string.
+		 * @return              A future receiving the considered user instance, or the rejection exception.
+		 *
+		 * @throws SecurityManagerException	Thrown if the executor cannot accept the call.
+		 */
+		std::future<UserPtr> checkCredentialsAsync( const std::string & userLogin, const std::string & userPassword, const std::string & source = "" ) {
+			return this->getExecutor().submit( [this, userLogin, userPassword, source] {
+				return this->checkCredentials( userLogin, userPassword, source );
+			} );
+		}
+
+		/**
+		 * Asynchronous version of checkCredentials, notifying a completion handler. The handler is called on
+		 * a thread of the executor.
+		 *
+		 * @param userLogin     The login for the considered user.
+		 * @param userPassword  The password for the considered user.
+		 * @param source		The origin of the attempt, or an empty string.
+		 * @param completion	The handler receiving the considered user instance, or the rejection exception.
+		 *
+		 * @throws SecurityManagerException	Thrown if the executor cannot accept the call.
+		 */
+		void checkCredentialsAsync( const std::string & userLogin, const std::string & userPassword, const std::string & source,
+									Completion<UserPtr> completion ) {
+			this->getExecutor().submit( [this, userLogin, userPassword, source] {
+				return this->checkCredentials( userLogin, userPassword, source );
+			}, completion );
+		}
+
+		/**
+		 * Asynchronous version of getUserById.
+		 */
+		std::future<UserPtr> getUserByIdAsync( uint userId ) const {
+			return this->getExecutor().submit( [this, userId] { return this->getUserById( userId ); } );
+		}
+
+		/**
+		 * Asynchronous version of getUserByLogin.
+		 */
+		std::future<UserPtr> getUserByLoginAsync( const std::string & login ) const {
+			return this->getExecutor().submit( [this, login] { return this->getUserByLogin( login ); } );
+		}
+
+		/**
+		 * Asynchronous version of insertUser.
+		 */
+		std::future<UserPtr> insertUserAsync( const std::string & login, const std::string & password ) {
+			return this->getExecutor().submit( [this, login, password] { return this->insertUser( login, password ); } );
+		}
+
+		/**
+		 * Asynchronous version of updateUser.
+		 */
+		std::future<void> updateUserAsync( UserPtr user ) {
+			return this->getExecutor().submit( [this, user] { this->updateUser( user ); } );
+		}
+
+		/**
+		 * Asynchronous version of deleteUser.
+		 */
+		std::future<void> deleteUserAsync( UserPtr user ) {
+			return this->getExecutor().submit( [this, user] { this->deleteUser( user ); } );
+		}
+
 	};
 
 	typedef std::shared_ptr<UserManager> UserManagerPtr;
@@ -322,14 +536,19 @@ namespace fr::koor::security {
 		virtual RolePtr insertRole( const std::string & roleName ) = 0;
 
 		/**
-		 * Update the informations for this role (actually, only the role name).
+		 * Renames a role. The role instances are shared and immutable: the given instance is left unchanged,
+		 * and a new instance, returned by this method, replaces it for every user.
 		 *
-		 * @param role	The role to update.
+		 * @param role			The role to rename.
+		 * @param newRoleName	The new name of the role.
+		 * @return The renamed role.
 		 *
 		 * @exception SecurityManagerException
 		 * 		Thrown if the role cannot be updated into the security system.
+		 * @exception RoleAlreadyRegisteredException
+		 * 		Thrown if another role already has the specified name.
 		 */
-		virtual void updateRole( RolePtr role ) = 0;
+		virtual RolePtr updateRole( RolePtr role, const std::string & newRoleName ) = 0;
 
 		/**
 		 * Delete, on the security system, the specified role.
@@ -340,6 +559,53 @@ namespace fr::koor::security {
 		 */
 		virtual void deleteRole( RolePtr role ) = 0;
 
+		/**
+		 * Returns the executor that runs the asynchronous methods of this manager.
+		 *
+		 * @return The executor.
+		 */
+		virtual Executor & getExecutor() const = 0;
+
+		/**
+		 * Asynchronous version of selectRoleById.
+		 *
+		 * @param roleIdentifier	The identifier of the role to returns.
+		 * @return					A future receiving the selected role, or the exception.
+		 *
+		 * @throws SecurityManagerException	Thrown if the executor cannot accept the call.
+		 */
+		std::future<RolePtr> selectRoleByIdAsync( uint roleIdentifier ) {
+			return this->getExecutor().submit( [this, roleIdentifier] { return this->selectRoleById( roleIdentifier ); } );
+		}
+
+		/**
+		 * Asynchronous version of selectRoleByName.
+		 */
+		std::future<RolePtr> selectRoleByNameAsync( const std::string & roleName ) {
+			return this->getExecutor().submit( [this, roleName] { return this->selectRoleByName( roleName ); } );
+		}
+
+		/**
+		 * Asynchronous version of insertRole.
+		 */
+		std::future<RolePtr> insertRoleAsync( const std::string & roleName ) {
+			return this->getExecutor().submit( [this, roleName] { return this->insertRole( roleName ); } );
+		}
+
+		/**
+		 * Asynchronous version of updateRole.
+		 */
+		std::future<RolePtr> updateRoleAsync( RolePtr role, const std::string & newRoleName ) {
+			return this->getExecutor().submit( [this, role, newRoleName] { return this->updateRole( role, newRoleName ); } );
+		}
+
+		/**
+		 * Asynchronous version of deleteRole.
+		 */
+		std::future<void> deleteRoleAsync( RolePtr role ) {
+			return this->getExecutor().submit( [this, role] { this->deleteRole( role ); } );
+		}
+
 	};
 
 	typedef std::shared_ptr<RoleManager> RoleManagerPtr;
@@ -0,0 +1,88 @@
+/*
+ * TokenClaims.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef API_TOKENCLAIMS_H_
+#define API_TOKENCLAIMS_H_
+
+#include <ctime>
+
+#include "Common.h"
+#include "Role.h"
+#include "RoleMembership.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * The informations carried by a session token (see UserManager::issueToken): the identifier of the
+	 * authenticated user, the identifiers of its roles and the expiry date of the token. Claims are
+	 * obtained from UserManager::verifyToken, without any access to the security storage.
+	 *
+	 * @see fr.koor.security.UserManager
+	 *
+	 * @author KooR.fr
+	 */
+	class TokenClaims {
+		uint userIdentifier;
+		time_t expiry;
+		RoleMembership roleMembership;
+
+	public:
+		/**
+		 * Class constructor.
+		 *
+		 * @param userIdentifier	The identifier of the authenticated user.
+		 * @param expiry			The date after which the token is rejected.
+		 */
+		TokenClaims( uint userIdentifier, time_t expiry ) : userIdentifier( userIdentifier ), expiry( expiry ) {}
+
+		/**
+		 * Returns the identifier of the authenticated user.
+		 * @return The user identifier.
+		 */
+		uint getUserIdentifier() const {
+			return this->userIdentifier;
+		}
+
+		/**
+		 * Returns the date after which the token is rejected.
+		 * @return The expiry date.
+		 */
+		time_t getExpiry() const {
+			return this->expiry;
+		}
+
+		/**
+		 * Returns the identifiers of the roles of the authenticated user.
+		 * @return The role identifiers.
+		 */
+		const RoleMembership & getRoleMembership() const {
+			return this->roleMembership;
+		}
+
+		/**
+		 * Adds a role to the claims.
+		 * @param roleIdentifier	The role identifier.
+		 */
+		void addRole( uint roleIdentifier ) {
+			this->roleMembership.add( roleIdentifier );
+		}
+
+		/**
+		 * Checks if the authenticated user had the specified role when the token was issued.
+		 *
+		 * @param role	The role to check.
+		 * @return true if the user is member of the role, false otherwise.
+		 */
+		bool isMemberOfRole( const Role & role ) const {
+			return this->roleMembership.contains( role.getIdentifier() );
+		}
+	};
+
+}
+
+#endif /* API_TOKENCLAIMS_H_ */
@@ -18,7 +18,7 @@ User::~User() {
 }
 
 bool User::isSamePassword( const std::string & password ) const {
-	return this->securityManager.getUserManager()->encryptPassword( password ) == this->password;
+	return this->securityManager.getUserManager()->verifyPassword( password, this->password );
 }
 
 void User::setPassword( const std::string & newPassword ) {
@@ -32,17 +32,11 @@ std::string User::getFullName() const {
 
 
 bool User::isMemberOfRole( const Role & role ) const {
-	for( RolePtr aRole : this->roles ) {
-		if ( *aRole == role ) return true;
-	}
-	return false;
+	return this->roleMembership.contains( role.getIdentifier() );
 }
 
 bool User::isMemberOfRole( RolePtr role ) const {
-	for( RolePtr aRole : this->roles ) {
-		if ( *aRole == *role ) return true;
-	}
-	return false;
+	return this->roleMembership.contains( role->getIdentifier() );
 }
 
 
@@ -52,10 +46,16 @@ const std::set<RolePtr> & User::getRoles() const {
 
 
 void User::addRole( RolePtr role ) {
-	this->roles.insert( role );
+	if ( this->roleMembership.add( role->getIdentifier() ) ) this->roles.insert( role );
 }
 
 
 void User::removeRole( RolePtr role ) {
-	this->roles.erase( role );
+	if ( ! this->roleMembership.remove( role->getIdentifier() ) ) return;
+	for( auto iterator = this->roles.begin(); iterator != this->roles.end(); ++iterator ) {
+		if ( (*iterator)->getIdentifier() == role->getIdentifier() ) {
+			this->roles.erase( iterator );
+			break;
+		}
+	}
 }
@@ -8,6 +8,7 @@
 
 #include "Common.h"
 #include "Role.h"
+#include "RoleMembership.h"
 
 
 namespace fr::koor::security {
@@ -43,6 +44,7 @@ namespace fr::koor::security {
 		uint consecutiveErrors = 0;
 		bool disabled = false;
 		std::set<RolePtr> roles;
+		RoleMembership roleMembership;
 
 		std::string firstName = "";
 		std::string lastName = "";
@@ -100,6 +102,27 @@ namespace fr::koor::security {
 		}
 
 
+		/**
+		 * Returns the encrypted password of this user, as stored in the used security system.
+		 * This method is reserved to the security manager implementations.
+		 *
+		 * @return The encrypted password.
+		 */
+		const std::string & getEncryptedPassword() const {
+			return this->password;
+		}
+
+		/**
+		 * Replaces the encrypted password of this user, without encrypting it again.
+		 * This method is reserved to the security manager implementations.
+		 *
+		 * @param encryptedPassword	The new encrypted password.
+		 */
+		void setEncryptedPassword( const std::string & encryptedPassword ) {
+			this->password = encryptedPassword;
+		}
+
+
 		/**
 		 * Check if the encrypted string (for the specified password) is the same that the encrypted password store in the used security system (certainly a relational
 		 * database).
@@ -280,13 +303,13 @@ namespace fr::koor::security {
 		const std::set<RolePtr> & getRoles() const;
 
 		/**
-		 * Adds another role to this user.
+		 * Adds another role to this user. Nothing is done if the user already has a role with the same identifier.
 		 * @param role	The new role to affect for this user.
 		 */
 		void addRole( RolePtr role );
 
 		/**
-		 * Removes a role to this user.
+		 * Removes a role to this user. The role is identified by its identifier.
 		 * @param role	The role to remove for this user.
 		 */
 		void removeRole( RolePtr role );
@@ -0,0 +1,104 @@
+/*
+ * PasswordHasherBenchmark.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <benchmark/benchmark.h>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "../impl/Pbkdf2PasswordHasher.h"
+#include "../impl/Sha256MultiBuffer.h"
+#include "../impl/WorkerPool.h"
+
+using namespace std;
+using namespace fr::koor::security;
+
+
+/**
+ * Hashes a password on each benchmark thread: the "hashes/s/core" counter is the average rate of one thread.
+ */
+static void BM_Pbkdf2Hash( benchmark::State & state ) {
+	Pbkdf2PasswordHasher hasher( (uint) state.range( 0 ) );
+	for ( auto _ : state ) {
+		benchmark::DoNotOptimize( hasher.hash( "correct horse battery staple" ) );
+	}
+	state.counters[ "hashes/s/core" ] = benchmark::Counter( (double) state.iterations(),
+			benchmark::Counter::kIsRate | benchmark::Counter::kAvgThreads );
+}
+BENCHMARK( BM_Pbkdf2Hash )->Arg( 10000 )->Arg( Pbkdf2PasswordHasher::DEFAULT_ITERATIONS )
+		->ThreadRange( 1, max( 1u, thread::hardware_concurrency() ) )->UseRealTime();
+
+/**
+ * Verifies a password (the login path) on each benchmark thread.
+ */
+static void BM_Pbkdf2Verify( benchmark::State & state ) {
+	Pbkdf2PasswordHasher hasher( (uint) state.range( 0 ) );
+	string encodedPassword = hasher.hash( "correct horse battery staple" );
+	for ( auto _ : state ) {
+		benchmark::DoNotOptimize( hasher.verify( "correct horse battery staple", encodedPassword ) );
+	}
+	state.counters[ "hashes/s/core" ] = benchmark::Counter( (double) state.iterations(),
+			benchmark::Counter::kIsRate | benchmark::Counter::kAvgThreads );
+}
+BENCHMARK( BM_Pbkdf2Verify )->Arg( Pbkdf2PasswordHasher::DEFAULT_ITERATIONS )->UseRealTime();
+
+/**
+ * Submits batches of hashes to a hashing pool of the given size, as the security manager does.
+ */
+static void BM_HashingPool( benchmark::State & state ) {
+	const uint threadCount = (uint) state.range( 0 );
+	const size_t batchSize = 4 * threadCount;
+	Pbkdf2PasswordHasher hasher( 10000 );
+	WorkerPool pool( "Benchmark hashing pool", threadCount, batchSize );
+
+	for ( auto _ : state ) {
+		vector<future<string>> results;
+		results.reserve( batchSize );
+		for( size_t i=0; i<batchSize; i++ ) {
+			results.push_back( pool.submit( [&hasher] { return hasher.hash( "correct horse battery staple" ); } ) );
+		}
+		for( auto & result : results ) benchmark::DoNotOptimize( result.get() );
+	}
+	state.counters[ "hashes/s/core" ] = benchmark::Counter( (double) ( state.iterations() * batchSize ) / threadCount,
+			benchmark::Counter::kIsRate );
+}
+BENCHMARK( BM_HashingPool )->RangeMultiplier( 2 )->Range( 1, max( 1u, thread::hardware_concurrency() ) )
+		->UseRealTime()->Unit( benchmark::kMillisecond );
+
+/**
+ * Derives a batch of 64 keys with the multi-buffer kernel of the given lane count (1 for the scalar code).
+ */
+static void BM_Pbkdf2MultiBuffer( benchmark::State & state ) {
+	const size_t laneCount = (size_t) state.range( 0 );
+	if ( laneCount > 1 && laneCount > Sha256MultiBuffer::getLaneCount() ) {
+		state.SkipWithError( "Kernel not supported by this processor" );
+		return;
+	}
+	vector<Pbkdf2Input> inputs( 64, Pbkdf2Input { "correct horse battery staple", Pbkdf2PasswordHasher::generateSalt(), 10000 } );
+	for ( auto _ : state ) {
+		benchmark::DoNotOptimize( Sha256MultiBuffer::pbkdf2HmacSha256( inputs, Pbkdf2PasswordHasher::HASH_LENGTH, laneCount ) );
+	}
+	state.counters[ "hashes/s/core" ] = benchmark::Counter( (double) ( state.iterations() * inputs.size() ),
+			benchmark::Counter::kIsRate );
+}
+BENCHMARK( BM_Pbkdf2MultiBuffer )->Arg( 1 )->Arg( 4 )->Arg( 8 )->Arg( 16 )->UseRealTime()->Unit( benchmark::kMillisecond );
+
+/**
+ * Hashes a batch of 64 passwords, as the bulk re-hash does on each hashing thread.
+ */
+static void BM_Pbkdf2HashBatch( benchmark::State & state ) {
+	Pbkdf2PasswordHasher hasher( Pbkdf2PasswordHasher::DEFAULT_ITERATIONS );
+	vector<string> clearPasswords( 64, "correct horse battery staple" );
+	for ( auto _ : state ) {
+		benchmark::DoNotOptimize( hasher.hashBatch( clearPasswords ) );
+	}
+	state.counters[ "hashes/s/core" ] = benchmark::Counter( (double) ( state.iterations() * clearPasswords.size() ),
+			benchmark::Counter::kIsRate );
+}
+BENCHMARK( BM_Pbkdf2HashBatch )->UseRealTime()->Unit( benchmark::kMillisecond );
+
+BENCHMARK_MAIN();
@@ -0,0 +1,291 @@
+/*
+ * SecurityComponentBenchmark.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string>
+
+#include <QtSql/QSqlQuery>
+
+#include "../api/RoleMembership.h"
+#include "../impl/Pbkdf2PasswordHasher.h"
+#include "../impl/SqlSecurityManager.h"
+
+using namespace std;
+using namespace fr::koor::security;
+
+
+//--------------------------------------------------------------------------------------------
+//--- Allocation accounting ------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+static atomic<unsigned long long> allocationCount { 0 };
+
+void * operator new( size_t size ) {
+	allocationCount.fetch_add( 1, memory_order_relaxed );
+	void * pointer = malloc( size == 0 ? 1 : size );
+	if ( pointer == nullptr ) throw bad_alloc();
+	return pointer;
+}
+
+void operator delete( void * pointer ) noexcept {
+	free( pointer );
+}
+
+void operator delete( void * pointer, size_t size ) noexcept {
+	free( pointer );
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- Utility functions ----------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+static const string BENCHMARK_LOGIN = "bench-login";
+static const string BENCHMARK_PASSWORD = "bench-secret";
+
+static unique_ptr<SqlSecurityManager> securityManager;
+static string openError;
+
+static string environment( const char * name, const char * defaultValue ) {
+	const char * value = getenv( name );
+	return value != nullptr ? value : defaultValue;
+}
+
+static void deleteBenchmarkUsers( SqlSecurityManager & securityManager ) {
+	PooledConnection connection = securityManager.getConnectionPool().acquire();
+	QSqlQuery query( connection.database() );
+	query.exec( "DELETE FROM T_USER_ROLES WHERE IdUser IN (SELECT IdUser FROM T_USERS WHERE Login LIKE 'bench-%')" );
+	query.exec( "DELETE FROM T_USERS WHERE Login LIKE 'bench-%'" );
+}
+
+/**
+ * Returns the security manager shared by the benchmarks, opened on the database described by the
+ * SECURITY_DB_HOST, SECURITY_DB_NAME, SECURITY_DB_USER and SECURITY_DB_PASSWORD variables, with a
+ * dedicated user. Rate limits are lifted: the same login is checked millions of times.
+ */
+static SqlSecurityManager * getSecurityManager( benchmark::State & state ) {
+	if ( ! securityManager && openError.empty() ) {
+		try {
+			unique_ptr<SqlSecurityManager> manager( new SqlSecurityManager(
+					environment( "SECURITY_DB_HOST", "localhost" ), environment( "SECURITY_DB_NAME", "SecurityComponent" ),
+					environment( "SECURITY_DB_USER", "webuser" ), environment( "SECURITY_DB_PASSWORD", "password" ) ) );
+			manager->openSession();
+			manager->getLoginRateLimiter().setLimit( 1000000000, chrono::milliseconds( 1 ) );
+			deleteBenchmarkUsers( *manager );
+			manager->getUserManager()->insertUser( BENCHMARK_LOGIN, BENCHMARK_PASSWORD );
+			securityManager = move( manager );
+		} catch ( const exception & exception ) {
+			openError = exception.what();
+		}
+	}
+	if ( ! securityManager ) state.SkipWithError( openError.c_str() );
+	return securityManager.get();
+}
+
+/**
+ * Stores the password of the benchmark user with the given PBKDF2 iteration count, so that logins don't
+ * rehash it.
+ */
+static void setIterations( SqlSecurityManager & securityManager, uint iterations ) {
+	securityManager.setPasswordHasher( PasswordHasherPtr( new Pbkdf2PasswordHasher( iterations ) ) );
+	UserManagerPtr userManager = securityManager.getUserManager();
+	UserPtr user = userManager->getUserByLogin( BENCHMARK_LOGIN );
+	user->setEncryptedPassword( userManager->encryptPassword( BENCHMARK_PASSWORD ) );
+	user->setConsecutiveErrors( 0 );
+	user->setDisabled( false );
+	userManager->updateUser( user );
+}
+
+/**
+ * Measures the allocations and the SQL statements of the timed loop of a benchmark, reported per
+ * operation by the allocs/op and queries/op counters.
+ */
+class OperationCounters {
+	benchmark::State & state;
+	const SqlSecurityManager * securityManager;
+	unsigned long long allocationStart;
+	unsigned long long queryStart;
+
+public:
+	OperationCounters( benchmark::State & state, const SqlSecurityManager * securityManager = nullptr )
+		: state( state ), securityManager( securityManager ),
+		  allocationStart( allocationCount.load() ),
+		  queryStart( securityManager != nullptr ? securityManager->getExecutedQueryCount() : 0 ) {
+	}
+
+	~OperationCounters() {
+		double iterations = (double) max( (size_t) 1, (size_t) this->state.iterations() );
+		this->state.counters[ "allocs/op" ] = ( allocationCount.load() - this->allocationStart ) / iterations;
+		if ( this->securityManager != nullptr ) {
+			this->state.counters[ "queries/op" ] = ( this->securityManager->getExecutedQueryCount() - this->queryStart ) / iterations;
+		}
+	}
+};
+
+
+//--------------------------------------------------------------------------------------------
+//--- Benchmarks -----------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+/**
+ * A successful login, with the given PBKDF2 iteration count: a low count shows the cost of everything but
+ * the hash.
+ */
+static void BM_CheckCredentialsSuccess( benchmark::State & state ) {
+	SqlSecurityManager * securityManager = getSecurityManager( state );
+	if ( securityManager == nullptr ) return;
+	setIterations( *securityManager, (uint) state.range( 0 ) );
+	UserManagerPtr userManager = securityManager->getUserManager();
+
+	{
+		OperationCounters counters( state, securityManager );
+		for ( auto _ : state ) {
+			benchmark::DoNotOptimize( userManager->checkCredentials( BENCHMARK_LOGIN, BENCHMARK_PASSWORD ) );
+		}
+	}
+}
+BENCHMARK( BM_CheckCredentialsSuccess )->Arg( 1000 )->Arg( Pbkdf2PasswordHasher::DEFAULT_ITERATIONS )->Unit( benchmark::kMicrosecond );
+
+/**
+ * A rejected login: a wrong password for the benchmark user (argument 0) or an unknown login (argument 1).
+ */
+static void BM_CheckCredentialsFailure( benchmark::State & state ) {
+	SqlSecurityManager * securityManager = getSecurityManager( state );
+	if ( securityManager == nullptr ) return;
+	setIterations( *securityManager, 1000 );
+	UserManagerPtr userManager = securityManager->getUserManager();
+	const string login = state.range( 0 ) == 0 ? BENCHMARK_LOGIN : "bench-unknown";
+
+	{
+		OperationCounters counters( state, securityManager );
+		for ( auto _ : state ) {
+			try {
+				userManager->checkCredentials( login, "wrong password" );
+			} catch ( const SecurityManagerException & exception ) {
+				benchmark::DoNotOptimize( exception.what() );
+			}
+		}
+	}
+	setIterations( *securityManager, 1000 );
+}
+BENCHMARK( BM_CheckCredentialsFailure )->Arg( 0 )->Arg( 1 )->Unit( benchmark::kMicrosecond );
+
+static void BM_SelectRoleById( benchmark::State & state ) {
+	SqlSecurityManager * securityManager = getSecurityManager( state );
+	if ( securityManager == nullptr ) return;
+	RoleManagerPtr roleManager = securityManager->getRoleManager();
+
+	OperationCounters counters( state, securityManager );
+	for ( auto _ : state ) {
+		benchmark::DoNotOptimize( roleManager->selectRoleById( 1 ) );
+	}
+}
+BENCHMARK( BM_SelectRoleById );
+
+static void BM_SelectRoleByName( benchmark::State & state ) {
+	SqlSecurityManager * securityManager = getSecurityManager( state );
+	if ( securityManager == nullptr ) return;
+	RoleManagerPtr roleManager = securityManager->getRoleManager();
+	const string roleName = "admin";
+
+	OperationCounters counters( state, securityManager );
+	for ( auto _ : state ) {
+		benchmark::DoNotOptimize( roleManager->selectRoleByName( roleName ) );
+	}
+}
+BENCHMARK( BM_SelectRoleByName );
+
+/**
+ * Membership checks of a user with the given number of roles, with small identifiers (second argument 0)
+ * or identifiers beyond the membership bitmap (second argument 1). Half of the checked roles are granted.
+ */
+static void BM_IsMemberOfRole( benchmark::State & state ) {
+	SqlSecurityManager * securityManager = getSecurityManager( state );
+	if ( securityManager == nullptr ) return;
+	const uint roleCount = (uint) state.range( 0 );
+	const uint firstIdentifier = state.range( 1 ) == 0 ? 1 : RoleMembership::DENSE_LIMIT;
+
+	User user( *securityManager, 1, "bench-member", "" );
+	vector<Role> checkedRoles;
+	for( uint i=0; i<roleCount; i++ ) {
+		uint identifier = firstIdentifier + 2 * i;
+		user.addRole( RolePtr( new Role( identifier, "bench-role-" + to_string( identifier ) ) ) );
+		checkedRoles.push_back( Role( identifier, "" ) );
+		checkedRoles.push_back( Role( identifier + 1, "" ) );
+	}
+
+	OperationCounters counters( state );
+	size_t position = 0;
+	for ( auto _ : state ) {
+		benchmark::DoNotOptimize( user.isMemberOfRole( checkedRoles[ position ] ) );
+		if ( ++position == checkedRoles.size() ) position = 0;
+	}
+}
+BENCHMARK( BM_IsMemberOfRole )->ArgsProduct( { { 1, 8, 64, 512 }, { 0, 1 } } );
+
+static void BM_EncryptPassword( benchmark::State & state ) {
+	SqlSecurityManager * securityManager = getSecurityManager( state );
+	if ( securityManager == nullptr ) return;
+	securityManager->setPasswordHasher( PasswordHasherPtr( new Pbkdf2PasswordHasher( (uint) state.range( 0 ) ) ) );
+	UserManagerPtr userManager = securityManager->getUserManager();
+
+	OperationCounters counters( state, securityManager );
+	for ( auto _ : state ) {
+		benchmark::DoNotOptimize( userManager->encryptPassword( BENCHMARK_PASSWORD ) );
+	}
+}
+BENCHMARK( BM_EncryptPassword )->Arg( 1000 )->Arg( Pbkdf2PasswordHasher::DEFAULT_ITERATIONS )->Unit( benchmark::kMicrosecond );
+
+/**
+ * Builds and destroys a user with the given number of roles, as done for each user read from the database.
+ */
+static void BM_UserConstruction( benchmark::State & state ) {
+	SqlSecurityManager * securityManager = getSecurityManager( state );
+	if ( securityManager == nullptr ) return;
+	vector<RolePtr> roles;
+	for( int i=0; i<state.range( 0 ); i++ ) roles.push_back( RolePtr( new Role( i + 1, "bench-role-" + to_string( i + 1 ) ) ) );
+	const string password = "$pbkdf2-sha256$i=310000$c2FsdHNhbHRzYWx0c2FsdA$aGFzaGhhc2hoYXNoaGFzaGhhc2hoYXNoaGFzaGhhc2g";
+
+	OperationCounters counters( state );
+	for ( auto _ : state ) {
+		User user( *securityManager, 1, BENCHMARK_LOGIN, password );
+		for( const RolePtr & role : roles ) user.addRole( role );
+		benchmark::DoNotOptimize( user );
+	}
+}
+BENCHMARK( BM_UserConstruction )->Arg( 0 )->Arg( 4 )->Arg( 32 );
+
+static void BM_VerifyToken( benchmark::State & state ) {
+	SqlSecurityManager * securityManager = getSecurityManager( state );
+	if ( securityManager == nullptr ) return;
+	UserManagerPtr userManager = securityManager->getUserManager();
+	string token = userManager->issueToken( userManager->getUserByLogin( BENCHMARK_LOGIN ) );
+
+	OperationCounters counters( state, securityManager );
+	for ( auto _ : state ) {
+		benchmark::DoNotOptimize( userManager->verifyToken( token ) );
+	}
+}
+BENCHMARK( BM_VerifyToken );
+
+
+int main( int argc, char * argv[] ) {
+	benchmark::Initialize( &argc, argv );
+	if ( benchmark::ReportUnrecognizedArguments( argc, argv ) ) return 1;
+	benchmark::RunSpecifiedBenchmarks();
+
+	if ( securityManager ) {
+		deleteBenchmarkUsers( *securityManager );
+		securityManager->close();
+		securityManager.reset();
+	}
+	return 0;
+}
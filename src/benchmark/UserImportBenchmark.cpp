@@ -0,0 +1,80 @@
+/*
+ * UserImportBenchmark.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+#include <QtSql/QSqlQuery>
+
+#include "../impl/Pbkdf2PasswordHasher.h"
+#include "../impl/SqlSecurityManager.h"
+#include "../impl/UserImporter.h"
+
+using namespace std;
+using namespace fr::koor::security;
+
+
+static string environment( const char * name, const char * defaultValue ) {
+	const char * value = getenv( name );
+	return value != nullptr ? value : defaultValue;
+}
+
+static void deleteBenchmarkUsers( SqlSecurityManager & securityManager ) {
+	PooledConnection connection = securityManager.getConnectionPool().acquire();
+	QSqlQuery query( connection.database() );
+	query.exec( "DELETE FROM T_USER_ROLES WHERE IdUser IN (SELECT IdUser FROM T_USERS WHERE Login LIKE 'bench-%')" );
+	query.exec( "DELETE FROM T_USERS WHERE Login LIKE 'bench-%'" );
+}
+
+/**
+ * Imports 10000 generated users, in batches of the given size, into the database described by the
+ * SECURITY_DB_HOST, SECURITY_DB_NAME, SECURITY_DB_USER and SECURITY_DB_PASSWORD variables. The second
+ * argument is the PBKDF2 iteration count: a low count measures the database writes, the default count
+ * measures the whole pipeline.
+ */
+static void BM_ImportUsers( benchmark::State & state ) {
+	const size_t userCount = 10000;
+	const size_t batchSize = (size_t) state.range( 0 );
+
+	// The CSV is generated once: only the import is measured
+	ostringstream csv;
+	csv << "login,password,firstName,lastName,email,roles\n";
+	for( size_t i=0; i<userCount; i++ ) {
+		csv << "bench-" << i << ",secret" << i << ",First" << i << ",Last" << i << ",bench" << i << "@koor.fr,admin\n";
+	}
+	const string content = csv.str();
+
+	try {
+		SqlSecurityManager securityManager( environment( "SECURITY_DB_HOST", "localhost" ), environment( "SECURITY_DB_NAME", "SecurityComponent" ),
+											environment( "SECURITY_DB_USER", "webuser" ), environment( "SECURITY_DB_PASSWORD", "password" ) );
+		securityManager.openSession();
+		securityManager.setPasswordHasher( PasswordHasherPtr( new Pbkdf2PasswordHasher( (uint) state.range( 1 ) ) ) );
+		deleteBenchmarkUsers( securityManager );
+
+		for ( auto _ : state ) {
+			istringstream input( content );
+			UserImporter importer( securityManager, batchSize );
+			const UserImporter::Progress & progress = importer.importCsv( input );
+			if ( progress.importedCount != userCount ) state.SkipWithError( "Some users were rejected" );
+
+			state.PauseTiming();
+			deleteBenchmarkUsers( securityManager );
+			state.ResumeTiming();
+		}
+		state.counters[ "users/s" ] = benchmark::Counter( (double) ( state.iterations() * userCount ), benchmark::Counter::kIsRate );
+
+		securityManager.close();
+	} catch ( const exception & exception ) {
+		state.SkipWithError( exception.what() );
+	}
+}
+BENCHMARK( BM_ImportUsers )->Args( { 100, 1000 } )->Args( { 1000, 1000 } )->Args( { 5000, 1000 } )
+		->Args( { 1000, Pbkdf2PasswordHasher::DEFAULT_ITERATIONS } )->Iterations( 1 )->Unit( benchmark::kMillisecond )->UseRealTime();
+
+BENCHMARK_MAIN();
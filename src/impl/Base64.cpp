@@ -0,0 +1,77 @@
+/*
+ * Base64.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include "Base64.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+static const char STANDARD_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char URL_SAFE_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+/**
+ * Returns the 6 bits value of a Base64 character (both alphabets are accepted), or -1 if it's invalid.
+ */
+static int decodeCharacter( char character ) {
+	if ( character >= 'A' && character <= 'Z' ) return character - 'A';
+	if ( character >= 'a' && character <= 'z' ) return character - 'a' + 26;
+	if ( character >= '0' && character <= '9' ) return character - '0' + 52;
+	if ( character == '+' || character == '-' ) return 62;
+	if ( character == '/' || character == '_' ) return 63;
+	return -1;
+}
+
+std::string Base64::encode( const void * data, size_t length, bool urlSafe ) {
+	const uint8_t * bytes = (const uint8_t *) data;
+	const char * alphabet = urlSafe ? URL_SAFE_ALPHABET : STANDARD_ALPHABET;
+
+	string result;
+	result.reserve( ( length + 2 ) / 3 * 4 );
+	size_t i = 0;
+	for( ; i + 3 <= length; i += 3 ) {
+		uint32_t value = ( bytes[i] << 16 ) | ( bytes[i+1] << 8 ) | bytes[i+2];
+		result += alphabet[ ( value >> 18 ) & 0x3f ];
+		result += alphabet[ ( value >> 12 ) & 0x3f ];
+		result += alphabet[ ( value >> 6 ) & 0x3f ];
+		result += alphabet[ value & 0x3f ];
+	}
+
+	size_t remaining = length - i;
+	if ( remaining > 0 ) {
+		uint32_t value = bytes[i] << 16;
+		if ( remaining == 2 ) value |= bytes[i+1] << 8;
+		result += alphabet[ ( value >> 18 ) & 0x3f ];
+		result += alphabet[ ( value >> 12 ) & 0x3f ];
+		if ( remaining == 2 ) result += alphabet[ ( value >> 6 ) & 0x3f ];
+		if ( ! urlSafe ) result.append( 3 - remaining, '=' );
+	}
+	return result;
+}
+
+bool Base64::decode( const std::string & text, std::vector<uint8_t> & data ) {
+	size_t length = text.size();
+	while ( length > 0 && text[ length - 1 ] == '=' ) length--;
+	if ( length % 4 == 1 ) return false;
+
+	data.clear();
+	data.reserve( length * 3 / 4 );
+	uint32_t buffer = 0;
+	int bits = 0;
+	for( size_t i=0; i<length; i++ ) {
+		int value = decodeCharacter( text[i] );
+		if ( value < 0 ) return false;
+		buffer = ( buffer << 6 ) | value;
+		bits += 6;
+		if ( bits >= 8 ) {
+			bits -= 8;
+			data.push_back( (uint8_t) ( buffer >> bits ) );
+		}
+	}
+	return true;
+}
@@ -0,0 +1,59 @@
+/*
+ * Base64.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_BASE64_H_
+#define IMPL_BASE64_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+namespace fr::koor::security {
+
+	/**
+	 * Base64 encoding (RFC 4648), used to store binary values (salts, hashes, signatures) in text form.
+	 *
+	 * @author KooR.fr
+	 */
+	class Base64 {
+	public:
+		/**
+		 * Encodes binary data.
+		 *
+		 * @param data		The data to encode.
+		 * @param length	The data length, in bytes.
+		 * @param urlSafe	true for the URL and filename safe alphabet, without padding; false for the standard one.
+		 * @return The encoded string.
+		 */
+		static std::string encode( const void * data, size_t length, bool urlSafe = false );
+
+		/**
+		 * Encodes binary data.
+		 *
+		 * @param data		The data to encode.
+		 * @param urlSafe	true for the URL and filename safe alphabet, without padding; false for the standard one.
+		 * @return The encoded string.
+		 */
+		static std::string encode( const std::vector<uint8_t> & data, bool urlSafe = false ) {
+			return encode( data.data(), data.size(), urlSafe );
+		}
+
+		/**
+		 * Decodes a string encoded with either alphabet. Padding is optional.
+		 *
+		 * @param text		The encoded string.
+		 * @param data		Receives the decoded data.
+		 * @return true if the string is valid Base64, false otherwise.
+		 */
+		static bool decode( const std::string & text, std::vector<uint8_t> & data );
+	};
+
+}
+
+#endif /* IMPL_BASE64_H_ */
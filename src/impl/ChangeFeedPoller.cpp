@@ -0,0 +1,90 @@
+/*
+ * ChangeFeedPoller.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <limits>
+
+#include "ChangeFeedPoller.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+ChangeFeedPoller::ChangeFeedPoller( ChangeReader changeReader, ChangeHandler changeHandler, ThreadExitHandler threadExitHandler,
+									unsigned long long initialVersion, std::chrono::milliseconds pollInterval,
+									std::chrono::milliseconds gapTimeout, size_t batchSize ) :
+		changeReader(changeReader), changeHandler(changeHandler), threadExitHandler(threadExitHandler),
+		pollInterval(pollInterval), gapTimeout(gapTimeout), batchSize( batchSize == 0 ? 1 : batchSize ),
+		appliedVersion(initialVersion), stalledVersion( numeric_limits<unsigned long long>::max() ) {
+	this->pollThread = thread( &ChangeFeedPoller::run, this );
+}
+
+ChangeFeedPoller::~ChangeFeedPoller() {
+	{
+		lock_guard<mutex> lock( this->threadMutex );
+		this->stopping = true;
+	}
+	this->stopRequested.notify_all();
+	this->pollThread.join();
+}
+
+size_t ChangeFeedPoller::poll() {
+	lock_guard<mutex> lock( this->pollMutex );
+	Changes changes = this->changeReader( this->appliedVersion, this->batchSize );
+
+	// The changes following a gap are read again until the gap is closed: they are applied once
+	Changes newChanges;
+	for( const Change & change : changes ) {
+		if ( change.version > this->appliedVersion && this->appliedAhead.count( change.version ) == 0 ) newChanges.push_back( change );
+	}
+	if ( ! newChanges.empty() ) this->changeHandler( newChanges );
+
+	chrono::steady_clock::time_point now = chrono::steady_clock::now();
+	for( const Change & change : changes ) {
+		if ( change.version <= this->appliedVersion ) continue;
+		if ( change.version != this->appliedVersion + 1 ) {
+			// A change not yet committed, or rolled back
+			if ( this->stalledVersion != this->appliedVersion ) {
+				this->stalledVersion = this->appliedVersion;
+				this->stalledSince = now;
+			}
+			if ( now - this->stalledSince < this->gapTimeout ) break;
+		}
+		this->appliedVersion = change.version;
+	}
+
+	for( const Change & change : changes ) {
+		if ( change.version > this->appliedVersion ) this->appliedAhead.insert( change.version );
+	}
+	this->appliedAhead.erase( this->appliedAhead.begin(), this->appliedAhead.upper_bound( this->appliedVersion ) );
+	return newChanges.size();
+}
+
+unsigned long long ChangeFeedPoller::getAppliedVersion() {
+	lock_guard<mutex> lock( this->pollMutex );
+	return this->appliedVersion;
+}
+
+void ChangeFeedPoller::run() {
+	unique_lock<mutex> lock( this->threadMutex );
+	while ( ! this->stopping ) {
+		this->stopRequested.wait_for( lock, this->pollInterval, [this] { return this->stopping; } );
+		if ( this->stopping ) break;
+
+		lock.unlock();
+		try {
+			// A full batch means that the feed is late: the next one is read at once
+			while ( this->poll() == this->batchSize ) {}
+		} catch ( ... ) {
+			// The changes are read again by the next poll
+		}
+		lock.lock();
+	}
+	lock.unlock();
+
+	if ( this->threadExitHandler ) this->threadExitHandler();
+}
@@ -0,0 +1,161 @@
+/*
+ * ChangeFeedPoller.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_CHANGEFEEDPOLLER_H_
+#define IMPL_CHANGEFEEDPOLLER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "../api/Common.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * <p>
+	 *     Follows a change log: a table where every change of a user or a role appends a row, numbered by a
+	 *     monotonically increasing version. A background thread reads, every poll interval, the changes following
+	 *     the last applied version and hands them to a handler (the SQL security manager invalidates or reloads
+	 *     the corresponding cache entries). Only the deltas are read: the caches stay fresh within the poll
+	 *     interval at the cost of one indexed query.
+	 * </p>
+	 * <p>
+	 *     Versions are allocated when a change is written, not when it is committed: a version may be read
+	 *     after a greater one (a longer transaction), or never (a rolled back one). The changes following
+	 *     such a gap are applied at once, but the applied version stays before the gap, so that the missing
+	 *     change is read as soon as it is committed. A gap older than the gap timeout is considered rolled back
+	 *     and skipped.
+	 * </p>
+	 * <p>
+	 *     If the reader or the handler fails, the changes are read again by the next poll.
+	 * </p>
+	 *
+	 * @author KooR.fr
+	 */
+	class ChangeFeedPoller {
+	public:
+		/**
+		 * The kind of the changed entities.
+		 */
+		enum EntityType : char {
+			USER = 'U',
+			ROLE = 'R'
+		};
+
+		/**
+		 * A row of the change log.
+		 */
+		struct Change {
+			unsigned long long version;
+			char entityType;
+			uint entityId;
+		};
+
+		typedef std::vector<Change> Changes;
+
+		/**
+		 * Reads, sorted by version, at most limit changes following a version. Must throw an exception if the
+		 * change log cannot be read.
+		 */
+		typedef std::function<Changes( unsigned long long afterVersion, size_t limit )> ChangeReader;
+
+		/**
+		 * Applies a batch of changes. Must throw an exception if they cannot be applied.
+		 */
+		typedef std::function<void( const Changes & )> ChangeHandler;
+
+		/**
+		 * Called by the background thread just before it terminates (to release its database connection).
+		 */
+		typedef std::function<void()> ThreadExitHandler;
+
+		/**
+		 * The default maximum number of changes read by a poll.
+		 */
+		static const size_t DEFAULT_BATCH_SIZE = 1000;
+
+	private:
+		ChangeReader changeReader;
+		ChangeHandler changeHandler;
+		ThreadExitHandler threadExitHandler;
+		std::chrono::milliseconds pollInterval;
+		std::chrono::milliseconds gapTimeout;
+		size_t batchSize;
+
+		std::mutex pollMutex;						// Serializes the polls
+		unsigned long long appliedVersion;			// Every change up to this version is applied
+		std::set<unsigned long long> appliedAhead;	// The applied changes following a gap
+		unsigned long long stalledVersion;
+		std::chrono::steady_clock::time_point stalledSince;
+
+		std::mutex threadMutex;
+		std::condition_variable stopRequested;
+		bool stopping = false;
+		std::thread pollThread;
+
+	public:
+		/**
+		 * Class constructor: starts the background poll thread.
+		 *
+		 * @param changeReader		The handler that reads the change log.
+		 * @param changeHandler		The handler that applies the changes.
+		 * @param threadExitHandler	The handler called when the background thread terminates.
+		 * @param initialVersion	The last version already reflected by the caches.
+		 * @param pollInterval		The delay between two polls.
+		 * @param gapTimeout		The delay after which a missing version is considered rolled back.
+		 * @param batchSize			The maximum number of changes read by a poll.
+		 */
+		ChangeFeedPoller( ChangeReader changeReader, ChangeHandler changeHandler, ThreadExitHandler threadExitHandler,
+						  unsigned long long initialVersion, std::chrono::milliseconds pollInterval,
+						  std::chrono::milliseconds gapTimeout = std::chrono::seconds( 30 ), size_t batchSize = DEFAULT_BATCH_SIZE );
+
+		/**
+		 * Class destructor: stops the background thread.
+		 */
+		~ChangeFeedPoller();
+
+		/**
+		 * Copies are forbidden
+		 */
+		ChangeFeedPoller( const ChangeFeedPoller & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		ChangeFeedPoller & operator=( const ChangeFeedPoller & original ) = delete;
+
+		/**
+		 * Synchronously reads and applies the next changes.
+		 *
+		 * @return The number of applied changes.
+		 *
+		 * @throws std::exception	Thrown by the handlers if the changes cannot be read or applied.
+		 */
+		size_t poll();
+
+		/**
+		 * Returns the version up to which every change is applied.
+		 * @return The applied version.
+		 */
+		unsigned long long getAppliedVersion();
+
+	private:
+
+		/**
+		 * The background thread main loop.
+		 */
+		void run();
+	};
+
+}
+
+#endif /* IMPL_CHANGEFEEDPOLLER_H_ */
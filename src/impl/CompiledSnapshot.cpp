@@ -0,0 +1,184 @@
+/*
+ * CompiledSnapshot.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <QtCore/QString>
+
+#include "../api/SecurityManager.h"
+#include "CompiledSnapshot.h"
+#include "LoginFolding.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+//--------------------------------------------------------------------------------------------
+//--- Utility functions ----------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+static_assert( sizeof( CompiledSnapshot::RoleRecord ) == 16, "RoleRecord must have a fixed width" );
+static_assert( sizeof( CompiledSnapshot::UserRecord ) == 80, "UserRecord must have a fixed width" );
+static_assert( sizeof( CompiledSnapshot::RoleMember ) == 8, "RoleMember must have a fixed width" );
+static_assert( sizeof( CompiledSnapshot::Header ) == 120, "Header must have a fixed width" );
+
+/**
+ * Checks that a section of count records lies in the file and is aligned.
+ */
+static bool isValidSection( uint64_t offset, uint64_t count, size_t recordSize, uint64_t fileSize ) {
+	return offset % 8 == 0 && offset <= fileSize && count <= ( fileSize - offset ) / recordSize;
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- CompiledSnapshot implementation --------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+CompiledSnapshot::CompiledSnapshot( const std::string & fileName, bool verifyChecksum ) {
+	int fileDescriptor = open( fileName.c_str(), O_RDONLY | O_CLOEXEC );
+	if ( fileDescriptor < 0 ) throw SecurityManagerException( "Cannot open the snapshot " + fileName + ": " + strerror( errno ) );
+
+	struct stat fileStatus;
+	if ( fstat( fileDescriptor, &fileStatus ) != 0 || (size_t) fileStatus.st_size < sizeof( Header ) ) {
+		::close( fileDescriptor );
+		throw SecurityManagerException( "The file " + fileName + " isn't a compiled snapshot" );
+	}
+	this->size = (size_t) fileStatus.st_size;
+	void * mapping = mmap( nullptr, this->size, PROT_READ, MAP_SHARED, fileDescriptor, 0 );
+	::close( fileDescriptor );			// The mapping keeps the file open
+	if ( mapping == MAP_FAILED ) throw SecurityManagerException( "Cannot map the snapshot " + fileName + ": " + strerror( errno ) );
+	this->data = (const char *) mapping;
+
+	const Header & header = *(const Header *) this->data;
+	auto reject = [&]( const QString & errorMessage ) {
+		munmap( mapping, this->size );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	};
+	if ( memcmp( header.magic, MAGIC, sizeof( MAGIC ) ) != 0 ) {
+		reject( QString( "The file %1 isn't a compiled snapshot" ).arg( fileName.c_str() ) );
+	}
+	if ( header.version != FORMAT_VERSION || header.headerSize != sizeof( Header ) ) {
+		reject( QString( "The snapshot %1 has the unsupported version %2" ).arg( fileName.c_str() ).arg( header.version ) );
+	}
+	if ( header.fileSize != this->size
+			|| ! isValidSection( header.rolesOffset, header.roleCount, sizeof( RoleRecord ), this->size )
+			|| ! isValidSection( header.roleNameIndexOffset, header.roleCount, sizeof( uint32_t ), this->size )
+			|| ! isValidSection( header.usersOffset, header.userCount, sizeof( UserRecord ), this->size )
+			|| ! isValidSection( header.loginIndexOffset, header.userCount, sizeof( uint32_t ), this->size )
+			|| ! isValidSection( header.userRolesOffset, header.userRoleCount, sizeof( uint32_t ), this->size )
+			|| ! isValidSection( header.roleMembersOffset, header.userRoleCount, sizeof( RoleMember ), this->size )
+			|| ! isValidSection( header.stringsOffset, header.stringsSize, 1, this->size ) ) {
+		reject( QString( "The snapshot %1 is truncated" ).arg( fileName.c_str() ) );
+	}
+	if ( verifyChecksum && computeChecksum( this->data + sizeof( Header ), this->size - sizeof( Header ) ) != header.checksum ) {
+		reject( QString( "The snapshot %1 is corrupted" ).arg( fileName.c_str() ) );
+	}
+
+	this->header = &header;
+	this->roles = (const RoleRecord *) ( this->data + header.rolesOffset );
+	this->roleNameIndex = (const uint32_t *) ( this->data + header.roleNameIndexOffset );
+	this->users = (const UserRecord *) ( this->data + header.usersOffset );
+	this->loginIndex = (const uint32_t *) ( this->data + header.loginIndexOffset );
+	this->userRoles = (const uint32_t *) ( this->data + header.userRolesOffset );
+	this->roleMembers = (const RoleMember *) ( this->data + header.roleMembersOffset );
+	this->strings = this->data + header.stringsOffset;
+	if ( ! this->areValidRecords() ) {
+		reject( QString( "The snapshot %1 is corrupted" ).arg( fileName.c_str() ) );
+	}
+}
+
+CompiledSnapshot::~CompiledSnapshot() {
+	munmap( (void *) this->data, this->size );
+}
+
+const CompiledSnapshot::RoleRecord * CompiledSnapshot::findRoleById( uint roleIdentifier ) const {
+	const RoleRecord * end = this->roles + this->header->roleCount;
+	const RoleRecord * role = lower_bound( this->roles, end, roleIdentifier, []( const RoleRecord & role, uint identifier ) {
+		return role.identifier < identifier;
+	} );
+	return role != end && role->identifier == roleIdentifier ? role : nullptr;
+}
+
+const CompiledSnapshot::RoleRecord * CompiledSnapshot::findRoleByName( std::string_view roleName ) const {
+	const uint32_t * end = this->roleNameIndex + this->header->roleCount;
+	const uint32_t * position = lower_bound( this->roleNameIndex, end, roleName, [this]( uint32_t position, string_view name ) {
+		return this->getString( this->roles[ position ].name ) < name;
+	} );
+	if ( position == end || this->getString( this->roles[ *position ].name ) != roleName ) return nullptr;
+	return &this->roles[ *position ];
+}
+
+const CompiledSnapshot::UserRecord * CompiledSnapshot::findUserById( uint userIdentifier ) const {
+	const UserRecord * end = this->users + this->header->userCount;
+	const UserRecord * user = lower_bound( this->users, end, userIdentifier, []( const UserRecord & user, uint identifier ) {
+		return user.identifier < identifier;
+	} );
+	return user != end && user->identifier == userIdentifier ? user : nullptr;
+}
+
+const CompiledSnapshot::UserRecord * CompiledSnapshot::findUserByLogin( std::string_view login ) const {
+	string foldedLogin = LoginFolding::foldLogin( login );
+	const uint32_t * end = this->loginIndex + this->header->userCount;
+	const uint32_t * position = lower_bound( this->loginIndex, end, foldedLogin, [this]( uint32_t position, const string & login ) {
+		return this->getString( this->users[ position ].foldedLogin ) < login;
+	} );
+	if ( position == end || this->getString( this->users[ *position ].foldedLogin ) != foldedLogin ) return nullptr;
+	return &this->users[ *position ];
+}
+
+std::pair<const CompiledSnapshot::RoleMember *, const CompiledSnapshot::RoleMember *> CompiledSnapshot::getRoleMembers( uint roleIdentifier ) const {
+	const RoleMember * end = this->roleMembers + this->header->userRoleCount;
+	const RoleMember * first = lower_bound( this->roleMembers, end, roleIdentifier, []( const RoleMember & member, uint identifier ) {
+		return member.roleIdentifier < identifier;
+	} );
+	const RoleMember * last = upper_bound( first, end, roleIdentifier, []( uint identifier, const RoleMember & member ) {
+		return identifier < member.roleIdentifier;
+	} );
+	return make_pair( first, last );
+}
+
+bool CompiledSnapshot::areValidRecords() const {
+	const Header & header = *this->header;
+	for( uint i=0; i<header.roleCount; i++ ) {
+		if ( ! this->isValidString( this->roles[i].name ) || this->roleNameIndex[i] >= header.roleCount ) return false;
+		// findRoleById searches the roles by identifier
+		if ( i > 0 && this->roles[i-1].identifier >= this->roles[i].identifier ) return false;
+	}
+	for( uint i=0; i<header.userCount; i++ ) {
+		const UserRecord & user = this->users[i];
+		if ( ! this->isValidString( user.login ) || ! this->isValidString( user.foldedLogin )
+				|| ! this->isValidString( user.password ) || ! this->isValidString( user.firstName )
+				|| ! this->isValidString( user.lastName ) || ! this->isValidString( user.email ) ) return false;
+		if ( user.firstRole > header.userRoleCount || user.roleCount > header.userRoleCount - user.firstRole ) return false;
+		if ( this->loginIndex[i] >= header.userCount ) return false;
+	}
+	for( uint i=0; i<header.userRoleCount; i++ ) {
+		if ( this->findRoleById( this->userRoles[i] ) == nullptr ) return false;
+		if ( this->roleMembers[i].userPosition >= header.userCount ) return false;
+	}
+	return true;
+}
+
+uint64_t CompiledSnapshot::computeChecksum( const char * buffer, size_t length ) {
+	const uint64_t prime = 0x100000001b3ULL;
+	uint64_t checksum = 0xcbf29ce484222325ULL;
+	size_t position = 0;
+	for( ; position + 8 <= length; position += 8 ) {
+		uint64_t word;
+		memcpy( &word, buffer + position, 8 );
+		checksum = ( checksum ^ word ) * prime;
+	}
+	for( ; position < length; position++ ) checksum = ( checksum ^ (unsigned char) buffer[ position ] ) * prime;
+	return checksum;
+}
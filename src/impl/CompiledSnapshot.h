@@ -0,0 +1,290 @@
+/*
+ * CompiledSnapshot.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_COMPILEDSNAPSHOT_H_
+#define IMPL_COMPILEDSNAPSHOT_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "../api/Common.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * <p>
+	 *     A read-only view of a compiled snapshot: the T_ROLES, T_USERS and T_USER_ROLES tables written by
+	 *     SnapshotCompiler in a binary file, memory mapped and read in place. Opening a snapshot copies
+	 *     nothing: the file is mapped, its header and the references of its records (strings, indexes and
+	 *     role assignments) are validated, and its checksum verified. Its pages are shared by every process
+	 *     mapping the same file.
+	 * </p>
+	 * <p>
+	 *     The file starts with a Header, followed by 8 bytes aligned sections of fixed width records: the
+	 *     roles and the users sorted by identifier, an index of the roles sorted by name, an index of the
+	 *     users sorted by folded login (case insensitive, trailing spaces ignored), the role identifiers of
+	 *     each user, the members of each role sorted by role then by user, and a pool holding every string.
+	 *     Integers are stored in the byte order of the compiling host.
+	 * </p>
+	 *
+	 * @see fr.koor.security.SnapshotCompiler
+	 *
+	 * @author KooR.fr
+	 */
+	class CompiledSnapshot {
+	public:
+		/**
+		 * The version of the file format.
+		 */
+		static const uint32_t FORMAT_VERSION = 1;
+
+		/**
+		 * The first bytes of a compiled snapshot.
+		 */
+		static constexpr char MAGIC[8] = { 'K', 'S', 'E', 'C', 'S', 'N', 'A', 'P' };
+
+		/**
+		 * A string of the string pool.
+		 */
+		struct StringRef {
+			uint32_t offset;
+			uint32_t length;
+		};
+
+		/**
+		 * A row of T_ROLES.
+		 */
+		struct RoleRecord {
+			uint32_t identifier;
+			uint32_t reserved;
+			StringRef name;
+		};
+
+		/**
+		 * A row of T_USERS, with the position of its role identifiers in the user roles section.
+		 */
+		struct UserRecord {
+			uint32_t identifier;
+			uint32_t connectionNumber;
+			int64_t lastConnection;
+			uint32_t consecutiveErrors;
+			uint32_t disabled;
+			uint32_t firstRole;
+			uint32_t roleCount;
+			StringRef login;
+			StringRef foldedLogin;
+			StringRef password;
+			StringRef firstName;
+			StringRef lastName;
+			StringRef email;
+		};
+
+		/**
+		 * A row of T_USER_ROLES, indexed by role.
+		 */
+		struct RoleMember {
+			uint32_t roleIdentifier;
+			uint32_t userPosition;			// In the users section
+		};
+
+		/**
+		 * The header of a compiled snapshot. Offsets are counted from the start of the file.
+		 */
+		struct Header {
+			char magic[8];
+			uint32_t version;
+			uint32_t headerSize;
+			uint64_t fileSize;
+			uint64_t checksum;				// Of the bytes following the header (see computeChecksum)
+			int64_t compiledAt;
+			uint32_t roleCount;
+			uint32_t userCount;
+			uint32_t userRoleCount;
+			uint32_t reserved;
+			uint64_t rolesOffset;
+			uint64_t roleNameIndexOffset;
+			uint64_t usersOffset;
+			uint64_t loginIndexOffset;
+			uint64_t userRolesOffset;
+			uint64_t roleMembersOffset;
+			uint64_t stringsOffset;
+			uint64_t stringsSize;
+		};
+
+	private:
+		const char * data = nullptr;
+		size_t size = 0;
+		const Header * header = nullptr;
+		const RoleRecord * roles = nullptr;
+		const uint32_t * roleNameIndex = nullptr;
+		const UserRecord * users = nullptr;
+		const uint32_t * loginIndex = nullptr;
+		const uint32_t * userRoles = nullptr;
+		const RoleMember * roleMembers = nullptr;
+		const char * strings = nullptr;
+
+	public:
+		/**
+		 * Class constructor: maps a compiled snapshot.
+		 *
+		 * @param fileName			The snapshot file.
+		 * @param verifyChecksum	false to skip the verification of the checksum. The references of the records
+		 * 							are validated anyway: a corrupted snapshot can't be read out of its mapping.
+		 *
+		 * @throws SecurityManagerException	Thrown if the file cannot be mapped, or isn't a valid snapshot.
+		 */
+		CompiledSnapshot( const std::string & fileName, bool verifyChecksum = true );
+
+		/**
+		 * Class destructor: unmaps the snapshot.
+		 */
+		~CompiledSnapshot();
+
+		/**
+		 * Copies are forbidden
+		 */
+		CompiledSnapshot( const CompiledSnapshot & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		CompiledSnapshot & operator=( const CompiledSnapshot & original ) = delete;
+
+		/**
+		 * Returns the header of the snapshot.
+		 * @return The header.
+		 */
+		const Header & getHeader() const {
+			return *this->header;
+		}
+
+		/**
+		 * Returns the number of roles of the snapshot.
+		 * @return The role count.
+		 */
+		uint getRoleCount() const {
+			return this->header->roleCount;
+		}
+
+		/**
+		 * Returns a role, by position (the roles being sorted by identifier).
+		 *
+		 * @param position	The position of the role, lower than getRoleCount.
+		 * @return The role record.
+		 */
+		const RoleRecord & getRole( uint position ) const {
+			return this->roles[ position ];
+		}
+
+		/**
+		 * Returns the number of users of the snapshot.
+		 * @return The user count.
+		 */
+		uint getUserCount() const {
+			return this->header->userCount;
+		}
+
+		/**
+		 * Returns a user, by position (the users being sorted by identifier).
+		 *
+		 * @param position	The position of the user, lower than getUserCount.
+		 * @return The user record.
+		 */
+		const UserRecord & getUser( uint position ) const {
+			return this->users[ position ];
+		}
+
+		/**
+		 * Finds a role by identifier.
+		 *
+		 * @param roleIdentifier	The role identifier.
+		 * @return The role record, or a null pointer if the role doesn't exist.
+		 */
+		const RoleRecord * findRoleById( uint roleIdentifier ) const;
+
+		/**
+		 * Finds a role by name.
+		 *
+		 * @param roleName		The role name.
+		 * @return The role record, or a null pointer if the role doesn't exist.
+		 */
+		const RoleRecord * findRoleByName( std::string_view roleName ) const;
+
+		/**
+		 * Finds a user by identifier.
+		 *
+		 * @param userIdentifier	The user identifier.
+		 * @return The user record, or a null pointer if the user doesn't exist.
+		 */
+		const UserRecord * findUserById( uint userIdentifier ) const;
+
+		/**
+		 * Finds a user by login, compared case insensitively (ASCII letters only).
+		 *
+		 * @param login		The login.
+		 * @return The user record, or a null pointer if the user doesn't exist.
+		 */
+		const UserRecord * findUserByLogin( std::string_view login ) const;
+
+		/**
+		 * Returns the role identifiers of a user.
+		 *
+		 * @param user		A user record of this snapshot.
+		 * @return The first role identifier: the user has user.roleCount of them.
+		 */
+		const uint32_t * getUserRoles( const UserRecord & user ) const {
+			return this->userRoles + user.firstRole;
+		}
+
+		/**
+		 * Returns the members of a role, sorted by user identifier.
+		 *
+		 * @param roleIdentifier	The role identifier.
+		 * @return The range of the members.
+		 */
+		std::pair<const RoleMember *, const RoleMember *> getRoleMembers( uint roleIdentifier ) const;
+
+		/**
+		 * Returns a string of the string pool.
+		 *
+		 * @param string	The string reference.
+		 * @return The string, which lives as long as this snapshot.
+		 */
+		std::string_view getString( const StringRef & string ) const {
+			return std::string_view( this->strings + string.offset, string.length );
+		}
+
+		/**
+		 * Computes the checksum stored in the header: FNV-1a over the 64 bits words of a buffer, then over its
+		 * last bytes.
+		 *
+		 * @param buffer	The buffer.
+		 * @param length	The length of the buffer.
+		 * @return The checksum.
+		 */
+		static uint64_t computeChecksum( const char * buffer, size_t length );
+
+	private:
+
+		/**
+		 * Checks that a string reference lies in the string pool.
+		 */
+		bool isValidString( const StringRef & string ) const {
+			return string.offset <= this->header->stringsSize && string.length <= this->header->stringsSize - string.offset;
+		}
+
+		/**
+		 * Checks the references of every record: strings, index positions, role assignments and role members.
+		 */
+		bool areValidRecords() const;
+	};
+
+}
+
+#endif /* IMPL_COMPILEDSNAPSHOT_H_ */
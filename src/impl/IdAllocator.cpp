@@ -0,0 +1,76 @@
+/*
+ * IdAllocator.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include "IdAllocator.h"
+#include "SqlSecurityManager.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+IdAllocator::IdAllocator( SqlSecurityManager & securityManager, const QString & tableName, const QString & columnName, uint blockSize )
+	: securityManager( securityManager ), tableName( tableName ), columnName( columnName ), blockSize( max( blockSize, 1u ) ) {
+}
+
+uint IdAllocator::allocate( QSqlDatabase & connection, uint count ) {
+	lock_guard<mutex> lock( this->allocatorMutex );
+	if ( this->blockEnd - this->nextIdentifier < count ) {
+		uint size = max( this->blockSize, count );
+		this->nextIdentifier = this->reserveBlock( connection, size );
+		this->blockEnd = this->nextIdentifier + size;
+	}
+
+	uint identifier = this->nextIdentifier;
+	this->nextIdentifier += count;
+	return identifier;
+}
+
+void IdAllocator::setBlockSize( uint blockSize ) {
+	lock_guard<mutex> lock( this->allocatorMutex );
+	this->blockSize = max( blockSize, 1u );
+}
+
+uint IdAllocator::reserveBlock( QSqlDatabase & connection, uint size ) {
+	QSqlQuery query( connection );
+	for( int attempt=0; attempt<MAXIMUM_ATTEMPTS; attempt++ ) {
+		query.prepare( "SELECT NextValue FROM T_SEQUENCES WHERE SequenceName=:name" );
+		query.bindValue( ":name", this->tableName );
+		if ( ! securityManager.execute( query ) ) {
+			QString errorMessage = QString( "Cannot read the sequence %1: %2" ).arg( this->tableName ).arg( query.lastError().text() );
+			throw SecurityManagerException( errorMessage.toStdString() );
+		}
+
+		if ( ! query.next() ) {
+			// First use: the sequence starts after the keys already in the table. If another process creates
+			// the row meanwhile, the insert fails and the row is read again.
+			QString strSql = "INSERT INTO T_SEQUENCES (SequenceName, NextValue) SELECT :name, COALESCE(MAX(%1), 0) + 1 FROM %2";
+			query.prepare( strSql.arg( this->columnName ).arg( this->tableName ) );
+			query.bindValue( ":name", this->tableName );
+			securityManager.execute( query );
+			continue;
+		}
+
+		uint first = query.value( 0 ).toUInt();
+		query.prepare( "UPDATE T_SEQUENCES SET NextValue=:next WHERE SequenceName=:name AND NextValue=:current" );
+		query.bindValue( ":next", first + size );
+		query.bindValue( ":name", this->tableName );
+		query.bindValue( ":current", first );
+		if ( ! securityManager.execute( query ) ) {
+			QString errorMessage = QString( "Cannot update the sequence %1: %2" ).arg( this->tableName ).arg( query.lastError().text() );
+			throw SecurityManagerException( errorMessage.toStdString() );
+		}
+		if ( query.numRowsAffected() == 1 ) return first;
+		// Another process reserved a block meanwhile: try again with the new value
+	}
+
+	QString errorMessage = QString( "Cannot reserve identifiers for %1: too many concurrent reservations" ).arg( this->tableName );
+	throw SecurityManagerException( errorMessage.toStdString() );
+}
@@ -0,0 +1,130 @@
+/*
+ * IdAllocator.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_IDALLOCATOR_H_
+#define IMPL_IDALLOCATOR_H_
+
+#include <mutex>
+#include <string>
+
+#include <QtSql/QSqlDatabase>
+
+#include "../api/Common.h"
+
+
+namespace fr::koor::security {
+
+	class SqlSecurityManager;
+
+	/**
+	 * <p>
+	 *     Allocates the primary keys of a table with the hi/lo strategy: blocks of consecutive identifiers
+	 *     are reserved in the T_SEQUENCES table, then handed out from memory. Only one insert out of
+	 *     blockSize costs extra queries.
+	 * </p>
+	 * <p>
+	 *     A block is reserved with a compare and swap on the NextValue column (the update only succeeds if
+	 *     the value read is still current), so several processes sharing the database never receive the same
+	 *     identifiers. Identifiers of a block not fully used when the process stops are lost: keys are
+	 *     unique and increasing, but not contiguous.
+	 * </p>
+	 * <p>
+	 *     The sequence row is created on first use, starting after the greatest key already in the table.
+	 * </p>
+	 *
+	 * @author KooR.fr
+	 */
+	class IdAllocator {
+	public:
+		/**
+		 * The default number of identifiers reserved at once.
+		 */
+		static const uint DEFAULT_BLOCK_SIZE = 100;
+
+	private:
+		/**
+		 * The maximum number of attempts to reserve a block when other processes reserve blocks concurrently.
+		 */
+		static const int MAXIMUM_ATTEMPTS = 16;
+
+		SqlSecurityManager & securityManager;
+		const QString tableName;
+		const QString columnName;
+		uint blockSize;
+
+		std::mutex allocatorMutex;
+		uint nextIdentifier = 0;
+		uint blockEnd = 0;			// The first identifier after the reserved block
+
+	public:
+		/**
+		 * Class constructor.
+		 *
+		 * @param securityManager	The security manager that accounts for the executed queries.
+		 * @param tableName			The name of the table (also the name of its sequence).
+		 * @param columnName		The name of the column that contains primary keys.
+		 * @param blockSize			The number of identifiers reserved at once.
+		 */
+		IdAllocator( SqlSecurityManager & securityManager, const QString & tableName, const QString & columnName,
+					 uint blockSize = DEFAULT_BLOCK_SIZE );
+
+		/**
+		 * Copies are forbidden
+		 */
+		IdAllocator( const IdAllocator & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		IdAllocator & operator=( const IdAllocator & original ) = delete;
+
+		/**
+		 * Returns the first identifier of a range of consecutive unused identifiers. A new block is reserved
+		 * if the current one has not enough identifiers left.
+		 * The connection must not be in a transaction: the reservation of the block must be committed even if
+		 * the insertions of the caller are rolled back.
+		 *
+		 * @param connection	The connection used to reserve a block, if required.
+		 * @param count			The number of identifiers required.
+		 * @return The first identifier of the range.
+		 *
+		 * @throws SecurityManagerException	Thrown if no block can be reserved.
+		 */
+		uint allocate( QSqlDatabase & connection, uint count = 1 );
+
+		/**
+		 * Changes the number of identifiers reserved at once. Takes effect at the next reservation.
+		 *
+		 * @param blockSize		The new block size.
+		 */
+		void setBlockSize( uint blockSize );
+
+		/**
+		 * Returns the number of identifiers reserved at once.
+		 *
+		 * @return The block size.
+		 */
+		uint getBlockSize() const {
+			return this->blockSize;
+		}
+
+	private:
+
+		/**
+		 * Reserves a block of identifiers in the T_SEQUENCES table.
+		 *
+		 * @param connection	The connection to use.
+		 * @param size			The number of identifiers to reserve.
+		 * @return The first identifier of the block.
+		 *
+		 * @throws SecurityManagerException	Thrown if the block cannot be reserved.
+		 */
+		uint reserveBlock( QSqlDatabase & connection, uint size );
+	};
+
+}
+
+#endif /* IMPL_IDALLOCATOR_H_ */
@@ -0,0 +1,860 @@
+/*
+ * InMemorySecurityManager.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <iterator>
+#include <unordered_map>
+
+#include <QtCore/QString>
+
+#include "InMemorySecurityManager.h"
+#include "LoginFolding.h"
+#include "Pbkdf2PasswordHasher.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+//--------------------------------------------------------------------------------------------
+//--- Utility functions ----------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+/**
+ * The types of the journal records. A USER record holds the whole state of a user: the identifier, the login,
+ * the password, the connection number, the last connection, the consecutive errors, the disabled flag, the
+ * first name, the last name, the email and the role identifiers separated by commas.
+ */
+static const string ROLE_RECORD = "ROLE";				// ROLE identifier name
+static const string DROP_ROLE_RECORD = "DROP_ROLE";		// DROP_ROLE identifier
+static const string USER_RECORD = "USER";				// USER identifier login password ... roles
+static const string DROP_USER_RECORD = "DROP_USER";		// DROP_USER identifier
+
+static const size_t USER_RECORD_SIZE = 12;
+
+/**
+ * Formats a journal record: one line, the fields being separated by tabulations.
+ */
+static string formatRecord( const vector<string> & fields ) {
+	string line;
+	for( const string & field : fields ) {
+		if ( ! line.empty() ) line += '\t';
+		for( char character : field ) {
+			switch( character ) {
+				case '\\': line += "\\\\"; break;
+				case '\t': line += "\\t"; break;
+				case '\n': line += "\\n"; break;
+				case '\r': line += "\\r"; break;
+				default: line += character;
+			}
+		}
+	}
+	return line + '\n';
+}
+
+/**
+ * Splits a line formatted by formatRecord (without its end of line) into its fields.
+ */
+static vector<string> parseRecord( const string & line ) {
+	vector<string> fields( 1 );
+	for( size_t i=0; i<line.size(); i++ ) {
+		if ( line[i] == '\t' ) {
+			fields.emplace_back();
+		} else if ( line[i] == '\\' && i + 1 < line.size() ) {
+			char escaped = line[ ++i ];
+			fields.back() += escaped == 't' ? '\t' : escaped == 'n' ? '\n' : escaped == 'r' ? '\r' : escaped;
+		} else {
+			fields.back() += line[i];
+		}
+	}
+	return fields;
+}
+
+/**
+ * Quotes a string as an SQL literal, with the escapes of mysqldump.
+ */
+static string quoteSql( const string & value ) {
+	string literal = "'";
+	for( char character : value ) {
+		switch( character ) {
+			case '\'': literal += "\\'"; break;
+			case '\\': literal += "\\\\"; break;
+			case '\n': literal += "\\n"; break;
+			case '\r': literal += "\\r"; break;
+			case '\0': literal += "\\0"; break;
+			default: literal += character;
+		}
+	}
+	return literal + "'";
+}
+
+static void throwMalformedSnapshot( size_t position ) {
+	QString errorMessage = QString( "Malformed snapshot at offset %1" ).arg( position );
+	throw SecurityManagerException( errorMessage.toStdString() );
+}
+
+static void skipSpaces( const string & text, size_t & position ) {
+	while ( position < text.size() && isspace( (unsigned char) text[ position ] ) ) position++;
+}
+
+/**
+ * Reads an SQL value: a quoted string, NULL (read as an empty string) or a number.
+ */
+static string parseSqlValue( const string & text, size_t & position ) {
+	string value;
+	if ( position < text.size() && text[ position ] == '\'' ) {
+		for( position++; position < text.size(); position++ ) {
+			char character = text[ position ];
+			if ( character == '\\' && position + 1 < text.size() ) {
+				char escaped = text[ ++position ];
+				value += escaped == 'n' ? '\n' : escaped == 'r' ? '\r' : escaped == 't' ? '\t' : escaped == '0' ? '\0' : escaped;
+			} else if ( character == '\'' ) {
+				if ( position + 1 < text.size() && text[ position + 1 ] == '\'' ) {
+					value += '\'';
+					position++;
+				} else {
+					position++;
+					return value;
+				}
+			} else {
+				value += character;
+			}
+		}
+		throwMalformedSnapshot( position );
+	}
+
+	size_t start = position;
+	while ( position < text.size() && text[ position ] != ',' && text[ position ] != ')' && ! isspace( (unsigned char) text[ position ] ) ) position++;
+	if ( position == start ) throwMalformedSnapshot( position );
+	value = text.substr( start, position - start );
+	return value == "NULL" || value == "null" ? string() : value;
+}
+
+/**
+ * Reads the rows of an INSERT statement, from the VALUES keyword to the closing semicolon.
+ */
+static void parseSqlRows( const string & text, size_t & position, vector<vector<string>> & rows ) {
+	skipSpaces( text, position );
+	if ( text.compare( position, 6, "VALUES" ) != 0 ) throwMalformedSnapshot( position );	// Column lists are not supported
+	position += 6;
+
+	while ( true ) {
+		skipSpaces( text, position );
+		if ( position >= text.size() || text[ position ] != '(' ) throwMalformedSnapshot( position );
+		position++;
+
+		vector<string> row;
+		while ( true ) {
+			skipSpaces( text, position );
+			row.push_back( parseSqlValue( text, position ) );
+			skipSpaces( text, position );
+			if ( position >= text.size() ) throwMalformedSnapshot( position );
+			if ( text[ position++ ] == ')' ) break;
+			if ( text[ position - 1 ] != ',' ) throwMalformedSnapshot( position - 1 );
+		}
+		rows.push_back( move( row ) );
+
+		skipSpaces( text, position );
+		if ( position >= text.size() ) throwMalformedSnapshot( position );
+		char separator = text[ position++ ];
+		if ( separator == ';' ) return;
+		if ( separator != ',' ) throwMalformedSnapshot( position - 1 );
+	}
+}
+
+static uint toIdentifier( const string & value ) {
+	return (uint) stoul( value );
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- InMemoryUserManager implementation -----------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+InMemorySecurityManager::InMemoryUserManager::InMemoryUserManager( InMemorySecurityManager & securityManager ) : securityManager( securityManager ) {
+}
+
+InMemorySecurityManager::InMemoryUserManager::~InMemoryUserManager() {
+}
+
+UserPtr InMemorySecurityManager::InMemoryUserManager::checkCredentials( const std::string & userLogin, const std::string & userPassword ) {
+	return this->checkCredentials( userLogin, userPassword, string() );
+}
+
+UserPtr InMemorySecurityManager::InMemoryUserManager::checkCredentials( const std::string & userLogin, const std::string & userPassword, const std::string & source ) {
+	chrono::milliseconds retryAfter;
+	if ( ! source.empty() && ! securityManager.sourceRateLimiter.tryAcquire( source, retryAfter ) ) {
+		throw RateLimitedException( "Too many login attempts from " + source, retryAfter );
+	}
+	if ( ! securityManager.loginRateLimiter.tryAcquire( LoginFolding::foldLogin( userLogin ), retryAfter ) ) {
+		throw RateLimitedException( "Too many login attempts for " + userLogin, retryAfter );
+	}
+
+	PasswordHasherPtr hasher = securityManager.getPasswordHasher();
+	StoredUser storedUser = securityManager.findByLogin( userLogin );
+	if ( ! storedUser ) {
+		// Unknown logins cost a hash too, so that they can't be detected by timing
+		hasher->hash( userPassword );
+		throw BadCredentialsException( "Your identity is rejected" );
+	}
+
+	if ( hasher->verify( userPassword, storedUser->getEncryptedPassword() ) ) {
+		if ( storedUser->isDisabled() ) throw AccountDisabledException( "Account is disabled" );
+		securityManager.loginRateLimiter.reset( LoginFolding::foldLogin( userLogin ) );
+
+		// Passwords stored with an outdated algorithm (or in clear) are upgraded at login
+		string rehashedPassword;
+		if ( hasher->needsRehash( storedUser->getEncryptedPassword() ) ) rehashedPassword = hasher->hash( userPassword );
+
+		// The user may have been changed since it was read: the bookkeeping is applied to its current version
+		lock_guard<mutex> lock( securityManager.mutationMutex );
+		StoredUser currentUser = securityManager.findById( storedUser->getIdentifier() );
+		if ( ! currentUser ) throw BadCredentialsException( "Your identity is rejected" );
+		shared_ptr<User> user = make_shared<User>( *currentUser );
+		user->setConnectionNumber( user->getConnectionNumber() + 1 );
+		user->setLastConnection( time( nullptr ) );
+		user->setConsecutiveErrors( 0 );
+		if ( ! rehashedPassword.empty() && currentUser->getEncryptedPassword() == storedUser->getEncryptedPassword() ) {
+			user->setEncryptedPassword( rehashedPassword );
+		}
+		try {
+			securityManager.appendRecord( userRecord( *user ), false );
+		} catch ( const exception & exception ) {
+			QString errorMessage = QString( "Can't check credentials: %1" ).arg( exception.what() );
+			throw BadCredentialsException( errorMessage.toStdString() );
+		}
+		securityManager.store( user, currentUser );
+		return make_shared<User>( *user );
+	}
+
+	lock_guard<mutex> lock( securityManager.mutationMutex );
+	StoredUser currentUser = securityManager.findById( storedUser->getIdentifier() );
+	if ( currentUser ) {
+		bool forceDisabling = currentUser->getConsecutiveErrors() == 2;
+		shared_ptr<User> user = make_shared<User>( *currentUser );
+		user->setConsecutiveErrors( user->getConsecutiveErrors() + 1 );
+		if ( forceDisabling ) user->setDisabled( true );
+		try {
+			securityManager.appendRecord( userRecord( *user ), forceDisabling );
+		} catch ( const exception & exception ) {
+			QString errorMessage = QString( "Your identity is rejected: %1" ).arg( exception.what() );
+			throw BadCredentialsException( errorMessage.toStdString() );
+		}
+		securityManager.store( user, currentUser );
+		if ( forceDisabling ) throw AccountDisabledException( "Account is disabled" );
+	}
+	throw BadCredentialsException( "Your identity is rejected" );
+}
+
+UserPtr InMemorySecurityManager::InMemoryUserManager::getUserById( uint userId ) const {
+	StoredUser user = securityManager.findById( userId );
+	if ( ! user ) {
+		QString errorMessage = QString( "User identifier %1 not found" ).arg( userId );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	return make_shared<User>( *user );
+}
+
+UserPtr InMemorySecurityManager::InMemoryUserManager::getUserByLogin( const std::string & login ) const {
+	StoredUser user = securityManager.findByLogin( login );
+	if ( ! user ) {
+		QString errorMessage = QString( "User %1 not found" ).arg( login.c_str() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	return make_shared<User>( *user );
+}
+
+void InMemorySecurityManager::InMemoryUserManager::forEachUserInRole( RolePtr role, const UserVisitor & visitor, size_t pageSize ) const {
+	// Every user is already in memory: only the members are copied, one at a time
+	vector<StoredUser> members;
+	for( Shard & shard : securityManager.shards ) {
+		shared_lock<shared_mutex> lock( shard.mutex );
+		for( auto & entry : shard.usersById ) {
+			if ( entry.second->isMemberOfRole( *role ) ) members.push_back( entry.second );
+		}
+	}
+	sort( members.begin(), members.end(), []( const StoredUser & first, const StoredUser & second ) {
+		return first->getIdentifier() < second->getIdentifier();
+	} );
+
+	for( const StoredUser & member : members ) {
+		if ( ! visitor( make_shared<User>( *member ) ) ) return;
+	}
+}
+
+UserPtr InMemorySecurityManager::InMemoryUserManager::insertUser( const std::string & login, const std::string & password ) {
+	if ( securityManager.findByLogin( login ) ) {
+		QString errorMessage = QString( "User %1 already registered" ).arg( login.c_str() );
+		throw UserAlreadyRegisteredException( errorMessage.toStdString() );
+	}
+
+	// Hashing is done before the mutations are locked
+	string encryptedPassword = this->encryptPassword( password );
+
+	lock_guard<mutex> lock( securityManager.mutationMutex );
+	if ( securityManager.findByLogin( login ) ) {
+		QString errorMessage = QString( "User %1 already registered" ).arg( login.c_str() );
+		throw UserAlreadyRegisteredException( errorMessage.toStdString() );
+	}
+
+	shared_ptr<User> user( new User( securityManager, securityManager.nextUserIdentifier, login, encryptedPassword ) );
+	try {
+		securityManager.appendRecord( userRecord( *user ), true );
+	} catch ( const std::exception & exception ) {
+		QString errorMessage = QString( "Can't insert the user %1: %2" ).arg( login.c_str() ).arg( exception.what() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	securityManager.nextUserIdentifier++;
+	securityManager.store( user, StoredUser() );
+	return make_shared<User>( *user );
+}
+
+void InMemorySecurityManager::InMemoryUserManager::updateUser( UserPtr user ) {
+	uint identifier = user->getIdentifier();
+	shared_ptr<User> updatedUser = make_shared<User>( *user );		// The caller keeps its own instance
+
+	lock_guard<mutex> lock( securityManager.mutationMutex );
+	StoredUser previousUser = securityManager.findById( identifier );
+	if ( ! previousUser ) {
+		QString errorMessage = QString( "Cannot update user with pk %1: user not found" ).arg( identifier );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+
+	StoredUser homonym = securityManager.findByLogin( user->getLogin() );
+	if ( homonym && homonym != previousUser ) {
+		QString errorMessage = QString( "User %1 already registered" ).arg( user->getLogin().c_str() );
+		throw UserAlreadyRegisteredException( errorMessage.toStdString() );
+	}
+	for( const RolePtr & role : user->getRoles() ) {
+		if ( ! securityManager.roleManager->roleRegistry.findById( role->getIdentifier() ) ) {
+			QString errorMessage = QString( "Cannot update user with pk %1: unknown role %2" ).arg( identifier ).arg( role->getIdentifier() );
+			throw SecurityManagerException( errorMessage.toStdString() );
+		}
+	}
+
+	try {
+		securityManager.appendRecord( userRecord( *updatedUser ), true );
+	} catch ( const std::exception & exception ) {
+		QString errorMessage = QString( "Cannot update user with pk %1: %2" ).arg( identifier ).arg( exception.what() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	securityManager.store( updatedUser, previousUser );
+}
+
+void InMemorySecurityManager::InMemoryUserManager::deleteUser( UserPtr user ) {
+	lock_guard<mutex> lock( securityManager.mutationMutex );
+	StoredUser previousUser = securityManager.findById( user->getIdentifier() );
+	if ( ! previousUser ) return;
+
+	try {
+		securityManager.appendRecord( { DROP_USER_RECORD, to_string( user->getIdentifier() ) }, true );
+	} catch ( const std::exception & exception ) {
+		QString errorMessage = QString( "Cannot delete user %1: %2" ).arg( user->getLogin().c_str() ).arg( exception.what() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	securityManager.unstore( previousUser );
+}
+
+std::string InMemorySecurityManager::InMemoryUserManager::encryptPassword( const std::string & clearPassword ) const {
+	return securityManager.getPasswordHasher()->hash( clearPassword );
+}
+
+bool InMemorySecurityManager::InMemoryUserManager::verifyPassword( const std::string & clearPassword, const std::string & encryptedPassword ) const {
+	return securityManager.getPasswordHasher()->verify( clearPassword, encryptedPassword );
+}
+
+std::string InMemorySecurityManager::InMemoryUserManager::issueToken( UserPtr user, std::chrono::seconds timeToLive ) {
+	if ( user->isDisabled() ) throw AccountDisabledException( "Account is disabled" );
+	return securityManager.tokenSigner.sign( *user, time( nullptr ) + timeToLive.count() );
+}
+
+TokenClaims InMemorySecurityManager::InMemoryUserManager::verifyToken( const std::string & token ) const {
+	return securityManager.tokenSigner.verify( token, time( nullptr ) );
+}
+
+Executor & InMemorySecurityManager::InMemoryUserManager::getExecutor() const {
+	return *securityManager.requestPool;
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- InMemoryRoleManager implementation -----------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+InMemorySecurityManager::InMemoryRoleManager::InMemoryRoleManager( InMemorySecurityManager & securityManager ) : securityManager( securityManager ) {
+}
+
+InMemorySecurityManager::InMemoryRoleManager::~InMemoryRoleManager() {
+}
+
+RolePtr InMemorySecurityManager::InMemoryRoleManager::selectRoleById( uint roleIdentifier ) {
+	RolePtr role = this->roleRegistry.findById( roleIdentifier );
+	if ( ! role ) {
+		QString errorMessage = QString( "Role identifier %1 not found" ).arg( roleIdentifier );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	return role;
+}
+
+RolePtr InMemorySecurityManager::InMemoryRoleManager::selectRoleByName( const std::string & roleName ) {
+	RolePtr role = this->roleRegistry.findByName( roleName );
+	if ( ! role ) {
+		QString errorMessage = QString( "Role %1 not found" ).arg( roleName.c_str() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	return role;
+}
+
+RolePtr InMemorySecurityManager::InMemoryRoleManager::insertRole( const std::string & roleName ) {
+	lock_guard<mutex> lock( securityManager.mutationMutex );
+	if ( this->roleRegistry.findByName( roleName ) ) {
+		QString errorMessage = QString( "Role %1 already registered" ).arg( roleName.c_str() );
+		throw RoleAlreadyRegisteredException( errorMessage.toStdString() );
+	}
+
+	uint primaryKey = securityManager.nextRoleIdentifier;
+	try {
+		securityManager.appendRecord( { ROLE_RECORD, to_string( primaryKey ), roleName }, true );
+	} catch ( const std::exception & exception ) {
+		QString errorMessage = QString( "Can't insert the role %1: %2" ).arg( roleName.c_str() ).arg( exception.what() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	securityManager.nextRoleIdentifier++;
+	return this->roleRegistry.intern( primaryKey, roleName );
+}
+
+RolePtr InMemorySecurityManager::InMemoryRoleManager::updateRole( RolePtr role, const std::string & newRoleName ) {
+	lock_guard<mutex> lock( securityManager.mutationMutex );
+	RolePtr homonym = this->roleRegistry.findByName( newRoleName );
+	if ( homonym && homonym->getIdentifier() != role->getIdentifier() ) {
+		QString errorMessage = QString( "Role %1 already registered" ).arg( newRoleName.c_str() );
+		throw RoleAlreadyRegisteredException( errorMessage.toStdString() );
+	}
+
+	try {
+		if ( ! this->roleRegistry.findById( role->getIdentifier() ) ) throw std::runtime_error( "role not found" );
+		securityManager.appendRecord( { ROLE_RECORD, to_string( role->getIdentifier() ), newRoleName }, true );
+	} catch ( const std::exception & exception ) {
+		QString errorMessage = QString( "Cannot update role with pk %1: %2" ).arg( role->getIdentifier() ).arg( exception.what() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	RolePtr replacedRole;
+	RolePtr renamedRole = this->roleRegistry.intern( role->getIdentifier(), newRoleName, &replacedRole );
+	if ( replacedRole ) securityManager.replaceRoleOfUsers( renamedRole );
+	return renamedRole;
+}
+
+void InMemorySecurityManager::InMemoryRoleManager::deleteRole( RolePtr role ) {
+	lock_guard<mutex> lock( securityManager.mutationMutex );
+	if ( ! this->roleRegistry.findById( role->getIdentifier() ) ) return;
+
+	try {
+		securityManager.appendRecord( { DROP_ROLE_RECORD, to_string( role->getIdentifier() ) }, true );
+	} catch ( const std::exception & exception ) {
+		QString errorMessage = QString( "Cannot delete role %1: %2" ).arg( role->getRoleName().c_str() ).arg( exception.what() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	securityManager.removeRoleFromUsers( role->getIdentifier() );
+	this->roleRegistry.remove( role->getIdentifier() );
+}
+
+Executor & InMemorySecurityManager::InMemoryRoleManager::getExecutor() const {
+	return *securityManager.requestPool;
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- InMemorySecurityManager implementation -------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+InMemorySecurityManager::InMemorySecurityManager( const std::string & snapshotFileName, const std::string & journalFileName ) :
+			snapshotFileName( snapshotFileName ),
+			journalFileName( journalFileName.empty() ? snapshotFileName + ".journal" : journalFileName ),
+			passwordHasher( new Pbkdf2PasswordHasher() ),
+			loginRateLimiter( 10, chrono::seconds( 6 ) ),
+			sourceRateLimiter( 100, chrono::milliseconds( 600 ) ),
+			requestPool( new WorkerPool( "Request pool" ) ) {
+	this->userManager = std::shared_ptr<InMemoryUserManager>( new InMemoryUserManager( *this ) );
+	this->roleManager = std::shared_ptr<InMemoryRoleManager>( new InMemoryRoleManager( *this ) );
+}
+
+InMemorySecurityManager::~InMemorySecurityManager() {
+	// Pending asynchronous calls still need the managers
+	this->requestPool.reset();
+}
+
+void InMemorySecurityManager::setPasswordHasher( PasswordHasherPtr passwordHasher ) {
+	if ( ! passwordHasher ) throw SecurityManagerException( "A password hasher is required" );
+	atomic_store( &this->passwordHasher, passwordHasher );
+}
+
+PasswordHasherPtr InMemorySecurityManager::getPasswordHasher() const {
+	return atomic_load( &this->passwordHasher );
+}
+
+void InMemorySecurityManager::openSession() {
+	lock_guard<mutex> lock( this->mutationMutex );
+	try {
+		if ( this->journal.is_open() ) this->journal.close();
+		this->clear();
+
+		ifstream snapshot( this->snapshotFileName, ios::binary );
+		if ( snapshot ) this->loadSnapshot( snapshot );
+
+		ifstream journalInput( this->journalFileName, ios::binary );
+		if ( journalInput ) {
+			uintmax_t validLength = 0;
+			this->replayJournal( journalInput, validLength );
+			journalInput.close();
+			// A truncated record would be glued to the next appended one
+			if ( filesystem::file_size( this->journalFileName ) > validLength ) filesystem::resize_file( this->journalFileName, validLength );
+		}
+
+		this->journal.clear();
+		this->journal.open( this->journalFileName, ios::out | ios::app | ios::binary );
+		if ( ! this->journal ) throw std::runtime_error( "cannot open the journal " + this->journalFileName );
+	} catch( exception & exception ) {
+		throw SecurityManagerException( string("Cannot open security session: ") + exception.what() );
+	}
+}
+
+void InMemorySecurityManager::close() {
+	lock_guard<mutex> lock( this->mutationMutex );
+	if ( ! this->journal.is_open() ) return;
+	this->journal.flush();
+	bool written = (bool) this->journal;
+	this->journal.close();
+	if ( ! written ) throw SecurityManagerException( "Cannot close security session: cannot write the journal " + this->journalFileName );
+}
+
+void InMemorySecurityManager::flushJournal() {
+	lock_guard<mutex> lock( this->mutationMutex );
+	if ( ! this->journal.is_open() ) return;
+	if ( ! this->journal.flush() ) throw SecurityManagerException( "Cannot write the journal " + this->journalFileName );
+}
+
+void InMemorySecurityManager::compact() {
+	lock_guard<mutex> lock( this->mutationMutex );
+
+	vector<StoredUser> users;
+	for( Shard & shard : this->shards ) {
+		shared_lock<shared_mutex> shardLock( shard.mutex );
+		for( auto & entry : shard.usersById ) users.push_back( entry.second );
+	}
+	sort( users.begin(), users.end(), []( const StoredUser & first, const StoredUser & second ) {
+		return first->getIdentifier() < second->getIdentifier();
+	} );
+	vector<uint> roleIdentifiers = this->roleManager->roleRegistry.getIdentifiers();
+	sort( roleIdentifiers.begin(), roleIdentifiers.end() );
+
+	// The new snapshot replaces the previous one only once completely written
+	string temporaryFileName = this->snapshotFileName + ".tmp";
+	{
+		ofstream output( temporaryFileName, ios::out | ios::trunc | ios::binary );
+		output << "-- Security informations written by InMemorySecurityManager::compact\n";
+		for( uint roleIdentifier : roleIdentifiers ) {
+			RolePtr role = this->roleManager->roleRegistry.findById( roleIdentifier );
+			if ( role ) output << "INSERT INTO `T_ROLES` VALUES (" << roleIdentifier << "," << quoteSql( role->getRoleName() ) << ");\n";
+		}
+		for( const StoredUser & user : users ) {
+			output << "INSERT INTO `T_USERS` VALUES (" << user->getIdentifier() << "," << quoteSql( user->getLogin() ) << ","
+				   << quoteSql( user->getEncryptedPassword() ) << "," << user->getConnectionNumber() << ","
+				   << (long long) user->getLastConnection() << "," << user->getConsecutiveErrors() << ","
+				   << ( user->isDisabled() ? 1 : 0 ) << "," << quoteSql( user->getFirstName() ) << ","
+				   << quoteSql( user->getLastName() ) << "," << quoteSql( user->getEmail() ) << ");\n";
+		}
+		for( const StoredUser & user : users ) {
+			for( const RolePtr & role : user->getRoles() ) {
+				output << "INSERT INTO `T_USER_ROLES` VALUES (" << user->getIdentifier() << "," << role->getIdentifier() << ");\n";
+			}
+		}
+		output << "INSERT INTO `T_SEQUENCES` VALUES ('T_ROLES'," << this->nextRoleIdentifier << "),('T_USERS',"
+			   << this->nextUserIdentifier << ");\n";
+		output.flush();
+		if ( ! output ) throw SecurityManagerException( "Cannot write the snapshot " + temporaryFileName );
+	}
+	if ( rename( temporaryFileName.c_str(), this->snapshotFileName.c_str() ) != 0 ) {
+		throw SecurityManagerException( "Cannot replace the snapshot " + this->snapshotFileName );
+	}
+
+	// The records of the journal are all included in the new snapshot
+	bool journalOpen = this->journal.is_open();
+	if ( journalOpen ) this->journal.close();
+	this->journal.clear();
+	this->journal.open( this->journalFileName, ios::out | ios::trunc | ios::binary );
+	if ( ! this->journal ) throw SecurityManagerException( "Cannot empty the journal " + this->journalFileName );
+	if ( ! journalOpen ) this->journal.close();
+}
+
+size_t InMemorySecurityManager::getUserCount() const {
+	size_t userCount = 0;
+	for( const Shard & shard : this->shards ) {
+		shared_lock<shared_mutex> lock( shard.mutex );
+		userCount += shard.usersById.size();
+	}
+	return userCount;
+}
+
+InMemorySecurityManager::Shard & InMemorySecurityManager::getLoginShard( const std::string & foldedLogin ) {
+	return this->shards[ hash<string>()( foldedLogin ) % SHARD_COUNT ];
+}
+
+InMemorySecurityManager::Shard & InMemorySecurityManager::getIdentifierShard( uint identifier ) {
+	return this->shards[ identifier % SHARD_COUNT ];
+}
+
+InMemorySecurityManager::StoredUser InMemorySecurityManager::findByLogin( const std::string & login ) {
+	string foldedLogin = LoginFolding::foldLogin( login );
+	Shard & shard = this->getLoginShard( foldedLogin );
+	shared_lock<shared_mutex> lock( shard.mutex );
+	auto iterator = shard.usersByLogin.find( foldedLogin );
+	return iterator != shard.usersByLogin.end() ? iterator->second : StoredUser();
+}
+
+InMemorySecurityManager::StoredUser InMemorySecurityManager::findById( uint identifier ) {
+	Shard & shard = this->getIdentifierShard( identifier );
+	shared_lock<shared_mutex> lock( shard.mutex );
+	auto iterator = shard.usersById.find( identifier );
+	return iterator != shard.usersById.end() ? iterator->second : StoredUser();
+}
+
+void InMemorySecurityManager::store( const StoredUser & user, const StoredUser & previousUser ) {
+	string foldedLogin = LoginFolding::foldLogin( user->getLogin() );
+	if ( previousUser ) {
+		string previousLogin = LoginFolding::foldLogin( previousUser->getLogin() );
+		if ( previousLogin != foldedLogin ) {
+			Shard & shard = this->getLoginShard( previousLogin );
+			unique_lock<shared_mutex> lock( shard.mutex );
+			shard.usersByLogin.erase( previousLogin );
+		}
+	}
+	{
+		Shard & shard = this->getLoginShard( foldedLogin );
+		unique_lock<shared_mutex> lock( shard.mutex );
+		shard.usersByLogin[ foldedLogin ] = user;
+	}
+	Shard & shard = this->getIdentifierShard( user->getIdentifier() );
+	unique_lock<shared_mutex> lock( shard.mutex );
+	shard.usersById[ user->getIdentifier() ] = user;
+}
+
+void InMemorySecurityManager::unstore( const StoredUser & user ) {
+	string foldedLogin = LoginFolding::foldLogin( user->getLogin() );
+	{
+		Shard & shard = this->getLoginShard( foldedLogin );
+		unique_lock<shared_mutex> lock( shard.mutex );
+		shard.usersByLogin.erase( foldedLogin );
+	}
+	Shard & shard = this->getIdentifierShard( user->getIdentifier() );
+	unique_lock<shared_mutex> lock( shard.mutex );
+	shard.usersById.erase( user->getIdentifier() );
+}
+
+void InMemorySecurityManager::clear() {
+	for( Shard & shard : this->shards ) {
+		unique_lock<shared_mutex> lock( shard.mutex );
+		shard.usersByLogin.clear();
+		shard.usersById.clear();
+	}
+	RoleRegistry & roleRegistry = this->roleManager->roleRegistry;
+	for( uint roleIdentifier : roleRegistry.getIdentifiers() ) roleRegistry.remove( roleIdentifier );
+	this->nextUserIdentifier = 1;
+	this->nextRoleIdentifier = 1;
+}
+
+void InMemorySecurityManager::loadSnapshot( std::istream & input ) {
+	string text( ( istreambuf_iterator<char>( input ) ), istreambuf_iterator<char>() );
+
+	unordered_map<string, vector<vector<string>>> tables;
+	size_t position = 0;
+	while ( ( position = text.find( "INSERT INTO", position ) ) != string::npos ) {
+		position += 11;
+		skipSpaces( text, position );
+		size_t start = position;
+		while ( position < text.size() && ( isalnum( (unsigned char) text[ position ] ) || text[ position ] == '_' || text[ position ] == '`' ) ) position++;
+		string tableName = text.substr( start, position - start );
+		tableName.erase( remove( tableName.begin(), tableName.end(), '`' ), tableName.end() );
+		parseSqlRows( text, position, tables[ tableName ] );
+	}
+
+	try {
+		RoleRegistry & roleRegistry = this->roleManager->roleRegistry;
+		for( const vector<string> & row : tables[ "T_ROLES" ] ) {
+			if ( row.size() != 2 ) throw std::runtime_error( "T_ROLES rows have 2 columns" );
+			uint identifier = toIdentifier( row[0] );
+			roleRegistry.intern( identifier, row[1] );
+			this->nextRoleIdentifier = max( this->nextRoleIdentifier, identifier + 1 );
+		}
+
+		unordered_map<uint, shared_ptr<User>> users;
+		for( const vector<string> & row : tables[ "T_USERS" ] ) {
+			if ( row.size() != 10 ) throw std::runtime_error( "T_USERS rows have 10 columns" );
+			uint identifier = toIdentifier( row[0] );
+			shared_ptr<User> user( new User( *this, identifier, row[1], row[2] ) );
+			user->setConnectionNumber( row[3].empty() ? 0 : toIdentifier( row[3] ) );
+			user->setLastConnection( row[4].empty() ? 0 : (time_t) stoll( row[4] ) );
+			user->setConsecutiveErrors( row[5].empty() ? 0 : toIdentifier( row[5] ) );
+			user->setDisabled( ! row[6].empty() && row[6] != "0" );
+			user->setFirstName( row[7] );
+			user->setLastName( row[8] );
+			user->setEmail( row[9] );
+			users[ identifier ] = user;
+			this->nextUserIdentifier = max( this->nextUserIdentifier, identifier + 1 );
+		}
+
+		for( const vector<string> & row : tables[ "T_USER_ROLES" ] ) {
+			if ( row.size() != 2 ) throw std::runtime_error( "T_USER_ROLES rows have 2 columns" );
+			auto iterator = row[0].empty() ? users.end() : users.find( toIdentifier( row[0] ) );
+			RolePtr role = row[1].empty() ? RolePtr() : roleRegistry.findById( toIdentifier( row[1] ) );
+			if ( iterator != users.end() && role ) iterator->second->addRole( role );
+		}
+
+		for( const vector<string> & row : tables[ "T_SEQUENCES" ] ) {
+			if ( row.size() != 2 ) throw std::runtime_error( "T_SEQUENCES rows have 2 columns" );
+			if ( row[0] == "T_ROLES" ) this->nextRoleIdentifier = max( this->nextRoleIdentifier, toIdentifier( row[1] ) );
+			if ( row[0] == "T_USERS" ) this->nextUserIdentifier = max( this->nextUserIdentifier, toIdentifier( row[1] ) );
+		}
+
+		for( auto & entry : users ) this->store( entry.second, StoredUser() );
+	} catch ( const std::exception & exception ) {
+		QString errorMessage = QString( "Malformed snapshot: %1" ).arg( exception.what() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+}
+
+size_t InMemorySecurityManager::replayJournal( std::istream & input, std::uintmax_t & validLength ) {
+	size_t recordCount = 0;
+	size_t lineNumber = 0;
+	string line;
+	while ( getline( input, line ) ) {
+		lineNumber++;
+		if ( input.eof() ) break;			// No end of line: the record was being written when the process stopped
+		validLength += line.size() + 1;
+		if ( line.empty() ) continue;
+
+		bool applied;
+		try {
+			applied = this->applyRecord( parseRecord( line ) );
+		} catch ( const std::exception & exception ) {
+			applied = false;
+		}
+		if ( ! applied ) {
+			QString errorMessage = QString( "Malformed journal record at line %1" ).arg( lineNumber );
+			throw SecurityManagerException( errorMessage.toStdString() );
+		}
+		recordCount++;
+	}
+	return recordCount;
+}
+
+bool InMemorySecurityManager::applyRecord( const std::vector<std::string> & fields ) {
+	RoleRegistry & roleRegistry = this->roleManager->roleRegistry;
+
+	if ( fields[0] == ROLE_RECORD && fields.size() == 3 ) {
+		uint identifier = toIdentifier( fields[1] );
+		RolePtr replacedRole;
+		RolePtr role = roleRegistry.intern( identifier, fields[2], &replacedRole );
+		if ( replacedRole ) this->replaceRoleOfUsers( role );
+		this->nextRoleIdentifier = max( this->nextRoleIdentifier, identifier + 1 );
+		return true;
+	}
+
+	if ( fields[0] == DROP_ROLE_RECORD && fields.size() == 2 ) {
+		uint identifier = toIdentifier( fields[1] );
+		this->removeRoleFromUsers( identifier );
+		roleRegistry.remove( identifier );
+		return true;
+	}
+
+	if ( fields[0] == USER_RECORD && fields.size() == USER_RECORD_SIZE ) {
+		uint identifier = toIdentifier( fields[1] );
+		shared_ptr<User> user( new User( *this, identifier, fields[2], fields[3] ) );
+		user->setConnectionNumber( toIdentifier( fields[4] ) );
+		user->setLastConnection( (time_t) stoll( fields[5] ) );
+		user->setConsecutiveErrors( toIdentifier( fields[6] ) );
+		user->setDisabled( fields[7] == "1" );
+		user->setFirstName( fields[8] );
+		user->setLastName( fields[9] );
+		user->setEmail( fields[10] );
+		for( size_t start = 0; start < fields[11].size(); ) {
+			size_t end = min( fields[11].find( ',', start ), fields[11].size() );
+			RolePtr role = roleRegistry.findById( toIdentifier( fields[11].substr( start, end - start ) ) );
+			if ( role ) user->addRole( role );
+			start = end + 1;
+		}
+		this->store( user, this->findById( identifier ) );
+		this->nextUserIdentifier = max( this->nextUserIdentifier, identifier + 1 );
+		return true;
+	}
+
+	if ( fields[0] == DROP_USER_RECORD && fields.size() == 2 ) {
+		StoredUser user = this->findById( toIdentifier( fields[1] ) );
+		if ( user ) this->unstore( user );
+		return true;
+	}
+
+	return false;
+}
+
+void InMemorySecurityManager::appendRecord( const std::vector<std::string> & fields, bool flush ) {
+	if ( ! this->journal.is_open() ) throw SecurityManagerException( "The security session is not open" );
+	this->journal << formatRecord( fields );
+	if ( flush ) this->journal.flush();
+	if ( ! this->journal ) throw SecurityManagerException( "Cannot write the journal " + this->journalFileName );
+}
+
+std::vector<std::string> InMemorySecurityManager::userRecord( const User & user ) {
+	string roleIdentifiers;
+	for( const RolePtr & role : user.getRoles() ) {
+		if ( ! roleIdentifiers.empty() ) roleIdentifiers += ',';
+		roleIdentifiers += to_string( role->getIdentifier() );
+	}
+	return {
+		USER_RECORD, to_string( user.getIdentifier() ), user.getLogin(), user.getEncryptedPassword(),
+		to_string( user.getConnectionNumber() ), to_string( (long long) user.getLastConnection() ),
+		to_string( user.getConsecutiveErrors() ), user.isDisabled() ? "1" : "0",
+		user.getFirstName(), user.getLastName(), user.getEmail(), roleIdentifiers
+	};
+}
+
+void InMemorySecurityManager::removeRoleFromUsers( uint roleIdentifier ) {
+	RolePtr role = this->roleManager->roleRegistry.findById( roleIdentifier );
+	if ( ! role ) return;
+
+	vector<StoredUser> members;
+	for( Shard & shard : this->shards ) {
+		shared_lock<shared_mutex> lock( shard.mutex );
+		for( auto & entry : shard.usersById ) {
+			if ( entry.second->isMemberOfRole( *role ) ) members.push_back( entry.second );
+		}
+	}
+	for( const StoredUser & member : members ) {
+		shared_ptr<User> user = make_shared<User>( *member );
+		user->removeRole( role );
+		this->store( user, member );
+	}
+}
+
+void InMemorySecurityManager::replaceRoleOfUsers( const RolePtr & role ) {
+	vector<StoredUser> members;
+	for( Shard & shard : this->shards ) {
+		shared_lock<shared_mutex> lock( shard.mutex );
+		for( auto & entry : shard.usersById ) {
+			if ( entry.second->isMemberOfRole( *role ) ) members.push_back( entry.second );
+		}
+	}
+	// Roles are compared by identifier: the previous instance is removed, then the new one added
+	for( const StoredUser & member : members ) {
+		shared_ptr<User> user = make_shared<User>( *member );
+		user->removeRole( role );
+		user->addRole( role );
+		this->store( user, member );
+	}
+}
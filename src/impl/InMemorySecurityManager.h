@@ -0,0 +1,364 @@
+/*
+ * InMemorySecurityManager.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_INMEMORYSECURITYMANAGER_H_
+#define IMPL_INMEMORYSECURITYMANAGER_H_
+
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../api/PasswordHasher.h"
+#include "../api/SecurityManager.h"
+#include "RateLimiter.h"
+#include "RoleRegistry.h"
+#include "TokenSigner.h"
+#include "WorkerPool.h"
+
+namespace fr::koor::security {
+
+
+	/**
+	 * <p>
+	 *     This security manager keeps all the security informations in memory: credentials checks and
+	 *     lookups never wait for any I/O. It is intended for read mostly services that can afford to hold
+	 *     every user in memory.
+	 * </p>
+	 * <p>
+	 *     openSession loads a snapshot: a dump of the SecurityComponent.sql tables, made of INSERT statements
+	 *     (mysqldump output, or a file written by compact). A missing snapshot is an empty one. Then the
+	 *     journal is replayed: every mutation is appended to it, before being applied, as a full
+	 *     record of the changed user or role. compact writes a new snapshot and empties the journal.
+	 * </p>
+	 * <p>
+	 *     Mutations made through the managers are flushed to the journal at once. The bookkeeping of the
+	 *     logins (connection number, last connection, consecutive errors) is only buffered, so that a login
+	 *     doesn't wait for the disk: it is written with the next flushed record, by flushJournal or by close,
+	 *     and lost if the process crashes, like in the write-behind mode of SqlSecurityManager.
+	 * </p>
+	 * <p>
+	 *     Users are indexed by login (compared case insensitively, like the database does) and by identifier
+	 *     in sharded tables: lookups only take a shared lock on one shard. Mutations are serialized, in the
+	 *     order of the journal.
+	 * </p>
+	 *
+	 * @see fr.koor.security.SecurityManager
+	 * @see fr.koor.security.SqlSecurityManager
+	 *
+	 * @author KooR.fr
+	 */
+	class InMemorySecurityManager : public SecurityManager {
+
+		static const size_t SHARD_COUNT = 16;
+
+		typedef std::shared_ptr<const User> StoredUser;
+
+		struct alignas(64) Shard {
+			mutable std::shared_mutex mutex;
+			std::unordered_map<std::string, StoredUser> usersByLogin;		// By folded login
+			std::unordered_map<uint, StoredUser> usersById;
+		};
+
+		class InMemoryUserManager;
+		class InMemoryRoleManager;
+
+		std::string snapshotFileName;
+		std::string journalFileName;
+
+		Shard shards[ SHARD_COUNT ];
+		std::mutex mutationMutex;				// Serializes the mutations and the journal appends
+		std::ofstream journal;
+		uint nextUserIdentifier = 1;			// Under mutationMutex
+		uint nextRoleIdentifier = 1;			// Under mutationMutex
+
+		std::shared_ptr<InMemoryUserManager> userManager;
+		std::shared_ptr<InMemoryRoleManager> roleManager;
+
+		PasswordHasherPtr passwordHasher;
+		TokenSigner tokenSigner;
+		RateLimiter loginRateLimiter;
+		RateLimiter sourceRateLimiter;
+
+		// Declared last: its queued calls complete before the other members are destroyed
+		std::unique_ptr<WorkerPool> requestPool;
+
+	public:
+		/**
+		 * Class constructor.
+		 *
+		 * @param snapshotFileName	The snapshot loaded by openSession and written by compact.
+		 * @param journalFileName	The journal of the mutations (the snapshot file name followed by
+		 * 							".journal" if empty).
+		 */
+		InMemorySecurityManager( const std::string & snapshotFileName, const std::string & journalFileName = "" );
+
+		/**
+		 * Class destructor.
+		 */
+		virtual ~InMemorySecurityManager();
+
+		/**
+		 * Loads the snapshot, replays the journal and opens the journal for the next mutations.
+		 *
+		 * @throws SecurityManagerException	Thrown when the snapshot or the journal cannot be read.
+		 */
+		void openSession() override;
+
+		/**
+		 * Writes the buffered records and closes the journal. The users and roles can still be read.
+		 *
+		 * @throws SecurityManagerException	Thrown when the journal cannot be written.
+		 */
+		void close() override;
+
+		/**
+		 * Returns the role manager associated to this security manager.
+		 * A role manager provided methods to manage roles.
+		 *
+		 * @return The role manager associated to this security manager.
+		 */
+		RoleManagerPtr getRoleManager() const override {
+			return this->roleManager;
+		}
+
+		/**
+		 * Returns the user manager associated to this security manager.
+		 * A user manager provided methods to manage users.
+		 *
+		 * @return The user manager associated to this security manager.
+		 */
+		UserManagerPtr getUserManager() const override {
+			return this->userManager;
+		}
+
+		/**
+		 * Writes the current users and roles in a new snapshot, which replaces the previous one atomically,
+		 * then empties the journal.
+		 *
+		 * @throws SecurityManagerException	Thrown when the snapshot cannot be written.
+		 */
+		void compact();
+
+		/**
+		 * Writes the buffered records (the login bookkeeping) to the journal.
+		 *
+		 * @throws SecurityManagerException	Thrown when the journal cannot be written.
+		 */
+		void flushJournal();
+
+		/**
+		 * Returns the number of users held by this manager.
+		 *
+		 * @return The user count.
+		 */
+		size_t getUserCount() const;
+
+		/**
+		 * Changes the algorithm used to hash the passwords (PBKDF2-HMAC-SHA256 with 100000 iterations by
+		 * default). Passwords stored with another algorithm, or a lower cost, are hashed again with this one
+		 * at the next successful login of their user.
+		 *
+		 * @param passwordHasher	The new password hasher.
+		 */
+		void setPasswordHasher( PasswordHasherPtr passwordHasher );
+
+		/**
+		 * Returns the algorithm used to hash the passwords.
+		 *
+		 * @return The password hasher.
+		 */
+		PasswordHasherPtr getPasswordHasher() const;
+
+		/**
+		 * Returns the key ring used to sign and verify the session tokens.
+		 *
+		 * @return The token signer.
+		 */
+		TokenSigner & getTokenSigner() {
+			return this->tokenSigner;
+		}
+
+		/**
+		 * Returns the limiter of the login attempts per login (see SqlSecurityManager::getLoginRateLimiter).
+		 *
+		 * @return The per login rate limiter.
+		 */
+		RateLimiter & getLoginRateLimiter() {
+			return this->loginRateLimiter;
+		}
+
+		/**
+		 * Returns the limiter of the login attempts per source (see SqlSecurityManager::getSourceRateLimiter).
+		 *
+		 * @return The per source rate limiter.
+		 */
+		RateLimiter & getSourceRateLimiter() {
+			return this->sourceRateLimiter;
+		}
+
+	private:
+
+		Shard & getLoginShard( const std::string & foldedLogin );
+
+		Shard & getIdentifierShard( uint identifier );
+
+		/**
+		 * Returns the stored user having a login, or a null pointer.
+		 */
+		StoredUser findByLogin( const std::string & login );
+
+		/**
+		 * Returns the stored user having an identifier, or a null pointer.
+		 */
+		StoredUser findById( uint identifier );
+
+		/**
+		 * Indexes a user, replacing its previous version (under mutationMutex).
+		 *
+		 * @param user			The new version of the user.
+		 * @param previousUser	The previous version of the user, or a null pointer.
+		 */
+		void store( const StoredUser & user, const StoredUser & previousUser );
+
+		/**
+		 * Removes a user from the indexes (under mutationMutex).
+		 */
+		void unstore( const StoredUser & user );
+
+		/**
+		 * Removes every user and role.
+		 */
+		void clear();
+
+		/**
+		 * Loads the INSERT statements of a snapshot.
+		 *
+		 * @throws SecurityManagerException	Thrown if the snapshot is malformed.
+		 */
+		void loadSnapshot( std::istream & input );
+
+		/**
+		 * Applies the records of the journal. A truncated last record (a crash while it was written) is ignored.
+		 *
+		 * @param input			The journal.
+		 * @param validLength	Receives the length of the complete records.
+		 * @return The number of applied records.
+		 *
+		 * @throws SecurityManagerException	Thrown if a record is malformed.
+		 */
+		size_t replayJournal( std::istream & input, std::uintmax_t & validLength );
+
+		/**
+		 * Applies a journal record (under mutationMutex).
+		 *
+		 * @param fields	The fields of the record, its type first.
+		 * @return false if the record is malformed.
+		 */
+		bool applyRecord( const std::vector<std::string> & fields );
+
+		/**
+		 * Appends a record to the journal (under mutationMutex).
+		 *
+		 * @param fields	The fields of the record, its type first.
+		 * @param flush		true to write the record at once, false to buffer it.
+		 *
+		 * @throws SecurityManagerException	Thrown if the journal is closed or cannot be written.
+		 */
+		void appendRecord( const std::vector<std::string> & fields, bool flush );
+
+		/**
+		 * Returns the journal record storing the whole state of a user.
+		 */
+		static std::vector<std::string> userRecord( const User & user );
+
+		/**
+		 * Removes a role from every user holding it (under mutationMutex).
+		 */
+		void removeRoleFromUsers( uint roleIdentifier );
+
+		/**
+		 * Replaces, in every user holding it, the previous instance of a renamed role (under mutationMutex).
+		 *
+		 * @param role	The new canonical instance of the role.
+		 */
+		void replaceRoleOfUsers( const RolePtr & role );
+
+		/**
+		 * In memory implementation for the UserManager interface.
+		 *
+		 * @author KooR.fr
+		 */
+		class InMemoryUserManager : public UserManager {
+			InMemorySecurityManager & securityManager;
+		public:
+			InMemoryUserManager( InMemorySecurityManager & securityManager );
+			~InMemoryUserManager() override;
+
+			UserPtr checkCredentials( const std::string & userLogin, const std::string & userPassword ) override;
+
+			UserPtr checkCredentials( const std::string & userLogin, const std::string & userPassword, const std::string & source ) override;
+
+			UserPtr getUserById( uint userId ) const override;
+
+			UserPtr getUserByLogin( const std::string & login ) const override;
+
+			void forEachUserInRole( RolePtr role, const UserVisitor & visitor, size_t pageSize = 500 ) const override;
+
+			UserPtr insertUser( const std::string & login, const std::string & password ) override;
+
+			void updateUser( UserPtr user ) override;
+
+			void deleteUser( UserPtr user ) override;
+
+			std::string encryptPassword( const std::string & clearPassword ) const override;
+
+			bool verifyPassword( const std::string & clearPassword, const std::string & encryptedPassword ) const override;
+
+			std::string issueToken( UserPtr user, std::chrono::seconds timeToLive = std::chrono::minutes( 15 ) ) override;
+
+			TokenClaims verifyToken( const std::string & token ) const override;
+
+			Executor & getExecutor() const override;
+		};
+
+		/**
+		 * In memory implementation for the RoleManager interface.
+		 *
+		 * @author KooR.fr
+		 */
+		class InMemoryRoleManager : public RoleManager {
+			InMemorySecurityManager & securityManager;
+			RoleRegistry roleRegistry;
+
+		public:
+			InMemoryRoleManager( InMemorySecurityManager & securityManager );
+			~InMemoryRoleManager() override;
+
+			RolePtr selectRoleById( uint roleIdentifier ) override;
+
+			RolePtr selectRoleByName( const std::string & roleName ) override;
+
+			RolePtr insertRole( const std::string & roleName ) override;
+
+			RolePtr updateRole( RolePtr role, const std::string & newRoleName ) override;
+
+			void deleteRole( RolePtr role ) override;
+
+			Executor & getExecutor() const override;
+
+			friend class InMemorySecurityManager;
+		};
+	};
+
+}
+
+#endif /* IMPL_INMEMORYSECURITYMANAGER_H_ */
@@ -0,0 +1,114 @@
+/*
+ * LoginFilter.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include "LoginFilter.h"
+#include "LoginFolding.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+//--------------------------------------------------------------------------------------------
+//--- Utility functions ----------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+static inline uint64_t mix( uint64_t value ) {
+	// splitmix64 finalizer
+	value ^= value >> 30;
+	value *= 0xBF58476D1CE4E5B9ULL;
+	value ^= value >> 27;
+	value *= 0x94D049BB133111EBULL;
+	value ^= value >> 31;
+	return value;
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- LoginFilter::Table implementation ------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+LoginFilter::Table::Table( size_t expectedLogins )
+	: words( max( (size_t) MINIMUM_BLOCK_COUNT, ( expectedLogins * BITS_PER_LOGIN + 511 ) / 512 ) * BLOCK_WORDS ),
+	  blockCount( words.size() / BLOCK_WORDS ) {
+}
+
+void LoginFilter::Table::add( uint64_t hash ) {
+	size_t block = (size_t) ( ( ( hash >> 32 ) * (uint64_t) this->blockCount ) >> 32 ) * BLOCK_WORDS;
+	uint64_t positions = mix( hash );
+	for( uint i=0; i<HASH_COUNT; i++, positions >>= 9 ) {
+		uint bit = positions & 511;
+		this->words[ block + bit / 64 ].fetch_or( (uint64_t) 1 << ( bit % 64 ), memory_order_relaxed );
+	}
+	this->loginCount++;
+}
+
+bool LoginFilter::Table::mightContain( uint64_t hash ) const {
+	size_t block = (size_t) ( ( ( hash >> 32 ) * (uint64_t) this->blockCount ) >> 32 ) * BLOCK_WORDS;
+	uint64_t positions = mix( hash );
+	for( uint i=0; i<HASH_COUNT; i++, positions >>= 9 ) {
+		uint bit = positions & 511;
+		if ( ( this->words[ block + bit / 64 ].load( memory_order_relaxed ) & ( (uint64_t) 1 << ( bit % 64 ) ) ) == 0 ) return false;
+	}
+	return true;
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- LoginFilter implementation -------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+void LoginFilter::add( const std::string & login ) {
+	uint64_t hash;
+	if ( ! hashLogin( login, hash ) ) return;			// Never rejected anyway
+
+	// Kept for the next rebuild: its loader may read the database before the login is stored
+	lock_guard<mutex> lock( this->addMutex );
+	shared_ptr<Table> currentTable = atomic_load( &this->table );
+	if ( currentTable ) currentTable->add( hash );
+	this->addedHashes.push_back( hash );
+}
+
+void LoginFilter::remove( const std::string & login ) {
+	this->staleCount++;
+}
+
+bool LoginFilter::mightContain( const std::string & login ) {
+	shared_ptr<Table> currentTable = atomic_load( &this->table );
+	if ( ! currentTable ) return true;
+
+	uint64_t hash;
+	if ( ! hashLogin( login, hash ) || currentTable->mightContain( hash ) ) return true;
+	this->rejectionCount++;
+	return false;
+}
+
+void LoginFilter::publish( std::shared_ptr<Table> rebuiltTable ) {
+	lock_guard<mutex> lock( this->addMutex );
+	for( uint64_t hash : this->addedHashes ) rebuiltTable->add( hash );
+	this->addedHashes.clear();
+	this->addedHashes.shrink_to_fit();
+	atomic_store( &this->table, rebuiltTable );
+	this->staleCount = 0;
+}
+
+size_t LoginFilter::getLoginCount() const {
+	shared_ptr<Table> currentTable = atomic_load( &this->table );
+	return currentTable ? currentTable->loginCount.load() : 0;
+}
+
+bool LoginFilter::hashLogin( const std::string & login, uint64_t & hash ) {
+	// FNV-1a on the folded login, then mixed
+	string foldedLogin = LoginFolding::foldLogin( login );
+	uint64_t value = 0xCBF29CE484222325ULL;
+	for( char character : foldedLogin ) {
+		if ( (unsigned char) character >= 0x80 ) return false;
+		value = ( value ^ (unsigned char) character ) * 0x100000001B3ULL;
+	}
+	hash = mix( value ^ foldedLogin.size() );
+	return true;
+}
@@ -0,0 +1,185 @@
+/*
+ * LoginFilter.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_LOGINFILTER_H_
+#define IMPL_LOGINFILTER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+
+namespace fr::koor::security {
+
+	/**
+	 * <p>
+	 *     A Bloom filter of the registered logins, used to reject the unknown logins without querying the
+	 *     database. mightContain never answers false for a registered login; it answers true for less than 1% of
+	 *     the unknown logins, which are then looked up as usual.
+	 * </p>
+	 * <p>
+	 *     The filter is blocked: the bits of a login all lie in the same 64 bytes block, so a lookup costs a
+	 *     single cache miss. Logins are compared like the database does (case insensitive, trailing spaces
+	 *     ignored): logins with non ASCII characters, whose folding depends on the column collation, are
+	 *     never rejected.
+	 * </p>
+	 * <p>
+	 *     The filter is loaded by rebuild, from the logins of the database. Logins must be added before they
+	 *     are stored. A Bloom filter cannot forget a login: removed or renamed logins remain, as false
+	 *     positives, until the next rebuild. Until the first rebuild, every login is accepted.
+	 * </p>
+	 * <p>
+	 *     The filter only knows the logins loaded by rebuild and those given to add: a login stored by another
+	 *     process is rejected until it is added. Its owner must keep it complete (see
+	 *     SqlSecurityManager::enableChangeFeed) before trusting a rejection.
+	 * </p>
+	 *
+	 * @author KooR.fr
+	 */
+	class LoginFilter {
+	public:
+		/**
+		 * The number of filter bits per login, when the filter is built.
+		 */
+		static const size_t BITS_PER_LOGIN = 12;
+
+		/**
+		 * The number of bits set per login.
+		 */
+		static const uint HASH_COUNT = 7;
+
+	private:
+		static const size_t BLOCK_WORDS = 8;		// 512 bits: one cache line
+		static const size_t MINIMUM_BLOCK_COUNT = 64;
+
+		struct Table {
+			std::vector<std::atomic<uint64_t>> words;
+			size_t blockCount;
+			std::atomic<size_t> loginCount { 0 };
+
+			Table( size_t expectedLogins );
+			void add( uint64_t hash );
+			bool mightContain( uint64_t hash ) const;
+		};
+
+		std::shared_ptr<Table> table;			// Accessed with atomic_load / atomic_store
+		std::mutex rebuildMutex;
+		std::mutex addMutex;					// Serializes add and the publication of a rebuilt table
+		std::vector<uint64_t> addedHashes;		// Added since the last rebuild (under addMutex)
+		std::atomic<size_t> staleCount { 0 };
+		std::atomic<unsigned long long> rejectionCount { 0 };
+
+	public:
+		/**
+		 * Class constructor: the filter accepts every login until it is rebuilt.
+		 */
+		LoginFilter() = default;
+
+		/**
+		 * Copies are forbidden
+		 */
+		LoginFilter( const LoginFilter & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		LoginFilter & operator=( const LoginFilter & original ) = delete;
+
+		/**
+		 * Adds a login to the filter. Must be called before the login is stored in the database.
+		 *
+		 * @param login		The login.
+		 */
+		void add( const std::string & login );
+
+		/**
+		 * Records that a login was removed from the database. Its bits stay set until the next rebuild.
+		 *
+		 * @param login		The login.
+		 */
+		void remove( const std::string & login );
+
+		/**
+		 * Checks if a login may be registered.
+		 *
+		 * @param login		The login.
+		 * @return false if the login is certainly unknown, true otherwise.
+		 */
+		bool mightContain( const std::string & login );
+
+		/**
+		 * Replaces the content of the filter by the logins produced by a loader. The logins added since the
+		 * previous rebuild are added again to the new filter: the loader may have read the database before
+		 * they were stored. If the loader throws an exception, the filter is left unchanged.
+		 *
+		 * @param expectedLogins	The number of logins to load, used to size the filter.
+		 * @param loader			Reads the stored logins and calls, for each of them, the function it receives
+		 * 							(a const std::string & parameter).
+		 */
+		template <typename Loader>
+		void rebuild( size_t expectedLogins, Loader loader ) {
+			std::lock_guard<std::mutex> lock( this->rebuildMutex );
+			std::shared_ptr<Table> rebuiltTable = std::make_shared<Table>( expectedLogins );
+			loader( [&rebuiltTable]( const std::string & login ) {
+				uint64_t hash;
+				if ( hashLogin( login, hash ) ) rebuiltTable->add( hash );
+			} );
+			this->publish( rebuiltTable );
+		}
+
+		/**
+		 * Checks if the filter was built: before that, every login is accepted.
+		 * @return true if the filter was built, false otherwise.
+		 */
+		bool isReady() const {
+			return (bool) std::atomic_load( &this->table );
+		}
+
+		/**
+		 * Returns the number of logins added to the current filter (by its rebuild, then by add).
+		 * @return The login count.
+		 */
+		size_t getLoginCount() const;
+
+		/**
+		 * Returns the number of logins removed since the last rebuild: they are still accepted by the filter.
+		 * @return The stale login count.
+		 */
+		size_t getStaleCount() const {
+			return this->staleCount;
+		}
+
+		/**
+		 * Returns the number of logins rejected by the filter since its creation.
+		 * @return The rejection count.
+		 */
+		unsigned long long getRejectionCount() const {
+			return this->rejectionCount;
+		}
+
+	private:
+
+		/**
+		 * Replaces the filter by a rebuilt one, after adding it the logins added meanwhile.
+		 */
+		void publish( std::shared_ptr<Table> rebuiltTable );
+
+		/**
+		 * Hashes a login folded like the database does.
+		 *
+		 * @param login		The login.
+		 * @param hash		Receives the hash.
+		 * @return false if the login cannot be folded (non ASCII characters), true otherwise.
+		 */
+		static bool hashLogin( const std::string & login, uint64_t & hash );
+	};
+
+}
+
+#endif /* IMPL_LOGINFILTER_H_ */
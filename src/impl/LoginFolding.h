@@ -0,0 +1,44 @@
+/*
+ * LoginFolding.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_LOGINFOLDING_H_
+#define IMPL_LOGINFOLDING_H_
+
+#include <string>
+#include <string_view>
+
+
+namespace fr::koor::security {
+
+	/**
+	 * Folds the logins like the comparisons of the database do: ASCII letters are lowered and trailing spaces
+	 * removed. Every structure keyed by login (rate limits, login filter, in-memory indexes, compiled snapshots,
+	 * import batches) uses it, so that the variants of a login are seen as the same login.
+	 *
+	 * @author KooR.fr
+	 */
+	class LoginFolding {
+	public:
+		/**
+		 * Folds a login.
+		 *
+		 * @param login		The login.
+		 * @return The folded login.
+		 */
+		static std::string foldLogin( std::string_view login ) {
+			size_t length = login.find_last_not_of( ' ' ) + 1;		// 0 if the login is made of spaces
+			std::string foldedLogin( login.substr( 0, length ) );
+			for( char & character : foldedLogin ) {
+				if ( character >= 'A' && character <= 'Z' ) character += 'a' - 'A';
+			}
+			return foldedLogin;
+		}
+	};
+
+}
+
+#endif /* IMPL_LOGINFOLDING_H_ */
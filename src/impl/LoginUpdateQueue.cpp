@@ -0,0 +1,127 @@
+/*
+ * LoginUpdateQueue.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <algorithm>
+
+#include "LoginUpdateQueue.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+LoginUpdateQueue::LoginUpdateQueue( FlushHandler flushHandler, ThreadExitHandler threadExitHandler,
+									size_t maximumPendingUsers, std::chrono::milliseconds flushInterval ) :
+		flushHandler(flushHandler), threadExitHandler(threadExitHandler),
+		maximumPendingUsers( maximumPendingUsers == 0 ? 1 : maximumPendingUsers ), flushInterval(flushInterval) {
+	this->flushThread = thread( &LoginUpdateQueue::run, this );
+}
+
+LoginUpdateQueue::~LoginUpdateQueue() {
+	{
+		lock_guard<mutex> lock( this->queueMutex );
+		this->stopping = true;
+	}
+	this->flushRequested.notify_all();
+	this->flushThread.join();
+}
+
+void LoginUpdateQueue::recordLogin( uint userId, const std::string & login, time_t connectionTime ) {
+	bool flushNeeded;
+	{
+		lock_guard<mutex> lock( this->queueMutex );
+		PendingLogins & pending = this->pendingLogins[ userId ];
+		if ( pending.login != login ) {
+			if ( ! pending.login.empty() ) this->identifiersByLogin.erase( pending.login );
+			pending.login = login;
+			this->identifiersByLogin[ login ] = userId;
+		}
+		pending.connectionCount++;
+		pending.lastConnection = max( pending.lastConnection, connectionTime );
+		flushNeeded = this->pendingLogins.size() >= this->maximumPendingUsers;
+	}
+	if ( flushNeeded ) this->flushRequested.notify_one();
+}
+
+bool LoginUpdateQueue::getPendingLogins( uint userId, PendingLogins & pending ) {
+	lock_guard<mutex> lock( this->queueMutex );
+	auto iterator = this->pendingLogins.find( userId );
+	if ( iterator == this->pendingLogins.end() ) return false;
+	pending = iterator->second;
+	return true;
+}
+
+void LoginUpdateQueue::flushLogin( const std::string & login ) {
+	// A batch being written may hold the logins of this user: it is written first
+	lock_guard<mutex> writeLock( this->writeMutex );
+	Batch batch;
+	{
+		lock_guard<mutex> lock( this->queueMutex );
+		auto iterator = this->identifiersByLogin.find( login );
+		if ( iterator == this->identifiersByLogin.end() ) return;
+		auto pending = this->pendingLogins.find( iterator->second );
+		batch.insert( *pending );
+		this->pendingLogins.erase( pending );
+		this->identifiersByLogin.erase( iterator );
+	}
+	this->write( batch );
+}
+
+void LoginUpdateQueue::flush() {
+	lock_guard<mutex> writeLock( this->writeMutex );
+	Batch batch;
+	{
+		lock_guard<mutex> lock( this->queueMutex );
+		batch.swap( this->pendingLogins );
+		this->identifiersByLogin.clear();
+	}
+	if ( ! batch.empty() ) this->write( batch );
+}
+
+size_t LoginUpdateQueue::size() {
+	lock_guard<mutex> lock( this->queueMutex );
+	return this->pendingLogins.size();
+}
+
+void LoginUpdateQueue::write( Batch & batch ) {
+	try {
+		this->flushHandler( batch );
+	} catch ( ... ) {
+		// The batch is kept for the next flush, merged with the logins recorded meanwhile
+		lock_guard<mutex> lock( this->queueMutex );
+		for( auto & entry : batch ) {
+			PendingLogins & pending = this->pendingLogins[ entry.first ];
+			if ( pending.login.empty() ) {
+				pending.login = entry.second.login;
+				this->identifiersByLogin[ pending.login ] = entry.first;
+			}
+			pending.connectionCount += entry.second.connectionCount;
+			pending.lastConnection = max( pending.lastConnection, entry.second.lastConnection );
+		}
+		throw;
+	}
+}
+
+void LoginUpdateQueue::run() {
+	unique_lock<mutex> lock( this->queueMutex );
+	while ( ! this->stopping ) {
+		this->flushRequested.wait_for( lock, this->flushInterval, [this] {
+			return this->stopping || this->pendingLogins.size() >= this->maximumPendingUsers;
+		} );
+
+		lock.unlock();
+		try {
+			this->flush();
+		} catch ( ... ) {
+			// Updates are kept: they will be written by the next flush
+		}
+		lock.lock();
+	}
+	lock.unlock();
+
+	if ( this->threadExitHandler ) this->threadExitHandler();
+}
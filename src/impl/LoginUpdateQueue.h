@@ -0,0 +1,160 @@
+/*
+ * LoginUpdateQueue.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_LOGINUPDATEQUEUE_H_
+#define IMPL_LOGINUPDATEQUEUE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include "../api/Common.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * <p>
+	 *     Collects, in memory, the bookkeeping of successful logins (connection number, last connection and
+	 *     consecutive errors reset) so that it can be written to the database later, in batches. Repeated
+	 *     logins of the same user are merged into a single pending update.
+	 * </p>
+	 * <p>
+	 *     Pending updates are flushed by a background thread, every flush interval or as soon as the number of
+	 *     pending users reaches the configured limit. The flush itself is delegated to a handler (the SQL
+	 *     security manager writes the batch in one transaction). If the handler fails, the updates are kept
+	 *     and retried on the next flush.
+	 * </p>
+	 *
+	 * @author KooR.fr
+	 */
+	class LoginUpdateQueue {
+	public:
+		/**
+		 * The merged bookkeeping of the not yet written logins of a user.
+		 */
+		struct PendingLogins {
+			std::string login;
+			uint connectionCount = 0;
+			time_t lastConnection = 0;
+		};
+
+		typedef std::unordered_map<uint, PendingLogins> Batch;
+
+		/**
+		 * Writes a batch of pending updates. Must throw an exception if the batch cannot be written.
+		 */
+		typedef std::function<void( const Batch & )> FlushHandler;
+
+		/**
+		 * Called by the background thread just before it terminates (to release its database connection).
+		 */
+		typedef std::function<void()> ThreadExitHandler;
+
+	private:
+		FlushHandler flushHandler;
+		ThreadExitHandler threadExitHandler;
+		size_t maximumPendingUsers;
+		std::chrono::milliseconds flushInterval;
+
+		std::mutex writeMutex;				// Held while a batch is written, taken before queueMutex
+		std::mutex queueMutex;
+		std::condition_variable flushRequested;
+		Batch pendingLogins;
+		std::unordered_map<std::string, uint> identifiersByLogin;
+		bool stopping = false;
+		std::thread flushThread;
+
+	public:
+		/**
+		 * Class constructor: starts the background flush thread.
+		 *
+		 * @param flushHandler			The handler that writes a batch of pending updates.
+		 * @param threadExitHandler		The handler called when the background thread terminates.
+		 * @param maximumPendingUsers	The number of pending users that triggers a flush.
+		 * @param flushInterval			The maximum delay before a pending update is written.
+		 */
+		LoginUpdateQueue( FlushHandler flushHandler, ThreadExitHandler threadExitHandler,
+						  size_t maximumPendingUsers, std::chrono::milliseconds flushInterval );
+
+		/**
+		 * Class destructor: stops the background thread after a last flush.
+		 */
+		~LoginUpdateQueue();
+
+		/**
+		 * Copies are forbidden
+		 */
+		LoginUpdateQueue( const LoginUpdateQueue & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		LoginUpdateQueue & operator=( const LoginUpdateQueue & original ) = delete;
+
+		/**
+		 * Records a successful login.
+		 *
+		 * @param userId		The identifier of the connected user.
+		 * @param login			The login of the connected user.
+		 * @param connectionTime	The connection date.
+		 */
+		void recordLogin( uint userId, const std::string & login, time_t connectionTime );
+
+		/**
+		 * Returns the not yet written logins of a user.
+		 *
+		 * @param userId		The user identifier.
+		 * @param pending		Receives the pending logins, if any.
+		 * @return true if the user has pending logins, false otherwise.
+		 */
+		bool getPendingLogins( uint userId, PendingLogins & pending );
+
+		/**
+		 * Synchronously writes the pending logins of the specified user, if any. If a batch is being written,
+		 * it is waited for: once this method returns, none of the logins of the user are still to be written.
+		 *
+		 * @param login		The user login.
+		 *
+		 * @throws std::exception	Thrown by the flush handler if the update cannot be written.
+		 */
+		void flushLogin( const std::string & login );
+
+		/**
+		 * Synchronously writes all the pending logins.
+		 *
+		 * @throws std::exception	Thrown by the flush handler if the updates cannot be written.
+		 */
+		void flush();
+
+		/**
+		 * Returns the number of users with pending logins.
+		 * @return The pending user count.
+		 */
+		size_t size();
+
+	private:
+
+		/**
+		 * Writes a batch with the flush handler, writeMutex being held. On failure, the batch is merged back into
+		 * the pending logins.
+		 */
+		void write( Batch & batch );
+
+		/**
+		 * The background thread main loop.
+		 */
+		void run();
+	};
+
+}
+
+#endif /* IMPL_LOGINUPDATEQUEUE_H_ */
@@ -0,0 +1,328 @@
+/*
+ * OperationMetrics.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <mutex>
+#include <sstream>
+
+#include "OperationMetrics.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+//--------------------------------------------------------------------------------------------
+//--- Utility functions ----------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+/**
+ * The SQL statements executed by the current thread (see OperationMetrics::countQuery).
+ */
+static thread_local unsigned long long threadQueryCount = 0;
+
+/**
+ * The identifier of the next OperationMetrics instance.
+ */
+static atomic<unsigned long long> nextIdentifier { 1 };
+
+/**
+ * Adds a value to a counter written by a single thread: no read-modify-write instruction is needed.
+ */
+static inline void add( atomic<unsigned long long> & counter, unsigned long long value ) {
+	counter.store( counter.load( memory_order_relaxed ) + value, memory_order_relaxed );
+}
+
+static string formatSeconds( unsigned long long nanoseconds ) {
+	ostringstream output;
+	output.precision( 9 );
+	output << nanoseconds / 1e9;
+	return output.str();
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- OperationMetrics internals -------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+/**
+ * The counters written by one thread.
+ */
+struct OperationMetrics::ThreadCounters {
+	struct Operation {
+		atomic<unsigned long long> errors;
+		atomic<unsigned long long> exceptions;
+		atomic<unsigned long long> queries;
+		atomic<unsigned long long> totalNanoseconds;
+		atomic<unsigned long long> maximumNanoseconds;
+		atomic<unsigned long long> buckets[ BUCKET_COUNT ];
+	};
+
+	struct Cache {
+		atomic<unsigned long long> hits;
+		atomic<unsigned long long> misses;
+	};
+
+	// Value initialized: every counter starts at zero
+	unique_ptr<Operation[]> operations;
+	unique_ptr<Cache[]> caches;
+
+	ThreadCounters( size_t operationCount, size_t cacheCount ) :
+			operations( new Operation[ operationCount ]() ), caches( new Cache[ cacheCount ]() ) {
+	}
+};
+
+/**
+ * The counters of every thread that recorded something. The counters of a terminated thread are kept (they
+ * are still summed by the snapshots) and handed over to the next thread that records something.
+ */
+struct OperationMetrics::Registry {
+	size_t operationCount;
+	size_t cacheCount;
+	mutable std::mutex mutex;
+	vector<unique_ptr<ThreadCounters>> counters;
+	vector<ThreadCounters *> releasedCounters;
+
+	ThreadCounters * acquire() {
+		lock_guard<std::mutex> lock( this->mutex );
+		if ( ! this->releasedCounters.empty() ) {
+			ThreadCounters * threadCounters = this->releasedCounters.back();
+			this->releasedCounters.pop_back();
+			return threadCounters;
+		}
+		this->counters.emplace_back( new ThreadCounters( this->operationCount, this->cacheCount ) );
+		return this->counters.back().get();
+	}
+
+	void release( ThreadCounters * threadCounters ) {
+		lock_guard<std::mutex> lock( this->mutex );
+		this->releasedCounters.push_back( threadCounters );
+	}
+};
+
+
+//--------------------------------------------------------------------------------------------
+//--- OperationMetrics::OperationSnapshot implementation -------------------------------------
+//--------------------------------------------------------------------------------------------
+
+std::chrono::nanoseconds OperationMetrics::OperationSnapshot::getPercentile( double percentile ) const {
+	if ( this->count == 0 ) return chrono::nanoseconds( 0 );
+	percentile = min( max( percentile, 0.0 ), 100.0 );
+	unsigned long long rank = max( (unsigned long long) ceil( percentile / 100 * this->count ), 1ULL );
+
+	unsigned long long cumulatedCount = 0;
+	for( uint bucket=0; bucket<this->buckets.size(); bucket++ ) {
+		cumulatedCount += this->buckets[ bucket ];
+		if ( cumulatedCount >= rank ) {
+			return chrono::nanoseconds( min( OperationMetrics::getBucketLimit( bucket ), this->maximumNanoseconds ) );
+		}
+	}
+	return chrono::nanoseconds( this->maximumNanoseconds );
+}
+
+std::chrono::nanoseconds OperationMetrics::OperationSnapshot::getMean() const {
+	return chrono::nanoseconds( this->count == 0 ? 0 : this->totalNanoseconds / this->count );
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- OperationMetrics::Snapshot implementation ----------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+const OperationMetrics::OperationSnapshot * OperationMetrics::Snapshot::findOperation( const std::string & name ) const {
+	for( const OperationSnapshot & operation : this->operations ) {
+		if ( operation.name == name ) return &operation;
+	}
+	return nullptr;
+}
+
+const OperationMetrics::CacheSnapshot * OperationMetrics::Snapshot::findCache( const std::string & name ) const {
+	for( const CacheSnapshot & cache : this->caches ) {
+		if ( cache.name == name ) return &cache;
+	}
+	return nullptr;
+}
+
+void OperationMetrics::Snapshot::writePrometheus( std::ostream & output, const std::string & prefix ) const {
+	static const double QUANTILES[] = { 0.5, 0.9, 0.99, 0.999 };
+
+	string metric = prefix + "_operation_duration_seconds";
+	output << "# HELP " << metric << " The duration of the operations.\n";
+	output << "# TYPE " << metric << " summary\n";
+	for( const OperationSnapshot & operation : this->operations ) {
+		for( double quantile : QUANTILES ) {
+			output << metric << "{operation=\"" << operation.name << "\",quantile=\"" << quantile << "\"} "
+				   << formatSeconds( operation.getPercentile( quantile * 100 ).count() ) << "\n";
+		}
+		output << metric << "_sum{operation=\"" << operation.name << "\"} " << formatSeconds( operation.totalNanoseconds ) << "\n";
+		output << metric << "_count{operation=\"" << operation.name << "\"} " << operation.count << "\n";
+	}
+
+	auto writeCounter = [&]( const string & name, const string & help, unsigned long long OperationSnapshot::*field ) {
+		output << "# HELP " << prefix << name << " " << help << "\n";
+		output << "# TYPE " << prefix << name << " counter\n";
+		for( const OperationSnapshot & operation : this->operations ) {
+			output << prefix << name << "{operation=\"" << operation.name << "\"} " << operation.*field << "\n";
+		}
+	};
+	writeCounter( "_operation_errors_total", "The calls that reported a failure.", &OperationSnapshot::errors );
+	writeCounter( "_operation_exceptions_total", "The calls that threw an exception.", &OperationSnapshot::exceptions );
+	writeCounter( "_operation_queries_total", "The SQL statements executed by the operations.", &OperationSnapshot::queries );
+
+	output << "# HELP " << prefix << "_cache_hits_total The cache lookups that found their entry.\n";
+	output << "# TYPE " << prefix << "_cache_hits_total counter\n";
+	for( const CacheSnapshot & cache : this->caches ) {
+		output << prefix << "_cache_hits_total{cache=\"" << cache.name << "\"} " << cache.hits << "\n";
+	}
+	output << "# HELP " << prefix << "_cache_misses_total The cache lookups that missed their entry.\n";
+	output << "# TYPE " << prefix << "_cache_misses_total counter\n";
+	for( const CacheSnapshot & cache : this->caches ) {
+		output << prefix << "_cache_misses_total{cache=\"" << cache.name << "\"} " << cache.misses << "\n";
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- OperationMetrics::Scope implementation -------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+OperationMetrics::Scope::Scope( OperationMetrics & metrics, uint operation ) :
+		metrics(metrics), operation(operation), start( chrono::steady_clock::now() ),
+		startQueryCount(threadQueryCount), uncaughtExceptions( uncaught_exceptions() ) {
+}
+
+OperationMetrics::Scope::~Scope() {
+	try {
+		this->metrics.record( this->operation, chrono::steady_clock::now() - this->start, threadQueryCount - this->startQueryCount,
+							  this->failed, uncaught_exceptions() > this->uncaughtExceptions );
+	} catch ( ... ) {
+		// The call isn't accounted if the counters of this thread cannot be allocated
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- OperationMetrics implementation --------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+OperationMetrics::OperationMetrics( const std::vector<std::string> & operationNames, const std::vector<std::string> & cacheNames ) :
+		operationNames(operationNames), cacheNames(cacheNames), identifier( nextIdentifier++ ), registry( new Registry() ) {
+	this->registry->operationCount = operationNames.size();
+	this->registry->cacheCount = cacheNames.size();
+}
+
+OperationMetrics::~OperationMetrics() {
+}
+
+void OperationMetrics::record( uint operation, std::chrono::nanoseconds duration, unsigned long long queries, bool failed, bool threw ) {
+	if ( operation >= this->operationNames.size() ) return;
+	ThreadCounters::Operation & counters = this->getThreadCounters().operations[ operation ];
+
+	unsigned long long nanoseconds = (unsigned long long) max( duration.count(), (chrono::nanoseconds::rep) 0 );
+	add( counters.buckets[ getBucket( nanoseconds ) ], 1 );
+	add( counters.totalNanoseconds, nanoseconds );
+	if ( nanoseconds > counters.maximumNanoseconds.load( memory_order_relaxed ) ) {
+		counters.maximumNanoseconds.store( nanoseconds, memory_order_relaxed );
+	}
+	add( counters.queries, queries );
+	if ( failed ) add( counters.errors, 1 );
+	if ( threw ) add( counters.exceptions, 1 );
+}
+
+void OperationMetrics::recordLookup( uint cache, bool hit ) {
+	if ( cache >= this->cacheNames.size() ) return;
+	ThreadCounters::Cache & counters = this->getThreadCounters().caches[ cache ];
+	add( hit ? counters.hits : counters.misses, 1 );
+}
+
+OperationMetrics::Snapshot OperationMetrics::getSnapshot() const {
+	Snapshot snapshot;
+	snapshot.operations.resize( this->operationNames.size() );
+	for( size_t operation=0; operation<this->operationNames.size(); operation++ ) {
+		snapshot.operations[ operation ].name = this->operationNames[ operation ];
+		snapshot.operations[ operation ].buckets.resize( BUCKET_COUNT, 0 );
+	}
+	snapshot.caches.resize( this->cacheNames.size() );
+	for( size_t cache=0; cache<this->cacheNames.size(); cache++ ) snapshot.caches[ cache ].name = this->cacheNames[ cache ];
+
+	lock_guard<std::mutex> lock( this->registry->mutex );
+	for( const unique_ptr<ThreadCounters> & threadCounters : this->registry->counters ) {
+		for( size_t operation=0; operation<this->operationNames.size(); operation++ ) {
+			const ThreadCounters::Operation & counters = threadCounters->operations[ operation ];
+			OperationSnapshot & operationSnapshot = snapshot.operations[ operation ];
+			for( uint bucket=0; bucket<BUCKET_COUNT; bucket++ ) {
+				unsigned long long count = counters.buckets[ bucket ].load( memory_order_relaxed );
+				operationSnapshot.buckets[ bucket ] += count;
+				operationSnapshot.count += count;
+			}
+			operationSnapshot.errors += counters.errors.load( memory_order_relaxed );
+			operationSnapshot.exceptions += counters.exceptions.load( memory_order_relaxed );
+			operationSnapshot.queries += counters.queries.load( memory_order_relaxed );
+			operationSnapshot.totalNanoseconds += counters.totalNanoseconds.load( memory_order_relaxed );
+			operationSnapshot.maximumNanoseconds = max( operationSnapshot.maximumNanoseconds, counters.maximumNanoseconds.load( memory_order_relaxed ) );
+		}
+		for( size_t cache=0; cache<this->cacheNames.size(); cache++ ) {
+			snapshot.caches[ cache ].hits += threadCounters->caches[ cache ].hits.load( memory_order_relaxed );
+			snapshot.caches[ cache ].misses += threadCounters->caches[ cache ].misses.load( memory_order_relaxed );
+		}
+	}
+	return snapshot;
+}
+
+void OperationMetrics::countQuery() {
+	threadQueryCount++;
+}
+
+uint OperationMetrics::getBucket( unsigned long long nanoseconds ) {
+	if ( nanoseconds < SUB_BUCKET_COUNT ) return (uint) nanoseconds;
+	uint exponent = 63 - __builtin_clzll( nanoseconds );						// >= 4
+	uint bucket = ( exponent - 3 ) * SUB_BUCKET_COUNT + (uint) ( ( nanoseconds >> ( exponent - 4 ) ) - SUB_BUCKET_COUNT );
+	return min( bucket, BUCKET_COUNT - 1 );
+}
+
+unsigned long long OperationMetrics::getBucketLimit( uint bucket ) {
+	if ( bucket < SUB_BUCKET_COUNT ) return bucket;
+	uint exponent = bucket / SUB_BUCKET_COUNT + 3;
+	unsigned long long subBucket = bucket % SUB_BUCKET_COUNT;
+	return ( ( SUB_BUCKET_COUNT + subBucket + 1 ) << ( exponent - 4 ) ) - 1;
+}
+
+OperationMetrics::ThreadCounters & OperationMetrics::getThreadCounters() {
+	struct Binding {
+		unsigned long long owner;
+		weak_ptr<Registry> registry;
+		ThreadCounters * counters;
+	};
+
+	// The counters of the calling thread, per instance: they are released when the thread terminates
+	struct ThreadBindings {
+		vector<Binding> bindings;
+
+		~ThreadBindings() {
+			for( Binding & binding : this->bindings ) {
+				shared_ptr<Registry> registry = binding.registry.lock();
+				if ( registry ) registry->release( binding.counters );
+			}
+		}
+	};
+	static thread_local ThreadBindings threadBindings;
+
+	for( Binding & binding : threadBindings.bindings ) {
+		if ( binding.owner == this->identifier ) return *binding.counters;
+	}
+
+	// First record of this thread: the bindings of the destroyed instances are dropped meanwhile
+	vector<Binding> & bindings = threadBindings.bindings;
+	bindings.erase( remove_if( bindings.begin(), bindings.end(), []( const Binding & binding ) {
+		return binding.registry.expired();
+	} ), bindings.end() );
+	ThreadCounters * threadCounters = this->registry->acquire();
+	bindings.push_back( { this->identifier, this->registry, threadCounters } );
+	return *threadCounters;
+}
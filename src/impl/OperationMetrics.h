@@ -0,0 +1,250 @@
+/*
+ * OperationMetrics.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_OPERATIONMETRICS_H_
+#define IMPL_OPERATIONMETRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../api/Common.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * <p>
+	 *     Measures the operations of a security manager: for each operation, a latency histogram, the number
+	 *     of SQL statements it executed and the number of calls that failed or threw an exception; and the hits
+	 *     and misses of its caches. The operations and the caches are identified by their index in the names
+	 *     given to the constructor.
+	 * </p>
+	 * <p>
+	 *     Recording is lock-free: each thread writes its own counters, which only the snapshots read. The
+	 *     histograms use log-linear buckets (16 sub-buckets per power of two, from 1 ns to about 18 minutes):
+	 *     a percentile is known within 6.25%, whatever the duration.
+	 * </p>
+	 *
+	 * @author KooR.fr
+	 */
+	class OperationMetrics {
+	public:
+		/**
+		 * The number of linear sub-buckets per power of two.
+		 */
+		static const uint SUB_BUCKET_COUNT = 16;
+
+		/**
+		 * The number of buckets of a histogram: the durations of 2^40 ns or more share the last one.
+		 */
+		static const uint BUCKET_COUNT = ( 40 - 3 ) * SUB_BUCKET_COUNT;
+
+		/**
+		 * The measures of an operation.
+		 */
+		struct OperationSnapshot {
+			std::string name;
+			unsigned long long count = 0;				// Completed calls
+			unsigned long long errors = 0;				// Calls that reported a failure
+			unsigned long long exceptions = 0;			// Calls that threw an exception
+			unsigned long long queries = 0;				// SQL statements executed by the calls
+			unsigned long long totalNanoseconds = 0;
+			unsigned long long maximumNanoseconds = 0;
+			std::vector<unsigned long long> buckets;	// BUCKET_COUNT call counts
+
+			/**
+			 * Returns the duration below which a percentage of the calls completed.
+			 *
+			 * @param percentile	The percentage, between 0 and 100.
+			 * @return The duration (0 if no call completed).
+			 */
+			std::chrono::nanoseconds getPercentile( double percentile ) const;
+
+			/**
+			 * Returns the average duration of the calls.
+			 * @return The mean duration (0 if no call completed).
+			 */
+			std::chrono::nanoseconds getMean() const;
+		};
+
+		/**
+		 * The hits and misses of a cache.
+		 */
+		struct CacheSnapshot {
+			std::string name;
+			unsigned long long hits = 0;
+			unsigned long long misses = 0;
+
+			double getHitRate() const {
+				unsigned long long lookups = hits + misses;
+				return lookups == 0 ? 0 : (double) hits / lookups;
+			}
+		};
+
+		/**
+		 * The measures of every operation and every cache, at a point in time.
+		 */
+		struct Snapshot {
+			std::vector<OperationSnapshot> operations;
+			std::vector<CacheSnapshot> caches;
+
+			/**
+			 * Returns the measures of an operation.
+			 *
+			 * @param name	The operation name.
+			 * @return The measures, or a null pointer if the operation is unknown.
+			 */
+			const OperationSnapshot * findOperation( const std::string & name ) const;
+
+			/**
+			 * Returns the hits and misses of a cache.
+			 *
+			 * @param name	The cache name.
+			 * @return The counts, or a null pointer if the cache is unknown.
+			 */
+			const CacheSnapshot * findCache( const std::string & name ) const;
+
+			/**
+			 * Writes the snapshot in the Prometheus text exposition format: a summary of the durations per
+			 * operation (quantiles 0.5, 0.9, 0.99 and 0.999), and counters of the errors, exceptions, queries,
+			 * cache hits and cache misses.
+			 *
+			 * @param output	The stream to write to.
+			 * @param prefix	The prefix of the metric names.
+			 */
+			void writePrometheus( std::ostream & output, const std::string & prefix = "security" ) const;
+		};
+
+		/**
+		 * Measures one call of an operation, from its construction to its destruction. The call is accounted
+		 * as an exception if the scope is left by an exception.
+		 */
+		class Scope {
+			OperationMetrics & metrics;
+			uint operation;
+			std::chrono::steady_clock::time_point start;
+			unsigned long long startQueryCount;
+			int uncaughtExceptions;
+			bool failed = false;
+
+		public:
+			Scope( OperationMetrics & metrics, uint operation );
+			~Scope();
+
+			/**
+			 * Copies are forbidden
+			 */
+			Scope( const Scope & original ) = delete;
+			/**
+			 * Copies are forbidden
+			 */
+			Scope & operator=( const Scope & original ) = delete;
+
+			/**
+			 * Accounts the call as an error (a failure reported without an exception).
+			 */
+			void setFailed() {
+				this->failed = true;
+			}
+		};
+
+	private:
+		struct Registry;
+
+		std::vector<std::string> operationNames;
+		std::vector<std::string> cacheNames;
+		unsigned long long identifier;				// Never reused, unlike the address
+		std::shared_ptr<Registry> registry;			// Outlives this instance while a thread still refers to it
+
+	public:
+		/**
+		 * Class constructor.
+		 *
+		 * @param operationNames	The names of the measured operations.
+		 * @param cacheNames		The names of the measured caches.
+		 */
+		OperationMetrics( const std::vector<std::string> & operationNames, const std::vector<std::string> & cacheNames = {} );
+
+		/**
+		 * Class destructor.
+		 */
+		~OperationMetrics();
+
+		/**
+		 * Copies are forbidden
+		 */
+		OperationMetrics( const OperationMetrics & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		OperationMetrics & operator=( const OperationMetrics & original ) = delete;
+
+		/**
+		 * Accounts a completed call of an operation.
+		 *
+		 * @param operation		The operation index.
+		 * @param duration		The duration of the call.
+		 * @param queries		The number of SQL statements executed by the call.
+		 * @param failed		true if the call reported a failure.
+		 * @param threw			true if the call threw an exception.
+		 */
+		void record( uint operation, std::chrono::nanoseconds duration, unsigned long long queries, bool failed, bool threw );
+
+		/**
+		 * Accounts a cache lookup.
+		 *
+		 * @param cache		The cache index.
+		 * @param hit		true if the lookup found its entry.
+		 */
+		void recordLookup( uint cache, bool hit );
+
+		/**
+		 * Sums the counters of every thread.
+		 *
+		 * @return The current measures.
+		 */
+		Snapshot getSnapshot() const;
+
+		/**
+		 * Accounts a SQL statement executed by the calling thread: the scopes opened by this thread add it to
+		 * the query count of their operation.
+		 */
+		static void countQuery();
+
+		/**
+		 * Returns the bucket of a duration.
+		 *
+		 * @param nanoseconds	The duration.
+		 * @return The bucket index.
+		 */
+		static uint getBucket( unsigned long long nanoseconds );
+
+		/**
+		 * Returns the greatest duration of a bucket.
+		 *
+		 * @param bucket	The bucket index.
+		 * @return The duration, in nanoseconds.
+		 */
+		static unsigned long long getBucketLimit( uint bucket );
+
+	private:
+
+		struct ThreadCounters;
+
+		/**
+		 * Returns the counters written by the calling thread, registering them the first time.
+		 */
+		ThreadCounters & getThreadCounters();
+	};
+
+}
+
+#endif /* IMPL_OPERATIONMETRICS_H_ */
@@ -0,0 +1,142 @@
+/*
+ * Pbkdf2PasswordHasher.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <random>
+
+#include "Base64.h"
+#include "Pbkdf2PasswordHasher.h"
+#include "Sha256.h"
+#include "Sha256MultiBuffer.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+const std::string Pbkdf2PasswordHasher::PREFIX = "$pbkdf2-sha256$";
+
+Pbkdf2PasswordHasher::Pbkdf2PasswordHasher( uint iterations ) : iterations( iterations == 0 ? 1 : iterations ) {
+}
+
+std::string Pbkdf2PasswordHasher::hash( const std::string & clearPassword ) const {
+	vector<uint8_t> salt = generateSalt();
+	return encode( this->iterations, salt, pbkdf2HmacSha256( clearPassword, salt, this->iterations, HASH_LENGTH ) );
+}
+
+bool Pbkdf2PasswordHasher::verify( const std::string & clearPassword, const std::string & encodedPassword ) const {
+	uint hashIterations;
+	vector<uint8_t> salt;
+	vector<uint8_t> expectedHash;
+	if ( ! decode( encodedPassword, hashIterations, salt, expectedHash ) ) {
+		// Legacy password, stored in clear (it may start with a '$')
+		return constantTimeEquals( clearPassword, encodedPassword );
+	}
+
+	vector<uint8_t> computedHash = pbkdf2HmacSha256( clearPassword, salt, hashIterations, expectedHash.size() );
+	return constantTimeEquals( string( computedHash.begin(), computedHash.end() ), string( expectedHash.begin(), expectedHash.end() ) );
+}
+
+bool Pbkdf2PasswordHasher::needsRehash( const std::string & encodedPassword ) const {
+	uint hashIterations;
+	vector<uint8_t> salt;
+	vector<uint8_t> hash;
+	if ( ! decode( encodedPassword, hashIterations, salt, hash ) ) return true;
+	return hashIterations < this->iterations;
+}
+
+bool Pbkdf2PasswordHasher::isEncoded( const std::string & storedPassword ) const {
+	uint hashIterations;
+	vector<uint8_t> salt;
+	vector<uint8_t> hash;
+	return decode( storedPassword, hashIterations, salt, hash );
+}
+
+std::vector<std::string> Pbkdf2PasswordHasher::hashBatch( const std::vector<std::string> & clearPasswords ) const {
+	vector<Pbkdf2Input> inputs;
+	inputs.reserve( clearPasswords.size() );
+	for( const string & clearPassword : clearPasswords ) {
+		inputs.push_back( Pbkdf2Input { clearPassword, generateSalt(), this->iterations } );
+	}
+
+	vector<vector<uint8_t>> hashes = Sha256MultiBuffer::pbkdf2HmacSha256( inputs, HASH_LENGTH );
+	vector<string> encodedPasswords;
+	encodedPasswords.reserve( inputs.size() );
+	for( size_t i=0; i<inputs.size(); i++ ) {
+		encodedPasswords.push_back( encode( this->iterations, inputs[i].salt, hashes[i] ) );
+	}
+	return encodedPasswords;
+}
+
+std::vector<bool> Pbkdf2PasswordHasher::verifyBatch( const std::vector<std::string> & clearPasswords,
+													 const std::vector<std::string> & encodedPasswords ) const {
+	vector<bool> results( clearPasswords.size(), false );
+	vector<Pbkdf2Input> inputs;
+	vector<vector<uint8_t>> expectedHashes;
+	vector<size_t> positions;
+
+	for( size_t i=0; i<clearPasswords.size(); i++ ) {
+		const string & encodedPassword = encodedPasswords[i];
+		Pbkdf2Input input { clearPasswords[i], {}, 0 };
+		vector<uint8_t> expectedHash;
+		if ( ! decode( encodedPassword, input.iterations, input.salt, expectedHash ) ) {
+			results[i] = constantTimeEquals( clearPasswords[i], encodedPassword );
+			continue;
+		}
+		// The batch derives keys of a single length
+		if ( expectedHash.size() != HASH_LENGTH ) {
+			results[i] = this->verify( clearPasswords[i], encodedPassword );
+			continue;
+		}
+		inputs.push_back( move( input ) );
+		expectedHashes.push_back( move( expectedHash ) );
+		positions.push_back( i );
+	}
+
+	vector<vector<uint8_t>> computedHashes = Sha256MultiBuffer::pbkdf2HmacSha256( inputs, HASH_LENGTH );
+	for( size_t i=0; i<inputs.size(); i++ ) {
+		results[ positions[i] ] = constantTimeEquals( string( computedHashes[i].begin(), computedHashes[i].end() ),
+													  string( expectedHashes[i].begin(), expectedHashes[i].end() ) );
+	}
+	return results;
+}
+
+std::string Pbkdf2PasswordHasher::encode( uint iterations, const std::vector<uint8_t> & salt, const std::vector<uint8_t> & hash ) {
+	return PREFIX + to_string( iterations ) + "$" + Base64::encode( salt, true ) + "$" + Base64::encode( hash, true );
+}
+
+bool Pbkdf2PasswordHasher::decode( const std::string & encodedPassword, uint & iterations, std::vector<uint8_t> & salt, std::vector<uint8_t> & hash ) {
+	if ( encodedPassword.compare( 0, PREFIX.size(), PREFIX ) != 0 ) return false;
+
+	size_t iterationsEnd = encodedPassword.find( '$', PREFIX.size() );
+	if ( iterationsEnd == string::npos || iterationsEnd == PREFIX.size() ) return false;
+	size_t saltEnd = encodedPassword.find( '$', iterationsEnd + 1 );
+	if ( saltEnd == string::npos ) return false;
+
+	unsigned long long parsedIterations = 0;
+	for( size_t i=PREFIX.size(); i<iterationsEnd; i++ ) {
+		char digit = encodedPassword[i];
+		if ( digit < '0' || digit > '9' ) return false;
+		parsedIterations = parsedIterations * 10 + ( digit - '0' );
+		if ( parsedIterations > 0xffffffffULL ) return false;
+	}
+	if ( parsedIterations == 0 ) return false;
+	iterations = (uint) parsedIterations;
+
+	if ( ! Base64::decode( encodedPassword.substr( iterationsEnd + 1, saltEnd - iterationsEnd - 1 ), salt ) ) return false;
+	if ( ! Base64::decode( encodedPassword.substr( saltEnd + 1 ), hash ) ) return false;
+	return ! hash.empty();
+}
+
+std::vector<uint8_t> Pbkdf2PasswordHasher::generateSalt() {
+	random_device randomDevice;
+	vector<uint8_t> salt( SALT_LENGTH );
+	for( size_t i=0; i<SALT_LENGTH; i += 4 ) {
+		uint32_t value = randomDevice();
+		for( size_t j=0; j<4 && i+j<SALT_LENGTH; j++ ) salt[i+j] = (uint8_t) ( value >> ( 8 * j ) );
+	}
+	return salt;
+}
@@ -0,0 +1,119 @@
+/*
+ * Pbkdf2PasswordHasher.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_PBKDF2PASSWORDHASHER_H_
+#define IMPL_PBKDF2PASSWORDHASHER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../api/PasswordHasher.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * <p>
+	 *     A password hasher based on PBKDF2-HMAC-SHA256. Encoded hashes have the following format:
+	 *     <code>$pbkdf2-sha256$&lt;iterations&gt;$&lt;salt&gt;$&lt;hash&gt;</code>, where salt and hash
+	 *     are encoded in unpadded URL safe Base64.
+	 * </p>
+	 * <p>
+	 *     The batch methods compute the derivations with the multi-buffer SHA-256 kernels.
+	 * </p>
+	 * <p>
+	 *     Passwords stored in clear by the previous versions of the security component (any value which
+	 *     isn't a valid encoded hash, even if it starts with a '$') are still accepted, and are reported as
+	 *     needing a rehash.
+	 * </p>
+	 *
+	 * @author KooR.fr
+	 */
+	class Pbkdf2PasswordHasher : public PasswordHasher {
+		uint iterations;
+	public:
+		/**
+		 * The prefix of the encoded hashes produced by this hasher.
+		 */
+		static const std::string PREFIX;
+
+		/**
+		 * The default iteration count.
+		 */
+		static const uint DEFAULT_ITERATIONS = 100000;
+
+		/**
+		 * The length, in bytes, of the generated salts.
+		 */
+		static const size_t SALT_LENGTH = 16;
+
+		/**
+		 * The length, in bytes, of the derived keys.
+		 */
+		static const size_t HASH_LENGTH = 32;
+
+		/**
+		 * Class constructor.
+		 *
+		 * @param iterations	The iteration count used for the new hashes.
+		 */
+		Pbkdf2PasswordHasher( uint iterations = DEFAULT_ITERATIONS );
+
+		std::string hash( const std::string & clearPassword ) const override;
+
+		bool verify( const std::string & clearPassword, const std::string & encodedPassword ) const override;
+
+		bool needsRehash( const std::string & encodedPassword ) const override;
+
+		bool isEncoded( const std::string & storedPassword ) const override;
+
+		std::vector<std::string> hashBatch( const std::vector<std::string> & clearPasswords ) const override;
+
+		std::vector<bool> verifyBatch( const std::vector<std::string> & clearPasswords,
+									   const std::vector<std::string> & encodedPasswords ) const override;
+
+		/**
+		 * Returns the iteration count used for the new hashes.
+		 * @return The iteration count.
+		 */
+		uint getIterations() const {
+			return this->iterations;
+		}
+
+		/**
+		 * Builds an encoded hash.
+		 *
+		 * @param iterations	The iteration count.
+		 * @param salt			The salt.
+		 * @param hash			The derived key.
+		 * @return The encoded hash.
+		 */
+		static std::string encode( uint iterations, const std::vector<uint8_t> & salt, const std::vector<uint8_t> & hash );
+
+		/**
+		 * Parses an encoded hash.
+		 *
+		 * @param encodedPassword	The encoded hash.
+		 * @param iterations		Receives the iteration count.
+		 * @param salt				Receives the salt.
+		 * @param hash				Receives the derived key.
+		 * @return true if the encoded hash is a valid PBKDF2 hash, false otherwise.
+		 */
+		static bool decode( const std::string & encodedPassword, uint & iterations, std::vector<uint8_t> & salt, std::vector<uint8_t> & hash );
+
+		/**
+		 * Generates a random salt.
+		 *
+		 * @return The new salt.
+		 */
+		static std::vector<uint8_t> generateSalt();
+	};
+
+}
+
+#endif /* IMPL_PBKDF2PASSWORDHASHER_H_ */
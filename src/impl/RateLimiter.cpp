@@ -0,0 +1,86 @@
+/*
+ * RateLimiter.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <functional>
+
+#include "RateLimiter.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+//--------------------------------------------------------------------------------------------
+//--- RateLimiter implementation -------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+RateLimiter::RateLimiter( uint burst, std::chrono::milliseconds interval, size_t capacity )
+	: emissionInterval( 0 ), burstTolerance( 0 ), shardCapacity( max( (size_t) 1, capacity / SHARD_COUNT ) ) {
+	this->setLimit( burst, interval );
+}
+
+void RateLimiter::setLimit( uint burst, std::chrono::milliseconds interval ) {
+	int64_t emissionInterval = chrono::duration_cast<chrono::nanoseconds>( interval ).count();
+	this->emissionInterval = emissionInterval;
+	this->burstTolerance = emissionInterval * ( max( burst, 1u ) - 1 );
+}
+
+bool RateLimiter::tryAcquire( const std::string & key, std::chrono::milliseconds & retryAfter ) {
+	shared_ptr<Bucket> bucket = this->getBucket( key );
+	int64_t now = chrono::duration_cast<chrono::nanoseconds>( Clock::now().time_since_epoch() ).count();
+	int64_t emissionInterval = this->emissionInterval.load( memory_order_relaxed );
+	int64_t burstTolerance = this->burstTolerance.load( memory_order_relaxed );
+
+	int64_t theoreticalArrival = bucket->theoreticalArrival.load( memory_order_relaxed );
+	while ( true ) {
+		int64_t start = max( theoreticalArrival, now );
+		if ( start - now > burstTolerance ) {
+			// Rejected attempts don't consume anything
+			int64_t delay = start - burstTolerance - now;
+			retryAfter = chrono::milliseconds( ( delay + 999999 ) / 1000000 );
+			return false;
+		}
+		if ( bucket->theoreticalArrival.compare_exchange_weak( theoreticalArrival, start + emissionInterval, memory_order_relaxed ) ) {
+			return true;
+		}
+	}
+}
+
+void RateLimiter::reset( const std::string & key ) {
+	Shard & shard = this->shards[ hash<string>()( key ) % SHARD_COUNT ];
+	lock_guard<mutex> lock( shard.mutex );
+	auto iterator = shard.buckets.find( key );
+	if ( iterator != shard.buckets.end() ) iterator->second->second->theoreticalArrival = 0;
+}
+
+size_t RateLimiter::size() {
+	size_t bucketCount = 0;
+	for( Shard & shard : this->shards ) {
+		lock_guard<mutex> lock( shard.mutex );
+		bucketCount += shard.buckets.size();
+	}
+	return bucketCount;
+}
+
+std::shared_ptr<RateLimiter::Bucket> RateLimiter::getBucket( const std::string & key ) {
+	Shard & shard = this->shards[ hash<string>()( key ) % SHARD_COUNT ];
+	lock_guard<mutex> lock( shard.mutex );
+
+	auto iterator = shard.buckets.find( key );
+	if ( iterator != shard.buckets.end() ) {
+		shard.recentBuckets.splice( shard.recentBuckets.begin(), shard.recentBuckets, iterator->second );
+		return iterator->second->second;
+	}
+
+	if ( shard.buckets.size() >= this->shardCapacity ) {
+		shard.buckets.erase( shard.recentBuckets.back().first );
+		shard.recentBuckets.pop_back();
+	}
+	shard.recentBuckets.emplace_front( key, make_shared<Bucket>() );
+	shard.buckets[ key ] = shard.recentBuckets.begin();
+	return shard.recentBuckets.front().second;
+}
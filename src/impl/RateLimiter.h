@@ -0,0 +1,128 @@
+/*
+ * RateLimiter.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_RATELIMITER_H_
+#define IMPL_RATELIMITER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "../api/Common.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * <p>
+	 *     Limits the rate of the attempts made for each key (a login or a source address). Each key owns a
+	 *     token bucket: a burst of attempts is accepted at once, then one attempt per interval. Buckets are
+	 *     implemented with the generic cell rate algorithm: a bucket is a single theoretical arrival time,
+	 *     updated with a compare and swap, so concurrent attempts for the same key never wait for a lock.
+	 * </p>
+	 * <p>
+	 *     Buckets are kept in a sharded table bounded by a capacity: when a shard is full, its least recently
+	 *     used bucket is evicted. An evicted key starts again with a full bucket.
+	 * </p>
+	 *
+	 * @author KooR.fr
+	 */
+	class RateLimiter {
+	public:
+		/**
+		 * The default maximum number of buckets.
+		 */
+		static const size_t DEFAULT_CAPACITY = 65536;
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		static const size_t SHARD_COUNT = 16;
+
+		struct Bucket {
+			std::atomic<int64_t> theoreticalArrival { 0 };		// In nanoseconds, on the steady clock
+		};
+
+		typedef std::list<std::pair<std::string, std::shared_ptr<Bucket>>> BucketList;
+
+		struct alignas(64) Shard {
+			std::mutex mutex;
+			BucketList recentBuckets;					// Most recently used first
+			std::unordered_map<std::string, BucketList::iterator> buckets;
+		};
+
+		std::atomic<int64_t> emissionInterval;			// In nanoseconds
+		std::atomic<int64_t> burstTolerance;			// In nanoseconds
+		const size_t shardCapacity;
+		Shard shards[ SHARD_COUNT ];
+
+	public:
+		/**
+		 * Class constructor.
+		 *
+		 * @param burst		The number of attempts accepted at once for a key.
+		 * @param interval	The delay after which one more attempt is accepted.
+		 * @param capacity	The maximum number of buckets.
+		 */
+		RateLimiter( uint burst, std::chrono::milliseconds interval, size_t capacity = DEFAULT_CAPACITY );
+
+		/**
+		 * Copies are forbidden
+		 */
+		RateLimiter( const RateLimiter & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		RateLimiter & operator=( const RateLimiter & original ) = delete;
+
+		/**
+		 * Changes the limit applied to every key.
+		 *
+		 * @param burst		The number of attempts accepted at once for a key.
+		 * @param interval	The delay after which one more attempt is accepted.
+		 */
+		void setLimit( uint burst, std::chrono::milliseconds interval );
+
+		/**
+		 * Consumes one attempt of a key, if any is available.
+		 *
+		 * @param key			The key (a login or a source).
+		 * @param retryAfter	Receives the delay after which an attempt will be available, if none is.
+		 * @return true if the attempt is accepted, false otherwise.
+		 */
+		bool tryAcquire( const std::string & key, std::chrono::milliseconds & retryAfter );
+
+		/**
+		 * Refills the bucket of a key: all its attempts are available again.
+		 *
+		 * @param key			The key (a login or a source).
+		 */
+		void reset( const std::string & key );
+
+		/**
+		 * Returns the number of buckets currently held.
+		 *
+		 * @return The bucket count.
+		 */
+		size_t size();
+
+	private:
+
+		/**
+		 * Returns the bucket of a key, created if needed, and marks it as the most recently used.
+		 */
+		std::shared_ptr<Bucket> getBucket( const std::string & key );
+	};
+
+}
+
+#endif /* IMPL_RATELIMITER_H_ */
@@ -0,0 +1,82 @@
+/*
+ * RoleRegistry.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <mutex>
+
+#include "RoleRegistry.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+RolePtr RoleRegistry::intern( uint roleIdentifier, const std::string & roleName, RolePtr * replacedRole ) {
+	if ( replacedRole != nullptr ) *replacedRole = nullptr;
+	{
+		// indexedName is the name of the canonical instance, whose name is never changed by the registry
+		shared_lock<shared_mutex> lock( this->registryMutex );
+		auto iterator = this->rolesById.find( roleIdentifier );
+		if ( iterator != this->rolesById.end() && iterator->second.indexedName == roleName ) {
+			return iterator->second.role;
+		}
+	}
+
+	unique_lock<shared_mutex> lock( this->registryMutex );
+	Entry & entry = this->rolesById[ roleIdentifier ];
+	if ( entry.role && entry.indexedName == roleName ) return entry.role;		// Interned meanwhile
+	if ( entry.role ) {
+		// The role has been renamed (by updateRole, or by another process)
+		auto nameIterator = this->rolesByName.find( entry.indexedName );
+		if ( nameIterator != this->rolesByName.end() && nameIterator->second == entry.role ) {
+			this->rolesByName.erase( nameIterator );
+		}
+		if ( replacedRole != nullptr ) *replacedRole = entry.role;
+	}
+	entry.role = make_shared<Role>( roleIdentifier, roleName );
+	entry.indexedName = roleName;
+	this->rolesByName[ roleName ] = entry.role;
+	return entry.role;
+}
+
+RolePtr RoleRegistry::findById( uint roleIdentifier ) const {
+	shared_lock<shared_mutex> lock( this->registryMutex );
+	auto iterator = this->rolesById.find( roleIdentifier );
+	if ( iterator == this->rolesById.end() ) return RolePtr( nullptr );
+	return iterator->second.role;
+}
+
+RolePtr RoleRegistry::findByName( const std::string & roleName ) const {
+	shared_lock<shared_mutex> lock( this->registryMutex );
+	auto iterator = this->rolesByName.find( roleName );
+	if ( iterator == this->rolesByName.end() ) return RolePtr( nullptr );
+	return iterator->second;
+}
+
+void RoleRegistry::remove( uint roleIdentifier ) {
+	unique_lock<shared_mutex> lock( this->registryMutex );
+	auto iterator = this->rolesById.find( roleIdentifier );
+	if ( iterator == this->rolesById.end() ) return;
+
+	auto nameIterator = this->rolesByName.find( iterator->second.indexedName );
+	if ( nameIterator != this->rolesByName.end() && nameIterator->second == iterator->second.role ) {
+		this->rolesByName.erase( nameIterator );
+	}
+	this->rolesById.erase( iterator );
+}
+
+std::vector<uint> RoleRegistry::getIdentifiers() const {
+	shared_lock<shared_mutex> lock( this->registryMutex );
+	vector<uint> identifiers;
+	identifiers.reserve( this->rolesById.size() );
+	for( auto & entry : this->rolesById ) identifiers.push_back( entry.first );
+	return identifiers;
+}
+
+size_t RoleRegistry::size() const {
+	shared_lock<shared_mutex> lock( this->registryMutex );
+	return this->rolesById.size();
+}
@@ -0,0 +1,112 @@
+/*
+ * RoleRegistry.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_ROLEREGISTRY_H_
+#define IMPL_ROLEREGISTRY_H_
+
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../api/Role.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * <p>
+	 *     Interns the Role instances of a security manager: each role identifier is mapped to one canonical
+	 *     instance, allocated once (object and reference count in a single block) and shared by every user
+	 *     holding the role. Roles can therefore be compared by pointer identity.
+	 * </p>
+	 * <p>
+	 *     The canonical instances are never modified, so that they can be read by any thread without locking:
+	 *     when a role is renamed, a new canonical instance replaces the previous one. The users already
+	 *     loaded keep the previous instance, with the previous name: intern reports the replaced instance, so
+	 *     that the security manager can reload or update them.
+	 * </p>
+	 *
+	 * @author KooR.fr
+	 */
+	class RoleRegistry {
+
+		struct Entry {
+			RolePtr role;
+			std::string indexedName;		// The name under which the role is indexed in rolesByName
+		};
+
+		mutable std::shared_mutex registryMutex;
+		std::unordered_map<uint, Entry> rolesById;
+		std::unordered_map<std::string, RolePtr> rolesByName;
+
+	public:
+		/**
+		 * Class constructor: builds an empty registry.
+		 */
+		RoleRegistry() {}
+
+		/**
+		 * Copies are forbidden
+		 */
+		RoleRegistry( const RoleRegistry & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		RoleRegistry & operator=( const RoleRegistry & original ) = delete;
+
+		/**
+		 * Returns the canonical instance of a role, registering it if required. If the role is already
+		 * registered with another name, a new instance replaces the previous one.
+		 *
+		 * @param roleIdentifier	The role identifier.
+		 * @param roleName			The role name.
+		 * @param replacedRole		Receives the previous instance if the role has been renamed, a null
+		 * 							pointer otherwise (may be a null pointer).
+		 * @return The canonical role instance.
+		 */
+		RolePtr intern( uint roleIdentifier, const std::string & roleName, RolePtr * replacedRole = nullptr );
+
+		/**
+		 * Returns the canonical instance of a role.
+		 *
+		 * @param roleIdentifier	The role identifier.
+		 * @return The role instance, or a null pointer if the role is not registered.
+		 */
+		RolePtr findById( uint roleIdentifier ) const;
+
+		/**
+		 * Returns the canonical instance of a role.
+		 *
+		 * @param roleName		The role name.
+		 * @return The role instance, or a null pointer if the role is not registered.
+		 */
+		RolePtr findByName( const std::string & roleName ) const;
+
+		/**
+		 * Unregisters a role.
+		 *
+		 * @param roleIdentifier	The identifier of the role to remove.
+		 */
+		void remove( uint roleIdentifier );
+
+		/**
+		 * Returns the identifiers of all the registered roles.
+		 * @return The role identifiers.
+		 */
+		std::vector<uint> getIdentifiers() const;
+
+		/**
+		 * Returns the number of registered roles.
+		 * @return The role count.
+		 */
+		size_t size() const;
+	};
+
+}
+
+#endif /* IMPL_ROLEREGISTRY_H_ */
@@ -0,0 +1,206 @@
+/*
+ * SessionStore.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <functional>
+#include <random>
+
+#include "Base64.h"
+#include "SessionStore.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+constexpr std::chrono::milliseconds SessionStore::DEFAULT_TICK;
+constexpr std::chrono::seconds SessionStore::DEFAULT_IDLE_TIMEOUT;
+
+
+//--------------------------------------------------------------------------------------------
+//--- TimerWheel implementation --------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+void SessionStore::TimerWheel::schedule( const SessionPtr & session ) {
+	// Deadlines beyond the last level are parked in it: they are scheduled again when their slot fires
+	const uint64_t horizon = ( (uint64_t) 1 << ( LEVEL_BITS * LEVEL_COUNT ) ) - 1;
+	uint64_t deadline = min( max( session->deadline, this->currentTick ), this->currentTick + horizon );
+	uint64_t delta = deadline - this->currentTick;
+
+	uint level = 0;
+	while ( level < LEVEL_COUNT - 1 && delta >= ( (uint64_t) 1 << ( LEVEL_BITS * ( level + 1 ) ) ) ) level++;
+	uint slot = ( deadline >> ( LEVEL_BITS * level ) ) & ( SLOT_COUNT - 1 );
+	this->slots[ level ][ slot ].push_back( session );
+}
+
+void SessionStore::TimerWheel::advance( uint64_t tick, std::vector<SessionPtr> & expiredSessions ) {
+	while ( this->currentTick < tick ) {
+		this->currentTick++;
+
+		// The slots of the upper levels are spread over the lower levels when the lower levels wrap
+		for( uint level=1; level<LEVEL_COUNT; level++ ) {
+			if ( ( this->currentTick & ( ( (uint64_t) 1 << ( LEVEL_BITS * level ) ) - 1 ) ) != 0 ) break;
+			uint slot = ( this->currentTick >> ( LEVEL_BITS * level ) ) & ( SLOT_COUNT - 1 );
+			vector<SessionPtr> cascadedSessions;
+			cascadedSessions.swap( this->slots[ level ][ slot ] );
+			for( SessionPtr & session : cascadedSessions ) {
+				if ( ! session->removed ) this->schedule( session );
+			}
+		}
+
+		vector<SessionPtr> firedSessions;
+		firedSessions.swap( this->slots[ 0 ][ this->currentTick & ( SLOT_COUNT - 1 ) ] );
+		for( SessionPtr & session : firedSessions ) {
+			if ( session->removed ) continue;
+			// Renewed sessions only had their deadline moved: they are scheduled again now
+			if ( session->deadline <= this->currentTick ) {
+				expiredSessions.push_back( session );
+			} else {
+				this->schedule( session );
+			}
+		}
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- SessionStore implementation ------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+SessionStore::SessionStore( std::chrono::milliseconds tick )
+	: tick( max( tick, chrono::milliseconds( 1 ) ) ), origin( Clock::now() ) {
+}
+
+SessionStore::~SessionStore() {
+	this->stopExpiryThread();
+}
+
+std::string SessionStore::create( const User & user, std::chrono::seconds idleTimeout ) {
+	static thread_local random_device randomDevice;
+	uint32_t randomBits[ 4 ];
+	for( uint32_t & value : randomBits ) value = randomDevice();
+
+	SessionPtr session = make_shared<Session>();
+	session->sessionId = Base64::encode( randomBits, sizeof( randomBits ), true );
+	session->user = make_shared<const User>( user );
+	session->idleTicks = max( (uint64_t) 1, (uint64_t) ( ( chrono::duration_cast<chrono::milliseconds>( idleTimeout ) + this->tick - chrono::milliseconds( 1 ) ) / this->tick ) );
+	session->deadline = this->currentTick() + session->idleTicks;
+
+	Shard & shard = this->getShard( session->sessionId );
+	lock_guard<mutex> lock( shard.mutex );
+	shard.sessions[ session->sessionId ] = session;
+	shard.timerWheel.schedule( session );
+	return session->sessionId;
+}
+
+std::shared_ptr<const User> SessionStore::find( const std::string & sessionId ) {
+	uint64_t now = this->currentTick();
+	Shard & shard = this->getShard( sessionId );
+	lock_guard<mutex> lock( shard.mutex );
+	auto iterator = shard.sessions.find( sessionId );
+	if ( iterator == shard.sessions.end() ) return nullptr;
+
+	Session & session = *iterator->second;
+	if ( session.deadline <= now ) return nullptr;			// Expired, not yet collected
+	session.deadline = now + session.idleTicks;
+	return session.user;
+}
+
+bool SessionStore::revoke( const std::string & sessionId ) {
+	Shard & shard = this->getShard( sessionId );
+	lock_guard<mutex> lock( shard.mutex );
+	auto iterator = shard.sessions.find( sessionId );
+	if ( iterator == shard.sessions.end() ) return false;
+
+	// The timer wheel drops the session when its slot fires
+	iterator->second->removed = true;
+	shard.sessions.erase( iterator );
+	return true;
+}
+
+size_t SessionStore::revokeUser( uint userIdentifier ) {
+	size_t revokedCount = 0;
+	for( Shard & shard : this->shards ) {
+		lock_guard<mutex> lock( shard.mutex );
+		for( auto iterator = shard.sessions.begin(); iterator != shard.sessions.end(); ) {
+			if ( (uint) iterator->second->user->getIdentifier() == userIdentifier ) {
+				iterator->second->removed = true;
+				iterator = shard.sessions.erase( iterator );
+				revokedCount++;
+			} else {
+				++iterator;
+			}
+		}
+	}
+	return revokedCount;
+}
+
+size_t SessionStore::expireSessions() {
+	uint64_t now = this->currentTick();
+	size_t expiredCount = 0;
+	vector<SessionPtr> expiredSessions;
+	for( Shard & shard : this->shards ) {
+		lock_guard<mutex> lock( shard.mutex );
+		shard.timerWheel.advance( now, expiredSessions );
+		for( SessionPtr & session : expiredSessions ) {
+			session->removed = true;
+			shard.sessions.erase( session->sessionId );
+		}
+		expiredCount += expiredSessions.size();
+		expiredSessions.clear();
+	}
+	return expiredCount;
+}
+
+void SessionStore::clear() {
+	for( Shard & shard : this->shards ) {
+		lock_guard<mutex> lock( shard.mutex );
+		for( auto & entry : shard.sessions ) entry.second->removed = true;
+		shard.sessions.clear();
+	}
+}
+
+size_t SessionStore::size() {
+	size_t sessionCount = 0;
+	for( Shard & shard : this->shards ) {
+		lock_guard<mutex> lock( shard.mutex );
+		sessionCount += shard.sessions.size();
+	}
+	return sessionCount;
+}
+
+void SessionStore::startExpiryThread() {
+	lock_guard<mutex> lock( this->threadMutex );
+	if ( this->expiryThread.joinable() ) return;
+	this->stopping = false;
+	this->expiryThread = thread( [this] {
+		unique_lock<mutex> lock( this->threadMutex );
+		while ( ! this->stopRequested.wait_for( lock, this->tick, [this] { return this->stopping; } ) ) {
+			lock.unlock();
+			this->expireSessions();
+			lock.lock();
+		}
+	} );
+}
+
+void SessionStore::stopExpiryThread() {
+	thread stoppedThread;
+	{
+		lock_guard<mutex> lock( this->threadMutex );
+		this->stopping = true;
+		stoppedThread.swap( this->expiryThread );
+	}
+	this->stopRequested.notify_all();
+	if ( stoppedThread.joinable() ) stoppedThread.join();
+}
+
+uint64_t SessionStore::currentTick() const {
+	return (uint64_t) ( ( Clock::now() - this->origin ) / this->tick );
+}
+
+SessionStore::Shard & SessionStore::getShard( const std::string & sessionId ) {
+	return this->shards[ hash<string>()( sessionId ) % SHARD_COUNT ];
+}
@@ -0,0 +1,201 @@
+/*
+ * SessionStore.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_SESSIONSTORE_H_
+#define IMPL_SESSIONSTORE_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "../api/User.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * <p>
+	 *     The server side sessions of the authenticated users. A session is identified by a random id and
+	 *     holds a snapshot of its user, taken when the session is created: looking a session up never touches
+	 *     the database. Each lookup renews the session (sliding expiry); a session that is not looked up
+	 *     during its idle timeout expires. Sessions can also be revoked, one by one or all the sessions of a
+	 *     user at once.
+	 * </p>
+	 * <p>
+	 *     Sessions are spread over shards, each one with its own lock. Expiry dates are tracked by one
+	 *     hierarchical timer wheel per shard (4 levels of 64 slots, one slot per tick): scheduling a session
+	 *     is O(1) and a renewal only updates the deadline of the session, which is checked when its slot
+	 *     fires. Expired sessions are collected by a background thread, started by startExpiryThread, at each
+	 *     tick; a session is never returned once its deadline has passed, even if not yet collected.
+	 * </p>
+	 *
+	 * @author KooR.fr
+	 */
+	class SessionStore {
+	public:
+		/**
+		 * The default duration of a timer wheel tick: the expiry precision.
+		 */
+		static constexpr std::chrono::milliseconds DEFAULT_TICK = std::chrono::seconds( 1 );
+
+		/**
+		 * The default idle timeout of a session.
+		 */
+		static constexpr std::chrono::seconds DEFAULT_IDLE_TIMEOUT = std::chrono::minutes( 30 );
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		static const size_t SHARD_COUNT = 16;
+		static const uint LEVEL_BITS = 6;
+		static const uint SLOT_COUNT = 1 << LEVEL_BITS;
+		static const uint LEVEL_COUNT = 4;
+
+		struct Session {
+			std::string sessionId;
+			std::shared_ptr<const User> user;
+			uint64_t idleTicks;
+			uint64_t deadline;			// The tick at which the session expires
+			bool removed = false;
+		};
+
+		typedef std::shared_ptr<Session> SessionPtr;
+
+		/**
+		 * A hierarchical timer wheel: level l holds the sessions whose deadline is less than 64^(l+1) ticks
+		 * away, in the slot given by the bits 6*l to 6*l+5 of their deadline.
+		 */
+		class TimerWheel {
+			std::vector<SessionPtr> slots[ LEVEL_COUNT ][ SLOT_COUNT ];
+			uint64_t currentTick = 0;
+		public:
+			void schedule( const SessionPtr & session );
+			void advance( uint64_t tick, std::vector<SessionPtr> & expiredSessions );
+		};
+
+		struct alignas(64) Shard {
+			std::mutex mutex;
+			std::unordered_map<std::string, SessionPtr> sessions;
+			TimerWheel timerWheel;
+		};
+
+		const std::chrono::milliseconds tick;
+		const Clock::time_point origin;
+		Shard shards[ SHARD_COUNT ];
+
+		std::mutex threadMutex;
+		std::condition_variable stopRequested;
+		bool stopping = false;
+		std::thread expiryThread;
+
+	public:
+		/**
+		 * Class constructor: builds an empty store.
+		 *
+		 * @param tick		The duration of a timer wheel tick.
+		 */
+		SessionStore( std::chrono::milliseconds tick = DEFAULT_TICK );
+
+		/**
+		 * Class destructor: stops the expiry thread.
+		 */
+		~SessionStore();
+
+		/**
+		 * Copies are forbidden
+		 */
+		SessionStore( const SessionStore & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		SessionStore & operator=( const SessionStore & original ) = delete;
+
+		/**
+		 * Opens a session for an authenticated user.
+		 *
+		 * @param user			The user (see UserManager::checkCredentials): a snapshot is kept by the session.
+		 * @param idleTimeout	The duration after which the session expires if it is not looked up.
+		 * @return The session id: 128 random bits, encoded in URL safe Base64.
+		 */
+		std::string create( const User & user, std::chrono::seconds idleTimeout = DEFAULT_IDLE_TIMEOUT );
+
+		/**
+		 * Looks a session up and renews it.
+		 *
+		 * @param sessionId		The session id.
+		 * @return The user snapshot of the session, or a null pointer if the session is unknown, expired or
+		 *         revoked.
+		 */
+		std::shared_ptr<const User> find( const std::string & sessionId );
+
+		/**
+		 * Revokes a session.
+		 *
+		 * @param sessionId		The session id.
+		 * @return true if the session was revoked, false if it was unknown.
+		 */
+		bool revoke( const std::string & sessionId );
+
+		/**
+		 * Revokes all the sessions of a user. This method scans every session.
+		 *
+		 * @param userIdentifier	The user identifier.
+		 * @return The number of revoked sessions.
+		 */
+		size_t revokeUser( uint userIdentifier );
+
+		/**
+		 * Collects the sessions expired since the last call (the expiry thread calls it at each tick).
+		 *
+		 * @return The number of expired sessions.
+		 */
+		size_t expireSessions();
+
+		/**
+		 * Revokes all the sessions.
+		 */
+		void clear();
+
+		/**
+		 * Returns the number of sessions, including those expired but not yet collected.
+		 *
+		 * @return The session count.
+		 */
+		size_t size();
+
+		/**
+		 * Starts the thread that collects the expired sessions, if not already started.
+		 */
+		void startExpiryThread();
+
+		/**
+		 * Stops the thread that collects the expired sessions.
+		 */
+		void stopExpiryThread();
+
+	private:
+
+		/**
+		 * Returns the current tick, counted from the creation of the store.
+		 */
+		uint64_t currentTick() const;
+
+		/**
+		 * Returns the shard that holds a session.
+		 */
+		Shard & getShard( const std::string & sessionId );
+	};
+
+}
+
+#endif /* IMPL_SESSIONSTORE_H_ */
@@ -0,0 +1,253 @@
+/*
+ * Sha256.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <cstring>
+
+#include "Sha256.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+//--------------------------------------------------------------------------------------------
+//--- Utility functions ----------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+static inline uint32_t rotateRight( uint32_t value, int bits ) {
+	return ( value >> bits ) | ( value << ( 32 - bits ) );
+}
+
+static inline uint32_t loadBigEndian( const uint8_t * bytes ) {
+	return ( (uint32_t) bytes[0] << 24 ) | ( (uint32_t) bytes[1] << 16 ) | ( (uint32_t) bytes[2] << 8 ) | (uint32_t) bytes[3];
+}
+
+static inline void storeBigEndian( uint8_t * bytes, uint32_t value ) {
+	bytes[0] = (uint8_t) ( value >> 24 );
+	bytes[1] = (uint8_t) ( value >> 16 );
+	bytes[2] = (uint8_t) ( value >> 8 );
+	bytes[3] = (uint8_t) value;
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- Sha256 implementation ------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+const uint32_t Sha256::INITIAL_STATE[ 8 ] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+const uint32_t Sha256::ROUND_CONSTANTS[ 64 ] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+Sha256::Sha256() {
+	memcpy( this->state, INITIAL_STATE, sizeof( this->state ) );
+}
+
+void Sha256::update( const void * data, size_t length ) {
+	const uint8_t * bytes = (const uint8_t *) data;
+	this->messageLength += length;
+
+	if ( this->bufferLength > 0 ) {
+		size_t copied = min( length, BLOCK_SIZE - this->bufferLength );
+		memcpy( this->buffer + this->bufferLength, bytes, copied );
+		this->bufferLength += copied;
+		bytes += copied;
+		length -= copied;
+		if ( this->bufferLength < BLOCK_SIZE ) return;
+		compress( this->state, this->buffer );
+		this->bufferLength = 0;
+	}
+
+	while ( length >= BLOCK_SIZE ) {
+		compress( this->state, bytes );
+		bytes += BLOCK_SIZE;
+		length -= BLOCK_SIZE;
+	}
+
+	memcpy( this->buffer, bytes, length );
+	this->bufferLength = length;
+}
+
+Sha256::Digest Sha256::finish() {
+	uint64_t bitLength = this->messageLength * 8;
+
+	this->buffer[ this->bufferLength++ ] = 0x80;
+	if ( this->bufferLength > BLOCK_SIZE - 8 ) {
+		memset( this->buffer + this->bufferLength, 0, BLOCK_SIZE - this->bufferLength );
+		compress( this->state, this->buffer );
+		this->bufferLength = 0;
+	}
+	memset( this->buffer + this->bufferLength, 0, BLOCK_SIZE - 8 - this->bufferLength );
+	storeBigEndian( this->buffer + 56, (uint32_t) ( bitLength >> 32 ) );
+	storeBigEndian( this->buffer + 60, (uint32_t) bitLength );
+	compress( this->state, this->buffer );
+
+	Digest result;
+	storeState( this->state, result.data() );
+	return result;
+}
+
+Sha256::Digest Sha256::digest( const void * data, size_t length ) {
+	Sha256 sha256;
+	sha256.update( data, length );
+	return sha256.finish();
+}
+
+void Sha256::compress( uint32_t state[ 8 ], const uint8_t block[ BLOCK_SIZE ] ) {
+	uint32_t w[ 64 ];
+	for( int i=0; i<16; i++ ) w[i] = loadBigEndian( block + 4 * i );
+	for( int i=16; i<64; i++ ) {
+		uint32_t s0 = rotateRight( w[i-15], 7 ) ^ rotateRight( w[i-15], 18 ) ^ ( w[i-15] >> 3 );
+		uint32_t s1 = rotateRight( w[i-2], 17 ) ^ rotateRight( w[i-2], 19 ) ^ ( w[i-2] >> 10 );
+		w[i] = w[i-16] + s0 + w[i-7] + s1;
+	}
+
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+	uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+	for( int i=0; i<64; i++ ) {
+		uint32_t s1 = rotateRight( e, 6 ) ^ rotateRight( e, 11 ) ^ rotateRight( e, 25 );
+		uint32_t choice = ( e & f ) ^ ( ~e & g );
+		uint32_t temp1 = h + s1 + choice + ROUND_CONSTANTS[i] + w[i];
+		uint32_t s0 = rotateRight( a, 2 ) ^ rotateRight( a, 13 ) ^ rotateRight( a, 22 );
+		uint32_t majority = ( a & b ) ^ ( a & c ) ^ ( b & c );
+		uint32_t temp2 = s0 + majority;
+
+		h = g; g = f; f = e; e = d + temp1;
+		d = c; c = b; b = a; a = temp1 + temp2;
+	}
+
+	state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+	state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void Sha256::storeState( const uint32_t state[ 8 ], uint8_t * digest ) {
+	for( int i=0; i<8; i++ ) storeBigEndian( digest + 4 * i, state[i] );
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- HmacSha256 implementation --------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+HmacSha256::HmacSha256( const void * key, size_t keyLength ) {
+	uint8_t paddedKey[ Sha256::BLOCK_SIZE ] = { 0 };
+	if ( keyLength > Sha256::BLOCK_SIZE ) {
+		Sha256::Digest keyDigest = Sha256::digest( key, keyLength );
+		memcpy( paddedKey, keyDigest.data(), keyDigest.size() );
+	} else {
+		memcpy( paddedKey, key, keyLength );
+	}
+
+	uint8_t innerKey[ Sha256::BLOCK_SIZE ];
+	for( size_t i=0; i<Sha256::BLOCK_SIZE; i++ ) {
+		innerKey[i] = paddedKey[i] ^ 0x36;
+		this->outerKey[i] = paddedKey[i] ^ 0x5c;
+	}
+	this->inner.update( innerKey, sizeof( innerKey ) );
+}
+
+Sha256::Digest HmacSha256::finish() {
+	Sha256::Digest innerDigest = this->inner.finish();
+	Sha256 outer;
+	outer.update( this->outerKey, sizeof( this->outerKey ) );
+	outer.update( innerDigest.data(), innerDigest.size() );
+	return outer.finish();
+}
+
+Sha256::Digest HmacSha256::mac( const void * key, size_t keyLength, const void * data, size_t length ) {
+	HmacSha256 hmac( key, keyLength );
+	hmac.update( data, length );
+	return hmac.finish();
+}
+
+void HmacSha256::precomputeStates( const void * key, size_t keyLength, uint32_t innerState[ 8 ], uint32_t outerState[ 8 ] ) {
+	HmacSha256 hmac( key, keyLength );
+	memcpy( innerState, hmac.inner.state, sizeof( hmac.inner.state ) );
+	memcpy( outerState, Sha256::INITIAL_STATE, sizeof( Sha256::INITIAL_STATE ) );
+	Sha256::compress( outerState, hmac.outerKey );
+}
+
+Sha256::Digest HmacSha256::mac( const uint32_t innerState[ 8 ], const uint32_t outerState[ 8 ], const void * data, size_t length ) {
+	Sha256 inner;
+	memcpy( inner.state, innerState, sizeof( inner.state ) );
+	inner.messageLength = Sha256::BLOCK_SIZE;
+	inner.update( data, length );
+	Sha256::Digest innerDigest = inner.finish();
+
+	Sha256 outer;
+	memcpy( outer.state, outerState, sizeof( outer.state ) );
+	outer.messageLength = Sha256::BLOCK_SIZE;
+	outer.update( innerDigest.data(), innerDigest.size() );
+	return outer.finish();
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- PBKDF2 implementation ------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+std::vector<uint8_t> fr::koor::security::pbkdf2HmacSha256( const std::string & password, const std::vector<uint8_t> & salt, uint iterations, size_t keyLength ) {
+	uint32_t innerState[ 8 ];
+	uint32_t outerState[ 8 ];
+	HmacSha256::precomputeStates( password.data(), password.size(), innerState, outerState );
+
+	// Each iteration hashes a 32 bytes message after a 64 bytes padded key: the padding is constant
+	uint8_t block[ Sha256::BLOCK_SIZE ] = { 0 };
+	block[ Sha256::DIGEST_SIZE ] = 0x80;
+	storeBigEndian( block + 60, ( Sha256::BLOCK_SIZE + Sha256::DIGEST_SIZE ) * 8 );
+
+	vector<uint8_t> derivedKey;
+	derivedKey.reserve( keyLength );
+	for( uint32_t blockIndex = 1; derivedKey.size() < keyLength; blockIndex++ ) {
+		uint8_t counter[ 4 ];
+		storeBigEndian( counter, blockIndex );
+		HmacSha256 firstHmac( password.data(), password.size() );
+		firstHmac.update( salt.data(), salt.size() );
+		firstHmac.update( counter, sizeof( counter ) );
+		Sha256::Digest u = firstHmac.finish();
+		Sha256::Digest result = u;
+
+		for( uint i=1; i<iterations; i++ ) {
+			uint32_t state[ 8 ];
+			memcpy( block, u.data(), u.size() );
+			memcpy( state, innerState, sizeof( state ) );
+			Sha256::compress( state, block );
+
+			Sha256::storeState( state, block );
+			memcpy( state, outerState, sizeof( state ) );
+			Sha256::compress( state, block );
+
+			Sha256::storeState( state, u.data() );
+			for( size_t j=0; j<Sha256::DIGEST_SIZE; j++ ) result[j] ^= u[j];
+		}
+
+		size_t copied = min( keyLength - derivedKey.size(), result.size() );
+		derivedKey.insert( derivedKey.end(), result.begin(), result.begin() + copied );
+	}
+	return derivedKey;
+}
+
+bool fr::koor::security::constantTimeEquals( const std::string & first, const std::string & second ) {
+	if ( first.size() != second.size() ) return false;
+	return constantTimeEquals( (const uint8_t *) first.data(), (const uint8_t *) second.data(), first.size() );
+}
+
+bool fr::koor::security::constantTimeEquals( const uint8_t * first, const uint8_t * second, size_t length ) {
+	volatile uint8_t difference = 0;
+	for( size_t i=0; i<length; i++ ) difference |= first[i] ^ second[i];
+	return difference == 0;
+}
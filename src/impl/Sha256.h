@@ -0,0 +1,218 @@
+/*
+ * Sha256.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_SHA256_H_
+#define IMPL_SHA256_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../api/Common.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * An implementation of the SHA-256 hash function (FIPS 180-4).
+	 *
+	 * @author KooR.fr
+	 */
+	class Sha256 {
+	public:
+		/**
+		 * The size, in bytes, of a SHA-256 digest.
+		 */
+		static const size_t DIGEST_SIZE = 32;
+
+		/**
+		 * The size, in bytes, of a SHA-256 message block.
+		 */
+		static const size_t BLOCK_SIZE = 64;
+
+		typedef std::array<uint8_t, DIGEST_SIZE> Digest;
+
+		/**
+		 * The SHA-256 initial hash value.
+		 */
+		static const uint32_t INITIAL_STATE[ 8 ];
+
+		/**
+		 * The SHA-256 round constants.
+		 */
+		static const uint32_t ROUND_CONSTANTS[ 64 ];
+
+	private:
+		uint32_t state[ 8 ];
+		uint8_t buffer[ BLOCK_SIZE ];
+		size_t bufferLength = 0;
+		uint64_t messageLength = 0;
+
+	public:
+		/**
+		 * Class constructor: starts a new hash computation.
+		 */
+		Sha256();
+
+		/**
+		 * Adds data to the hashed message.
+		 *
+		 * @param data		The data to add.
+		 * @param length	The number of bytes to add.
+		 */
+		void update( const void * data, size_t length );
+
+		/**
+		 * Adds data to the hashed message.
+		 *
+		 * @param data		The data to add.
+		 */
+		void update( const std::string & data ) {
+			this->update( data.data(), data.size() );
+		}
+
+		/**
+		 * Terminates the hash computation.
+		 *
+		 * @return The message digest.
+		 */
+		Digest finish();
+
+		/**
+		 * Computes the digest of a message.
+		 *
+		 * @param data		The message.
+		 * @param length	The message length, in bytes.
+		 * @return The message digest.
+		 */
+		static Digest digest( const void * data, size_t length );
+
+		/**
+		 * Applies the SHA-256 compression function to one message block.
+		 *
+		 * @param state		The hash state to update.
+		 * @param block		The 64 bytes message block.
+		 */
+		static void compress( uint32_t state[ 8 ], const uint8_t block[ BLOCK_SIZE ] );
+
+		/**
+		 * Writes a hash state as a big endian digest.
+		 *
+		 * @param state		The hash state.
+		 * @param digest	The 32 bytes output.
+		 */
+		static void storeState( const uint32_t state[ 8 ], uint8_t * digest );
+
+		friend class HmacSha256;
+	};
+
+
+	/**
+	 * An implementation of HMAC-SHA256 (RFC 2104).
+	 *
+	 * @author KooR.fr
+	 */
+	class HmacSha256 {
+		Sha256 inner;
+		uint8_t outerKey[ Sha256::BLOCK_SIZE ];
+	public:
+		/**
+		 * Class constructor: starts a new MAC computation.
+		 *
+		 * @param key		The secret key.
+		 * @param keyLength	The key length, in bytes.
+		 */
+		HmacSha256( const void * key, size_t keyLength );
+
+		/**
+		 * Adds data to the authenticated message.
+		 *
+		 * @param data		The data to add.
+		 * @param length	The number of bytes to add.
+		 */
+		void update( const void * data, size_t length ) {
+			this->inner.update( data, length );
+		}
+
+		/**
+		 * Terminates the MAC computation.
+		 *
+		 * @return The message authentication code.
+		 */
+		Sha256::Digest finish();
+
+		/**
+		 * Computes the authentication code of a message.
+		 *
+		 * @param key			The secret key.
+		 * @param keyLength		The key length, in bytes.
+		 * @param data			The message.
+		 * @param length		The message length, in bytes.
+		 * @return The message authentication code.
+		 */
+		static Sha256::Digest mac( const void * key, size_t keyLength, const void * data, size_t length );
+
+		/**
+		 * Computes the hash states obtained after the inner and outer padded keys. PBKDF2 uses them to
+		 * compute each HMAC of its iterations with exactly two compressions.
+		 *
+		 * @param key			The secret key.
+		 * @param keyLength		The key length, in bytes.
+		 * @param innerState	Receives the state after the inner padded key.
+		 * @param outerState	Receives the state after the outer padded key.
+		 */
+		static void precomputeStates( const void * key, size_t keyLength, uint32_t innerState[ 8 ], uint32_t outerState[ 8 ] );
+
+		/**
+		 * Computes the authentication code of a message from the states precomputed for a key (see
+		 * precomputeStates): the padded keys are not hashed again.
+		 *
+		 * @param innerState	The state after the inner padded key.
+		 * @param outerState	The state after the outer padded key.
+		 * @param data			The message.
+		 * @param length		The message length, in bytes.
+		 * @return The message authentication code.
+		 */
+		static Sha256::Digest mac( const uint32_t innerState[ 8 ], const uint32_t outerState[ 8 ], const void * data, size_t length );
+	};
+
+
+	/**
+	 * Derives a key from a password with PBKDF2-HMAC-SHA256 (RFC 8018).
+	 *
+	 * @param password		The password.
+	 * @param salt			The salt.
+	 * @param iterations	The iteration count (at least 1).
+	 * @param keyLength		The length, in bytes, of the derived key.
+	 * @return The derived key.
+	 */
+	std::vector<uint8_t> pbkdf2HmacSha256( const std::string & password, const std::vector<uint8_t> & salt, uint iterations, size_t keyLength );
+
+	/**
+	 * Compares two byte strings in a time that doesn't depend on the position of the first difference.
+	 *
+	 * @param first		The first string.
+	 * @param second	The second string.
+	 * @return true if both strings are equal, false otherwise.
+	 */
+	bool constantTimeEquals( const std::string & first, const std::string & second );
+
+	/**
+	 * Compares two byte arrays in a time that doesn't depend on the position of the first difference.
+	 *
+	 * @param first		The first array.
+	 * @param second	The second array.
+	 * @param length	The length, in bytes, of both arrays.
+	 * @return true if both arrays are equal, false otherwise.
+	 */
+	bool constantTimeEquals( const uint8_t * first, const uint8_t * second, size_t length );
+
+}
+
+#endif /* IMPL_SHA256_H_ */
@@ -0,0 +1,261 @@
+/*
+ * Sha256MultiBuffer.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <algorithm>
+#include <cstring>
+
+#include "Sha256.h"
+#include "Sha256MultiBuffer.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+//--------------------------------------------------------------------------------------------
+//--- Lane kernels ---------------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+// One 32 bits word per lane. The kernels below are generic: each target specific wrapper inlines
+// them, so that the compiler emits SSE2, AVX2 or AVX-512 instructions for the same source.
+typedef uint32_t Lanes4 __attribute__(( vector_size( 16 ) ));
+typedef uint32_t Lanes8 __attribute__(( vector_size( 32 ) ));
+typedef uint32_t Lanes16 __attribute__(( vector_size( 64 ) ));
+
+#define LANE_KERNEL inline __attribute__(( always_inline ))
+
+// Lane kernels are always inlined: the ABI of vector return values never applies to them
+#pragma GCC diagnostic ignored "-Wpsabi"
+
+template <typename Vector>
+static LANE_KERNEL Vector broadcast( uint32_t value ) {
+	Vector result = {};
+	return result + value;
+}
+
+// A macro rather than a function: GCC reports ABI notes for vector parameters, even always inlined
+#define ROTATE_RIGHT( value, bits ) ( ( ( value ) >> ( bits ) ) | ( ( value ) << ( 32 - ( bits ) ) ) )
+
+/**
+ * The SHA-256 compression function applied to one block per lane. Words are already in host order.
+ */
+template <typename Vector>
+static LANE_KERNEL void compressLanes( Vector state[ 8 ], Vector w[ 16 ] ) {
+	Vector a = state[0], b = state[1], c = state[2], d = state[3];
+	Vector e = state[4], f = state[5], g = state[6], h = state[7];
+
+	for( int i=0; i<64; i++ ) {
+		if ( i >= 16 ) {
+			// The message schedule is kept in a ring of 16 words
+			Vector w15 = w[ ( i + 1 ) & 15 ];
+			Vector w2 = w[ ( i + 14 ) & 15 ];
+			Vector s0 = ROTATE_RIGHT( w15, 7 ) ^ ROTATE_RIGHT( w15, 18 ) ^ ( w15 >> 3 );
+			Vector s1 = ROTATE_RIGHT( w2, 17 ) ^ ROTATE_RIGHT( w2, 19 ) ^ ( w2 >> 10 );
+			w[ i & 15 ] += s0 + w[ ( i + 9 ) & 15 ] + s1;
+		}
+
+		Vector s1 = ROTATE_RIGHT( e, 6 ) ^ ROTATE_RIGHT( e, 11 ) ^ ROTATE_RIGHT( e, 25 );
+		Vector choice = ( e & f ) ^ ( ~e & g );
+		Vector temp1 = h + s1 + choice + Sha256::ROUND_CONSTANTS[i] + w[ i & 15 ];
+		Vector s0 = ROTATE_RIGHT( a, 2 ) ^ ROTATE_RIGHT( a, 13 ) ^ ROTATE_RIGHT( a, 22 );
+		Vector majority = ( a & b ) ^ ( a & c ) ^ ( b & c );
+		Vector temp2 = s0 + majority;
+
+		h = g; g = f; f = e; e = d + temp1;
+		d = c; c = b; b = a; a = temp1 + temp2;
+	}
+
+	state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+	state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+/**
+ * Fills a message block with a 32 bytes digest followed by the constant padding of a message of 96 bytes
+ * (a 64 bytes padded HMAC key, then the digest).
+ */
+template <typename Vector>
+static LANE_KERNEL void loadDigestBlock( Vector w[ 16 ], const Vector digest[ 8 ] ) {
+	for( int j=0; j<8; j++ ) w[j] = digest[j];
+	w[8] = broadcast<Vector>( 0x80000000 );
+	for( int j=9; j<15; j++ ) w[j] = broadcast<Vector>( 0 );
+	w[15] = broadcast<Vector>( ( Sha256::BLOCK_SIZE + Sha256::DIGEST_SIZE ) * 8 );
+}
+
+/**
+ * Runs the PBKDF2 iterations 2 to maxIterations of every lane. Arrays are transposed: word j of lane l
+ * is at index j * lane count + l. Lanes stop accumulating once their own iteration count is reached.
+ */
+template <typename Vector>
+static LANE_KERNEL void iterateLanes( const uint32_t * innerStates, const uint32_t * outerStates, uint32_t * digests,
+									  uint32_t * results, const uint32_t * iterations, uint maxIterations ) {
+	Vector innerState[ 8 ], outerState[ 8 ], u[ 8 ], result[ 8 ];
+	memcpy( innerState, innerStates, sizeof( innerState ) );
+	memcpy( outerState, outerStates, sizeof( outerState ) );
+	memcpy( u, digests, sizeof( u ) );
+	memcpy( result, results, sizeof( result ) );
+	Vector laneIterations;
+	memcpy( &laneIterations, iterations, sizeof( laneIterations ) );
+
+	for( uint i=1; i<maxIterations; i++ ) {
+		Vector w[ 16 ];
+		Vector state[ 8 ];
+
+		loadDigestBlock( w, u );
+		for( int j=0; j<8; j++ ) state[j] = innerState[j];
+		compressLanes( state, w );
+
+		loadDigestBlock( w, state );
+		for( int j=0; j<8; j++ ) u[j] = outerState[j];
+		compressLanes( u, w );
+
+		Vector active = (Vector) ( laneIterations > broadcast<Vector>( i ) );
+		for( int j=0; j<8; j++ ) result[j] ^= u[j] & active;
+	}
+
+	memcpy( digests, u, sizeof( u ) );
+	memcpy( results, result, sizeof( result ) );
+}
+
+typedef void (*LaneKernel)( const uint32_t *, const uint32_t *, uint32_t *, uint32_t *, const uint32_t *, uint );
+
+static void iterateLanes4( const uint32_t * innerStates, const uint32_t * outerStates, uint32_t * digests,
+						   uint32_t * results, const uint32_t * iterations, uint maxIterations ) {
+	iterateLanes<Lanes4>( innerStates, outerStates, digests, results, iterations, maxIterations );
+}
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+
+__attribute__(( target( "avx2" ) ))
+static void iterateLanes8( const uint32_t * innerStates, const uint32_t * outerStates, uint32_t * digests,
+						   uint32_t * results, const uint32_t * iterations, uint maxIterations ) {
+	iterateLanes<Lanes8>( innerStates, outerStates, digests, results, iterations, maxIterations );
+}
+
+__attribute__(( target( "avx512f" ) ))
+static void iterateLanes16( const uint32_t * innerStates, const uint32_t * outerStates, uint32_t * digests,
+							uint32_t * results, const uint32_t * iterations, uint maxIterations ) {
+	iterateLanes<Lanes16>( innerStates, outerStates, digests, results, iterations, maxIterations );
+}
+
+#endif
+
+/**
+ * Returns the kernel with the highest lane count supported by the processor and not above the requested one.
+ */
+static LaneKernel selectKernel( size_t & laneCount ) {
+#if defined( __x86_64__ ) || defined( __i386__ )
+	__builtin_cpu_init();
+	if ( laneCount >= 16 && __builtin_cpu_supports( "avx512f" ) ) {
+		laneCount = 16;
+		return iterateLanes16;
+	}
+	if ( laneCount >= 8 && __builtin_cpu_supports( "avx2" ) ) {
+		laneCount = 8;
+		return iterateLanes8;
+	}
+#endif
+	if ( laneCount >= 4 ) {
+		laneCount = 4;
+		return iterateLanes4;
+	}
+	laneCount = 1;
+	return nullptr;
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- Sha256MultiBuffer implementation -------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+size_t Sha256MultiBuffer::getLaneCount() {
+	static const size_t laneCount = [] {
+		size_t widest = 16;
+		selectKernel( widest );
+		return widest;
+	}();
+	return laneCount;
+}
+
+std::vector<std::vector<uint8_t>> Sha256MultiBuffer::pbkdf2HmacSha256( const std::vector<Pbkdf2Input> & inputs, size_t keyLength,
+																		 size_t laneCount ) {
+	vector<vector<uint8_t>> derivedKeys( inputs.size() );
+	if ( laneCount == 0 ) laneCount = getLaneCount();
+	LaneKernel kernel = selectKernel( laneCount );
+
+	if ( kernel == nullptr || inputs.size() == 1 ) {
+		for( size_t i=0; i<inputs.size(); i++ ) {
+			derivedKeys[i] = fr::koor::security::pbkdf2HmacSha256( inputs[i].password, inputs[i].salt, inputs[i].iterations, keyLength );
+		}
+		return derivedKeys;
+	}
+
+	// One lane task per output block of each derived key, grouped by iteration count
+	size_t blockCount = ( keyLength + Sha256::DIGEST_SIZE - 1 ) / Sha256::DIGEST_SIZE;
+	vector<pair<size_t, uint32_t>> tasks;
+	tasks.reserve( inputs.size() * blockCount );
+	for( size_t i=0; i<inputs.size(); i++ ) {
+		derivedKeys[i].resize( keyLength );
+		for( uint32_t block=1; block<=blockCount; block++ ) tasks.push_back( make_pair( i, block ) );
+	}
+	stable_sort( tasks.begin(), tasks.end(), [&inputs]( const pair<size_t, uint32_t> & first, const pair<size_t, uint32_t> & second ) {
+		return inputs[ first.first ].iterations < inputs[ second.first ].iterations;
+	} );
+
+	vector<uint32_t> innerStates( 8 * laneCount );
+	vector<uint32_t> outerStates( 8 * laneCount );
+	vector<uint32_t> digests( 8 * laneCount );
+	vector<uint32_t> results( 8 * laneCount );
+	vector<uint32_t> iterations( laneCount );
+
+	for( size_t first=0; first<tasks.size(); first += laneCount ) {
+		size_t used = min( laneCount, tasks.size() - first );
+		uint maxIterations = 1;
+		fill( innerStates.begin(), innerStates.end(), 0 );
+		fill( outerStates.begin(), outerStates.end(), 0 );
+		fill( digests.begin(), digests.end(), 0 );
+		fill( results.begin(), results.end(), 0 );
+		fill( iterations.begin(), iterations.end(), 0 );
+
+		for( size_t lane=0; lane<used; lane++ ) {
+			const Pbkdf2Input & input = inputs[ tasks[ first + lane ].first ];
+			uint32_t innerState[ 8 ];
+			uint32_t outerState[ 8 ];
+			HmacSha256::precomputeStates( input.password.data(), input.password.size(), innerState, outerState );
+
+			// The first iteration (salt and block index) is computed by the scalar implementation
+			uint8_t counter[ 4 ];
+			uint32_t block = tasks[ first + lane ].second;
+			for( int j=0; j<4; j++ ) counter[j] = (uint8_t) ( block >> ( 24 - 8 * j ) );
+			HmacSha256 firstHmac( input.password.data(), input.password.size() );
+			firstHmac.update( input.salt.data(), input.salt.size() );
+			firstHmac.update( counter, sizeof( counter ) );
+			Sha256::Digest u = firstHmac.finish();
+
+			for( int j=0; j<8; j++ ) {
+				uint32_t word = ( (uint32_t) u[4*j] << 24 ) | ( (uint32_t) u[4*j+1] << 16 ) | ( (uint32_t) u[4*j+2] << 8 ) | u[4*j+3];
+				innerStates[ j * laneCount + lane ] = innerState[j];
+				outerStates[ j * laneCount + lane ] = outerState[j];
+				digests[ j * laneCount + lane ] = word;
+				results[ j * laneCount + lane ] = word;
+			}
+			iterations[ lane ] = max( input.iterations, 1u );
+			maxIterations = max( maxIterations, iterations[ lane ] );
+		}
+
+		kernel( innerStates.data(), outerStates.data(), digests.data(), results.data(), iterations.data(), maxIterations );
+
+		for( size_t lane=0; lane<used; lane++ ) {
+			vector<uint8_t> & derivedKey = derivedKeys[ tasks[ first + lane ].first ];
+			size_t offset = ( tasks[ first + lane ].second - 1 ) * Sha256::DIGEST_SIZE;
+			for( size_t byte=0; offset + byte < keyLength && byte < Sha256::DIGEST_SIZE; byte++ ) {
+				uint32_t word = results[ ( byte / 4 ) * laneCount + lane ];
+				derivedKey[ offset + byte ] = (uint8_t) ( word >> ( 24 - 8 * ( byte % 4 ) ) );
+			}
+		}
+	}
+	return derivedKeys;
+}
@@ -0,0 +1,66 @@
+/*
+ * Sha256MultiBuffer.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_SHA256MULTIBUFFER_H_
+#define IMPL_SHA256MULTIBUFFER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../api/Common.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * The parameters of one key derivation of a PBKDF2 batch.
+	 */
+	struct Pbkdf2Input {
+		std::string password;
+		std::vector<uint8_t> salt;
+		uint iterations;
+	};
+
+	/**
+	 * <p>
+	 *     Multi-buffer SHA-256: the independent HMAC computations of several key derivations are interleaved,
+	 *     one per lane of a SIMD register, so that a single instruction stream advances 4 (SSE2), 8 (AVX2) or
+	 *     16 (AVX-512) derivations at once. The widest kernel supported by the processor is selected at run
+	 *     time; with a single lane, the scalar implementation is used.
+	 * </p>
+	 *
+	 * @author KooR.fr
+	 */
+	class Sha256MultiBuffer {
+	public:
+		/**
+		 * Returns the number of lanes of the widest kernel supported by the processor.
+		 *
+		 * @return 16, 8 or 4.
+		 */
+		static size_t getLaneCount();
+
+		/**
+		 * Derives keys with PBKDF2-HMAC-SHA256 (RFC 8018) for a batch of independent inputs. The result is the
+		 * same as calling pbkdf2HmacSha256 for each input. Inputs with the same iteration count are the most
+		 * efficient: the lanes of a group run until its highest iteration count.
+		 *
+		 * @param inputs		The passwords, salts and iteration counts.
+		 * @param keyLength		The length, in bytes, of the derived keys.
+		 * @param laneCount		The number of lanes to use: 0 for the widest supported kernel, 1 for the scalar
+		 *						implementation. Unsupported widths fall back to the widest narrower kernel.
+		 * @return The derived keys, in the order of the inputs.
+		 */
+		static std::vector<std::vector<uint8_t>> pbkdf2HmacSha256( const std::vector<Pbkdf2Input> & inputs, size_t keyLength,
+																	size_t laneCount = 0 );
+	};
+
+}
+
+#endif /* IMPL_SHA256MULTIBUFFER_H_ */
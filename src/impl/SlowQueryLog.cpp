@@ -0,0 +1,98 @@
+/*
+ * SlowQueryLog.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <algorithm>
+
+#include "SlowQueryLog.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+/**
+ * The executions of the current thread since its last sampled one.
+ */
+static thread_local uint threadExecutionCount = 0;
+
+
+SlowQueryLog::SlowQueryLog( std::chrono::nanoseconds threshold, size_t capacity, uint sampleInterval ) :
+		threshold( threshold.count() ), sampleInterval(sampleInterval), capacity( max( capacity, (size_t) 1 ) ) {
+	this->slowExecutions.reserve( this->capacity );
+}
+
+bool SlowQueryLog::isSampled() {
+	uint sampleInterval = this->sampleInterval.load( memory_order_relaxed );
+	if ( sampleInterval == 0 || ++threadExecutionCount < sampleInterval ) return false;
+	threadExecutionCount = 0;
+	return true;
+}
+
+void SlowQueryLog::record( const Execution & execution, bool slow, bool sampled ) {
+	if ( slow ) this->slowExecutionCount++;
+
+	lock_guard<std::mutex> lock( this->mutex );
+	if ( slow ) {
+		if ( this->slowExecutions.size() < this->capacity ) {
+			this->slowExecutions.push_back( execution );
+		} else {
+			this->slowExecutions[ this->nextPosition ] = execution;
+		}
+		this->nextPosition = ( this->nextPosition + 1 ) % this->capacity;
+	}
+	if ( ! sampled ) return;
+
+	auto iterator = this->statistics.find( execution.statement );
+	if ( iterator == this->statistics.end() ) {
+		if ( this->statistics.size() >= MAXIMUM_STATEMENT_COUNT ) return;
+		iterator = this->statistics.emplace( execution.statement, StatementStatistics() ).first;
+		iterator->second.statement = execution.statement;
+	}
+	StatementStatistics & statementStatistics = iterator->second;
+	statementStatistics.executions++;
+	if ( ! execution.succeeded ) statementStatistics.failures++;
+	if ( execution.rowCount > 0 ) statementStatistics.rows += execution.rowCount;
+	statementStatistics.totalDuration += execution.duration;
+	statementStatistics.maximumDuration = max( statementStatistics.maximumDuration, execution.duration );
+}
+
+std::vector<SlowQueryLog::Execution> SlowQueryLog::getSlowExecutions() const {
+	lock_guard<std::mutex> lock( this->mutex );
+	if ( this->slowExecutions.size() < this->capacity ) return this->slowExecutions;
+
+	vector<Execution> executions( this->slowExecutions.begin() + this->nextPosition, this->slowExecutions.end() );
+	executions.insert( executions.end(), this->slowExecutions.begin(), this->slowExecutions.begin() + this->nextPosition );
+	return executions;
+}
+
+std::vector<SlowQueryLog::StatementStatistics> SlowQueryLog::getStatementStatistics() const {
+	vector<StatementStatistics> result;
+	{
+		lock_guard<std::mutex> lock( this->mutex );
+		result.reserve( this->statistics.size() );
+		for( auto & entry : this->statistics ) result.push_back( entry.second );
+	}
+	sort( result.begin(), result.end(), []( const StatementStatistics & first, const StatementStatistics & second ) {
+		return first.totalDuration > second.totalDuration;
+	} );
+	return result;
+}
+
+void SlowQueryLog::clear() {
+	lock_guard<std::mutex> lock( this->mutex );
+	this->slowExecutions.clear();
+	this->nextPosition = 0;
+	this->statistics.clear();
+}
+
+void SlowQueryLog::setCapacity( size_t capacity ) {
+	lock_guard<std::mutex> lock( this->mutex );
+	this->capacity = max( capacity, (size_t) 1 );
+	this->slowExecutions.clear();
+	this->slowExecutions.reserve( this->capacity );
+	this->nextPosition = 0;
+}
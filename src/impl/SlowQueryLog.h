@@ -0,0 +1,218 @@
+/*
+ * SlowQueryLog.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_SLOWQUERYLOG_H_
+#define IMPL_SLOWQUERYLOG_H_
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../api/Common.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * <p>
+	 *     Records the timed executions of the SQL statements of a security manager. A statement is identified
+	 *     by its SQL text, with its placeholders: the bound values (passwords among them) are never recorded,
+	 *     only their number.
+	 * </p>
+	 * <p>
+	 *     Executions longer than the threshold are kept in a ring buffer of the last slow statements. Besides,
+	 *     one execution out of the sample interval (counted per thread) is added to the per statement
+	 *     statistics. The other executions only cost a comparison and an increment: their SQL text, bound
+	 *     value count and row count are not even read.
+	 * </p>
+	 *
+	 * @author KooR.fr
+	 */
+	class SlowQueryLog {
+	public:
+		/**
+		 * A timed execution of a statement.
+		 */
+		struct Execution {
+			std::string statement;					// The SQL text
+			int boundValueCount = 0;
+			int rowCount = -1;						// Selected or affected rows, -1 if unknown
+			std::chrono::nanoseconds duration { 0 };
+			time_t executedAt = 0;
+			bool batch = false;						// Executed with QSqlQuery::execBatch
+			bool succeeded = true;
+		};
+
+		/**
+		 * The sampled executions of a statement.
+		 */
+		struct StatementStatistics {
+			std::string statement;
+			unsigned long long executions = 0;
+			unsigned long long failures = 0;
+			unsigned long long rows = 0;			// Known row counts only
+			std::chrono::nanoseconds totalDuration { 0 };
+			std::chrono::nanoseconds maximumDuration { 0 };
+
+			std::chrono::nanoseconds getMeanDuration() const {
+				if ( executions == 0 ) return std::chrono::nanoseconds( 0 );
+				return std::chrono::nanoseconds( totalDuration.count() / (long long) executions );
+			}
+		};
+
+		/**
+		 * The default number of slow executions kept.
+		 */
+		static const size_t DEFAULT_CAPACITY = 256;
+
+		/**
+		 * The default duration above which an execution is slow.
+		 */
+		static constexpr std::chrono::milliseconds DEFAULT_THRESHOLD = std::chrono::milliseconds( 100 );
+
+		/**
+		 * The default number of executions per sampled one.
+		 */
+		static const uint DEFAULT_SAMPLE_INTERVAL = 64;
+
+		/**
+		 * The maximum number of distinct statements with statistics: the next ones are not sampled.
+		 */
+		static const size_t MAXIMUM_STATEMENT_COUNT = 1024;
+
+	private:
+		std::atomic<long long> threshold;				// In nanoseconds
+		std::atomic<uint> sampleInterval;
+		std::atomic<unsigned long long> slowExecutionCount { 0 };
+
+		mutable std::mutex mutex;
+		std::vector<Execution> slowExecutions;			// Ring buffer
+		size_t capacity;
+		size_t nextPosition = 0;
+		std::unordered_map<std::string, StatementStatistics> statistics;
+
+	public:
+		/**
+		 * Class constructor.
+		 *
+		 * @param threshold			The duration above which an execution is slow.
+		 * @param capacity			The number of slow executions kept.
+		 * @param sampleInterval	The number of executions per sampled one (0 disables the sampling).
+		 */
+		SlowQueryLog( std::chrono::nanoseconds threshold = DEFAULT_THRESHOLD, size_t capacity = DEFAULT_CAPACITY,
+					  uint sampleInterval = DEFAULT_SAMPLE_INTERVAL );
+
+		/**
+		 * Copies are forbidden
+		 */
+		SlowQueryLog( const SlowQueryLog & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		SlowQueryLog & operator=( const SlowQueryLog & original ) = delete;
+
+		/**
+		 * Tells whether an execution must be recorded. Called after every execution: when it returns false,
+		 * the execution is not recorded.
+		 *
+		 * @param duration	The duration of the execution.
+		 * @param slow		Receives true if the execution is slow.
+		 * @param sampled	Receives true if the execution is sampled.
+		 * @return true if the execution is slow or sampled.
+		 */
+		bool isRecorded( std::chrono::nanoseconds duration, bool & slow, bool & sampled ) {
+			slow = duration.count() >= this->threshold.load( std::memory_order_relaxed );
+			sampled = this->isSampled();
+			return slow || sampled;
+		}
+
+		/**
+		 * Records an execution accepted by isRecorded.
+		 *
+		 * @param execution		The execution.
+		 * @param slow			true if the execution is slow: it is kept in the ring buffer.
+		 * @param sampled		true if the execution is sampled: it is added to the statement statistics.
+		 */
+		void record( const Execution & execution, bool slow, bool sampled );
+
+		/**
+		 * Returns the slow executions kept, the oldest first.
+		 *
+		 * @return The last slow executions.
+		 */
+		std::vector<Execution> getSlowExecutions() const;
+
+		/**
+		 * Returns the number of slow executions since the creation of this log (those overwritten included).
+		 *
+		 * @return The slow execution count.
+		 */
+		unsigned long long getSlowExecutionCount() const {
+			return this->slowExecutionCount;
+		}
+
+		/**
+		 * Returns the statistics of the sampled statements, the longest total duration first.
+		 *
+		 * @return The statement statistics.
+		 */
+		std::vector<StatementStatistics> getStatementStatistics() const;
+
+		/**
+		 * Removes the slow executions and the statement statistics.
+		 */
+		void clear();
+
+		/**
+		 * Changes the duration above which an execution is slow.
+		 *
+		 * @param threshold		The new threshold.
+		 */
+		void setThreshold( std::chrono::nanoseconds threshold ) {
+			this->threshold = threshold.count();
+		}
+
+		/**
+		 * Returns the duration above which an execution is slow.
+		 *
+		 * @return The threshold.
+		 */
+		std::chrono::nanoseconds getThreshold() const {
+			return std::chrono::nanoseconds( this->threshold.load() );
+		}
+
+		/**
+		 * Changes the number of slow executions kept. The kept executions are removed.
+		 *
+		 * @param capacity	The new capacity.
+		 */
+		void setCapacity( size_t capacity );
+
+		/**
+		 * Changes the number of executions per sampled one.
+		 *
+		 * @param sampleInterval	The new interval (0 disables the sampling, 1 samples every execution).
+		 */
+		void setSampleInterval( uint sampleInterval ) {
+			this->sampleInterval = sampleInterval;
+		}
+
+	private:
+
+		/**
+		 * Tells whether the current execution of the calling thread is sampled.
+		 */
+		bool isSampled();
+	};
+
+}
+
+#endif /* IMPL_SLOWQUERYLOG_H_ */
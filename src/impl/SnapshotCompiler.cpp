@@ -0,0 +1,222 @@
+/*
+ * SnapshotCompiler.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+#include <QtCore/QVariant>
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include "CompiledSnapshot.h"
+#include "LoginFolding.h"
+#include "SnapshotCompiler.h"
+#include "SqlSecurityManager.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+//--------------------------------------------------------------------------------------------
+//--- Utility functions ----------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+static uint64_t alignSection( uint64_t offset ) {
+	return ( offset + 7 ) & ~(uint64_t) 7;
+}
+
+/**
+ * Executes a query reading a whole table.
+ */
+static void selectTable( SqlSecurityManager & securityManager, QSqlQuery & query, const QString & strSql ) {
+	query.setForwardOnly( true );
+	if ( ! securityManager.execute( query, strSql ) ) {
+		QString errorMessage = QString( "Cannot read the security tables: %1" ).arg( query.lastError().text() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- SnapshotCompiler implementation --------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+void SnapshotCompiler::addRole( uint roleIdentifier, const std::string & roleName ) {
+	this->roles[ roleIdentifier ] = roleName;
+}
+
+void SnapshotCompiler::addUser( const User & user ) {
+	UserRow & row = this->users[ user.getIdentifier() ];
+	row.login = user.getLogin();
+	row.password = user.getEncryptedPassword();
+	row.connectionNumber = user.getConnectionNumber();
+	row.lastConnection = user.getLastConnection();
+	row.consecutiveErrors = user.getConsecutiveErrors();
+	row.disabled = user.isDisabled();
+	row.firstName = user.getFirstName();
+	row.lastName = user.getLastName();
+	row.email = user.getEmail();
+	for( const RolePtr & role : user.getRoles() ) {
+		this->roles.emplace( role->getIdentifier(), role->getRoleName() );
+		this->userRoles.emplace( user.getIdentifier(), role->getIdentifier() );
+	}
+}
+
+void SnapshotCompiler::addUserRole( uint userIdentifier, uint roleIdentifier ) {
+	this->userRoles.emplace( userIdentifier, roleIdentifier );
+}
+
+void SnapshotCompiler::load( SqlSecurityManager & securityManager ) {
+	PooledConnection connection = securityManager.getConnectionPool().acquire();
+	QSqlQuery query( connection.database() );
+
+	selectTable( securityManager, query, "SELECT IdRole, RoleName FROM T_ROLES" );
+	while ( query.next() ) this->addRole( query.value( 0 ).toUInt(), query.value( 1 ).toString().toStdString() );
+
+	selectTable( securityManager, query, "SELECT IdUser, Login, Password, ConnectionNumber, LastConnection, ConsecutiveError, "
+										 "IsDisabled, FirstName, LastName, Email FROM T_USERS" );
+	while ( query.next() ) {
+		UserRow & row = this->users[ query.value( 0 ).toUInt() ];
+		row.login = query.value( 1 ).toString().toStdString();
+		row.password = query.value( 2 ).toString().toStdString();
+		row.connectionNumber = query.value( 3 ).toUInt();
+		row.lastConnection = (time_t) query.value( 4 ).toULongLong();
+		row.consecutiveErrors = query.value( 5 ).toUInt();
+		row.disabled = query.value( 6 ).toBool();
+		row.firstName = query.value( 7 ).toString().toStdString();
+		row.lastName = query.value( 8 ).toString().toStdString();
+		row.email = query.value( 9 ).toString().toStdString();
+	}
+
+	selectTable( securityManager, query, "SELECT IdUser, IdRole FROM T_USER_ROLES" );
+	while ( query.next() ) {
+		if ( query.value( 0 ).isNull() || query.value( 1 ).isNull() ) continue;
+		this->addUserRole( query.value( 0 ).toUInt(), query.value( 1 ).toUInt() );
+	}
+}
+
+void SnapshotCompiler::write( const std::string & fileName ) const {
+	typedef CompiledSnapshot::StringRef StringRef;
+
+	string strings;
+	auto addString = [&strings]( const string & value ) {
+		if ( strings.size() + value.size() > numeric_limits<uint32_t>::max() ) {
+			throw SecurityManagerException( "The strings of the snapshot exceed 4 GB" );
+		}
+		StringRef reference { (uint32_t) strings.size(), (uint32_t) value.size() };
+		strings += value;
+		return reference;
+	};
+
+	// Roles, sorted by identifier, and their name index
+	vector<CompiledSnapshot::RoleRecord> roleRecords;
+	for( auto & entry : this->roles ) roleRecords.push_back( { entry.first, 0, addString( entry.second ) } );
+	vector<uint32_t> roleNameIndex( roleRecords.size() );
+	for( uint32_t i=0; i<roleNameIndex.size(); i++ ) roleNameIndex[i] = i;
+	sort( roleNameIndex.begin(), roleNameIndex.end(), [this, &roleRecords]( uint32_t first, uint32_t second ) {
+		return this->roles.at( roleRecords[ first ].identifier ) < this->roles.at( roleRecords[ second ].identifier );
+	} );
+
+	// Users, sorted by identifier, with their role identifiers
+	vector<CompiledSnapshot::UserRecord> userRecords;
+	vector<string> foldedLogins;
+	vector<uint32_t> userRoleIdentifiers;
+	vector<CompiledSnapshot::RoleMember> roleMembers;
+	auto assignment = this->userRoles.begin();
+	for( auto & entry : this->users ) {
+		const UserRow & row = entry.second;
+		CompiledSnapshot::UserRecord record;
+		memset( &record, 0, sizeof( record ) );
+		record.identifier = entry.first;
+		record.connectionNumber = row.connectionNumber;
+		record.lastConnection = (int64_t) row.lastConnection;
+		record.consecutiveErrors = row.consecutiveErrors;
+		record.disabled = row.disabled ? 1 : 0;
+		record.firstRole = (uint32_t) userRoleIdentifiers.size();
+
+		while ( assignment != this->userRoles.end() && assignment->first < entry.first ) ++assignment;
+		for( ; assignment != this->userRoles.end() && assignment->first == entry.first; ++assignment ) {
+			if ( this->roles.count( assignment->second ) == 0 ) continue;
+			userRoleIdentifiers.push_back( assignment->second );
+			roleMembers.push_back( { assignment->second, (uint32_t) userRecords.size() } );
+		}
+		record.roleCount = (uint32_t) userRoleIdentifiers.size() - record.firstRole;
+
+		foldedLogins.push_back( LoginFolding::foldLogin( row.login ) );
+		record.login = addString( row.login );
+		record.foldedLogin = addString( foldedLogins.back() );
+		record.password = addString( row.password );
+		record.firstName = addString( row.firstName );
+		record.lastName = addString( row.lastName );
+		record.email = addString( row.email );
+		userRecords.push_back( record );
+	}
+	// Stable: the members of a role stay sorted by user identifier
+	stable_sort( roleMembers.begin(), roleMembers.end(), []( const CompiledSnapshot::RoleMember & first, const CompiledSnapshot::RoleMember & second ) {
+		return first.roleIdentifier < second.roleIdentifier;
+	} );
+
+	vector<uint32_t> loginIndex( userRecords.size() );
+	for( uint32_t i=0; i<loginIndex.size(); i++ ) loginIndex[i] = i;
+	sort( loginIndex.begin(), loginIndex.end(), [&foldedLogins]( uint32_t first, uint32_t second ) {
+		return foldedLogins[ first ] < foldedLogins[ second ];
+	} );
+	for( size_t i=1; i<loginIndex.size(); i++ ) {
+		if ( foldedLogins[ loginIndex[i] ] == foldedLogins[ loginIndex[i-1] ] ) {
+			QString errorMessage = QString( "Login %1 is duplicated" ).arg( this->users.at( userRecords[ loginIndex[i] ].identifier ).login.c_str() );
+			throw SecurityManagerException( errorMessage.toStdString() );
+		}
+	}
+
+	// Layout: the header, then the 8 bytes aligned sections
+	CompiledSnapshot::Header header;
+	memset( &header, 0, sizeof( header ) );
+	memcpy( header.magic, CompiledSnapshot::MAGIC, sizeof( header.magic ) );
+	header.version = CompiledSnapshot::FORMAT_VERSION;
+	header.headerSize = sizeof( header );
+	header.compiledAt = (int64_t) time( nullptr );
+	header.roleCount = (uint32_t) roleRecords.size();
+	header.userCount = (uint32_t) userRecords.size();
+	header.userRoleCount = (uint32_t) userRoleIdentifiers.size();
+	header.rolesOffset = alignSection( sizeof( header ) );
+	header.roleNameIndexOffset = alignSection( header.rolesOffset + roleRecords.size() * sizeof( CompiledSnapshot::RoleRecord ) );
+	header.usersOffset = alignSection( header.roleNameIndexOffset + roleNameIndex.size() * sizeof( uint32_t ) );
+	header.loginIndexOffset = alignSection( header.usersOffset + userRecords.size() * sizeof( CompiledSnapshot::UserRecord ) );
+	header.userRolesOffset = alignSection( header.loginIndexOffset + loginIndex.size() * sizeof( uint32_t ) );
+	header.roleMembersOffset = alignSection( header.userRolesOffset + userRoleIdentifiers.size() * sizeof( uint32_t ) );
+	header.stringsOffset = alignSection( header.roleMembersOffset + roleMembers.size() * sizeof( CompiledSnapshot::RoleMember ) );
+	header.stringsSize = strings.size();
+	header.fileSize = header.stringsOffset + strings.size();
+
+	vector<char> buffer( header.fileSize, 0 );
+	memcpy( buffer.data() + header.rolesOffset, roleRecords.data(), roleRecords.size() * sizeof( CompiledSnapshot::RoleRecord ) );
+	memcpy( buffer.data() + header.roleNameIndexOffset, roleNameIndex.data(), roleNameIndex.size() * sizeof( uint32_t ) );
+	memcpy( buffer.data() + header.usersOffset, userRecords.data(), userRecords.size() * sizeof( CompiledSnapshot::UserRecord ) );
+	memcpy( buffer.data() + header.loginIndexOffset, loginIndex.data(), loginIndex.size() * sizeof( uint32_t ) );
+	memcpy( buffer.data() + header.userRolesOffset, userRoleIdentifiers.data(), userRoleIdentifiers.size() * sizeof( uint32_t ) );
+	memcpy( buffer.data() + header.roleMembersOffset, roleMembers.data(), roleMembers.size() * sizeof( CompiledSnapshot::RoleMember ) );
+	memcpy( buffer.data() + header.stringsOffset, strings.data(), strings.size() );
+	header.checksum = CompiledSnapshot::computeChecksum( buffer.data() + sizeof( header ), buffer.size() - sizeof( header ) );
+	memcpy( buffer.data(), &header, sizeof( header ) );
+
+	// The previous snapshot is replaced only once the new one is completely written
+	string temporaryFileName = fileName + ".tmp";
+	{
+		ofstream output( temporaryFileName, ios::out | ios::trunc | ios::binary );
+		output.write( buffer.data(), buffer.size() );
+		output.flush();
+		if ( ! output ) throw SecurityManagerException( "Cannot write the snapshot " + temporaryFileName );
+	}
+	if ( rename( temporaryFileName.c_str(), fileName.c_str() ) != 0 ) {
+		throw SecurityManagerException( "Cannot replace the snapshot " + fileName );
+	}
+}
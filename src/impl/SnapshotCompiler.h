@@ -0,0 +1,134 @@
+/*
+ * SnapshotCompiler.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_SNAPSHOTCOMPILER_H_
+#define IMPL_SNAPSHOTCOMPILER_H_
+
+#include <ctime>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+
+#include "../api/Common.h"
+#include "../api/User.h"
+
+
+namespace fr::koor::security {
+
+	class SqlSecurityManager;
+
+	/**
+	 * <p>
+	 *     Writes the users, the roles and the role assignments in a compiled snapshot (see CompiledSnapshot),
+	 *     served by a SnapshotSecurityManager. The rows are collected in memory, then sorted, indexed and
+	 *     written at once by write.
+	 * </p>
+	 * <p>
+	 *     Role assignments referencing an unknown user or role are dropped. Logins must be unique once
+	 *     folded (case insensitive, trailing spaces ignored).
+	 * </p>
+	 *
+	 * @see fr.koor.security.CompiledSnapshot
+	 *
+	 * @author KooR.fr
+	 */
+	class SnapshotCompiler {
+
+		struct UserRow {
+			std::string login;
+			std::string password;
+			uint connectionNumber = 0;
+			time_t lastConnection = 0;
+			uint consecutiveErrors = 0;
+			bool disabled = false;
+			std::string firstName;
+			std::string lastName;
+			std::string email;
+		};
+
+		std::map<uint, std::string> roles;
+		std::map<uint, UserRow> users;
+		std::set<std::pair<uint, uint>> userRoles;		// User identifier, role identifier
+
+	public:
+		/**
+		 * Class constructor: builds an empty compiler.
+		 */
+		SnapshotCompiler() {}
+
+		/**
+		 * Copies are forbidden
+		 */
+		SnapshotCompiler( const SnapshotCompiler & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		SnapshotCompiler & operator=( const SnapshotCompiler & original ) = delete;
+
+		/**
+		 * Adds a role, or renames it.
+		 *
+		 * @param roleIdentifier	The role identifier.
+		 * @param roleName			The role name.
+		 */
+		void addRole( uint roleIdentifier, const std::string & roleName );
+
+		/**
+		 * Adds a user, or replaces it, with its roles.
+		 *
+		 * @param user		The user.
+		 */
+		void addUser( const User & user );
+
+		/**
+		 * Adds a role assignment.
+		 *
+		 * @param userIdentifier	The user identifier.
+		 * @param roleIdentifier	The role identifier.
+		 */
+		void addUserRole( uint userIdentifier, uint roleIdentifier );
+
+		/**
+		 * Reads the T_ROLES, T_USERS and T_USER_ROLES tables of a database, with one query per table.
+		 *
+		 * @param securityManager	The security manager connected to the database.
+		 *
+		 * @throws SecurityManagerException	Thrown if a table cannot be read.
+		 */
+		void load( SqlSecurityManager & securityManager );
+
+		/**
+		 * Returns the number of roles added.
+		 * @return The role count.
+		 */
+		size_t getRoleCount() const {
+			return this->roles.size();
+		}
+
+		/**
+		 * Returns the number of users added.
+		 * @return The user count.
+		 */
+		size_t getUserCount() const {
+			return this->users.size();
+		}
+
+		/**
+		 * Writes the snapshot. The file is written under a temporary name, then renamed: the processes
+		 * mapping the previous snapshot keep reading it until they reload.
+		 *
+		 * @param fileName	The snapshot file.
+		 *
+		 * @throws SecurityManagerException	Thrown if a login is duplicated or if the file cannot be written.
+		 */
+		void write( const std::string & fileName ) const;
+	};
+
+}
+
+#endif /* IMPL_SNAPSHOTCOMPILER_H_ */
@@ -0,0 +1,279 @@
+/*
+ * SnapshotSecurityManager.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <ctime>
+#include <unordered_set>
+
+#include <QtCore/QString>
+
+#include "LoginFolding.h"
+#include "Pbkdf2PasswordHasher.h"
+#include "SnapshotSecurityManager.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+//--------------------------------------------------------------------------------------------
+//--- Utility functions ----------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+static const char * READ_ONLY_MESSAGE = "The users and roles of a compiled snapshot cannot be changed";
+
+
+//--------------------------------------------------------------------------------------------
+//--- SnapshotUserManager implementation -----------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+SnapshotSecurityManager::SnapshotUserManager::SnapshotUserManager( SnapshotSecurityManager & securityManager ) : securityManager( securityManager ) {
+}
+
+SnapshotSecurityManager::SnapshotUserManager::~SnapshotUserManager() {
+}
+
+UserPtr SnapshotSecurityManager::SnapshotUserManager::checkCredentials( const std::string & userLogin, const std::string & userPassword ) {
+	return this->checkCredentials( userLogin, userPassword, string() );
+}
+
+UserPtr SnapshotSecurityManager::SnapshotUserManager::checkCredentials( const std::string & userLogin, const std::string & userPassword, const std::string & source ) {
+	chrono::milliseconds retryAfter;
+	if ( ! source.empty() && ! securityManager.sourceRateLimiter.tryAcquire( source, retryAfter ) ) {
+		throw RateLimitedException( "Too many login attempts from " + source, retryAfter );
+	}
+	string foldedLogin = LoginFolding::foldLogin( userLogin );
+	if ( ! securityManager.loginRateLimiter.tryAcquire( foldedLogin, retryAfter ) ) {
+		throw RateLimitedException( "Too many login attempts for " + userLogin, retryAfter );
+	}
+
+	PasswordHasherPtr hasher = securityManager.getPasswordHasher();
+	shared_ptr<const CompiledSnapshot> snapshot = securityManager.getSnapshot();
+	const CompiledSnapshot::UserRecord * record = snapshot->findUserByLogin( userLogin );
+	if ( record == nullptr ) {
+		// Unknown logins cost a hash too, so that they can't be detected by timing
+		hasher->hash( userPassword );
+		throw BadCredentialsException( "Your identity is rejected" );
+	}
+
+	// The snapshot is read-only: neither the bookkeeping nor the password upgrades are recorded
+	if ( ! hasher->verify( userPassword, string( snapshot->getString( record->password ) ) ) ) {
+		throw BadCredentialsException( "Your identity is rejected" );
+	}
+	if ( record->disabled ) throw AccountDisabledException( "Account is disabled" );
+	securityManager.loginRateLimiter.reset( foldedLogin );
+	return securityManager.readUser( *snapshot, *record );
+}
+
+UserPtr SnapshotSecurityManager::SnapshotUserManager::getUserById( uint userId ) const {
+	shared_ptr<const CompiledSnapshot> snapshot = securityManager.getSnapshot();
+	const CompiledSnapshot::UserRecord * record = snapshot->findUserById( userId );
+	if ( record == nullptr ) {
+		QString errorMessage = QString( "User identifier %1 not found" ).arg( userId );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	return securityManager.readUser( *snapshot, *record );
+}
+
+UserPtr SnapshotSecurityManager::SnapshotUserManager::getUserByLogin( const std::string & login ) const {
+	shared_ptr<const CompiledSnapshot> snapshot = securityManager.getSnapshot();
+	const CompiledSnapshot::UserRecord * record = snapshot->findUserByLogin( login );
+	if ( record == nullptr ) {
+		QString errorMessage = QString( "User %1 not found" ).arg( login.c_str() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	return securityManager.readUser( *snapshot, *record );
+}
+
+void SnapshotSecurityManager::SnapshotUserManager::forEachUserInRole( RolePtr role, const UserVisitor & visitor, size_t pageSize ) const {
+	// The members of each role are indexed in the snapshot: no page is needed
+	shared_ptr<const CompiledSnapshot> snapshot = securityManager.getSnapshot();
+	auto members = snapshot->getRoleMembers( role->getIdentifier() );
+	for( const CompiledSnapshot::RoleMember * member = members.first; member != members.second; ++member ) {
+		if ( ! visitor( securityManager.readUser( *snapshot, snapshot->getUser( member->userPosition ) ) ) ) return;
+	}
+}
+
+UserPtr SnapshotSecurityManager::SnapshotUserManager::insertUser( const std::string & login, const std::string & password ) {
+	throw SecurityManagerException( READ_ONLY_MESSAGE );
+}
+
+void SnapshotSecurityManager::SnapshotUserManager::updateUser( UserPtr user ) {
+	throw SecurityManagerException( READ_ONLY_MESSAGE );
+}
+
+void SnapshotSecurityManager::SnapshotUserManager::deleteUser( UserPtr user ) {
+	throw SecurityManagerException( READ_ONLY_MESSAGE );
+}
+
+std::string SnapshotSecurityManager::SnapshotUserManager::encryptPassword( const std::string & clearPassword ) const {
+	return securityManager.getPasswordHasher()->hash( clearPassword );
+}
+
+bool SnapshotSecurityManager::SnapshotUserManager::verifyPassword( const std::string & clearPassword, const std::string & encryptedPassword ) const {
+	return securityManager.getPasswordHasher()->verify( clearPassword, encryptedPassword );
+}
+
+std::string SnapshotSecurityManager::SnapshotUserManager::issueToken( UserPtr user, std::chrono::seconds timeToLive ) {
+	if ( user->isDisabled() ) throw AccountDisabledException( "Account is disabled" );
+	return securityManager.tokenSigner.sign( *user, time( nullptr ) + timeToLive.count() );
+}
+
+TokenClaims SnapshotSecurityManager::SnapshotUserManager::verifyToken( const std::string & token ) const {
+	return securityManager.tokenSigner.verify( token, time( nullptr ) );
+}
+
+Executor & SnapshotSecurityManager::SnapshotUserManager::getExecutor() const {
+	return *securityManager.requestPool;
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- SnapshotRoleManager implementation -----------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+SnapshotSecurityManager::SnapshotRoleManager::SnapshotRoleManager( SnapshotSecurityManager & securityManager ) : securityManager( securityManager ) {
+}
+
+SnapshotSecurityManager::SnapshotRoleManager::~SnapshotRoleManager() {
+}
+
+RolePtr SnapshotSecurityManager::SnapshotRoleManager::selectRoleById( uint roleIdentifier ) {
+	RolePtr role = this->roleRegistry.findById( roleIdentifier );
+	if ( ! role ) {
+		QString errorMessage = QString( "Role identifier %1 not found" ).arg( roleIdentifier );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	return role;
+}
+
+RolePtr SnapshotSecurityManager::SnapshotRoleManager::selectRoleByName( const std::string & roleName ) {
+	RolePtr role = this->roleRegistry.findByName( roleName );
+	if ( ! role ) {
+		QString errorMessage = QString( "Role %1 not found" ).arg( roleName.c_str() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	return role;
+}
+
+RolePtr SnapshotSecurityManager::SnapshotRoleManager::insertRole( const std::string & roleName ) {
+	throw SecurityManagerException( READ_ONLY_MESSAGE );
+}
+
+RolePtr SnapshotSecurityManager::SnapshotRoleManager::updateRole( RolePtr role, const std::string & newRoleName ) {
+	throw SecurityManagerException( READ_ONLY_MESSAGE );
+}
+
+void SnapshotSecurityManager::SnapshotRoleManager::deleteRole( RolePtr role ) {
+	throw SecurityManagerException( READ_ONLY_MESSAGE );
+}
+
+Executor & SnapshotSecurityManager::SnapshotRoleManager::getExecutor() const {
+	return *securityManager.requestPool;
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- SnapshotSecurityManager implementation -------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+SnapshotSecurityManager::SnapshotSecurityManager( const std::string & snapshotFileName ) :
+			snapshotFileName( snapshotFileName ),
+			passwordHasher( new Pbkdf2PasswordHasher() ),
+			loginRateLimiter( 10, chrono::seconds( 6 ) ),
+			sourceRateLimiter( 100, chrono::milliseconds( 600 ) ),
+			requestPool( new WorkerPool( "Request pool" ) ) {
+	this->userManager = std::shared_ptr<SnapshotUserManager>( new SnapshotUserManager( *this ) );
+	this->roleManager = std::shared_ptr<SnapshotRoleManager>( new SnapshotRoleManager( *this ) );
+}
+
+SnapshotSecurityManager::~SnapshotSecurityManager() {
+	// Pending asynchronous calls still need the managers
+	this->requestPool.reset();
+}
+
+void SnapshotSecurityManager::setPasswordHasher( PasswordHasherPtr passwordHasher ) {
+	if ( ! passwordHasher ) throw SecurityManagerException( "A password hasher is required" );
+	atomic_store( &this->passwordHasher, passwordHasher );
+}
+
+PasswordHasherPtr SnapshotSecurityManager::getPasswordHasher() const {
+	return atomic_load( &this->passwordHasher );
+}
+
+void SnapshotSecurityManager::openSession() {
+	try {
+		this->reload();
+	} catch( exception & exception ) {
+		throw SecurityManagerException( string("Cannot open security session: ") + exception.what() );
+	}
+}
+
+void SnapshotSecurityManager::close() {
+	lock_guard<mutex> lock( this->reloadMutex );
+	atomic_store( &this->snapshot, shared_ptr<const CompiledSnapshot>() );
+}
+
+void SnapshotSecurityManager::reload() {
+	lock_guard<mutex> lock( this->reloadMutex );
+	shared_ptr<const CompiledSnapshot> newSnapshot = make_shared<const CompiledSnapshot>( this->snapshotFileName );
+
+	// The new roles are registered before the snapshot referencing them is published,
+	// the removed ones are unregistered after
+	RoleRegistry & roleRegistry = this->roleManager->roleRegistry;
+	unordered_set<uint> roleIdentifiers;
+	for( uint position=0; position<newSnapshot->getRoleCount(); position++ ) {
+		const CompiledSnapshot::RoleRecord & role = newSnapshot->getRole( position );
+		roleRegistry.intern( role.identifier, string( newSnapshot->getString( role.name ) ) );
+		roleIdentifiers.insert( role.identifier );
+	}
+	atomic_store( &this->snapshot, newSnapshot );
+	for( uint roleIdentifier : roleRegistry.getIdentifiers() ) {
+		if ( roleIdentifiers.count( roleIdentifier ) == 0 ) roleRegistry.remove( roleIdentifier );
+	}
+}
+
+time_t SnapshotSecurityManager::getCompiledAt() const {
+	return (time_t) this->getSnapshot()->getHeader().compiledAt;
+}
+
+size_t SnapshotSecurityManager::getUserCount() const {
+	return this->getSnapshot()->getUserCount();
+}
+
+std::shared_ptr<const CompiledSnapshot> SnapshotSecurityManager::getSnapshot() const {
+	shared_ptr<const CompiledSnapshot> snapshot = atomic_load( &this->snapshot );
+	if ( ! snapshot ) throw SecurityManagerException( "The security session isn't opened" );
+	return snapshot;
+}
+
+UserPtr SnapshotSecurityManager::readUser( const CompiledSnapshot & snapshot, const CompiledSnapshot::UserRecord & record ) {
+	UserPtr user( new User( *this, record.identifier, string( snapshot.getString( record.login ) ), string( snapshot.getString( record.password ) ) ) );
+	user->setConnectionNumber( record.connectionNumber );
+	user->setLastConnection( (time_t) record.lastConnection );
+	user->setConsecutiveErrors( record.consecutiveErrors );
+	user->setDisabled( record.disabled != 0 );
+	user->setFirstName( string( snapshot.getString( record.firstName ) ) );
+	user->setLastName( string( snapshot.getString( record.lastName ) ) );
+	user->setEmail( string( snapshot.getString( record.email ) ) );
+
+	const uint32_t * roleIdentifiers = snapshot.getUserRoles( record );
+	for( uint i=0; i<record.roleCount; i++ ) {
+		RolePtr role = this->roleManager->roleRegistry.findById( roleIdentifiers[i] );
+		if ( ! role ) {
+			// Read from a previous mapping, after a reload removed the role
+			const CompiledSnapshot::RoleRecord * roleRecord = snapshot.findRoleById( roleIdentifiers[i] );
+			if ( roleRecord == nullptr ) {
+				QString errorMessage = QString( "Role identifier %1 of user %2 not found in the snapshot" )
+						.arg( roleIdentifiers[i] ).arg( record.identifier );
+				throw SecurityManagerException( errorMessage.toStdString() );
+			}
+			role = make_shared<Role>( roleRecord->identifier, string( snapshot.getString( roleRecord->name ) ) );
+		}
+		user->addRole( role );
+	}
+	return user;
+}
@@ -0,0 +1,265 @@
+/*
+ * SnapshotSecurityManager.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_SNAPSHOTSECURITYMANAGER_H_
+#define IMPL_SNAPSHOTSECURITYMANAGER_H_
+
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "../api/PasswordHasher.h"
+#include "../api/SecurityManager.h"
+#include "CompiledSnapshot.h"
+#include "RateLimiter.h"
+#include "RoleRegistry.h"
+#include "TokenSigner.h"
+#include "WorkerPool.h"
+
+namespace fr::koor::security {
+
+
+	/**
+	 * <p>
+	 *     A read-only security manager serving a compiled snapshot (see CompiledSnapshot), written by
+	 *     SnapshotCompiler or by the CompileSnapshot tool. openSession maps the file: nothing is parsed nor
+	 *     copied, the users are built from the mapped records when they are requested. Every process serving
+	 *     the same snapshot shares its pages.
+	 * </p>
+	 * <p>
+	 *     The users and the roles cannot be changed: the mutations throw a SecurityManagerException. The
+	 *     bookkeeping of the logins (connection number, last connection, consecutive errors) isn't recorded
+	 *     either, so accounts aren't disabled after three errors: the rate limiters bound the guesses.
+	 * </p>
+	 * <p>
+	 *     reload maps the last compiled version of the file. The calls in progress finish on the previous
+	 *     mapping, which is released with its last reader.
+	 * </p>
+	 *
+	 * @see fr.koor.security.SecurityManager
+	 * @see fr.koor.security.SnapshotCompiler
+	 *
+	 * @author KooR.fr
+	 */
+	class SnapshotSecurityManager : public SecurityManager {
+
+		class SnapshotUserManager;
+		class SnapshotRoleManager;
+
+		std::string snapshotFileName;
+		std::shared_ptr<const CompiledSnapshot> snapshot;		// Through atomic_load and atomic_store
+		std::mutex reloadMutex;									// Serializes openSession, reload and close
+
+		std::shared_ptr<SnapshotUserManager> userManager;
+		std::shared_ptr<SnapshotRoleManager> roleManager;
+
+		PasswordHasherPtr passwordHasher;
+		TokenSigner tokenSigner;
+		RateLimiter loginRateLimiter;
+		RateLimiter sourceRateLimiter;
+
+		// Declared last: its queued calls complete before the other members are destroyed
+		std::unique_ptr<WorkerPool> requestPool;
+
+	public:
+		/**
+		 * Class constructor.
+		 *
+		 * @param snapshotFileName	The compiled snapshot mapped by openSession.
+		 */
+		SnapshotSecurityManager( const std::string & snapshotFileName );
+
+		/**
+		 * Class destructor.
+		 */
+		virtual ~SnapshotSecurityManager();
+
+		/**
+		 * Maps the compiled snapshot.
+		 *
+		 * @throws SecurityManagerException	Thrown when the file cannot be mapped or isn't a valid snapshot.
+		 */
+		void openSession() override;
+
+		/**
+		 * Releases the mapping of the snapshot.
+		 */
+		void close() override;
+
+		/**
+		 * Returns the role manager associated to this security manager.
+		 * A role manager provided methods to manage roles.
+		 *
+		 * @return The role manager associated to this security manager.
+		 */
+		RoleManagerPtr getRoleManager() const override {
+			return this->roleManager;
+		}
+
+		/**
+		 * Returns the user manager associated to this security manager.
+		 * A user manager provided methods to manage users.
+		 *
+		 * @return The user manager associated to this security manager.
+		 */
+		UserManagerPtr getUserManager() const override {
+			return this->userManager;
+		}
+
+		/**
+		 * Maps the current version of the snapshot file, in place of the previous one. If the new version
+		 * is invalid, the previous one is kept.
+		 *
+		 * @throws SecurityManagerException	Thrown when the file cannot be mapped or isn't a valid snapshot.
+		 */
+		void reload();
+
+		/**
+		 * Returns the date at which the mapped snapshot was compiled.
+		 *
+		 * @return The compilation date.
+		 *
+		 * @throws SecurityManagerException	Thrown if the session isn't opened.
+		 */
+		time_t getCompiledAt() const;
+
+		/**
+		 * Returns the number of users of the mapped snapshot.
+		 *
+		 * @return The user count.
+		 *
+		 * @throws SecurityManagerException	Thrown if the session isn't opened.
+		 */
+		size_t getUserCount() const;
+
+		/**
+		 * Changes the algorithm used to verify the passwords (PBKDF2-HMAC-SHA256 with 100000 iterations by
+		 * default). It must recognize the hashes stored in the snapshot.
+		 *
+		 * @param passwordHasher	The new password hasher.
+		 */
+		void setPasswordHasher( PasswordHasherPtr passwordHasher );
+
+		/**
+		 * Returns the algorithm used to verify the passwords.
+		 *
+		 * @return The password hasher.
+		 */
+		PasswordHasherPtr getPasswordHasher() const;
+
+		/**
+		 * Returns the key ring used to sign and verify the session tokens.
+		 *
+		 * @return The token signer.
+		 */
+		TokenSigner & getTokenSigner() {
+			return this->tokenSigner;
+		}
+
+		/**
+		 * Returns the limiter of the login attempts per login (see SqlSecurityManager::getLoginRateLimiter).
+		 *
+		 * @return The per login rate limiter.
+		 */
+		RateLimiter & getLoginRateLimiter() {
+			return this->loginRateLimiter;
+		}
+
+		/**
+		 * Returns the limiter of the login attempts per source (see SqlSecurityManager::getSourceRateLimiter).
+		 *
+		 * @return The per source rate limiter.
+		 */
+		RateLimiter & getSourceRateLimiter() {
+			return this->sourceRateLimiter;
+		}
+
+	private:
+
+		/**
+		 * Returns the mapped snapshot.
+		 *
+		 * @throws SecurityManagerException	Thrown if the session isn't opened.
+		 */
+		std::shared_ptr<const CompiledSnapshot> getSnapshot() const;
+
+		/**
+		 * Builds a user from its record.
+		 */
+		UserPtr readUser( const CompiledSnapshot & snapshot, const CompiledSnapshot::UserRecord & record );
+
+		/**
+		 * Read-only implementation for the UserManager interface.
+		 *
+		 * @author KooR.fr
+		 */
+		class SnapshotUserManager : public UserManager {
+			SnapshotSecurityManager & securityManager;
+		public:
+			SnapshotUserManager( SnapshotSecurityManager & securityManager );
+			~SnapshotUserManager() override;
+
+			UserPtr checkCredentials( const std::string & userLogin, const std::string & userPassword ) override;
+
+			UserPtr checkCredentials( const std::string & userLogin, const std::string & userPassword, const std::string & source ) override;
+
+			UserPtr getUserById( uint userId ) const override;
+
+			UserPtr getUserByLogin( const std::string & login ) const override;
+
+			void forEachUserInRole( RolePtr role, const UserVisitor & visitor, size_t pageSize = 500 ) const override;
+
+			UserPtr insertUser( const std::string & login, const std::string & password ) override;
+
+			void updateUser( UserPtr user ) override;
+
+			void deleteUser( UserPtr user ) override;
+
+			std::string encryptPassword( const std::string & clearPassword ) const override;
+
+			bool verifyPassword( const std::string & clearPassword, const std::string & encryptedPassword ) const override;
+
+			std::string issueToken( UserPtr user, std::chrono::seconds timeToLive = std::chrono::minutes( 15 ) ) override;
+
+			TokenClaims verifyToken( const std::string & token ) const override;
+
+			Executor & getExecutor() const override;
+		};
+
+		/**
+		 * Read-only implementation for the RoleManager interface.
+		 *
+		 * @author KooR.fr
+		 */
+		class SnapshotRoleManager : public RoleManager {
+			SnapshotSecurityManager & securityManager;
+			RoleRegistry roleRegistry;
+
+		public:
+			SnapshotRoleManager( SnapshotSecurityManager & securityManager );
+			~SnapshotRoleManager() override;
+
+			RolePtr selectRoleById( uint roleIdentifier ) override;
+
+			RolePtr selectRoleByName( const std::string & roleName ) override;
+
+			RolePtr insertRole( const std::string & roleName ) override;
+
+			RolePtr updateRole( RolePtr role, const std::string & newRoleName ) override;
+
+			void deleteRole( RolePtr role ) override;
+
+			Executor & getExecutor() const override;
+
+			friend class SnapshotSecurityManager;
+		};
+	};
+
+}
+
+#endif /* IMPL_SNAPSHOTSECURITYMANAGER_H_ */
@@ -0,0 +1,261 @@
+/*
+ * SqlConnectionPool.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <QtSql/QSqlError>
+#include <QtSql/QSqlQuery>
+
+#include "../api/SecurityManager.h"
+#include "SqlConnectionPool.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+//--------------------------------------------------------------------------------------------
+//--- PooledConnection implementation --------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+PooledConnection::PooledConnection( SqlConnectionPool & pool, const QSqlDatabase & connection, const std::shared_ptr<StatementCache> & statements ) :
+		pool(&pool), connection(connection), statements(statements) {
+}
+
+PooledConnection::PooledConnection( PooledConnection && original ) :
+		pool(original.pool), connection(original.connection), statements(move(original.statements)) {
+	original.pool = nullptr;
+	original.connection = QSqlDatabase();
+}
+
+PooledConnection::~PooledConnection() {
+	// The connection copy must be dropped before the pool can remove it
+	this->connection = QSqlDatabase();
+	if ( this->pool != nullptr ) this->pool->release();
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- SqlConnectionPool implementation -------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+uint SqlConnectionPool::poolCounter = 0;
+
+const uint SqlConnectionPool::DEFAULT_MAXIMUM_SIZE;
+
+SqlConnectionPool::SqlConnectionPool( const std::string & driverName, const std::string & hostname, const std::string & database,
+									  const std::string & login, const std::string & password, uint maximumSize ) :
+		driverName(driverName), hostname(hostname), database(database), login(login), password(password), maximumSize(maximumSize) {
+	static mutex counterMutex;
+	lock_guard<mutex> lock( counterMutex );
+	this->poolIdentifier = ++poolCounter;
+	if ( this->maximumSize == 0 ) this->maximumSize = 1;
+}
+
+SqlConnectionPool::~SqlConnectionPool() {
+	// The other threads no longer use the pool: their connections can be removed from here
+	for( auto & entry : this->connections ) {
+		removeConnection( entry.second );
+	}
+}
+
+uint SqlConnectionPool::getMaximumSize() const {
+	lock_guard<mutex> lock( this->poolMutex );
+	return this->maximumSize;
+}
+
+void SqlConnectionPool::setMaximumSize( uint maximumSize ) {
+	{
+		lock_guard<mutex> lock( this->poolMutex );
+		this->maximumSize = maximumSize == 0 ? 1 : maximumSize;
+	}
+	this->connectionReleased.notify_all();
+}
+
+std::chrono::milliseconds SqlConnectionPool::getAcquireTimeout() const {
+	lock_guard<mutex> lock( this->poolMutex );
+	return this->acquireTimeout;
+}
+
+void SqlConnectionPool::setAcquireTimeout( std::chrono::milliseconds acquireTimeout ) {
+	lock_guard<mutex> lock( this->poolMutex );
+	this->acquireTimeout = acquireTimeout;
+}
+
+std::chrono::milliseconds SqlConnectionPool::getHealthCheckInterval() const {
+	lock_guard<mutex> lock( this->poolMutex );
+	return this->healthCheckInterval;
+}
+
+void SqlConnectionPool::setHealthCheckInterval( std::chrono::milliseconds healthCheckInterval ) {
+	lock_guard<mutex> lock( this->poolMutex );
+	this->healthCheckInterval = healthCheckInterval;
+}
+
+PooledConnection SqlConnectionPool::acquire() {
+	thread::id threadId = this_thread::get_id();
+	QString connectionName;
+	shared_ptr<StatementCache> statements;
+	ThreadConnection closedConnection;
+	bool isNewConnection = false;
+	bool needsHealthCheck = false;
+
+	{
+		unique_lock<mutex> lock( this->poolMutex );
+		auto iterator = this->connections.find( threadId );
+		if ( iterator != this->connections.end() && iterator->second.leases > 0 ) {
+			// Reentrant lease: the thread already owns a slot
+			iterator->second.leases++;
+			return PooledConnection( *this, QSqlDatabase::database( iterator->second.name, false ), iterator->second.statements );
+		}
+
+		bool slotAvailable = this->connectionReleased.wait_for( lock, this->acquireTimeout, [this] {
+			return this->activeThreads < this->maximumSize;
+		} );
+		if ( ! slotAvailable ) {
+			QString errorMessage = QString( "No database connection available after %1 ms" ).arg( (qlonglong) this->acquireTimeout.count() );
+			throw SecurityManagerException( errorMessage.toStdString() );
+		}
+		this->activeThreads++;
+
+		ThreadConnection & threadConnection = this->connections[ threadId ];
+		if ( ! threadConnection.name.isEmpty() && threadConnection.generation != this->generation ) {
+			// Marked by closeAll: the thread closes its connection, then opens a new one
+			closedConnection = threadConnection;
+			threadConnection = ThreadConnection();
+		}
+		if ( threadConnection.name.isEmpty() ) {
+			threadConnection.name = QString( "SecurityComponent-%1-%2" ).arg( this->poolIdentifier ).arg( ++this->connectionCounter );
+			threadConnection.statements = make_shared<StatementCache>( this->statementCounters );
+			threadConnection.generation = this->generation;
+			isNewConnection = true;
+		}
+		auto now = chrono::steady_clock::now();
+		needsHealthCheck = now - threadConnection.lastUse > this->healthCheckInterval;
+		threadConnection.lastUse = now;
+		threadConnection.leases = 1;
+		connectionName = threadConnection.name;
+		statements = threadConnection.statements;
+	}
+
+	// Connections are opened and checked outside of the lock: it can take a while
+	if ( ! closedConnection.name.isEmpty() ) removeConnection( closedConnection );
+	try {
+		QSqlDatabase connection;
+		if ( isNewConnection ) {
+			connection = this->openConnection( connectionName );
+		} else {
+			connection = QSqlDatabase::database( connectionName, false );
+			if ( needsHealthCheck ) this->checkHealth( connection, *statements );
+		}
+		return PooledConnection( *this, connection, statements );
+	} catch ( ... ) {
+		{
+			lock_guard<mutex> lock( this->poolMutex );
+			this->connections.erase( threadId );
+			this->activeThreads--;
+		}
+		this->connectionReleased.notify_one();
+		ThreadConnection failedConnection;
+		failedConnection.name = connectionName;
+		failedConnection.statements = statements;
+		removeConnection( failedConnection );
+		throw;
+	}
+}
+
+void SqlConnectionPool::release() {
+	ThreadConnection connectionToRemove;
+	{
+		lock_guard<mutex> lock( this->poolMutex );
+		auto iterator = this->connections.find( this_thread::get_id() );
+		if ( iterator == this->connections.end() ) return;
+		if ( --iterator->second.leases > 0 ) return;
+
+		this->activeThreads--;
+		iterator->second.lastUse = chrono::steady_clock::now();
+		// Too many idle threads keep a connection, or closeAll was called: the releasing thread closes its own one
+		if ( this->connections.size() > this->maximumSize || iterator->second.generation != this->generation ) {
+			connectionToRemove = iterator->second;
+			this->connections.erase( iterator );
+		}
+	}
+	this->connectionReleased.notify_one();
+	if ( ! connectionToRemove.name.isEmpty() ) removeConnection( connectionToRemove );
+}
+
+void SqlConnectionPool::closeThreadConnection() {
+	ThreadConnection threadConnection;
+	{
+		lock_guard<mutex> lock( this->poolMutex );
+		auto iterator = this->connections.find( this_thread::get_id() );
+		if ( iterator == this->connections.end() || iterator->second.leases > 0 ) return;
+		threadConnection = iterator->second;
+		this->connections.erase( iterator );
+	}
+	removeConnection( threadConnection );
+}
+
+void SqlConnectionPool::closeAll() {
+	{
+		// Qt connections must be closed by their thread: the other ones are only marked
+		lock_guard<mutex> lock( this->poolMutex );
+		this->generation++;
+	}
+	this->closeThreadConnection();
+}
+
+uint SqlConnectionPool::getOpenConnectionCount() {
+	lock_guard<mutex> lock( this->poolMutex );
+	return this->connections.size();
+}
+
+StatementCache::Statistics SqlConnectionPool::getStatementCacheStatistics() const {
+	StatementCache::Statistics statistics;
+	statistics.hits = this->statementCounters.hits;
+	statistics.misses = this->statementCounters.misses;
+	return statistics;
+}
+
+QSqlDatabase SqlConnectionPool::openConnection( const QString & connectionName ) {
+	QSqlDatabase connection = QSqlDatabase::addDatabase( this->driverName.c_str(), connectionName );
+	connection.setHostName( this->hostname.c_str() );
+	connection.setDatabaseName( this->database.c_str() );
+	connection.setUserName( this->login.c_str() );
+	connection.setPassword( this->password.c_str() );
+	if ( ! connection.open() ) {
+		QString errorMessage = QString( "Cannot open database connection: %1" ).arg( connection.lastError().text() );
+		connection = QSqlDatabase();
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	if ( this->connectionInitializer ) this->connectionInitializer( connection );
+	return connection;
+}
+
+void SqlConnectionPool::checkHealth( QSqlDatabase & connection, StatementCache & statements ) {
+	if ( connection.isOpen() ) {
+		QSqlQuery query( connection );
+		if ( query.exec( "SELECT 1" ) ) return;
+	}
+
+	// Statements prepared on the lost session are no longer valid
+	statements.clear();
+	connection.close();
+	if ( ! connection.open() ) {
+		QString errorMessage = QString( "Cannot reopen database connection: %1" ).arg( connection.lastError().text() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	if ( this->connectionInitializer ) this->connectionInitializer( connection );
+}
+
+void SqlConnectionPool::removeConnection( const ThreadConnection & threadConnection ) {
+	// Queries must be destroyed before their connection is removed
+	if ( threadConnection.statements ) threadConnection.statements->clear();
+	{
+		QSqlDatabase connection = QSqlDatabase::database( threadConnection.name, false );
+		if ( connection.isOpen() ) connection.close();
+	}
+	QSqlDatabase::removeDatabase( threadConnection.name );
+}
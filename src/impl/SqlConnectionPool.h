@@ -0,0 +1,333 @@
+/*
+ * SqlConnectionPool.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_SQLCONNECTIONPOOL_H_
+#define IMPL_SQLCONNECTIONPOOL_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <QtSql/QSqlDatabase>
+
+#include "../api/Common.h"
+#include "StatementCache.h"
+
+
+namespace fr::koor::security {
+
+	class SqlConnectionPool;
+
+	/**
+	 * <p>
+	 *     A lease on the database connection of the calling thread. The lease is obtained by calling
+	 *     SqlConnectionPool::acquire and is automatically given back to the pool when this object is destroyed.
+	 * </p>
+	 * <p>
+	 *     Qt connections can only be used from the thread that created them: never pass a PooledConnection
+	 *     (or the QSqlDatabase it exposes) to another thread.
+	 * </p>
+	 *
+	 * @see fr.koor.security.impl.SqlConnectionPool
+	 *
+	 * @author KooR.fr
+	 */
+	class PooledConnection {
+		SqlConnectionPool * pool;
+		QSqlDatabase connection;
+		std::shared_ptr<StatementCache> statements;
+	public:
+		/**
+		 * Class constructor. Reserved to the SqlConnectionPool class.
+		 *
+		 * @param pool			The pool that owns the connection.
+		 * @param connection	The leased connection.
+		 * @param statements	The prepared statements of the connection.
+		 */
+		PooledConnection( SqlConnectionPool & pool, const QSqlDatabase & connection, const std::shared_ptr<StatementCache> & statements );
+
+		/**
+		 * Move constructor: the lease is transfered to the new instance.
+		 *
+		 * @param original	The lease to move.
+		 */
+		PooledConnection( PooledConnection && original );
+
+		/**
+		 * Class destructor: the lease is given back to the pool.
+		 */
+		~PooledConnection();
+
+		/**
+		 * Copies are forbidden
+		 */
+		PooledConnection( const PooledConnection & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		PooledConnection & operator=( const PooledConnection & original ) = delete;
+
+		/**
+		 * Returns the leased connection. Use it to build your QSqlQuery instances.
+		 *
+		 * @return The Qt database connection.
+		 */
+		QSqlDatabase & database() {
+			return this->connection;
+		}
+
+		/**
+		 * Returns a prepared query of the statement cache of the connection, preparing it if required.
+		 * Use it for the statements executed again and again with different bound values.
+		 *
+		 * @param statementId	The statement identifier: one identifier per distinct SQL text.
+		 * @param strSql		The SQL text of the statement.
+		 * @return The prepared query, to bind by name and execute.
+		 *
+		 * @throws SecurityManagerException	Thrown if the statement cannot be prepared.
+		 */
+		QSqlQuery & prepare( uint statementId, const QString & strSql ) {
+			return this->statements->prepare( this->connection, statementId, strSql );
+		}
+	};
+
+
+	/**
+	 * <p>
+	 *     This pool manages the database connections used by a SqlSecurityManager. Because a Qt connection
+	 *     cannot be shared between threads, each thread receives its own named connection: the pool bounds the
+	 *     number of threads that can hold a connection at the same time. When the pool is exhausted, callers
+	 *     wait (at most the configured acquire timeout) for another thread to release its lease.
+	 * </p>
+	 * <p>
+	 *     A connection which stayed idle longer than the health check interval is checked before being leased
+	 *     again and is reopened if the RDBMS has dropped it.
+	 * </p>
+	 * <p>
+	 *     A connection is only opened, used and closed by its thread: closeAll closes the connection of the
+	 *     calling thread and marks the other ones, which their threads close at the end of their current
+	 *     lease or at the start of the next one.
+	 * </p>
+	 *
+	 * @see fr.koor.security.impl.PooledConnection
+	 * @see fr.koor.security.impl.SqlSecurityManager
+	 *
+	 * @author KooR.fr
+	 */
+	class SqlConnectionPool {
+	public:
+		/**
+		 * Prepares a newly opened (or reopened) connection: sets the session options, for instance. Must throw
+		 * an exception if the connection is not usable.
+		 */
+		typedef std::function<void( QSqlDatabase & )> ConnectionInitializer;
+
+	private:
+		/**
+		 * Bookkeeping for the connection owned by a thread.
+		 */
+		struct ThreadConnection {
+			QString name;
+			std::shared_ptr<StatementCache> statements;
+			uint leases = 0;
+			uint generation = 0;			// The closeAll calls before the connection was opened
+			std::chrono::steady_clock::time_point lastUse;
+		};
+
+		static uint poolCounter;
+
+		mutable std::mutex poolMutex;
+		std::condition_variable connectionReleased;
+		std::map<std::thread::id, ThreadConnection> connections;
+		uint activeThreads = 0;
+		uint connectionCounter = 0;
+		uint generation = 0;
+		uint poolIdentifier;
+		StatementCache::Counters statementCounters;
+
+		std::string driverName;
+		std::string hostname;
+		std::string database;
+		std::string login;
+		std::string password;
+
+		ConnectionInitializer connectionInitializer;
+
+		uint maximumSize;
+		std::chrono::milliseconds acquireTimeout = std::chrono::seconds( 5 );
+		std::chrono::milliseconds healthCheckInterval = std::chrono::seconds( 30 );
+
+	public:
+		/**
+		 * The default number of connections that can be leased at the same time.
+		 */
+		static const uint DEFAULT_MAXIMUM_SIZE = 8;
+
+		/**
+		 * Class constructor. No connection is opened before the first call to acquire.
+		 *
+		 * @param driverName	The Qt SQL driver to use (QMYSQL, for instance).
+		 * @param hostname		The hostname or the ip address of the RDBMS.
+		 * @param database		The name of the used database.
+		 * @param login			The login used to establish the connections.
+		 * @param password		The login password to establish the connections.
+		 * @param maximumSize	The maximum number of connections leased at the same time.
+		 */
+		SqlConnectionPool( const std::string & driverName, const std::string & hostname, const std::string & database,
+						   const std::string & login, const std::string & password, uint maximumSize = DEFAULT_MAXIMUM_SIZE );
+
+		/**
+		 * Class destructor: all the connections are closed. No other thread must still use the pool.
+		 */
+		~SqlConnectionPool();
+
+		/**
+		 * Copies are forbidden
+		 */
+		SqlConnectionPool( const SqlConnectionPool & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		SqlConnectionPool & operator=( const SqlConnectionPool & original ) = delete;
+
+		/**
+		 * Leases the connection of the calling thread, opening it if required. Leases are reentrant: a thread
+		 * which already holds a lease gets its connection again without consuming another slot of the pool.
+		 *
+		 * @return The lease on the thread connection.
+		 *
+		 * @throws SecurityManagerException Thrown if no connection is released before the acquire timeout or
+		 *         if the connection cannot be opened.
+		 */
+		PooledConnection acquire();
+
+		/**
+		 * Closes the connection owned by the calling thread. A thread that stops using the security manager
+		 * (a worker thread that terminates, for instance) should call this method. No lease must be held by
+		 * the calling thread.
+		 */
+		void closeThreadConnection();
+
+		/**
+		 * Closes all the connections of the pool. The connection of the calling thread is closed at once (no
+		 * lease must be held by the calling thread); those of the other threads are closed by their thread,
+		 * when it releases its lease or when it acquires its connection again.
+		 */
+		void closeAll();
+
+		/**
+		 * Returns the Qt SQL driver used by the connections.
+		 * @return The driver name.
+		 */
+		const std::string & getDriverName() const {
+			return this->driverName;
+		}
+
+		/**
+		 * Changes the function called each time a connection is opened. Must be called before the first
+		 * connection is opened.
+		 *
+		 * @param connectionInitializer		The connection initializer, or nullptr.
+		 */
+		void setConnectionInitializer( ConnectionInitializer connectionInitializer ) {
+			this->connectionInitializer = connectionInitializer;
+		}
+
+		/**
+		 * Returns the maximum number of connections leased at the same time.
+		 * @return The pool size.
+		 */
+		uint getMaximumSize() const;
+
+		/**
+		 * Changes the maximum number of connections leased at the same time.
+		 * @param maximumSize	The new pool size (at least 1).
+		 */
+		void setMaximumSize( uint maximumSize );
+
+		/**
+		 * Returns the maximum duration a caller waits for a connection.
+		 * @return The acquire timeout.
+		 */
+		std::chrono::milliseconds getAcquireTimeout() const;
+
+		/**
+		 * Changes the maximum duration a caller waits for a connection.
+		 * @param acquireTimeout	The new acquire timeout.
+		 */
+		void setAcquireTimeout( std::chrono::milliseconds acquireTimeout );
+
+		/**
+		 * Returns the idle duration after which a connection is checked before being leased.
+		 * @return The health check interval.
+		 */
+		std::chrono::milliseconds getHealthCheckInterval() const;
+
+		/**
+		 * Changes the idle duration after which a connection is checked before being leased.
+		 * @param healthCheckInterval	The new health check interval.
+		 */
+		void setHealthCheckInterval( std::chrono::milliseconds healthCheckInterval );
+
+		/**
+		 * Returns the number of connections currently opened by the pool.
+		 * @return The opened connection count.
+		 */
+		uint getOpenConnectionCount();
+
+		/**
+		 * Returns the hits and misses of the statement caches of all the connections.
+		 * @return The statement cache statistics.
+		 */
+		StatementCache::Statistics getStatementCacheStatistics() const;
+
+	private:
+
+		/**
+		 * Gives back a lease of the calling thread. Called by the PooledConnection destructor.
+		 */
+		void release();
+
+		/**
+		 * Opens a new named connection for the calling thread, then calls the connection initializer.
+		 *
+		 * @param connectionName	The Qt name of the connection.
+		 * @return The opened connection.
+		 *
+		 * @throws SecurityManagerException	Thrown if the connection cannot be opened or initialized.
+		 */
+		QSqlDatabase openConnection( const QString & connectionName );
+
+		/**
+		 * Checks that the connection is still usable, and tries to reopen it otherwise. The prepared
+		 * statements of a reopened connection are dropped.
+		 *
+		 * @param connection	The connection to check.
+		 * @param statements	The prepared statements of the connection.
+		 *
+		 * @throws SecurityManagerException	Thrown if the connection cannot be reopened.
+		 */
+		void checkHealth( QSqlDatabase & connection, StatementCache & statements );
+
+		/**
+		 * Drops the prepared statements of a connection, then closes and unregisters it.
+		 *
+		 * @param threadConnection	The bookkeeping of the connection.
+		 */
+		static void removeConnection( const ThreadConnection & threadConnection );
+
+		friend class PooledConnection;
+	};
+
+}
+
+#endif /* IMPL_SQLCONNECTIONPOOL_H_ */
@@ -1,8 +1,14 @@
+#include <algorithm>
 #include <ctime>
+#include <sstream>
+#include <unordered_set>
 
 #include <QtCore/QVariant>
+#include <QtSql/QSqlError>
 #include <QtSql/QSqlQuery>
 
+#include "LoginFolding.h"
+#include "Pbkdf2PasswordHasher.h"
 #include "SqlSecurityManager.h"
 
 using namespace std;
@@ -15,32 +21,159 @@ using namespace fr::koor::security;
 //--------------------------------------------------------------------------------------------
 
 /**
- * Returns the next used primary key for the specified table and column.
- * Caution: the type of the specified column must be compatible with the int java type.
- *
- * @param tableName		The name of the considered table.
- * @param columnName	The name of the column that contains primary keys.
- * @return The next used value.
- *
- * @throws SecurityManagerException	Thrown if a Sql error is generated.
+ * The T_USERS columns read to build a User instance (see SqlUserManager::readUser).
  */
-uint getNextAvailablePrimaryKey( QString tableName, QString columnName ) {
-	try {
-		QString strSql = "SELECT max(%1) FROM %2";
-		strSql = strSql.arg( columnName ).arg( tableName );
-		QSqlQuery query( strSql );
-		query.exec();
-		uint nextIdentifier = 0;
-		if ( query.next() ) {
-			nextIdentifier = query.value( 0 ).toInt();
-		}
-		return ++nextIdentifier;
-	} catch ( const std::exception & exception ) {
-		QString errorMessage = QString( "Cannot compute next primary key: %1" ).arg( exception.what() );
-		throw SecurityManagerException( errorMessage.toStdString() );
+static const QString USER_COLUMNS = "u.IdUser, u.Login, u.Password, u.ConnectionNumber, u.LastConnection, u.ConsecutiveError, "
+									"u.IsDisabled, u.FirstName, u.LastName, u.Email";
+
+/**
+ * The joins that add the role identifier and the role name (null if the user has no role) to the user columns.
+ */
+static const QString USER_ROLES_JOIN = " FROM T_USERS u LEFT JOIN T_USER_ROLES ur ON ur.IdUser=u.IdUser LEFT JOIN T_ROLES r ON r.IdRole=ur.IdRole ";
+
+/**
+ * The maximum number of values bound to an IN list: SQLite refuses more than 999 parameters per statement.
+ */
+static const size_t MAXIMUM_IN_LIST_SIZE = 500;
+
+/**
+ * The identifiers of the statements kept prepared by each connection (see PooledConnection::prepare).
+ */
+enum Statement : uint {
+	SELECT_USER_BY_LOGIN,
+	SELECT_USER_BY_IDENTIFIER,
+	SELECT_USERS_IN_ROLE,
+	SELECT_USER_IDENTIFIER,
+	INSERT_USER,
+	UPDATE_USER,
+	UPDATE_PASSWORD,
+	RECORD_LOGIN,
+	RECORD_LOGIN_AND_PASSWORD,
+	RECORD_ERROR,
+	RECORD_ERROR_AND_DISABLE,
+	DELETE_USER_ROLES,
+	DELETE_USER,
+	SELECT_ROLE_NAME,
+	SELECT_ROLE_IDENTIFIER,
+	INSERT_ROLE,
+	UPDATE_ROLE,
+	DELETE_ROLE,
+	SELECT_CHANGES
+};
+
+/**
+ * The operations measured by the metrics of this manager (see SqlSecurityManager::getMetrics), and their names.
+ */
+enum Operation : uint {
+	OPERATION_CHECK_CREDENTIALS,
+	OPERATION_GET_USER_BY_ID,
+	OPERATION_GET_USER_BY_LOGIN,
+	OPERATION_FOR_EACH_USER_IN_ROLE,
+	OPERATION_INSERT_USER,
+	OPERATION_UPDATE_USER,
+	OPERATION_DELETE_USER,
+	OPERATION_SELECT_ROLE_BY_ID,
+	OPERATION_SELECT_ROLE_BY_NAME,
+	OPERATION_INSERT_ROLE,
+	OPERATION_UPDATE_ROLE,
+	OPERATION_DELETE_ROLE,
+	OPERATION_REFRESH_ROLES,
+	OPERATION_INSERT_USERS,
+	OPERATION_REHASH_LEGACY_PASSWORDS,
+	OPERATION_WRITE_LOGIN_UPDATES,
+	OPERATION_APPLY_CHANGES,
+	OPERATION_HASH_PASSWORD,
+	OPERATION_VERIFY_PASSWORD,
+	OPERATION_SQL_QUERY,
+	OPERATION_SQL_BATCH
+};
+
+static const char * const OPERATION_NAMES[] = {
+	"check_credentials",
+	"get_user_by_id",
+	"get_user_by_login",
+	"for_each_user_in_role",
+	"insert_user",
+	"update_user",
+	"delete_user",
+	"select_role_by_id",
+	"select_role_by_name",
+	"insert_role",
+	"update_role",
+	"delete_role",
+	"refresh_roles",
+	"insert_users",
+	"rehash_legacy_passwords",
+	"write_login_updates",
+	"apply_changes",
+	"hash_password",
+	"verify_password",
+	"sql_query",
+	"sql_batch"
+};
+
+/**
+ * The caches measured by the metrics of this manager. The user and statement caches keep their own statistics.
+ */
+enum MeasuredCache : uint {
+	ROLE_CACHE
+};
+
+/**
+ * The session options of the SQLite connections: write-ahead logging, so that the readers never wait for the
+ * writer, commits synced at checkpoints only, memory mapped reads and a 16 MB page cache.
+ */
+static const char * const SQLITE_PRAGMAS[] = {
+	"PRAGMA journal_mode=WAL",
+	"PRAGMA synchronous=NORMAL",
+	"PRAGMA busy_timeout=5000",
+	"PRAGMA mmap_size=268435456",
+	"PRAGMA cache_size=-16384",
+	"PRAGMA temp_store=MEMORY",
+	"PRAGMA foreign_keys=ON"
+};
+
+/**
+ * The schema of SecurityComponent.sql, in the SQLite dialect. Logins and role names use the NOCASE collation,
+ * like the case insensitive collation of the MySQL tables.
+ */
+static const char * const SQLITE_SCHEMA[] = {
+	"CREATE TABLE IF NOT EXISTS T_ROLES ( IdRole INTEGER NOT NULL PRIMARY KEY, RoleName VARCHAR(50) NOT NULL COLLATE NOCASE UNIQUE )",
+	"CREATE TABLE IF NOT EXISTS T_USERS ( IdUser INTEGER NOT NULL PRIMARY KEY, Login VARCHAR(50) NOT NULL COLLATE NOCASE UNIQUE, "
+		"Password VARCHAR(128) NOT NULL, ConnectionNumber INTEGER NOT NULL DEFAULT 0, LastConnection INTEGER DEFAULT NULL, "
+		"ConsecutiveError INTEGER DEFAULT 0, IsDisabled INTEGER DEFAULT 0, FirstName VARCHAR(25) NOT NULL DEFAULT '', "
+		"LastName VARCHAR(25) NOT NULL DEFAULT '', Email VARCHAR(50) NOT NULL DEFAULT '' )",
+	"CREATE TABLE IF NOT EXISTS T_USER_ROLES ( IdUser INTEGER DEFAULT NULL REFERENCES T_USERS (IdUser), "
+		"IdRole INTEGER DEFAULT NULL REFERENCES T_ROLES (IdRole) )",
+	"CREATE INDEX IF NOT EXISTS T_USER_ROLES_IdUser ON T_USER_ROLES (IdUser)",
+	"CREATE INDEX IF NOT EXISTS T_USER_ROLES_IdRole ON T_USER_ROLES (IdRole)",
+	"CREATE TABLE IF NOT EXISTS T_SEQUENCES ( SequenceName VARCHAR(50) NOT NULL PRIMARY KEY, NextValue INTEGER NOT NULL )",
+	"CREATE TABLE IF NOT EXISTS T_CHANGE_LOG ( Version INTEGER PRIMARY KEY AUTOINCREMENT, EntityType CHAR(1) NOT NULL, "
+		"EntityId INTEGER NOT NULL, ChangedAt INTEGER NOT NULL )",
+	"CREATE INDEX IF NOT EXISTS T_CHANGE_LOG_ChangedAt ON T_CHANGE_LOG (ChangedAt)",
+	"INSERT OR IGNORE INTO T_ROLES VALUES (1,'admin'),(2,'demo')"
+};
+
+/**
+ * The deleter of the worker pools: releasing the last reference only signals it. The pool is destroyed by
+ * SqlSecurityManager::retirePool, whose thread waits for this signal and doesn't belong to the pool.
+ */
+struct PoolRelease {
+	std::shared_ptr<std::promise<void>> released = std::make_shared<std::promise<void>>();
+
+	void operator()( WorkerPool * pool ) const {
+		this->released->set_value();
 	}
+};
+
+/**
+ * Shares a new worker pool: it must be destroyed by SqlSecurityManager::retirePool.
+ */
+static shared_ptr<WorkerPool> shareWorkerPool( WorkerPool * pool ) {
+	return shared_ptr<WorkerPool>( pool, PoolRelease() );
 }
 
+
 //--------------------------------------------------------------------------------------------
 //--- SqlUserManager implementation ----------------------------------------------------------
 //--------------------------------------------------------------------------------------------
@@ -52,101 +185,69 @@ SqlSecurityManager::SqlUserManager::~SqlUserManager() {
 }
 
 UserPtr SqlSecurityManager::SqlUserManager::checkCredentials( const std::string & userLogin, const std::string & userPassword ) {
-	try {
-		string userNewPassword = this->encryptPassword( userPassword );
-
-		QString strSql = "SELECT * FROM T_USERS WHERE Login=:login and  Password=:password";
-		QSqlQuery query;
-		query.prepare( strSql );
-		query.bindValue( ":login", userLogin.c_str() );
-		query.bindValue( ":password", userNewPassword.c_str() );
-		query.exec();
-
-		if ( query.next() ) {
-			// User informations update
-
-			uint identifier = query.value( 0 ).toUInt();
-			uint connectionNumber =  query.value( 3 ).toUInt() + 1;
-			time_t lastConnection = (time_t) query.value( 4 ).toULongLong();
-			uint consecutiveError = query.value( 5 ).toUInt();
-			bool isDisabled = query.value( 6 ).toBool();
-			QString firstName = query.value( 7 ).toString();
-			QString lastName = query.value( 8 ).toString();
-			QString email = query.value( 9 ).toString();
-
-			if ( isDisabled ) throw AccountDisabledException( "Account is disabled" );
-
-
-			strSql = "UPDATE T_USERS SET ConnectionNumber=:connectionNumber, LastConnection=:lastConnection WHERE IdUser=:identifier";
-			query.prepare( strSql );
-			query.bindValue( ":connectionNumber", connectionNumber );
-			query.bindValue( ":lastConnection", (qulonglong) time( nullptr ) );
-			query.bindValue( ":identifier", identifier );
-			query.exec();
+	return this->checkCredentials( userLogin, userPassword, string() );
+}
 
+UserPtr SqlSecurityManager::SqlUserManager::checkCredentials( const std::string & userLogin, const std::string & userPassword, const std::string & source ) {
+	OperationMetrics::Scope scope( securityManager.metrics, OPERATION_CHECK_CREDENTIALS );
 
-			if ( consecutiveError != 0 ){
-				query = QSqlQuery();
-				strSql = "UPDATE T_USERS SET ConsecutiveError = 0 WHERE IdUser=:identifier";
-				query.prepare( strSql );
-				query.bindValue( ":identifier", identifier );
-				query.exec();
-				consecutiveError = 0;
-			}
+	// Admission control: rejected attempts never reach the database
+	chrono::milliseconds retryAfter;
+	if ( ! source.empty() && ! securityManager.sourceRateLimiter.tryAcquire( source, retryAfter ) ) {
+		throw RateLimitedException( "Too many login attempts from " + source, retryAfter );
+	}
+	if ( ! securityManager.loginRateLimiter.tryAcquire( LoginFolding::foldLogin( userLogin ), retryAfter ) ) {
+		throw RateLimitedException( "Too many login attempts for " + userLogin, retryAfter );
+	}
 
-			UserPtr user( new User( securityManager, identifier, userLogin, userNewPassword ) );
-			user->setConnectionNumber( connectionNumber );
-			user->setLastConnection( lastConnection );
-			user->setConsecutiveErrors( consecutiveError );
-			user->setDisabled( isDisabled );
-			user->setFirstName( firstName.toStdString() );
-			user->setLastName( lastName.toStdString() );
-			user->setEmail( email.toStdString() );
-
-			// Associated roles loading
-			RoleManagerPtr roleManager = securityManager.getRoleManager();
-			strSql = "SELECT IdRole FROM T_USER_ROLES WHERE IdUser=:identifier";
-			query.prepare( strSql );
-			query.bindValue( ":identifier", identifier );
-			query.exec();
+	if ( securityManager.isUnknownLogin( userLogin ) ) {
+		// Unknown logins cost a hash too, so that they can't be detected by timing
+		securityManager.hashPassword( userPassword );
+		throw BadCredentialsException( "Your identity is rejected" );
+	}
 
-			while ( query.next() ) {
-				user->addRole( roleManager->selectRoleById( query.value(0).toInt() ) );
-			}
+	UserPtr user;
+	try {
+		// User informations and associated roles are fetched in a single round trip. The connection is
+		// released before the password verification, which is far longer than the query.
+		PooledConnection connection = securityManager.connectionPool.acquire();
+		user = this->selectUser( connection, SELECT_USER_BY_LOGIN, "u.Login=:key", userLogin.c_str() );
+	} catch ( const exception & exception ) {
+		QString errorMessage = QString( "Can't check credentials: %1" ).arg( exception.what() );
+		throw BadCredentialsException( errorMessage.toStdString() );
+	}
 
-			return user;
+	bool samePassword;
+	try {
+		if ( ! user ) {
+			// Unknown logins cost a hash too, so that they can't be detected by timing
+			securityManager.hashPassword( userPassword );
+			throw BadCredentialsException( "Your identity is rejected" );
 		}
-	} catch ( const AccountDisabledException & exception ) {
+		samePassword = securityManager.verifyPassword( userPassword, user->getEncryptedPassword() );
+	} catch ( const BadCredentialsException & exception ) {
 		throw exception;
 	} catch ( const exception & exception ) {
 		QString errorMessage = QString( "Can't check credentials: %1" ).arg( exception.what() );
 		throw BadCredentialsException( errorMessage.toStdString() );
 	}
 
-	try {
-		QString strSql = "SELECT * FROM T_USERS WHERE Login=:login";
-		QSqlQuery query;
-		query.prepare( strSql );
-		query.bindValue( ":login", userLogin.c_str() );
-		query.exec();
-
-		if ( query.next() ) {
-			uint identifier = query.value( 0 ).toUInt();
-			bool forceDisabling = query.value( 5 ).toUInt() == 2;
-
-			strSql = "UPDATE T_USERS SET ConsecutiveError=ConsecutiveError+1 WHERE IdUser=:identifier";
-			query.prepare( strSql );
-			query.bindValue( ":identifier", identifier );
-			query.exec();
-
-			if ( forceDisabling ) {
-				strSql = "UPDATE T_USERS SET IsDisabled = 1 WHERE IdUser=:identifier";
-				query.prepare( strSql );
-				query.bindValue( ":identifier", identifier );
-				query.exec();
-				throw AccountDisabledException( "Account is disabled" );
-			}
+	if ( samePassword ) {
+		if ( user->isDisabled() ) throw AccountDisabledException( "Account is disabled" );
+		securityManager.loginRateLimiter.reset( LoginFolding::foldLogin( userLogin ) );
+		try {
+			this->recordSuccessfulLogin( user, userPassword );
+		} catch ( const exception & exception ) {
+			QString errorMessage = QString( "Can't check credentials: %1" ).arg( exception.what() );
+			throw BadCredentialsException( errorMessage.toStdString() );
 		}
+		return user;
+	}
+
+	try {
+		this->recordFailedLogin( user );
+	} catch ( const AccountDisabledException & exception ) {
+		throw exception;
 	} catch ( const exception & exception ) {
 		QString errorMessage = QString( "Your identity is rejected: %1" ).arg( exception.what() );
 		throw BadCredentialsException( errorMessage.toStdString() );
@@ -155,36 +256,358 @@ UserPtr SqlSecurityManager::SqlUserManager::checkCredentials( const std::string
 	throw BadCredentialsException( "Your identity is rejected" );
 }
 
+void SqlSecurityManager::SqlUserManager::recordSuccessfulLogin( UserPtr user, const std::string & clearPassword ) {
+	uint identifier = user->getIdentifier();
+	user->setConnectionNumber( user->getConnectionNumber() + 1 );
+	user->setConsecutiveErrors( 0 );
+
+	// Passwords stored with an outdated algorithm (or in clear) are upgraded at login
+	bool rehashNeeded = securityManager.getPasswordHasher()->needsRehash( user->getEncryptedPassword() );
+	if ( rehashNeeded ) user->setEncryptedPassword( securityManager.hashPassword( clearPassword ) );
+
+	PooledConnection connection = securityManager.connectionPool.acquire();
+
+	shared_ptr<LoginUpdateQueue> loginUpdates = atomic_load( &securityManager.loginUpdates );
+	if ( loginUpdates ) {
+		loginUpdates->recordLogin( identifier, user->getLogin(), time( nullptr ) );
+		if ( rehashNeeded ) {
+			QSqlQuery & query = connection.prepare( UPDATE_PASSWORD, "UPDATE T_USERS SET Password=:password WHERE IdUser=:identifier" );
+			query.bindValue( ":password", user->getEncryptedPassword().c_str() );
+			query.bindValue( ":identifier", identifier );
+			if ( ! securityManager.execute( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
+		}
+	} else {
+		QString strSql = "UPDATE T_USERS SET ConnectionNumber=ConnectionNumber+1, LastConnection=:lastConnection, ConsecutiveError=0";
+		if ( rehashNeeded ) strSql += ", Password=:password";
+		strSql += " WHERE IdUser=:identifier";
+		QSqlQuery & query = connection.prepare( rehashNeeded ? RECORD_LOGIN_AND_PASSWORD : RECORD_LOGIN, strSql );
+		query.bindValue( ":lastConnection", (qulonglong) time( nullptr ) );
+		if ( rehashNeeded ) query.bindValue( ":password", user->getEncryptedPassword().c_str() );
+		query.bindValue( ":identifier", identifier );
+		if ( ! securityManager.execute( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
+	}
+	this->userCache.invalidate( identifier );
+}
+
+void SqlSecurityManager::SqlUserManager::recordFailedLogin( UserPtr user ) {
+	uint identifier = user->getIdentifier();
+
+	// A pending consecutive errors reset must be written before the error is accounted
+	shared_ptr<LoginUpdateQueue> loginUpdates = atomic_load( &securityManager.loginUpdates );
+	if ( loginUpdates ) loginUpdates->flushLogin( user->getLogin() );
+
+	// The consecutive errors read with the user already include the pending logins
+	bool forceDisabling = user->getConsecutiveErrors() == 2;
+
+	PooledConnection connection = securityManager.connectionPool.acquire();
+	QSqlDatabase & database = connection.database();
+	QString strSql = "UPDATE T_USERS SET ConsecutiveError=ConsecutiveError+1";
+	if ( forceDisabling ) strSql += ", IsDisabled=1";
+	strSql += " WHERE IdUser=:identifier";
+
+	// The other nodes must revoke the sessions of the disabled account: the disabling and its change log
+	// row are written together
+	if ( forceDisabling ) database.transaction();
+	try {
+		QSqlQuery & query = connection.prepare( forceDisabling ? RECORD_ERROR_AND_DISABLE : RECORD_ERROR, strSql );
+		query.bindValue( ":identifier", identifier );
+		if ( ! securityManager.execute( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
+		if ( forceDisabling ) {
+			securityManager.logChanges( database, ChangeFeedPoller::USER, QVariantList() << identifier );
+			if ( ! database.commit() ) throw std::runtime_error( database.lastError().text().toStdString() );
+		}
+	} catch ( ... ) {
+		if ( forceDisabling ) database.rollback();
+		this->userCache.invalidate( identifier );
+		throw;
+	}
+	this->userCache.invalidate( identifier );
+
+	if ( forceDisabling ) throw AccountDisabledException( "Account is disabled" );
+}
+
 UserPtr SqlSecurityManager::SqlUserManager::getUserById( uint userId ) const {
-	// TODO
-	return UserPtr(nullptr);
+	OperationMetrics::Scope scope( securityManager.metrics, OPERATION_GET_USER_BY_ID );
+	UserPtr user = this->userCache.getById( userId );
+	if ( user ) return user;
+
+	PooledConnection connection = securityManager.connectionPool.acquire();
+	try {
+		user = this->selectUser( connection, SELECT_USER_BY_IDENTIFIER, "u.IdUser=:key", userId );
+	} catch ( const std::exception & exception ) {
+		QString errorMessage = QString( "Cannot select user for identifier %1: %2" ).arg( userId ).arg( exception.what() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+
+	if ( ! user ) {
+		QString errorMessage = QString( "User identifier %1 not found" ).arg( userId );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	this->userCache.put( *user );
+	return user;
 }
 
 UserPtr SqlSecurityManager::SqlUserManager::getUserByLogin( const std::string & login ) const {
-	// TODO
-	return UserPtr(nullptr);
+	OperationMetrics::Scope scope( securityManager.metrics, OPERATION_GET_USER_BY_LOGIN );
+	UserPtr user = this->userCache.getByLogin( login );
+	if ( user ) return user;
+
+	if ( securityManager.isUnknownLogin( login ) ) {
+		QString errorMessage = QString( "User %1 not found" ).arg( login.c_str() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+
+	PooledConnection connection = securityManager.connectionPool.acquire();
+	try {
+		user = this->selectUser( connection, SELECT_USER_BY_LOGIN, "u.Login=:key", login.c_str() );
+	} catch ( const std::exception & exception ) {
+		QString errorMessage = QString( "Cannot select user %1: %2" ).arg( login.c_str() ).arg( exception.what() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+
+	if ( ! user ) {
+		QString errorMessage = QString( "User %1 not found" ).arg( login.c_str() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	this->userCache.put( *user );
+	return user;
 }
 
-std::vector<UserPtr> SqlSecurityManager::SqlUserManager::getUsersByRole( RolePtr role ) const {
-	// TODO
-	return vector<UserPtr>();
+void SqlSecurityManager::SqlUserManager::forEachUserInRole( RolePtr role, const UserVisitor & visitor, size_t pageSize ) const {
+	OperationMetrics::Scope scope( securityManager.metrics, OPERATION_FOR_EACH_USER_IN_ROLE );
+	if ( pageSize == 0 ) pageSize = 1;
+
+	// Keyset pagination: each page restarts after the last visited identifier, with the roles of its users
+	QString strSql = "SELECT " + USER_COLUMNS + ", r.IdRole, r.RoleName "
+					 "FROM ( SELECT IdUser FROM T_USER_ROLES WHERE IdRole=:role AND IdUser>:lastIdentifier "
+					 "ORDER BY IdUser LIMIT :pageSize ) page "
+					 "JOIN T_USERS u ON u.IdUser=page.IdUser "
+					 "LEFT JOIN T_USER_ROLES ur ON ur.IdUser=u.IdUser LEFT JOIN T_ROLES r ON r.IdRole=ur.IdRole "
+					 "ORDER BY u.IdUser";
+	uint lastIdentifier = 0;
+	bool morePages = true;
+
+	while ( morePages ) {
+		// The page is read before the visit: the connection isn't held while the visitor runs
+		vector<UserPtr> page;
+		page.reserve( pageSize );
+		try {
+			PooledConnection connection = securityManager.connectionPool.acquire();
+			QSqlQuery & query = connection.prepare( SELECT_USERS_IN_ROLE, strSql );
+			query.bindValue( ":role", role->getIdentifier() );
+			query.bindValue( ":lastIdentifier", lastIdentifier );
+			query.bindValue( ":pageSize", (qulonglong) pageSize );
+			if ( ! securityManager.execute( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
+
+			if ( query.next() ) {
+				while ( query.isValid() ) page.push_back( this->readUser( query ) );
+			}
+		} catch ( const std::exception & exception ) {
+			QString errorMessage = QString( "Cannot select users of role %1: %2" ).arg( role->getRoleName().c_str() ).arg( exception.what() );
+			throw SecurityManagerException( errorMessage.toStdString() );
+		}
+
+		morePages = page.size() == pageSize;
+		if ( ! page.empty() ) lastIdentifier = page.back()->getIdentifier();
+		for( UserPtr & user : page ) {
+			if ( ! visitor( user ) ) return;
+		}
+	}
 }
 
 UserPtr SqlSecurityManager::SqlUserManager::insertUser( const std::string & login, const std::string & password ) {
-	// TODO
-	return UserPtr(nullptr);
+	OperationMetrics::Scope scope( securityManager.metrics, OPERATION_INSERT_USER );
+	bool userExists = false;
+	try {
+		PooledConnection connection = securityManager.connectionPool.acquire();
+		QSqlQuery & query = connection.prepare( SELECT_USER_IDENTIFIER, "SELECT IdUser FROM T_USERS WHERE Login=:login" );
+		query.bindValue( ":login", login.c_str() );
+		if ( ! securityManager.execute( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
+
+		if ( query.next() ) userExists = true;
+	} catch ( const std::exception & exception ) {
+		QString errorMessage = QString( "Can't check the user existance: %1" ).arg( exception.what() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+
+	if ( userExists ) {
+		QString errorMessage = QString( "User %1 already registered" ).arg( login.c_str() );
+		throw UserAlreadyRegisteredException( errorMessage.toStdString() );
+	}
+
+	// Hashing is done without holding a connection
+	string encryptedPassword = this->encryptPassword( password );
+	securityManager.loginFilter.add( login );
+
+	PooledConnection connection = securityManager.connectionPool.acquire();
+	QSqlDatabase & database = connection.database();
+	try {
+		uint primaryKey = securityManager.userIdAllocator.allocate( database );
+		database.transaction();
+		QString strSql = "INSERT INTO T_USERS (IdUser, Login, Password, ConnectionNumber, LastConnection, ConsecutiveError, IsDisabled) "
+						 "VALUES ( :pk, :login, :password, 0, 0, 0, 0 )";
+		QSqlQuery & query = connection.prepare( INSERT_USER, strSql );
+		query.bindValue( ":pk", primaryKey );
+		query.bindValue( ":login", login.c_str() );
+		query.bindValue( ":password", encryptedPassword.c_str() );
+		if ( ! securityManager.execute( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
+		securityManager.logChanges( database, ChangeFeedPoller::USER, QVariantList() << primaryKey );
+		if ( ! database.commit() ) throw std::runtime_error( database.lastError().text().toStdString() );
+
+		return UserPtr( new User( securityManager, primaryKey, login, encryptedPassword ) );
+	} catch ( const std::exception & exception ) {
+		database.rollback();
+		QString errorMessage = QString( "Can't insert the user %1: %2" ).arg( login.c_str() ).arg( exception.what() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
 }
 
 void SqlSecurityManager::SqlUserManager::updateUser( UserPtr user ) {
-	// TODO
+	OperationMetrics::Scope scope( securityManager.metrics, OPERATION_UPDATE_USER );
+	PooledConnection connection = securityManager.connectionPool.acquire();
+	QSqlDatabase & database = connection.database();
+	uint identifier = user->getIdentifier();
+	securityManager.loginFilter.add( user->getLogin() );			// The login may have been changed
+
+	try {
+		database.transaction();
+
+		QString strSql = "UPDATE T_USERS SET Login=:login, Password=:password, ConnectionNumber=:connectionNumber, "
+						 "LastConnection=:lastConnection, ConsecutiveError=:consecutiveError, IsDisabled=:isDisabled, "
+						 "FirstName=:firstName, LastName=:lastName, Email=:email WHERE IdUser=:identifier";
+		QSqlQuery & query = connection.prepare( UPDATE_USER, strSql );
+		query.bindValue( ":login", user->getLogin().c_str() );
+		query.bindValue( ":password", user->getEncryptedPassword().c_str() );
+		query.bindValue( ":connectionNumber", user->getConnectionNumber() );
+		query.bindValue( ":lastConnection", (qulonglong) user->getLastConnection() );
+		query.bindValue( ":consecutiveError", user->getConsecutiveErrors() );
+		query.bindValue( ":isDisabled", user->isDisabled() ? 1 : 0 );
+		query.bindValue( ":firstName", user->getFirstName().c_str() );
+		query.bindValue( ":lastName", user->getLastName().c_str() );
+		query.bindValue( ":email", user->getEmail().c_str() );
+		query.bindValue( ":identifier", identifier );
+		if ( ! securityManager.execute( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
+
+		// Role associations are replaced
+		QSqlQuery & deleteQuery = connection.prepare( DELETE_USER_ROLES, "DELETE FROM T_USER_ROLES WHERE IdUser=:identifier" );
+		deleteQuery.bindValue( ":identifier", identifier );
+		if ( ! securityManager.execute( deleteQuery ) ) throw std::runtime_error( deleteQuery.lastError().text().toStdString() );
+
+		if ( ! user->getRoles().empty() ) {
+			QVariantList userIds;
+			QVariantList roleIds;
+			for( const RolePtr & role : user->getRoles() ) {
+				userIds << identifier;
+				roleIds << role->getIdentifier();
+			}
+			// Positional bindings: this batch is not kept in the statement cache
+			QSqlQuery insertQuery( database );
+			insertQuery.prepare( "INSERT INTO T_USER_ROLES (IdUser, IdRole) VALUES ( ?, ? )" );
+			insertQuery.addBindValue( userIds );
+			insertQuery.addBindValue( roleIds );
+			if ( ! securityManager.executeBatch( insertQuery ) ) throw std::runtime_error( insertQuery.lastError().text().toStdString() );
+		}
+
+		securityManager.logChanges( database, ChangeFeedPoller::USER, QVariantList() << identifier );
+		if ( ! database.commit() ) throw std::runtime_error( database.lastError().text().toStdString() );
+	} catch ( const std::exception & exception ) {
+		database.rollback();
+		this->userCache.invalidate( identifier );
+		QString errorMessage = QString( "Cannot update user with pk %1: %2" ).arg( identifier ).arg( exception.what() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	this->userCache.invalidate( identifier );
+	if ( user->isDisabled() ) securityManager.sessionStore.revokeUser( identifier );
 }
 
 void SqlSecurityManager::SqlUserManager::deleteUser( UserPtr user ) {
-	// TODO
+	OperationMetrics::Scope scope( securityManager.metrics, OPERATION_DELETE_USER );
+	PooledConnection connection = securityManager.connectionPool.acquire();
+	QSqlDatabase & database = connection.database();
+	uint identifier = user->getIdentifier();
+
+	try {
+		database.transaction();
+
+		QSqlQuery & rolesQuery = connection.prepare( DELETE_USER_ROLES, "DELETE FROM T_USER_ROLES WHERE IdUser=:identifier" );
+		rolesQuery.bindValue( ":identifier", identifier );
+		if ( ! securityManager.execute( rolesQuery ) ) throw std::runtime_error( rolesQuery.lastError().text().toStdString() );
+
+		QSqlQuery & userQuery = connection.prepare( DELETE_USER, "DELETE FROM T_USERS WHERE IdUser=:identifier" );
+		userQuery.bindValue( ":identifier", identifier );
+		if ( ! securityManager.execute( userQuery ) ) throw std::runtime_error( userQuery.lastError().text().toStdString() );
+
+		securityManager.logChanges( database, ChangeFeedPoller::USER, QVariantList() << identifier );
+		if ( ! database.commit() ) throw std::runtime_error( database.lastError().text().toStdString() );
+	} catch ( const std::exception & exception ) {
+		database.rollback();
+		QString errorMessage = QString( "Cannot delete user %1: %2" ).arg( user->getLogin().c_str() ).arg( exception.what() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	this->userCache.invalidate( identifier );
+	securityManager.loginFilter.remove( user->getLogin() );
+	securityManager.sessionStore.revokeUser( identifier );
 }
 
 std::string SqlSecurityManager::SqlUserManager::encryptPassword( const std::string & clearPassword ) const {
-	return clearPassword;  	// TODO: finish encription
+	return securityManager.hashPassword( clearPassword );
+}
+
+bool SqlSecurityManager::SqlUserManager::verifyPassword( const std::string & clearPassword, const std::string & encryptedPassword ) const {
+	return securityManager.verifyPassword( clearPassword, encryptedPassword );
+}
+
+std::string SqlSecurityManager::SqlUserManager::issueToken( UserPtr user, std::chrono::seconds timeToLive ) {
+	if ( user->isDisabled() ) throw AccountDisabledException( "Account is disabled" );
+	return securityManager.tokenSigner.sign( *user, time( nullptr ) + timeToLive.count() );
+}
+
+TokenClaims SqlSecurityManager::SqlUserManager::verifyToken( const std::string & token ) const {
+	return securityManager.tokenSigner.verify( token, time( nullptr ) );
+}
+
+Executor & SqlSecurityManager::SqlUserManager::getExecutor() const {
+	return *securityManager.requestExecutor;
+}
+
+UserPtr SqlSecurityManager::SqlUserManager::selectUser( PooledConnection & connection, uint statementId, const QString & condition, const QVariant & key ) const {
+	QString strSql = "SELECT " + USER_COLUMNS + ", r.IdRole, r.RoleName" + USER_ROLES_JOIN + "WHERE " + condition;
+	QSqlQuery & query = connection.prepare( statementId, strSql );
+	query.bindValue( ":key", key );
+	if ( ! securityManager.execute( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
+
+	if ( ! query.next() ) return UserPtr( nullptr );
+	return this->readUser( query );
+}
+
+UserPtr SqlSecurityManager::SqlUserManager::readUser( QSqlQuery & query ) const {
+	UserPtr user( new User( securityManager, query.value( 0 ).toUInt(), query.value( 1 ).toString().toStdString(), query.value( 2 ).toString().toStdString() ) );
+	user->setConnectionNumber( query.value( 3 ).toUInt() );
+	user->setLastConnection( (time_t) query.value( 4 ).toULongLong() );
+	user->setConsecutiveErrors( query.value( 5 ).toUInt() );
+	user->setDisabled( query.value( 6 ).toBool() );
+	user->setFirstName( query.value( 7 ).toString().toStdString() );
+	user->setLastName( query.value( 8 ).toString().toStdString() );
+	user->setEmail( query.value( 9 ).toString().toStdString() );
+
+	// Logins not yet written by the write-behind queue
+	shared_ptr<LoginUpdateQueue> loginUpdates = atomic_load( &securityManager.loginUpdates );
+	LoginUpdateQueue::PendingLogins pendingLogins;
+	if ( loginUpdates && loginUpdates->getPendingLogins( user->getIdentifier(), pendingLogins ) ) {
+		user->setConnectionNumber( user->getConnectionNumber() + pendingLogins.connectionCount );
+		user->setLastConnection( pendingLogins.lastConnection );
+		user->setConsecutiveErrors( 0 );
+	}
+
+	// Associated roles loading: one row per role, a null role if the user has none
+	uint identifier = user->getIdentifier();
+	do {
+		if ( ! query.value( 10 ).isNull() ) {
+			user->addRole( securityManager.roleManager->internRole( query.value( 10 ).toUInt(), query.value( 11 ).toString().toStdString() ) );
+		}
+	} while ( query.next() && query.value( 0 ).toUInt() == identifier );
+
+	return user;
 }
 
 
@@ -199,16 +622,23 @@ SqlSecurityManager::SqlRoleManager::~SqlRoleManager() {
 }
 
 RolePtr SqlSecurityManager::SqlRoleManager::selectRoleById( uint roleIdentifier ) {
+	OperationMetrics::Scope scope( securityManager.metrics, OPERATION_SELECT_ROLE_BY_ID );
+	RolePtr role = this->roleRegistry.findById( roleIdentifier );
+	securityManager.metrics.recordLookup( ROLE_CACHE, role != nullptr );
+	if ( role ) return role;
+
+	// Not yet cached: the role may have been inserted by another process
+	PooledConnection connection = securityManager.connectionPool.acquire();
+
 	try {
 		QString strSql = "SELECT RoleName FROM T_ROLES WHERE IdRole=:roleIdentifier";
-		QSqlQuery query;
-		query.prepare( strSql );
+		QSqlQuery & query = connection.prepare( SELECT_ROLE_NAME, strSql );
 		query.bindValue( ":roleIdentifier", roleIdentifier );
-		query.exec();
+		if ( ! securityManager.execute( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
 
 		if ( query.next() ) {
 			std::string roleName = query.value( 0 ).toString().toStdString();
-			return RolePtr( new Role( roleIdentifier, roleName ) );
+			return this->internRole( roleIdentifier, roleName );
 		}
 	} catch ( const std::exception & exception ) {
 		QString errorMessage = QString( "Cannot select role for identifier  %1: %2" ).arg( roleIdentifier ).arg( exception.what() );
@@ -221,35 +651,53 @@ RolePtr SqlSecurityManager::SqlRoleManager::selectRoleById( uint roleIdentifier
 
 
 RolePtr SqlSecurityManager::SqlRoleManager::selectRoleByName( const std::string & roleName ) {
+	OperationMetrics::Scope scope( securityManager.metrics, OPERATION_SELECT_ROLE_BY_NAME );
+	RolePtr role = this->findRoleByName( roleName );
+	if ( role ) return role;
+
+	QString errorMessage = QString( "Role %1 not found" ).arg( roleName.c_str() );
+	throw SecurityManagerException( errorMessage.toStdString() );
+}
+
+RolePtr SqlSecurityManager::SqlRoleManager::findRoleByName( const std::string & roleName ) {
+	RolePtr role = this->roleRegistry.findByName( roleName );
+	securityManager.metrics.recordLookup( ROLE_CACHE, role != nullptr );
+	if ( role ) return role;
+
+	// Not yet cached: the role may have been inserted by another process
+	PooledConnection connection = securityManager.connectionPool.acquire();
+
 	try {
-		QString strSql = "SELECT idRole FROM T_ROLES WHERE RoleName=:roleName";
-		QSqlQuery query;
-		query.prepare( strSql );
+		QString strSql = "SELECT IdRole, RoleName FROM T_ROLES WHERE RoleName=:roleName";
+		QSqlQuery & query = connection.prepare( SELECT_ROLE_IDENTIFIER, strSql );
 		query.bindValue( ":roleName", roleName.c_str() );
-		query.exec();
+		if ( ! securityManager.execute( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
 
 		if ( query.next() ) {
+			// The comparison ignores case: intern the stored spelling, not the requested one,
+			// otherwise a case variant would be taken for a rename of the role
 			uint roleIdentifier = query.value( 0 ).toInt();
-			return RolePtr( new Role( roleIdentifier, roleName ) );
+			std::string storedName = query.value( 1 ).toString().toStdString();
+			return this->internRole( roleIdentifier, storedName );
 		}
 	} catch ( const std::exception & exception ) {
 		QString errorMessage = QString( "Cannot select role %1: %2" ).arg( roleName.c_str() ).arg( exception.what() );
 		throw SecurityManagerException( errorMessage.toStdString() );
 	}
-
-	QString errorMessage = QString( "Role %1 not found" ).arg( roleName.c_str() );
-	throw SecurityManagerException( errorMessage.toStdString() );
+	return nullptr;
 }
 
 
 RolePtr SqlSecurityManager::SqlRoleManager::insertRole( const std::string & roleName ) {
+	OperationMetrics::Scope scope( securityManager.metrics, OPERATION_INSERT_ROLE );
+	PooledConnection connection = securityManager.connectionPool.acquire();
+
 	bool roleExists = false;
 	try {
-		QString strSql = "SELECT IdRole FROM T_ROLES WHERE RoleName=:roleName";
-		QSqlQuery query;
-		query.prepare( strSql );
+		QString strSql = "SELECT IdRole, RoleName FROM T_ROLES WHERE RoleName=:roleName";
+		QSqlQuery & query = connection.prepare( SELECT_ROLE_IDENTIFIER, strSql );
 		query.bindValue( ":roleName", roleName.c_str() );
-		query.exec();
+		if ( ! securityManager.execute( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
 
 		if ( query.next() ) roleExists = true;
 
@@ -263,32 +711,45 @@ RolePtr SqlSecurityManager::SqlRoleManager::insertRole( const std::string & role
 		throw RoleAlreadyRegisteredException( errorMessage.toStdString() );
 	}
 
+	QSqlDatabase & database = connection.database();
 	try {
-		uint primaryKey = getNextAvailablePrimaryKey( "T_ROLES", "IdRole" );
+		uint primaryKey = securityManager.roleIdAllocator.allocate( database );
+		database.transaction();
 		QString strSql = "INSERT INTO T_ROLES VALUES ( :pk, :roleName )";
-		QSqlQuery query;
-		query.prepare( strSql );
+		QSqlQuery & query = connection.prepare( INSERT_ROLE, strSql );
 		query.bindValue( ":pk", primaryKey );
 		query.bindValue( ":roleName", roleName.c_str() );
-		if ( ! query.exec() ) throw std::runtime_error( "Bad primary key" );
+		if ( ! securityManager.execute( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
+		securityManager.logChanges( database, ChangeFeedPoller::ROLE, QVariantList() << primaryKey );
+		if ( ! database.commit() ) throw std::runtime_error( database.lastError().text().toStdString() );
 
-		return RolePtr( new Role( primaryKey, roleName ) );
+		return this->roleRegistry.intern( primaryKey, roleName );
 	} catch ( const std::exception & exception ) {
+		database.rollback();
 		QString errorMessage = QString( "Can't insert the role %1: %2" ).arg( roleName.c_str() ).arg( exception.what() );
 		throw SecurityManagerException( errorMessage.toStdString() );
 	}
 }
 
 
-void SqlSecurityManager::SqlRoleManager::updateRole( RolePtr role ) {
+RolePtr SqlSecurityManager::SqlRoleManager::updateRole( RolePtr role, const std::string & newRoleName ) {
+	OperationMetrics::Scope scope( securityManager.metrics, OPERATION_UPDATE_ROLE );
+	PooledConnection connection = securityManager.connectionPool.acquire();
+	QSqlDatabase & database = connection.database();
+
 	try {
+		database.transaction();
 		QString strSql = "UPDATE T_ROLES SET RoleName=:roleName WHERE IdRole=:idRole";
-		QSqlQuery query;
-		query.prepare( strSql );
+		QSqlQuery & query = connection.prepare( UPDATE_ROLE, strSql );
 		query.bindValue( ":idRole", role->getIdentifier() );
-		query.bindValue( ":roleName", role->getRoleName().c_str() );
-		query.exec();
+		query.bindValue( ":roleName", newRoleName.c_str() );
+		if ( ! securityManager.execute( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
+		securityManager.logChanges( database, ChangeFeedPoller::ROLE, QVariantList() << role->getIdentifier() );
+		if ( ! database.commit() ) throw std::runtime_error( database.lastError().text().toStdString() );
+
+		return this->internRole( role->getIdentifier(), newRoleName );
 	} catch ( const std::exception & exception ) {
+		database.rollback();
 		QString errorMessage = QString( "Cannot update role with pk %1: %2" ).arg( role->getIdentifier() ).arg( exception.what() );
 		throw SecurityManagerException( errorMessage.toStdString() );
 	}
@@ -296,54 +757,761 @@ void SqlSecurityManager::SqlRoleManager::updateRole( RolePtr role ) {
 
 
 void SqlSecurityManager::SqlRoleManager::deleteRole( RolePtr role ) {
+	OperationMetrics::Scope scope( securityManager.metrics, OPERATION_DELETE_ROLE );
+	PooledConnection connection = securityManager.connectionPool.acquire();
+	QSqlDatabase & database = connection.database();
+
 	try {
+		database.transaction();
 		QString strSql = "DELETE FROM T_ROLES WHERE IdRole=:idRole";
-		QSqlQuery query;
-		query.prepare( strSql );
+		QSqlQuery & query = connection.prepare( DELETE_ROLE, strSql );
 		query.bindValue( ":idRole", role->getIdentifier() );
-		query.exec();
+		if ( ! securityManager.execute( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
+		securityManager.logChanges( database, ChangeFeedPoller::ROLE, QVariantList() << role->getIdentifier() );
+		if ( ! database.commit() ) throw std::runtime_error( database.lastError().text().toStdString() );
+
+		this->roleRegistry.remove( role->getIdentifier() );
 	} catch ( const std::exception & exception ) {
+		database.rollback();
 		QString errorMessage = QString( "Cannot delete role %1: %2" ).arg( role->getRoleName().c_str() ).arg( exception.what() );
 		throw SecurityManagerException( errorMessage.toStdString() );
 	}
 }
 
+Executor & SqlSecurityManager::SqlRoleManager::getExecutor() const {
+	return *securityManager.requestExecutor;
+}
+
+
+void SqlSecurityManager::SqlRoleManager::refreshRoles() {
+	OperationMetrics::Scope scope( securityManager.metrics, OPERATION_REFRESH_ROLES );
+	PooledConnection connection = securityManager.connectionPool.acquire();
+
+	unordered_map<uint, string> roleNames;
+	try {
+		QString strSql = "SELECT IdRole, RoleName FROM T_ROLES";
+		QSqlQuery query( connection.database() );
+		query.setForwardOnly( true );
+		if ( ! securityManager.execute( query, strSql ) ) throw std::runtime_error( query.lastError().text().toStdString() );
+
+		while ( query.next() ) {
+			roleNames[ query.value( 0 ).toUInt() ] = query.value( 1 ).toString().toStdString();
+		}
+	} catch ( const std::exception & exception ) {
+		QString errorMessage = QString( "Cannot load roles: %1" ).arg( exception.what() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+
+	for( uint roleIdentifier : this->roleRegistry.getIdentifiers() ) {
+		if ( roleNames.count( roleIdentifier ) == 0 ) this->roleRegistry.remove( roleIdentifier );
+	}
+	for( auto & entry : roleNames ) this->internRole( entry.first, entry.second );
+}
+
+RolePtr SqlSecurityManager::SqlRoleManager::internRole( uint roleIdentifier, const std::string & roleName ) {
+	RolePtr replacedRole;
+	RolePtr role = this->roleRegistry.intern( roleIdentifier, roleName, &replacedRole );
+	if ( replacedRole ) securityManager.userManager->userCache.clear();
+	return role;
+}
+
 
 
 //--------------------------------------------------------------------------------------------
 //--- SqlSecurityManager implementation ------------------------------------------------------
 //--------------------------------------------------------------------------------------------
 
-QSqlDatabase SqlSecurityManager::connection = QSqlDatabase::addDatabase("QMYSQL");
+SqlSecurityManager::SqlSecurityManager( const std::string & hostname, const std::string & database, const std::string & login, const std::string & password,
+										uint poolSize ) :
+			SqlSecurityManager( MYSQL_DRIVER, hostname, database, login, password, poolSize ) {
+}
 
-SqlSecurityManager::SqlSecurityManager( const std::string & hostname, const std::string & database, const std::string & login, const std::string & password ) :
-			hostname(hostname), database(database), login(login), password(password) {
-	this->userManager = UserManagerPtr( new SqlUserManager( *this ) );
-	this->roleManager = RoleManagerPtr( new SqlRoleManager( *this ) );
+SqlSecurityManager::SqlSecurityManager( const std::string & driverName, const std::string & hostname, const std::string & database,
+										const std::string & login, const std::string & password, uint poolSize ) :
+			connectionPool( driverName, hostname, database, login, password, poolSize ),
+			metrics( vector<string>( begin( OPERATION_NAMES ), end( OPERATION_NAMES ) ), { "role" } ),
+			roleIdAllocator( *this, "T_ROLES", "IdRole" ),
+			userIdAllocator( *this, "T_USERS", "IdUser" ),
+			passwordHasher( new Pbkdf2PasswordHasher() ),
+			hashingPool( shareWorkerPool( new WorkerPool( "Password hashing pool" ) ) ),
+			loginRateLimiter( 10, chrono::seconds( 6 ) ),
+			sourceRateLimiter( 100, chrono::milliseconds( 600 ) ),
+			requestExecutor( new RequestExecutor( *this ) ) {
+	this->userManager = std::shared_ptr<SqlUserManager>( new SqlUserManager( *this ) );
+	this->roleManager = std::shared_ptr<SqlRoleManager>( new SqlRoleManager( *this ) );
+	this->configureRequestPool( 0 );
+
+	if ( driverName == SQLITE_DRIVER ) {
+		this->connectionPool.setConnectionInitializer( []( QSqlDatabase & connection ) {
+			QSqlQuery query( connection );
+			for( const char * pragma : SQLITE_PRAGMAS ) {
+				if ( ! query.exec( pragma ) ) {
+					QString errorMessage = QString( "Cannot execute %1: %2" ).arg( pragma ).arg( query.lastError().text() );
+					throw SecurityManagerException( errorMessage.toStdString() );
+				}
+			}
+		} );
+	}
 }
 
 SqlSecurityManager::~SqlSecurityManager() {
+	// Pending asynchronous calls still need the managers and the connections
+	retirePool( atomic_exchange( &this->requestPool, shared_ptr<WorkerPool>() ) );
+	retirePool( atomic_exchange( &this->hashingPool, shared_ptr<WorkerPool>() ) );
+	// The poller applies the changes to members destroyed before it
+	this->stopChangeFeed();
+}
+
+bool SqlSecurityManager::execute( QSqlQuery & query, const QString & strSql ) {
+	OperationMetrics::countQuery();
+	this->executedQueryCount++;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	bool executed = strSql.isEmpty() ? query.exec() : query.exec( strSql );
+	this->recordExecution( query, chrono::steady_clock::now() - start, executed, false );
+	return executed;
+}
+
+bool SqlSecurityManager::executeBatch( QSqlQuery & query ) {
+	OperationMetrics::countQuery();
+	this->executedQueryCount++;
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	bool executed = query.execBatch();
+	this->recordExecution( query, chrono::steady_clock::now() - start, executed, true );
+	return executed;
+}
+
+void SqlSecurityManager::recordExecution( QSqlQuery & query, std::chrono::nanoseconds duration, bool executed, bool batch ) {
+	this->metrics.record( batch ? OPERATION_SQL_BATCH : OPERATION_SQL_QUERY, duration, 1, ! executed, false );
+
+	// The details of the other executions are not even read
+	bool slow, sampled;
+	if ( ! this->slowQueryLog.isRecorded( duration, slow, sampled ) ) return;
+
+	SlowQueryLog::Execution execution;
+	execution.statement = query.lastQuery().toStdString();
+	execution.boundValueCount = query.boundValues().size();
+	if ( executed ) execution.rowCount = query.isSelect() ? query.size() : query.numRowsAffected();
+	execution.duration = duration;
+	execution.executedAt = time( nullptr );
+	execution.batch = batch;
+	execution.succeeded = executed;
+	this->slowQueryLog.record( execution, slow, sampled );
+}
+
+OperationMetrics::Snapshot SqlSecurityManager::getMetrics() const {
+	OperationMetrics::Snapshot snapshot = this->metrics.getSnapshot();
+
+	UserCache::Statistics userStatistics = this->userManager->userCache.getStatistics();
+	OperationMetrics::CacheSnapshot userCache;
+	userCache.name = "user";
+	userCache.hits = userStatistics.hits;
+	userCache.misses = userStatistics.misses;
+	snapshot.caches.push_back( userCache );
+
+	StatementCache::Statistics statementStatistics = this->connectionPool.getStatementCacheStatistics();
+	OperationMetrics::CacheSnapshot statementCache;
+	statementCache.name = "statement";
+	statementCache.hits = statementStatistics.hits;
+	statementCache.misses = statementStatistics.misses;
+	snapshot.caches.push_back( statementCache );
+
+	return snapshot;
+}
+
+std::string SqlSecurityManager::dumpMetrics() const {
+	ostringstream output;
+	this->getMetrics().writePrometheus( output );
+	return output.str();
+}
+
+void SqlSecurityManager::setPasswordHasher( PasswordHasherPtr passwordHasher ) {
+	if ( ! passwordHasher ) throw SecurityManagerException( "A password hasher is required" );
+	atomic_store( &this->passwordHasher, passwordHasher );
+}
+
+PasswordHasherPtr SqlSecurityManager::getPasswordHasher() const {
+	return atomic_load( &this->passwordHasher );
+}
+
+void SqlSecurityManager::configureHashingPool( uint threadCount, size_t queueCapacity, std::chrono::milliseconds submitTimeout ) {
+	shared_ptr<WorkerPool> hashingPool = shareWorkerPool( new WorkerPool( "Password hashing pool", threadCount, queueCapacity, submitTimeout ) );
+	retirePool( atomic_exchange( &this->hashingPool, hashingPool ) );
+}
+
+void SqlSecurityManager::configureRequestPool( uint threadCount, size_t queueCapacity, std::chrono::milliseconds submitTimeout ) {
+	if ( threadCount == 0 ) threadCount = this->connectionPool.getMaximumSize();
+	shared_ptr<WorkerPool> requestPool = shareWorkerPool( new WorkerPool( "Request pool", threadCount, queueCapacity, submitTimeout, [this] {
+		this->connectionPool.closeThreadConnection();
+	} ) );
+	// The previous pool, if any, completes its queued calls first
+	retirePool( atomic_exchange( &this->requestPool, requestPool ) );
+}
+
+void SqlSecurityManager::retirePool( std::shared_ptr<WorkerPool> pool ) {
+	if ( ! pool ) return;
+	// The other references are held by the requests in progress: the last one released wakes this thread up,
+	// even if it is a thread of the pool itself
+	WorkerPool * retiredPool = pool.get();
+	future<void> released = get_deleter<PoolRelease>( pool )->released->get_future();
+	pool.reset();
+	released.wait();
+	delete retiredPool;				// Its queued tasks complete first
+}
+
+void SqlSecurityManager::RequestExecutor::execute( std::function<void()> task ) {
+	shared_ptr<WorkerPool> requestPool = atomic_load( &securityManager.requestPool );
+	if ( ! requestPool ) throw SecurityManagerException( "The request pool is stopped" );
+	requestPool->execute( move( task ) );
+}
+
+std::string SqlSecurityManager::hashPassword( const std::string & clearPassword ) {
+	OperationMetrics::Scope scope( this->metrics, OPERATION_HASH_PASSWORD );
+	PasswordHasherPtr hasher = this->getPasswordHasher();
+	shared_ptr<WorkerPool> hashingPool = atomic_load( &this->hashingPool );
+	// A hashing thread never waits for another hashing task (it could wait forever)
+	if ( hashingPool->isWorkerThread() ) return hasher->hash( clearPassword );
+	return hashingPool->submit( [hasher, &clearPassword] { return hasher->hash( clearPassword ); } ).get();
+}
+
+std::vector<std::string> SqlSecurityManager::hashPasswords( const std::vector<std::string> & clearPasswords ) {
+	PasswordHasherPtr hasher = this->getPasswordHasher();
+	shared_ptr<WorkerPool> hashingPool = atomic_load( &this->hashingPool );
+	if ( hashingPool->isWorkerThread() ) return hasher->hashBatch( clearPasswords );
+
+	size_t threadCount = hashingPool->getThreadCount();
+	size_t chunkSize = ( clearPasswords.size() + threadCount - 1 ) / threadCount;
+	vector<future<vector<string>>> chunks;
+	for( size_t first=0; first<clearPasswords.size(); first += chunkSize ) {
+		vector<string> chunk( clearPasswords.begin() + first, clearPasswords.begin() + min( first + chunkSize, clearPasswords.size() ) );
+		chunks.push_back( hashingPool->submit( [hasher, chunk] { return hasher->hashBatch( chunk ); } ) );
+	}
+
+	vector<string> encodedPasswords;
+	encodedPasswords.reserve( clearPasswords.size() );
+	for( auto & chunk : chunks ) {
+		vector<string> encodedChunk = chunk.get();
+		encodedPasswords.insert( encodedPasswords.end(), encodedChunk.begin(), encodedChunk.end() );
+	}
+	return encodedPasswords;
+}
+
+bool SqlSecurityManager::verifyPassword( const std::string & clearPassword, const std::string & encodedPassword ) {
+	OperationMetrics::Scope scope( this->metrics, OPERATION_VERIFY_PASSWORD );
+	PasswordHasherPtr hasher = this->getPasswordHasher();
+	shared_ptr<WorkerPool> hashingPool = atomic_load( &this->hashingPool );
+	if ( hashingPool->isWorkerThread() ) return hasher->verify( clearPassword, encodedPassword );
+	return hashingPool->submit( [hasher, &clearPassword, &encodedPassword] {
+		return hasher->verify( clearPassword, encodedPassword );
+	} ).get();
+}
+
+size_t SqlSecurityManager::rehashLegacyPasswords( size_t batchSize ) {
+	OperationMetrics::Scope scope( this->metrics, OPERATION_REHASH_LEGACY_PASSWORDS );
+	if ( batchSize == 0 ) batchSize = 1;
+	PasswordHasherPtr hasher = this->getPasswordHasher();
+	size_t hashedCount = 0;
+	uint lastIdentifier = 0;
+	bool morePages = true;
+
+	while ( morePages ) {
+		QVariantList identifiers;
+		QVariantList legacyPasswords;
+		vector<string> clearPasswords;
+		{
+			PooledConnection connection = this->connectionPool.acquire();
+			QSqlQuery query( connection.database() );
+			query.setForwardOnly( true );
+			query.prepare( "SELECT IdUser, Password FROM T_USERS WHERE IdUser > :lastIdentifier ORDER BY IdUser LIMIT :pageSize" );
+			query.bindValue( ":lastIdentifier", lastIdentifier );
+			query.bindValue( ":pageSize", (qulonglong) batchSize );
+			if ( ! this->execute( query ) ) {
+				QString errorMessage = QString( "Cannot read passwords: %1" ).arg( query.lastError().text() );
+				throw SecurityManagerException( errorMessage.toStdString() );
+			}
+
+			size_t rowCount = 0;
+			while ( query.next() ) {
+				rowCount++;
+				lastIdentifier = query.value( 0 ).toUInt();
+				string password = query.value( 1 ).toString().toStdString();
+				if ( ! hasher->isEncoded( password ) ) {
+					identifiers << lastIdentifier;
+					legacyPasswords << query.value( 1 );
+					clearPasswords.push_back( password );
+				}
+			}
+			morePages = rowCount == batchSize;
+		}
+		if ( clearPasswords.empty() ) continue;
+
+		// Hashing is done without holding a connection
+		QVariantList encodedPasswords;
+		for( const string & encodedPassword : this->hashPasswords( clearPasswords ) ) encodedPasswords << encodedPassword.c_str();
+
+		// The rows are updated one by one: the emulated batches of the Qt drivers only report the affected
+		// rows of their last execution, and passwords changed meanwhile are not updated
+		PooledConnection connection = this->connectionPool.acquire();
+		QSqlDatabase & database = connection.database();
+		QVariantList updatedIdentifiers;
+		database.transaction();
+		QSqlQuery query( database );
+		query.prepare( "UPDATE T_USERS SET Password=? WHERE IdUser=? AND Password=?" );
+		try {
+			for( int i=0; i<identifiers.size(); i++ ) {
+				query.bindValue( 0, encodedPasswords[i] );
+				query.bindValue( 1, identifiers[i] );
+				query.bindValue( 2, legacyPasswords[i] );
+				if ( ! this->execute( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
+				if ( query.numRowsAffected() > 0 ) updatedIdentifiers << identifiers[i];
+			}
+			if ( ! updatedIdentifiers.empty() ) this->logChanges( database, ChangeFeedPoller::USER, updatedIdentifiers );
+			if ( ! database.commit() ) throw std::runtime_error( database.lastError().text().toStdString() );
+		} catch ( const std::exception & exception ) {
+			database.rollback();
+			QString errorMessage = QString( "Cannot write hashed passwords: %1" ).arg( exception.what() );
+			throw SecurityManagerException( errorMessage.toStdString() );
+		}
+
+		for( const QVariant & identifier : updatedIdentifiers ) this->userManager->userCache.invalidate( identifier.toUInt() );
+		hashedCount += updatedIdentifiers.size();
+	}
+	return hashedCount;
+}
+
+size_t SqlSecurityManager::insertUsers( const std::vector<UserImporter::Record> & records, std::vector<std::string> & rejections ) {
+	OperationMetrics::Scope scope( this->metrics, OPERATION_INSERT_USERS );
+	// Duplicated logins and unknown roles are rejected before anything is sent to the database. The logins
+	// are folded like the database compares them: "Bob" and "bob " are the same login
+	vector<const UserImporter::Record *> candidates;
+	vector<vector<uint>> candidateRoles;
+	unordered_set<string> batchLogins;
+	for( const UserImporter::Record & record : records ) {
+		if ( ! batchLogins.insert( LoginFolding::foldLogin( record.login ) ).second ) {
+			rejections.push_back( "Login " + record.login + " is duplicated" );
+			continue;
+		}
+
+		vector<uint> roleIdentifiers;
+		bool rolesFound = true;
+		for( const string & roleName : record.roleNames ) {
+			// A database error is thrown: only a missing role rejects the user
+			RolePtr role = this->roleManager->findRoleByName( roleName );
+			if ( ! role ) {
+				rejections.push_back( "Unknown role " + roleName + " for user " + record.login );
+				rolesFound = false;
+				break;
+			}
+			roleIdentifiers.push_back( role->getIdentifier() );
+		}
+		if ( ! rolesFound ) continue;
+
+		candidates.push_back( &record );
+		candidateRoles.push_back( move( roleIdentifiers ) );
+	}
+	if ( candidates.empty() ) return 0;
+
+	unordered_set<string> registeredLogins;
+	{
+		PooledConnection connection = this->connectionPool.acquire();
+		QSqlQuery query( connection.database() );
+		query.setForwardOnly( true );
+		for( size_t start=0; start<candidates.size(); start+=MAXIMUM_IN_LIST_SIZE ) {
+			size_t end = min( start + MAXIMUM_IN_LIST_SIZE, candidates.size() );
+			QString placeholders = "?";
+			for( size_t i=start+1; i<end; i++ ) placeholders += ",?";
+			query.prepare( "SELECT Login FROM T_USERS WHERE Login IN (" + placeholders + ")" );
+			for( size_t i=start; i<end; i++ ) query.addBindValue( candidates[i]->login.c_str() );
+			if ( ! this->execute( query ) ) {
+				QString errorMessage = QString( "Cannot check registered logins: %1" ).arg( query.lastError().text() );
+				throw SecurityManagerException( errorMessage.toStdString() );
+			}
+			while ( query.next() ) registeredLogins.insert( LoginFolding::foldLogin( query.value( 0 ).toString().toStdString() ) );
+		}
+	}
+
+	PasswordHasherPtr hasher = this->getPasswordHasher();
+	vector<const UserImporter::Record *> accepted;
+	vector<vector<uint>> acceptedRoles;
+	vector<bool> alreadyHashed;
+	vector<string> clearPasswords;
+	for( size_t i=0; i<candidates.size(); i++ ) {
+		if ( registeredLogins.count( LoginFolding::foldLogin( candidates[i]->login ) ) > 0 ) {
+			rejections.push_back( "User " + candidates[i]->login + " already registered" );
+			continue;
+		}
+		accepted.push_back( candidates[i] );
+		acceptedRoles.push_back( move( candidateRoles[i] ) );
+		const string & password = candidates[i]->password;
+		alreadyHashed.push_back( hasher->isEncoded( password ) );
+		if ( ! alreadyHashed.back() ) clearPasswords.push_back( password );
+	}
+	if ( accepted.empty() ) return 0;
+
+	// Hashing is done in parallel, without holding a connection
+	vector<string> hashedPasswords = this->hashPasswords( clearPasswords );
+	for( const UserImporter::Record * record : accepted ) this->loginFilter.add( record->login );
+
+	PooledConnection connection = this->connectionPool.acquire();
+	QSqlDatabase & database = connection.database();
+	uint identifier = this->userIdAllocator.allocate( database, (uint) accepted.size() );
+	database.transaction();
+	try {
+
+		QVariantList identifiers, logins, passwords, disabledFlags, firstNames, lastNames, emails;
+		QVariantList roleUserIdentifiers, roleIdentifiers;
+		size_t hashedPosition = 0;
+		for( size_t i=0; i<accepted.size(); i++, identifier++ ) {
+			const UserImporter::Record & record = *accepted[i];
+			identifiers << identifier;
+			logins << record.login.c_str();
+			passwords << ( alreadyHashed[i] ? record.password : hashedPasswords[ hashedPosition++ ] ).c_str();
+			disabledFlags << ( record.disabled ? 1 : 0 );
+			firstNames << record.firstName.c_str();
+			lastNames << record.lastName.c_str();
+			emails << record.email.c_str();
+			for( uint roleIdentifier : acceptedRoles[i] ) {
+				roleUserIdentifiers << identifier;
+				roleIdentifiers << roleIdentifier;
+			}
+		}
+
+		QSqlQuery query( database );
+		query.prepare( "INSERT INTO T_USERS (IdUser, Login, Password, ConnectionNumber, LastConnection, ConsecutiveError, IsDisabled, "
+					   "FirstName, LastName, Email) VALUES ( ?, ?, ?, 0, 0, 0, ?, ?, ?, ? )" );
+		query.addBindValue( identifiers );
+		query.addBindValue( logins );
+		query.addBindValue( passwords );
+		query.addBindValue( disabledFlags );
+		query.addBindValue( firstNames );
+		query.addBindValue( lastNames );
+		query.addBindValue( emails );
+		if ( ! this->executeBatch( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
+
+		if ( ! roleIdentifiers.empty() ) {
+			query.prepare( "INSERT INTO T_USER_ROLES (IdUser, IdRole) VALUES ( ?, ? )" );
+			query.addBindValue( roleUserIdentifiers );
+			query.addBindValue( roleIdentifiers );
+			if ( ! this->executeBatch( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
+		}
+
+		// The other nodes add the new logins to their login filter
+		this->logChanges( database, ChangeFeedPoller::USER, identifiers );
+		if ( ! database.commit() ) throw std::runtime_error( database.lastError().text().toStdString() );
+	} catch ( const std::exception & exception ) {
+		database.rollback();
+		QString errorMessage = QString( "Cannot insert %1 users: %2" ).arg( accepted.size() ).arg( exception.what() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	return accepted.size();
+}
+
+UserCache & SqlSecurityManager::getUserCache() {
+	return this->userManager->userCache;
+}
+
+void SqlSecurityManager::enableWriteBehind( size_t maximumPendingUsers, std::chrono::milliseconds flushInterval ) {
+	lock_guard<mutex> lock( this->writeBehindMutex );
+	this->stopLoginUpdates();
+	this->writeBehindEnabled = true;
+	this->writeBehindMaximumPendingUsers = maximumPendingUsers;
+	this->writeBehindFlushInterval = flushInterval;
+	this->startLoginUpdates();
+}
+
+void SqlSecurityManager::disableWriteBehind() {
+	lock_guard<mutex> lock( this->writeBehindMutex );
+	this->writeBehindEnabled = false;
+	this->stopLoginUpdates();
+}
+
+void SqlSecurityManager::flushLoginUpdates() {
+	shared_ptr<LoginUpdateQueue> loginUpdates = atomic_load( &this->loginUpdates );
+	if ( loginUpdates ) loginUpdates->flush();
+}
+
+void SqlSecurityManager::startLoginUpdates() {
+	if ( ! this->writeBehindEnabled || atomic_load( &this->loginUpdates ) ) return;
+	shared_ptr<LoginUpdateQueue> loginUpdates(
+		new LoginUpdateQueue(
+			[this]( const LoginUpdateQueue::Batch & batch ) { this->writeLoginUpdates( batch ); },
+			[this]() { this->connectionPool.closeThreadConnection(); },
+			this->writeBehindMaximumPendingUsers, this->writeBehindFlushInterval
+		)
+	);
+	atomic_store( &this->loginUpdates, loginUpdates );
+}
+
+void SqlSecurityManager::stopLoginUpdates() {
+	shared_ptr<LoginUpdateQueue> loginUpdates = atomic_exchange( &this->loginUpdates, shared_ptr<LoginUpdateQueue>() );
+	if ( ! loginUpdates ) return;
+	loginUpdates->flush();
+	// The queue is destroyed (and its thread stopped) by the last request that still uses it
+}
+
+void SqlSecurityManager::writeLoginUpdates( const LoginUpdateQueue::Batch & batch ) {
+	OperationMetrics::Scope scope( this->metrics, OPERATION_WRITE_LOGIN_UPDATES );
+	PooledConnection connection = this->connectionPool.acquire();
+	QSqlDatabase & database = connection.database();
+
+	QVariantList connectionCounts;
+	QVariantList lastConnections;
+	QVariantList identifiers;
+	for( auto & entry : batch ) {
+		connectionCounts << entry.second.connectionCount;
+		lastConnections << (qulonglong) entry.second.lastConnection;
+		identifiers << entry.first;
+	}
+
+	database.transaction();
+	QSqlQuery query( database );
+	query.prepare( "UPDATE T_USERS SET ConnectionNumber=ConnectionNumber+?, LastConnection=?, ConsecutiveError=0 WHERE IdUser=?" );
+	query.addBindValue( connectionCounts );
+	query.addBindValue( lastConnections );
+	query.addBindValue( identifiers );
+	if ( ! this->executeBatch( query ) || ! database.commit() ) {
+		QString errorMessage = QString( "Cannot write login updates: %1" ).arg( query.lastError().text() );
+		database.rollback();
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+
+	for( auto & entry : batch ) this->userManager->userCache.invalidate( entry.first );
+}
+
+void SqlSecurityManager::enableChangeFeed( std::chrono::milliseconds pollInterval ) {
+	this->changeFeedEnabled = true;
+	this->changeFeedPollInterval = pollInterval;
+}
+
+void SqlSecurityManager::disableChangeFeed() {
+	this->changeFeedEnabled = false;
+	this->stopChangeFeed();
+}
+
+size_t SqlSecurityManager::pollChanges() {
+	shared_ptr<ChangeFeedPoller> changeFeed = atomic_load( &this->changeFeed );
+	if ( ! changeFeed ) return 0;
+	try {
+		return changeFeed->poll();
+	} catch ( const std::exception & exception ) {
+		QString errorMessage = QString( "Cannot apply the change log: %1" ).arg( exception.what() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+}
+
+size_t SqlSecurityManager::purgeChangeLog( std::chrono::seconds retention ) {
+	PooledConnection connection = this->connectionPool.acquire();
+	QSqlQuery query( connection.database() );
+	query.prepare( "DELETE FROM T_CHANGE_LOG WHERE ChangedAt < :limit" );
+	query.bindValue( ":limit", (qulonglong) ( time( nullptr ) - retention.count() ) );
+	if ( ! this->execute( query ) ) {
+		QString errorMessage = QString( "Cannot purge the change log: %1" ).arg( query.lastError().text() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	return (size_t) max( query.numRowsAffected(), 0 );
+}
+
+void SqlSecurityManager::startChangeFeed( PooledConnection & connection ) {
+	if ( ! this->changeFeedEnabled ) return;
+
+	QSqlQuery query( connection.database() );
+	if ( ! this->execute( query, "SELECT COALESCE( MAX(Version), 0 ) FROM T_CHANGE_LOG" ) || ! query.next() ) {
+		QString errorMessage = QString( "Cannot read the change log: %1" ).arg( query.lastError().text() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	shared_ptr<ChangeFeedPoller> changeFeed(
+		new ChangeFeedPoller(
+			[this]( unsigned long long afterVersion, size_t limit ) { return this->readChanges( afterVersion, limit ); },
+			[this]( const ChangeFeedPoller::Changes & changes ) { this->applyChanges( changes ); },
+			[this]() { this->connectionPool.closeThreadConnection(); },
+			query.value( 0 ).toULongLong(), this->changeFeedPollInterval
+		)
+	);
+	atomic_store( &this->changeFeed, changeFeed );
+}
+
+void SqlSecurityManager::stopChangeFeed() {
+	// The poller is destroyed (and its thread stopped) by the last request that still uses it
+	atomic_store( &this->changeFeed, shared_ptr<ChangeFeedPoller>() );
+}
+
+void SqlSecurityManager::logChanges( QSqlDatabase & database, ChangeFeedPoller::EntityType entityType, const QVariantList & entityIds ) {
+	// Logged even if this node doesn't poll the feed: the other nodes may
+	if ( ! this->changeLogAvailable || entityIds.empty() ) return;
+
+	const char entityTypeName[] = { (char) entityType, '\0' };
+	QVariantList entityTypes;
+	QVariantList changeDates;
+	qulonglong now = (qulonglong) time( nullptr );
+	for( size_t i=0; i<(size_t) entityIds.size(); i++ ) {
+		entityTypes << entityTypeName;
+		changeDates << now;
+	}
+
+	// Positional bindings: this batch is not kept in the statement cache
+	QSqlQuery query( database );
+	query.prepare( "INSERT INTO T_CHANGE_LOG (EntityType, EntityId, ChangedAt) VALUES ( ?, ?, ? )" );
+	query.addBindValue( entityTypes );
+	query.addBindValue( entityIds );
+	query.addBindValue( changeDates );
+	if ( ! this->executeBatch( query ) ) throw std::runtime_error( query.lastError().text().toStdString() );
+}
+
+ChangeFeedPoller::Changes SqlSecurityManager::readChanges( unsigned long long afterVersion, size_t limit ) {
+	PooledConnection connection = this->connectionPool.acquire();
+	QSqlQuery & query = connection.prepare( SELECT_CHANGES, "SELECT Version, EntityType, EntityId FROM T_CHANGE_LOG "
+															"WHERE Version > :version ORDER BY Version LIMIT :limit" );
+	query.bindValue( ":version", (qulonglong) afterVersion );
+	query.bindValue( ":limit", (qulonglong) limit );
+	if ( ! this->execute( query ) ) {
+		QString errorMessage = QString( "Cannot read the change log: %1" ).arg( query.lastError().text() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+
+	ChangeFeedPoller::Changes changes;
+	while ( query.next() ) {
+		string entityType = query.value( 1 ).toString().toStdString();
+		changes.push_back( { query.value( 0 ).toULongLong(), entityType.empty() ? '\0' : entityType[0], query.value( 2 ).toUInt() } );
+	}
+	return changes;
+}
+
+void SqlSecurityManager::applyChanges( const ChangeFeedPoller::Changes & changes ) {
+	OperationMetrics::Scope scope( this->metrics, OPERATION_APPLY_CHANGES );
+	unordered_set<uint> userIdentifiers;
+	unordered_set<uint> roleIdentifiers;
+	for( const ChangeFeedPoller::Change & change : changes ) {
+		if ( change.entityType == ChangeFeedPoller::USER ) userIdentifiers.insert( change.entityId );
+		else if ( change.entityType == ChangeFeedPoller::ROLE ) roleIdentifiers.insert( change.entityId );
+	}
+	PooledConnection connection = this->connectionPool.acquire();
+
+	if ( ! userIdentifiers.empty() ) {
+		// The current state of the changed users: new logins join the login filter, the sessions of the
+		// deleted or disabled users are revoked
+		QString placeholders = "?";
+		for( size_t i=1; i<userIdentifiers.size(); i++ ) placeholders += ",?";
+		QSqlQuery query( connection.database() );
+		query.setForwardOnly( true );
+		query.prepare( "SELECT IdUser, Login, IsDisabled FROM T_USERS WHERE IdUser IN (" + placeholders + ")" );
+		for( uint identifier : userIdentifiers ) query.addBindValue( identifier );
+		if ( ! this->execute( query ) ) {
+			QString errorMessage = QString( "Cannot read the changed users: %1" ).arg( query.lastError().text() );
+			throw SecurityManagerException( errorMessage.toStdString() );
+		}
+
+		unordered_set<uint> activeUsers;
+		while ( query.next() ) {
+			this->loginFilter.add( query.value( 1 ).toString().toStdString() );
+			if ( ! query.value( 2 ).toBool() ) activeUsers.insert( query.value( 0 ).toUInt() );
+		}
+		for( uint identifier : userIdentifiers ) {
+			this->userManager->userCache.invalidate( identifier );
+			if ( activeUsers.count( identifier ) == 0 ) this->sessionStore.revokeUser( identifier );
+		}
+	}
+
+	if ( ! roleIdentifiers.empty() ) {
+		QString placeholders = "?";
+		for( size_t i=1; i<roleIdentifiers.size(); i++ ) placeholders += ",?";
+		QSqlQuery query( connection.database() );
+		query.setForwardOnly( true );
+		query.prepare( "SELECT IdRole, RoleName FROM T_ROLES WHERE IdRole IN (" + placeholders + ")" );
+		for( uint identifier : roleIdentifiers ) query.addBindValue( identifier );
+		if ( ! this->execute( query ) ) {
+			QString errorMessage = QString( "Cannot read the changed roles: %1" ).arg( query.lastError().text() );
+			throw SecurityManagerException( errorMessage.toStdString() );
+		}
+
+		// Renamed roles get a new instance: the cached users holding the previous one are evicted
+		RoleRegistry & roleRegistry = this->roleManager->getRoleRegistry();
+		while ( query.next() ) {
+			uint identifier = query.value( 0 ).toUInt();
+			this->roleManager->internRole( identifier, query.value( 1 ).toString().toStdString() );
+			roleIdentifiers.erase( identifier );
+		}
+		for( uint identifier : roleIdentifiers ) roleRegistry.remove( identifier );
+		// The cached users may still hold a deleted role
+		if ( ! roleIdentifiers.empty() ) this->userManager->userCache.clear();
+	}
 }
 
 void SqlSecurityManager::openSession() {
 	try {
-		this->connection.setHostName( hostname.c_str() );
-		this->connection.setDatabaseName( database.c_str() );
-		this->connection.setUserName( login.c_str() );
-		this->connection.setPassword( password.c_str() );
-		if ( ! this->connection.open() ) {
-			throw SecurityManagerException( "Cannot open security session" );
+		// Opens the connection of the calling thread: the other ones are opened on demand
+		PooledConnection connection = this->connectionPool.acquire();
+		if ( this->connectionPool.getDriverName() == SQLITE_DRIVER ) this->createSqliteSchema( connection );
+		this->changeLogAvailable = connection.database().tables().contains( "T_CHANGE_LOG" );
+		// The feed starts before the caches are loaded: the changes made meanwhile are applied again
+		if ( ! atomic_load( &this->changeFeed ) ) this->startChangeFeed( connection );
+		this->roleManager->refreshRoles();
+		this->rebuildLoginFilter( connection );
+		{
+			lock_guard<mutex> lock( this->writeBehindMutex );
+			this->startLoginUpdates();
 		}
+		this->sessionStore.startExpiryThread();
 		new int[10];		// For produce a memory leaks
 	} catch( exception & exception ) {
 		throw SecurityManagerException( string("Cannot open security session: ") + exception.what() );
 	}
 }
 
+void SqlSecurityManager::createSqliteSchema( PooledConnection & connection ) {
+	QSqlDatabase & database = connection.database();
+	if ( database.tables().contains( "T_CHANGE_LOG" ) ) return;		// The last table created by SQLITE_SCHEMA
+
+	database.transaction();
+	QSqlQuery query( database );
+	for( const char * statement : SQLITE_SCHEMA ) {
+		if ( ! this->execute( query, statement ) ) {
+			QString errorMessage = QString( "Cannot create the security schema: %1" ).arg( query.lastError().text() );
+			database.rollback();
+			throw SecurityManagerException( errorMessage.toStdString() );
+		}
+	}
+	if ( ! database.commit() ) {
+		QString errorMessage = QString( "Cannot create the security schema: %1" ).arg( database.lastError().text() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+}
+
+bool SqlSecurityManager::isUnknownLogin( const std::string & login ) {
+	// Without the change feed, the logins stored by the other processes are missing from the filter
+	return atomic_load( &this->changeFeed ) && ! this->loginFilter.mightContain( login );
+}
+
+void SqlSecurityManager::rebuildLoginFilter( PooledConnection & connection ) {
+	QSqlQuery countQuery( connection.database() );
+	if ( ! this->execute( countQuery, "SELECT COUNT(*) FROM T_USERS" ) || ! countQuery.next() ) {
+		QString errorMessage = QString( "Cannot count users: %1" ).arg( countQuery.lastError().text() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+
+	this->loginFilter.rebuild( countQuery.value( 0 ).toULongLong(), [&]( const auto & addLogin ) {
+		QSqlQuery query( connection.database() );
+		query.setForwardOnly( true );
+		if ( ! this->execute( query, "SELECT Login FROM T_USERS" ) ) {
+			QString errorMessage = QString( "Cannot load logins: %1" ).arg( query.lastError().text() );
+			throw SecurityManagerException( errorMessage.toStdString() );
+		}
+		while ( query.next() ) addLogin( query.value( 0 ).toString().toStdString() );
+	} );
+}
+
+void SqlSecurityManager::refreshRoles() {
+	this->roleManager->refreshRoles();
+}
+
 void SqlSecurityManager::close() {
 	try {
-		this->connection.close();
-		QSqlDatabase::removeDatabase("QMYSQL");
+		{
+			lock_guard<mutex> lock( this->writeBehindMutex );
+			this->stopLoginUpdates();
+		}
+		this->stopChangeFeed();
+		this->sessionStore.stopExpiryThread();
+		this->sessionStore.clear();
+		this->connectionPool.closeAll();
 	} catch( exception & exception ) {
 		throw SecurityManagerException( string("Cannot close security session: ") + exception.what() );
 	}
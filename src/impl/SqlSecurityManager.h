@@ -8,9 +8,28 @@
 #ifndef IMPL_SQLSECURITYMANAGER_H_
 #define IMPL_SQLSECURITYMANAGER_H_
 
-#include <QtSql/QSqlDatabase>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 
+#include <QtSql/QSqlQuery>
+
+#include "../api/PasswordHasher.h"
 #include "../api/SecurityManager.h"
+#include "ChangeFeedPoller.h"
+#include "IdAllocator.h"
+#include "LoginFilter.h"
+#include "LoginUpdateQueue.h"
+#include "OperationMetrics.h"
+#include "RateLimiter.h"
+#include "RoleRegistry.h"
+#include "SlowQueryLog.h"
+#include "SqlConnectionPool.h"
+#include "SessionStore.h"
+#include "TokenSigner.h"
+#include "UserCache.h"
+#include "UserImporter.h"
+#include "WorkerPool.h"
 
 namespace fr::koor::security {
 
@@ -28,25 +47,89 @@ namespace fr::koor::security {
 	 */
 	class SqlSecurityManager : public SecurityManager {
 
-		static QSqlDatabase connection;
+		SqlConnectionPool connectionPool;
+		std::atomic<unsigned long long> executedQueryCount { 0 };
+		OperationMetrics metrics;
+		SlowQueryLog slowQueryLog;
+		IdAllocator roleIdAllocator;
+		IdAllocator userIdAllocator;
+
+		class SqlUserManager;
+		class RequestExecutor;
+		class SqlRoleManager;
+
+		std::shared_ptr<SqlUserManager> userManager;
+		std::shared_ptr<SqlRoleManager> roleManager;
+
+		std::shared_ptr<LoginUpdateQueue> loginUpdates;
+		// Guards the write-behind settings, and serializes the start and stop of the queue
+		std::mutex writeBehindMutex;
+		bool writeBehindEnabled = false;
+		size_t writeBehindMaximumPendingUsers = 0;
+		std::chrono::milliseconds writeBehindFlushInterval { 0 };
+
+		std::shared_ptr<ChangeFeedPoller> changeFeed;
+		std::atomic<bool> changeFeedEnabled { false };
+		std::atomic<bool> changeLogAvailable { false };			// Read by every write
+		std::atomic<std::chrono::milliseconds> changeFeedPollInterval { std::chrono::milliseconds( 0 ) };
+
+		PasswordHasherPtr passwordHasher;
+		std::shared_ptr<WorkerPool> hashingPool;				// Swapped with atomic_load / atomic_store
+
+		TokenSigner tokenSigner;
+		SessionStore sessionStore;
+		LoginFilter loginFilter;
+		RateLimiter loginRateLimiter;
+		RateLimiter sourceRateLimiter;
+
+		// Declared last: its queued calls complete before the other members are destroyed
+		std::shared_ptr<WorkerPool> requestPool;				// Swapped with atomic_load / atomic_store
+		std::unique_ptr<RequestExecutor> requestExecutor;
 
-		UserManagerPtr userManager;
-		RoleManagerPtr roleManager;
+	public:
+		/**
+		 * The Qt driver of the MySQL / MariaDB databases (the default one).
+		 */
+		static constexpr const char * MYSQL_DRIVER = "QMYSQL";
 
-		std::string hostname;
-		std::string database;
-		std::string login;
-		std::string password;
+		/**
+		 * The Qt driver of the embedded SQLite databases.
+		 */
+		static constexpr const char * SQLITE_DRIVER = "QSQLITE";
 
-	public:
 		/**
-		 * Class constructor.
+		 * Class constructor: the security informations are stored in a MySQL database.
 		 * @param hostname	The hostname or the ip address of the RDBMS.
 		 * @param database	The name of the used database.
 		 * @param login		The login used to establish the connection.
 		 * @param password  The login password to establish the connection.
+		 * @param poolSize	The maximum number of database connections used at the same time.
 		 */
-		SqlSecurityManager( const std::string & hostname, const std::string & database, const std::string & login, const std::string & password );
+		SqlSecurityManager( const std::string & hostname, const std::string & database, const std::string & login, const std::string & password,
+							uint poolSize = SqlConnectionPool::DEFAULT_MAXIMUM_SIZE );
+
+		/**
+		 * <p>
+		 *     Class constructor, with the Qt driver to use.
+		 * </p>
+		 * <p>
+		 *     With SQLITE_DRIVER, the database is the path of a file, created if needed, and the hostname,
+		 *     login and password are ignored. Connections use write-ahead logging (readers never wait for the
+		 *     writer), memory mapped reads and a larger page cache. openSession creates the tables of
+		 *     SecurityComponent.sql if they don't exist yet. Logins and role names are compared case
+		 *     insensitively, like with MySQL. In-memory databases (":memory:") are not supported: each
+		 *     connection would see its own database.
+		 * </p>
+		 *
+		 * @param driverName	The Qt driver (MYSQL_DRIVER or SQLITE_DRIVER).
+		 * @param hostname		The hostname or the ip address of the RDBMS.
+		 * @param database		The name of the used database.
+		 * @param login			The login used to establish the connection.
+		 * @param password		The login password to establish the connection.
+		 * @param poolSize		The maximum number of database connections used at the same time.
+		 */
+		SqlSecurityManager( const std::string & driverName, const std::string & hostname, const std::string & database,
+							const std::string & login, const std::string & password, uint poolSize = SqlConnectionPool::DEFAULT_MAXIMUM_SIZE );
 
 		/**
 		 * Class destructor.
@@ -89,9 +172,489 @@ namespace fr::koor::security {
 			return this->userManager;
 		}
 
+		/**
+		 * Reloads the role catalog from the database. Roles renamed meanwhile get a new instance: the roles
+		 * already handed out keep their previous name, and the cached users holding them are evicted.
+		 *
+		 * @throws SecurityManagerException	Thrown if the roles cannot be loaded.
+		 */
+		void refreshRoles();
+
+		/**
+		 * <p>
+		 *     Enables the write-behind mode: the bookkeeping of successful logins (connection number, last
+		 *     connection and consecutive errors reset) is collected in memory, repeated logins of a user are
+		 *     merged, and the updates are written in one batched transaction when the number of pending users
+		 *     reaches a limit or when the flush interval expires. Pending updates are also written by close.
+		 * </p>
+		 * <p>
+		 *     Users read by this manager take the pending updates into account. Updates that are still pending
+		 *     are lost if the process crashes. The mode can be enabled or disabled at any time, from any thread.
+		 * </p>
+		 *
+		 * @param maximumPendingUsers	The number of pending users that triggers a flush.
+		 * @param flushInterval			The maximum delay before a login bookkeeping is written.
+		 */
+		void enableWriteBehind( size_t maximumPendingUsers = 1000, std::chrono::milliseconds flushInterval = std::chrono::seconds( 1 ) );
+
+		/**
+		 * Disables the write-behind mode: the pending updates are written and the next logins are written
+		 * synchronously again.
+		 *
+		 * @throws SecurityManagerException	Thrown if the pending updates cannot be written.
+		 */
+		void disableWriteBehind();
+
+		/**
+		 * Synchronously writes the pending login updates (write-behind mode only).
+		 *
+		 * @throws SecurityManagerException	Thrown if the pending updates cannot be written.
+		 */
+		void flushLoginUpdates();
+
+		/**
+		 * <p>
+		 *     Enables the change feed. Whenever the T_CHANGE_LOG table exists when openSession is called, the write
+		 *     methods of the managers append a row to it, in the transaction of the change, for every user or role
+		 *     they insert, update or delete (and for every account disabled after three errors), whether the feed is
+		 *     enabled or not. Between openSession and close, a background thread reads the new rows every poll interval: the changed users are evicted from the user cache and
+		 *     added to the login filter, the changed roles are reloaded, and the sessions of the deleted or
+		 *     disabled users are revoked. The changes made by the other nodes are seen within the poll interval.
+		 *     While the feed runs, the logins rejected by the login filter are not looked up in the database.
+		 * </p>
+		 * <p>
+		 *     The nodes which only write to the database (the import tools, for instance) don't need it. The
+		 *     login bookkeeping isn't logged: the cached
+		 *     users keep their connection counts until their time to live expires. Must be called before
+		 *     openSession.
+		 * </p>
+		 *
+		 * @param pollInterval	The delay between two reads of the change log.
+		 */
+		void enableChangeFeed( std::chrono::milliseconds pollInterval = std::chrono::seconds( 1 ) );
+
+		/**
+		 * Disables the change feed: the changes are still logged, but no longer polled. Must be called before openSession.
+		 */
+		void disableChangeFeed();
+
+		/**
+		 * Synchronously applies the changes logged since the last poll (change feed mode only, between
+		 * openSession and close).
+		 *
+		 * @return The number of applied changes.
+		 *
+		 * @throws SecurityManagerException	Thrown if the change log cannot be read.
+		 */
+		size_t pollChanges();
+
+		/**
+		 * Deletes the rows of the change log older than the retention. The retention must be far longer than the
+		 * time a node may be unable to read the change log: a node missing a purged change keeps serving the
+		 * stale entry until its time to live expires.
+		 *
+		 * @param retention		The age of the oldest rows kept.
+		 * @return The number of deleted rows.
+		 *
+		 * @throws SecurityManagerException	Thrown if the rows cannot be deleted.
+		 */
+		size_t purgeChangeLog( std::chrono::seconds retention );
+
+		/**
+		 * Changes the algorithm used to hash the passwords (PBKDF2-HMAC-SHA256 with 100000 iterations by
+		 * default). Passwords stored with another algorithm, or a lower cost, are still accepted and are
+		 * hashed again with this one at the next successful login of their user.
+		 *
+		 * @param passwordHasher	The new password hasher.
+		 */
+		void setPasswordHasher( PasswordHasherPtr passwordHasher );
+
+		/**
+		 * Returns the algorithm used to hash the passwords.
+		 *
+		 * @return The password hasher.
+		 */
+		PasswordHasherPtr getPasswordHasher() const;
+
+		/**
+		 * <p>
+		 *     Resizes the pool of threads that hash and verify the passwords. Hashing is intentionally slow: it
+		 *     is done on this bounded pool so that a burst of logins cannot use more cores than configured.
+		 *     When all the threads are busy and the queue is full, logins fail after the submit timeout
+		 *     instead of piling up.
+		 * </p>
+		 * <p>
+		 *     The requests in progress complete on the previous pool, which is destroyed once they no longer
+		 *     use it. Must not be called from a hashing thread.
+		 * </p>
+		 *
+		 * @param threadCount		The number of hashing threads (0 for the number of cores).
+		 * @param queueCapacity		The maximum number of hashing requests waiting for a thread.
+		 * @param submitTimeout		The maximum time a request waits for a place in the queue.
+		 */
+		void configureHashingPool( uint threadCount, size_t queueCapacity = WorkerPool::DEFAULT_QUEUE_CAPACITY,
+								   std::chrono::milliseconds submitTimeout = std::chrono::seconds( 5 ) );
+
+		/**
+		 * <p>
+		 *     Resizes the pool of threads that run the asynchronous methods of the user and role managers
+		 *     (checkCredentialsAsync, selectRoleByIdAsync, ...). Each thread owns its database connection: by
+		 *     default, the pool has one thread per connection of the connection pool. When all the threads
+		 *     are busy and the queue is full, asynchronous calls fail after the submit timeout.
+		 * </p>
+		 * <p>
+		 *     The calls already queued complete on the previous pool, which is destroyed once they are done:
+		 *     this method waits for them. Must not be called from a request thread.
+		 * </p>
+		 *
+		 * @param threadCount		The number of request threads (0 for the connection pool size).
+		 * @param queueCapacity		The maximum number of calls waiting for a thread.
+		 * @param submitTimeout		The maximum time a call waits for a place in the queue.
+		 */
+		void configureRequestPool( uint threadCount, size_t queueCapacity = WorkerPool::DEFAULT_QUEUE_CAPACITY,
+								   std::chrono::milliseconds submitTimeout = std::chrono::seconds( 5 ) );
+
+		/**
+		 * <p>
+		 *     Hashes, with the current password hasher, every password still stored in clear (any value that
+		 *     the hasher doesn't decode). Users are read by pages of batchSize identifiers, each page is hashed
+		 *     in batches on the hashing pool and written back in one transaction. Passwords changed meanwhile
+		 *     are left untouched, and are not counted.
+		 * </p>
+		 * <p>
+		 *     Hashes with an outdated cost can't be upgraded without the clear password: they are upgraded at
+		 *     the next login of their user.
+		 * </p>
+		 *
+		 * @param batchSize		The number of users read and written at once.
+		 * @return The number of hashed passwords.
+		 *
+		 * @throws SecurityManagerException	Thrown if the users cannot be read or updated.
+		 */
+		size_t rehashLegacyPasswords( size_t batchSize = 1024 );
+
+		/**
+		 * Hashes several passwords, spread over the threads of the hashing pool.
+		 *
+		 * @param clearPasswords	The passwords (in clear).
+		 * @return The encoded hashes, in the order of the passwords.
+		 *
+		 * @throws SecurityManagerException	Thrown if the hashing pool is saturated.
+		 */
+		std::vector<std::string> hashPasswords( const std::vector<std::string> & clearPasswords );
+
+		/**
+		 * <p>
+		 *     Inserts a batch of users, and their role assignments, in a single transaction: the users and
+		 *     the role assignments are each written with one batched insert. Passwords are hashed in
+		 *     parallel before the transaction starts, except valid encoded hashes of the current password
+		 *     hasher, which are stored unchanged.
+		 * </p>
+		 * <p>
+		 *     Users whose login is duplicated or already registered, or who reference an unknown role, are
+		 *     not inserted: the reason is appended to the rejections. A database error aborts the insertion.
+		 * </p>
+		 *
+		 * @param records		The users to insert.
+		 * @param rejections	Receives the reasons of the rejected users.
+		 * @return The number of inserted users.
+		 *
+		 * @throws SecurityManagerException	Thrown if the batch cannot be written (nothing is written then).
+		 */
+		size_t insertUsers( const std::vector<UserImporter::Record> & records, std::vector<std::string> & rejections );
+
+		/**
+		 * Returns the cache placed in front of the user lookups. Use it to tune its capacity and time to live,
+		 * or to read its statistics.
+		 *
+		 * @return The user cache.
+		 */
+		UserCache & getUserCache();
+
+		/**
+		 * Executes a batch query (see QSqlQuery::execBatch) on one of the connections of this manager.
+		 * The whole batch is accounted as a single executed query.
+		 *
+		 * @param query		The prepared query, bound with lists of values.
+		 * @return true if the query was successfully executed, false otherwise.
+		 */
+		bool executeBatch( QSqlQuery & query );
+
+		/**
+		 * Returns the pool that provides the database connections of this security manager.
+		 * Use it to tune the pool size, the acquire timeout or the health check interval.
+		 *
+		 * @return The connection pool.
+		 */
+		SqlConnectionPool & getConnectionPool() {
+			return this->connectionPool;
+		}
+
+		/**
+		 * Returns the key ring used to sign and verify the session tokens (see UserManager::issueToken). Nodes
+		 * that verify each other's tokens must share their keys.
+		 *
+		 * @return The token signer.
+		 */
+		TokenSigner & getTokenSigner() {
+			return this->tokenSigner;
+		}
+
+		/**
+		 * Returns the server side sessions of the authenticated users. Expired sessions are collected between
+		 * openSession and close; close revokes every session. Deleting or disabling a user revokes its sessions.
+		 *
+		 * @return The session store.
+		 */
+		SessionStore & getSessionStore() {
+			return this->sessionStore;
+		}
+
+		/**
+		 * Returns the filter used to reject the unknown logins without querying the database. It is rebuilt
+		 * from the database by openSession. The rejections are trusted only while the change feed runs (see
+		 * enableChangeFeed), which adds the logins stored by the other nodes: otherwise, every login is
+		 * looked up in the database.
+		 *
+		 * @return The login filter.
+		 */
+		LoginFilter & getLoginFilter() {
+			return this->loginFilter;
+		}
+
+		/**
+		 * Returns the limiter of the login attempts per login: by default, 10 attempts at once, then one
+		 * every 6 seconds. A successful login refills the bucket of its login, so only the failed attempts
+		 * add up. Logins are compared case insensitively, like the database does.
+		 *
+		 * @return The per login rate limiter.
+		 */
+		RateLimiter & getLoginRateLimiter() {
+			return this->loginRateLimiter;
+		}
+
+		/**
+		 * Returns the limiter of the login attempts per source (see UserManager::checkCredentials): by
+		 * default, 100 attempts at once, then one every 600 milliseconds.
+		 *
+		 * @return The per source rate limiter.
+		 */
+		RateLimiter & getSourceRateLimiter() {
+			return this->sourceRateLimiter;
+		}
+
+		/**
+		 * Returns the allocator of the role identifiers. Use it to tune the number of identifiers reserved at once.
+		 *
+		 * @return The role identifier allocator.
+		 */
+		IdAllocator & getRoleIdAllocator() {
+			return this->roleIdAllocator;
+		}
+
+		/**
+		 * Returns the allocator of the user identifiers. Use it to tune the number of identifiers reserved at once.
+		 *
+		 * @return The user identifier allocator.
+		 */
+		IdAllocator & getUserIdAllocator() {
+			return this->userIdAllocator;
+		}
+
+		/**
+		 * Executes a query on one of the connections of this manager. Every SQL statement sent by the user
+		 * and role managers goes through this method, so that the database round trips can be accounted and
+		 * timed (see getSlowQueryLog).
+		 *
+		 * @param query		The query to execute (already prepared and bound if strSql is empty).
+		 * @param strSql	The SQL statement to execute, or an empty string to execute the prepared one.
+		 * @return true if the query was successfully executed, false otherwise.
+		 */
+		bool execute( QSqlQuery & query, const QString & strSql = QString() );
+
+		/**
+		 * Returns the number of SQL statements executed by this manager since its creation.
+		 *
+		 * @return The executed query count.
+		 */
+		unsigned long long getExecutedQueryCount() const {
+			return this->executedQueryCount;
+		}
+
+		/**
+		 * <p>
+		 *     Returns the measures of the user and role manager methods, and of the statements they execute:
+		 *     latency histograms, SQL statement counts, error and exception counts per operation (named like
+		 *     "check_credentials", "select_role_by_id" or "sql_query"), and the hits and misses of the role,
+		 *     user and statement caches ("role", "user" and "statement").
+		 * </p>
+		 * <p>
+		 *     The measures are accumulated since the creation of this manager.
+		 * </p>
+		 *
+		 * @return The current measures.
+		 */
+		OperationMetrics::Snapshot getMetrics() const;
+
+		/**
+		 * Returns the measures of getMetrics in the Prometheus text exposition format (metrics prefixed by
+		 * "security_"), ready to be served to a scraper.
+		 *
+		 * @return The metrics text.
+		 */
+		std::string dumpMetrics() const;
+
+		/**
+		 * Returns the log of the statements executed by this manager: the last executions slower than its
+		 * threshold (100 ms by default), and the timings of a sample of every statement. Use it to tune the
+		 * threshold and the sampling, or to find the statement responsible for a slow call.
+		 *
+		 * @return The slow query log.
+		 */
+		SlowQueryLog & getSlowQueryLog() {
+			return this->slowQueryLog;
+		}
+
 
 	private:
 
+		/**
+		 * Waits, without spinning, until the requests in progress release a pool retired by configureHashingPool,
+		 * configureRequestPool or the destructor, then destroys it on the calling thread: its queued tasks
+		 * complete first.
+		 *
+		 * @param pool	The retired pool, or a null pointer.
+		 */
+		static void retirePool( std::shared_ptr<WorkerPool> pool );
+
+		/**
+		 * Starts the write-behind queue, if the write-behind mode is enabled and the queue isn't started.
+		 * The caller must hold writeBehindMutex.
+		 */
+		void startLoginUpdates();
+
+		/**
+		 * Stops the write-behind queue after a last flush. The caller must hold writeBehindMutex.
+		 */
+		void stopLoginUpdates();
+
+		/**
+		 * Starts the change feed poller from the last logged version, if the change feed is enabled.
+		 *
+		 * @param connection	The connection used to read the last version.
+		 */
+		void startChangeFeed( PooledConnection & connection );
+
+		/**
+		 * Stops the change feed poller.
+		 */
+		void stopChangeFeed();
+
+		/**
+		 * Appends a change of several entities to the change log, if the change feed is enabled.
+		 *
+		 * @param database		The connection, in the transaction of the change.
+		 * @param entityType	The type of the changed entities.
+		 * @param entityIds		The identifiers of the changed entities.
+		 *
+		 * @throws std::runtime_error	Thrown if the change cannot be logged.
+		 */
+		void logChanges( QSqlDatabase & database, ChangeFeedPoller::EntityType entityType, const QVariantList & entityIds );
+
+		/**
+		 * Reads the changes following a version (the change reader of the change feed poller).
+		 *
+		 * @throws SecurityManagerException	Thrown if the change log cannot be read.
+		 */
+		ChangeFeedPoller::Changes readChanges( unsigned long long afterVersion, size_t limit );
+
+		/**
+		 * Applies a batch of changes to the caches (the change handler of the change feed poller).
+		 *
+		 * @throws SecurityManagerException	Thrown if the changed entities cannot be read.
+		 */
+		void applyChanges( const ChangeFeedPoller::Changes & changes );
+
+		/**
+		 * Accounts an execution of a query in the metrics and, if it is slow or sampled, in the slow query log.
+		 *
+		 * @param query			The executed query.
+		 * @param duration		The duration of the execution.
+		 * @param executed		true if the query was successfully executed.
+		 * @param batch			true if the query was executed as a batch.
+		 */
+		void recordExecution( QSqlQuery & query, std::chrono::nanoseconds duration, bool executed, bool batch );
+
+		/**
+		 * Checks if a login is certainly unknown, without querying the database: the login filter must reject
+		 * it, and be kept complete by the change feed.
+		 *
+		 * @param login		The login.
+		 * @return true if the login is certainly unknown, false if it must be looked up.
+		 */
+		bool isUnknownLogin( const std::string & login );
+
+		/**
+		 * Loads the logins of the database into the login filter.
+		 *
+		 * @param connection	The connection used to read the logins.
+		 *
+		 * @throws SecurityManagerException	Thrown if the logins cannot be read.
+		 */
+		void rebuildLoginFilter( PooledConnection & connection );
+
+		/**
+		 * Creates the missing tables of an SQLite database.
+		 *
+		 * @param connection	The connection to the database.
+		 *
+		 * @throws SecurityManagerException	Thrown if the schema cannot be created.
+		 */
+		void createSqliteSchema( PooledConnection & connection );
+
+		/**
+		 * Writes a batch of login updates in one transaction (the flush handler of the write-behind queue).
+		 *
+		 * @param batch		The pending updates to write.
+		 *
+		 * @throws SecurityManagerException	Thrown if the batch cannot be written.
+		 */
+		void writeLoginUpdates( const LoginUpdateQueue::Batch & batch );
+
+		/**
+		 * Hashes a password on the hashing pool.
+		 *
+		 * @param clearPassword		The password (in clear).
+		 * @return The encoded hash.
+		 *
+		 * @throws SecurityManagerException	Thrown if the hashing pool is saturated.
+		 */
+		std::string hashPassword( const std::string & clearPassword );
+
+		/**
+		 * Verifies a password on the hashing pool.
+		 *
+		 * @param clearPassword		The password (in clear).
+		 * @param encodedPassword	The encoded hash.
+		 * @return true if the password matches, false otherwise.
+		 *
+		 * @throws SecurityManagerException	Thrown if the hashing pool is saturated.
+		 */
+		bool verifyPassword( const std::string & clearPassword, const std::string & encodedPassword );
+
+		/**
+		 * The executor of the asynchronous methods of the managers: it forwards the calls to the current request
+		 * pool, which can be replaced while calls are submitted.
+		 */
+		class RequestExecutor : public Executor {
+			SqlSecurityManager & securityManager;
+
+		public:
+			RequestExecutor( SqlSecurityManager & securityManager ) : securityManager( securityManager ) {}
+
+			void execute( std::function<void()> task ) override;
+		};
+
 		/**
 		 * SQL implementation for the UserManager interface.
 		 *
@@ -99,17 +662,20 @@ namespace fr::koor::security {
 		 */
 		class SqlUserManager : public UserManager {
 			SqlSecurityManager & securityManager;
+			mutable UserCache userCache;
 		public:
 			SqlUserManager( const SqlSecurityManager & securityManager );
 			~SqlUserManager() override;
 
 			UserPtr checkCredentials( const std::string & userLogin, const std::string & userPassword ) override;
 
+			UserPtr checkCredentials( const std::string & userLogin, const std::string & userPassword, const std::string & source ) override;
+
 			UserPtr getUserById( uint userId ) const override;
 
 			UserPtr getUserByLogin( const std::string & login ) const override;
 
-			std::vector<UserPtr> getUsersByRole( RolePtr role ) const override;
+			void forEachUserInRole( RolePtr role, const UserVisitor & visitor, size_t pageSize = 500 ) const override;
 
 			UserPtr insertUser( const std::string & login, const std::string & password ) override;
 
@@ -119,6 +685,56 @@ namespace fr::koor::security {
 
 			std::string encryptPassword( const std::string & clearPassword ) const override;
 
+			bool verifyPassword( const std::string & clearPassword, const std::string & encryptedPassword ) const override;
+
+			std::string issueToken( UserPtr user, std::chrono::seconds timeToLive = std::chrono::minutes( 15 ) ) override;
+
+			TokenClaims verifyToken( const std::string & token ) const override;
+
+			Executor & getExecutor() const override;
+
+		private:
+
+			/**
+			 * Writes the bookkeeping of a successful login, and the new hash of the password if the stored one
+			 * uses an outdated algorithm or cost.
+			 *
+			 * @param user				The connected user, updated accordingly.
+			 * @param clearPassword		The password (in clear) used to log in.
+			 */
+			void recordSuccessfulLogin( UserPtr user, const std::string & clearPassword );
+
+			/**
+			 * Accounts a failed login, and disables the account after three consecutive errors.
+			 *
+			 * @param user		The user read before the password verification.
+			 *
+			 * @throws AccountDisabledException	Thrown if the account has just been disabled.
+			 */
+			void recordFailedLogin( UserPtr user );
+
+			/**
+			 * Selects a user, and its roles, from the database.
+			 *
+			 * @param connection	The connection to use.
+			 * @param statementId	The identifier of the statement in the statement cache of the connection.
+			 * @param condition		The SQL condition on the T_USERS table (aliased u) with a :key placeholder.
+			 * @param key			The value to bind to the :key placeholder.
+			 * @return The user instance, or a null pointer if no user matches the condition.
+			 */
+			UserPtr selectUser( PooledConnection & connection, uint statementId, const QString & condition, const QVariant & key ) const;
+
+			/**
+			 * Builds a user from the current row of a query selecting the USER_COLUMNS, followed by the role
+			 * identifier and the role name. The rows of the same user (one per role) are consumed: the query
+			 * is left on the first row of the next user, or after the last row.
+			 *
+			 * @param query		The executed query, positioned on the first row of the user.
+			 * @return The user instance.
+			 */
+			UserPtr readUser( QSqlQuery & query ) const;
+
+			friend class SqlSecurityManager;
 		};
 
 		/**
@@ -128,6 +744,8 @@ namespace fr::koor::security {
 		 */
 		class SqlRoleManager : public RoleManager {
 			SqlSecurityManager & securityManager;
+			RoleRegistry roleRegistry;
+
 		public:
 			SqlRoleManager( const SqlSecurityManager & securityManager );
 			~SqlRoleManager() override;
@@ -139,13 +757,50 @@ namespace fr::koor::security {
 
 			RolePtr insertRole( const std::string & roleName ) override;
 
-			void updateRole( RolePtr role ) override;
+			RolePtr updateRole( RolePtr role, const std::string & newRoleName ) override;
 
 			void deleteRole( RolePtr role ) override;
 
-		};
+			Executor & getExecutor() const override;
+
+			/**
+			 * Looks for a role by its name, in the registry then in the database.
+			 *
+			 * @param roleName	The name of the searched role.
+			 * @return The role, or a null pointer if no role has this name.
+			 *
+			 * @throws SecurityManagerException	Thrown if the database cannot be queried.
+			 */
+			RolePtr findRoleByName( const std::string & roleName );
+
+			/**
+			 * Reloads the whole role catalog from the database.
+			 *
+			 * @throws SecurityManagerException	Thrown if the roles cannot be loaded.
+			 */
+			void refreshRoles();
+
+			/**
+			 * Interns a role read from the database. If the role has been renamed, the cached users, which
+			 * hold its previous instance, are evicted.
+			 *
+			 * @param roleIdentifier	The role identifier.
+			 * @param roleName			The role name.
+			 * @return The canonical role instance.
+			 */
+			RolePtr internRole( uint roleIdentifier, const std::string & roleName );
+
+			/**
+			 * Returns the registry of the canonical role instances. Every role read from the database must be
+			 * interned in it, with internRole.
+			 *
+			 * @return The role registry.
+			 */
+			RoleRegistry & getRoleRegistry() {
+				return this->roleRegistry;
+			}
 
-		//friend class SqlRoleManager;
+		};
 	};
 
 }
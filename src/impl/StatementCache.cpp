@@ -0,0 +1,35 @@
+/*
+ * StatementCache.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <QtSql/QSqlError>
+
+#include "../api/SecurityManager.h"
+#include "StatementCache.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+QSqlQuery & StatementCache::prepare( QSqlDatabase & connection, uint statementId, const QString & strSql ) {
+	auto iterator = this->statements.find( statementId );
+	if ( iterator != this->statements.end() ) {
+		this->counters.hits++;
+		// The result set of the previous execution is released, the prepared statement is kept
+		iterator->second->finish();
+		return *iterator->second;
+	}
+
+	this->counters.misses++;
+	unique_ptr<QSqlQuery> query( new QSqlQuery( connection ) );
+	query->setForwardOnly( true );
+	if ( ! query->prepare( strSql ) ) {
+		QString errorMessage = QString( "Cannot prepare statement: %1" ).arg( query->lastError().text() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	return *( this->statements[ statementId ] = move( query ) );
+}
@@ -0,0 +1,118 @@
+/*
+ * StatementCache.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_STATEMENTCACHE_H_
+#define IMPL_STATEMENTCACHE_H_
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+
+#include <QtSql/QSqlDatabase>
+#include <QtSql/QSqlQuery>
+
+#include "../api/Common.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * <p>
+	 *     The prepared statements of one database connection, indexed by a statement identifier chosen by the
+	 *     caller. A statement is prepared (a server side prepare on MariaDB) the first time it is requested;
+	 *     then the same QSqlQuery is returned, ready to be bound again and executed.
+	 * </p>
+	 * <p>
+	 *     Like its connection, a cache belongs to one thread. A returned query must be consumed before the
+	 *     same statement is requested again. Cached queries are forward only and should be bound by name:
+	 *     positional bindings accumulate from one use to the next.
+	 * </p>
+	 *
+	 * @see fr.koor.security.impl.SqlConnectionPool
+	 *
+	 * @author KooR.fr
+	 */
+	class StatementCache {
+	public:
+		/**
+		 * Counters describing the activity of the statement caches of a pool.
+		 */
+		struct Statistics {
+			unsigned long long hits = 0;
+			unsigned long long misses = 0;
+
+			/**
+			 * Returns the proportion of the requests served by an already prepared statement.
+			 *
+			 * @return The hit rate, between 0 and 1.
+			 */
+			double getHitRate() const {
+				return hits + misses == 0 ? 0 : (double) hits / ( hits + misses );
+			}
+		};
+
+		/**
+		 * The counters shared by the statement caches of a pool.
+		 */
+		struct Counters {
+			std::atomic<unsigned long long> hits { 0 };
+			std::atomic<unsigned long long> misses { 0 };
+		};
+
+	private:
+		Counters & counters;
+		std::unordered_map<uint, std::unique_ptr<QSqlQuery>> statements;
+
+	public:
+		/**
+		 * Class constructor: builds an empty cache.
+		 *
+		 * @param counters	The counters that account for the hits and misses of this cache.
+		 */
+		StatementCache( Counters & counters ) : counters( counters ) {}
+
+		/**
+		 * Copies are forbidden
+		 */
+		StatementCache( const StatementCache & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		StatementCache & operator=( const StatementCache & original ) = delete;
+
+		/**
+		 * Returns the prepared query of a statement, preparing it if required.
+		 *
+		 * @param connection	The connection of this cache.
+		 * @param statementId	The statement identifier: one identifier per distinct SQL text.
+		 * @param strSql		The SQL text of the statement.
+		 * @return The prepared query.
+		 *
+		 * @throws SecurityManagerException	Thrown if the statement cannot be prepared.
+		 */
+		QSqlQuery & prepare( QSqlDatabase & connection, uint statementId, const QString & strSql );
+
+		/**
+		 * Drops every prepared statement. Must be called before the connection is closed or reopened.
+		 */
+		void clear() {
+			this->statements.clear();
+		}
+
+		/**
+		 * Returns the number of prepared statements.
+		 *
+		 * @return The cached statement count.
+		 */
+		size_t size() const {
+			return this->statements.size();
+		}
+	};
+
+}
+
+#endif /* IMPL_STATEMENTCACHE_H_ */
@@ -0,0 +1,159 @@
+/*
+ * TokenSigner.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <mutex>
+#include <random>
+#include <vector>
+
+#include <QtCore/QString>
+
+#include "../api/SecurityManager.h"
+#include "Base64.h"
+#include "Sha256.h"
+#include "TokenSigner.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+//--------------------------------------------------------------------------------------------
+//--- Utility functions ----------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+/*
+ * Payload layout: version (1 byte), key identifier (1), user identifier (4), expiry (8), bitmap length (1),
+ * bitmap of the role identifiers below RoleMembership::DENSE_LIMIT, count of the other role identifiers (2),
+ * other role identifiers (4 each). Integers are big endian.
+ */
+static const size_t HEADER_LENGTH = 15;
+
+static void appendInteger( vector<uint8_t> & buffer, uint64_t value, size_t length ) {
+	for( size_t i=length; i>0; i-- ) buffer.push_back( (uint8_t) ( value >> ( 8 * ( i - 1 ) ) ) );
+}
+
+static uint64_t readInteger( const uint8_t * bytes, size_t length ) {
+	uint64_t value = 0;
+	for( size_t i=0; i<length; i++ ) value = ( value << 8 ) | bytes[i];
+	return value;
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- TokenSigner implementation -------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+TokenSigner::TokenSigner() {
+	random_device randomDevice;
+	string secret( MINIMUM_KEY_LENGTH, '\0' );
+	for( char & character : secret ) character = (char) randomDevice();
+	this->addKey( 0, secret );
+}
+
+void TokenSigner::addKey( uint8_t keyIdentifier, const std::string & secret ) {
+	if ( secret.size() < MINIMUM_KEY_LENGTH ) {
+		QString errorMessage = QString( "Token signing keys must have at least %1 bytes" ).arg( (uint) MINIMUM_KEY_LENGTH );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+
+	Key key;
+	HmacSha256::precomputeStates( secret.data(), secret.size(), key.innerState, key.outerState );
+	unique_lock<shared_mutex> lock( this->keysMutex );
+	this->keys[ keyIdentifier ] = key;
+}
+
+void TokenSigner::setActiveKey( uint8_t keyIdentifier ) {
+	unique_lock<shared_mutex> lock( this->keysMutex );
+	if ( this->keys.count( keyIdentifier ) == 0 ) {
+		QString errorMessage = QString( "Unknown token signing key %1" ).arg( keyIdentifier );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	this->activeKey = keyIdentifier;
+}
+
+uint8_t TokenSigner::getActiveKey() const {
+	shared_lock<shared_mutex> lock( this->keysMutex );
+	return this->activeKey;
+}
+
+void TokenSigner::removeKey( uint8_t keyIdentifier ) {
+	unique_lock<shared_mutex> lock( this->keysMutex );
+	if ( keyIdentifier == this->activeKey ) {
+		QString errorMessage = QString( "The active token signing key %1 cannot be removed" ).arg( keyIdentifier );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+	this->keys.erase( keyIdentifier );
+}
+
+std::string TokenSigner::sign( const User & user, time_t expiry ) const {
+	uint8_t bitmap[ RoleMembership::DENSE_LIMIT / 8 ] = { 0 };
+	size_t bitmapLength = 0;
+	vector<uint> sparseRoles;
+	for( const RolePtr & role : user.getRoles() ) {
+		uint roleIdentifier = role->getIdentifier();
+		if ( roleIdentifier < RoleMembership::DENSE_LIMIT ) {
+			bitmap[ roleIdentifier / 8 ] |= (uint8_t) ( 1 << ( roleIdentifier % 8 ) );
+			bitmapLength = max( bitmapLength, (size_t) roleIdentifier / 8 + 1 );
+		} else {
+			sparseRoles.push_back( roleIdentifier );
+		}
+	}
+	if ( sparseRoles.size() > 0xFFFF ) throw SecurityManagerException( "Too many roles to issue a token" );
+
+	vector<uint8_t> payload;
+	payload.reserve( HEADER_LENGTH + bitmapLength + 2 + 4 * sparseRoles.size() + MAC_LENGTH );
+	shared_lock<shared_mutex> lock( this->keysMutex );
+	payload.push_back( FORMAT_VERSION );
+	payload.push_back( this->activeKey );
+	appendInteger( payload, user.getIdentifier(), 4 );
+	appendInteger( payload, (uint64_t) expiry, 8 );
+	payload.push_back( (uint8_t) bitmapLength );
+	payload.insert( payload.end(), bitmap, bitmap + bitmapLength );
+	appendInteger( payload, sparseRoles.size(), 2 );
+	for( uint roleIdentifier : sparseRoles ) appendInteger( payload, roleIdentifier, 4 );
+
+	const Key & key = this->keys.at( this->activeKey );
+	Sha256::Digest mac = HmacSha256::mac( key.innerState, key.outerState, payload.data(), payload.size() );
+	payload.insert( payload.end(), mac.begin(), mac.begin() + MAC_LENGTH );
+	return Base64::encode( payload, true );
+}
+
+TokenClaims TokenSigner::verify( const std::string & token, time_t now ) const {
+	vector<uint8_t> data;
+	if ( ! Base64::decode( token, data ) || data.size() < HEADER_LENGTH + 2 + MAC_LENGTH || data[0] != FORMAT_VERSION ) {
+		throw InvalidTokenException( "Malformed token" );
+	}
+	size_t payloadLength = data.size() - MAC_LENGTH;
+
+	{
+		shared_lock<shared_mutex> lock( this->keysMutex );
+		auto iterator = this->keys.find( data[1] );
+		if ( iterator == this->keys.end() ) throw InvalidTokenException( "Token signed with an unknown key" );
+		Sha256::Digest mac = HmacSha256::mac( iterator->second.innerState, iterator->second.outerState, data.data(), payloadLength );
+		if ( ! constantTimeEquals( mac.data(), data.data() + payloadLength, MAC_LENGTH ) ) {
+			throw InvalidTokenException( "Invalid token signature" );
+		}
+	}
+
+	// The payload is authentic: only its consistency is checked now
+	time_t expiry = (time_t) readInteger( data.data() + 6, 8 );
+	if ( expiry <= now ) throw InvalidTokenException( "Token expired" );
+
+	TokenClaims claims( (uint) readInteger( data.data() + 2, 4 ), expiry );
+	size_t bitmapLength = data[ 14 ];
+	size_t position = HEADER_LENGTH + bitmapLength;
+	if ( bitmapLength > RoleMembership::DENSE_LIMIT / 8 || position + 2 > payloadLength ) throw InvalidTokenException( "Malformed token" );
+	for( size_t i=0; i<bitmapLength * 8; i++ ) {
+		if ( data[ HEADER_LENGTH + i / 8 ] & ( 1 << ( i % 8 ) ) ) claims.addRole( (uint) i );
+	}
+
+	size_t sparseCount = readInteger( data.data() + position, 2 );
+	position += 2;
+	if ( position + 4 * sparseCount != payloadLength ) throw InvalidTokenException( "Malformed token" );
+	for( size_t i=0; i<sparseCount; i++, position += 4 ) claims.addRole( (uint) readInteger( data.data() + position, 4 ) );
+	return claims;
+}
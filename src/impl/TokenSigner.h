@@ -0,0 +1,140 @@
+/*
+ * TokenSigner.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_TOKENSIGNER_H_
+#define IMPL_TOKENSIGNER_H_
+
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <shared_mutex>
+#include <string>
+
+#include "../api/TokenClaims.h"
+#include "../api/User.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * <p>
+	 *     Signs and verifies session tokens with HMAC-SHA256. A token is the URL safe Base64 encoding of a
+	 *     binary payload (format version, key identifier, user identifier, expiry date, role bitmap and role
+	 *     identifiers too large for the bitmap) followed by the first 16 bytes of its MAC.
+	 * </p>
+	 * <p>
+	 *     Keys are held in a key ring indexed by a one byte identifier, stored in each token. Tokens are
+	 *     signed with the active key and verified with the key they designate: to rotate keys, add the new
+	 *     key on every node, then activate it, then remove the old one once the tokens it signed have
+	 *     expired. The padded keys are hashed once, when a key is added, so a verification costs two SHA-256
+	 *     compressions.
+	 * </p>
+	 * <p>
+	 *     A signer starts with a random key: its tokens can only be verified by the process that issued them
+	 *     until a shared key is added and activated.
+	 * </p>
+	 *
+	 * @author KooR.fr
+	 */
+	class TokenSigner {
+	public:
+		/**
+		 * The minimal length, in bytes, of a signing key.
+		 */
+		static const size_t MINIMUM_KEY_LENGTH = 32;
+
+		/**
+		 * The length, in bytes, of the truncated MAC ending each token.
+		 */
+		static const size_t MAC_LENGTH = 16;
+
+	private:
+		static constexpr uint8_t FORMAT_VERSION = 1;
+
+		struct Key {
+			uint32_t innerState[ 8 ];
+			uint32_t outerState[ 8 ];
+		};
+
+		mutable std::shared_mutex keysMutex;
+		std::map<uint8_t, Key> keys;
+		uint8_t activeKey = 0;
+
+	public:
+		/**
+		 * Class constructor: the key ring holds a random key, with identifier 0, which is active.
+		 */
+		TokenSigner();
+
+		/**
+		 * Copies are forbidden
+		 */
+		TokenSigner( const TokenSigner & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		TokenSigner & operator=( const TokenSigner & original ) = delete;
+
+		/**
+		 * Adds a key to the key ring, or replaces the key with the same identifier.
+		 *
+		 * @param keyIdentifier		The key identifier, stored in the tokens.
+		 * @param secret			The secret key (at least MINIMUM_KEY_LENGTH bytes).
+		 *
+		 * @throws SecurityManagerException	Thrown if the key is too short.
+		 */
+		void addKey( uint8_t keyIdentifier, const std::string & secret );
+
+		/**
+		 * Changes the key used to sign the new tokens.
+		 *
+		 * @param keyIdentifier		The identifier of a key of the key ring.
+		 *
+		 * @throws SecurityManagerException	Thrown if the key is unknown.
+		 */
+		void setActiveKey( uint8_t keyIdentifier );
+
+		/**
+		 * Returns the identifier of the key used to sign the new tokens.
+		 * @return The active key identifier.
+		 */
+		uint8_t getActiveKey() const;
+
+		/**
+		 * Removes a key from the key ring: the tokens it signed are rejected from now on.
+		 *
+		 * @param keyIdentifier		The key identifier.
+		 *
+		 * @throws SecurityManagerException	Thrown if the key is the active one.
+		 */
+		void removeKey( uint8_t keyIdentifier );
+
+		/**
+		 * Issues a token for a user.
+		 *
+		 * @param user		The user.
+		 * @param expiry	The date after which the token is rejected.
+		 * @return The signed token.
+		 */
+		std::string sign( const User & user, time_t expiry ) const;
+
+		/**
+		 * Checks a token and extracts its claims.
+		 *
+		 * @param token		The token.
+		 * @param now		The current date, compared to the expiry date.
+		 * @return The claims carried by the token.
+		 *
+		 * @throws InvalidTokenException	Thrown if the token is malformed, forged, signed with an unknown
+		 *         key or expired.
+		 */
+		TokenClaims verify( const std::string & token, time_t now ) const;
+	};
+
+}
+
+#endif /* IMPL_TOKENSIGNER_H_ */
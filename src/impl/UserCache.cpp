@@ -0,0 +1,175 @@
+/*
+ * UserCache.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <vector>
+
+#include "UserCache.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+constexpr std::chrono::milliseconds UserCache::DEFAULT_TIME_TO_LIVE;
+
+UserCache::UserCache( size_t capacity, std::chrono::milliseconds timeToLive ) : timeToLive( timeToLive.count() ) {
+	this->setCapacity( capacity );
+}
+
+UserPtr UserCache::getById( uint userId ) {
+	Shard & shard = this->shardFor( userId );
+	shared_ptr<const User> snapshot;
+	string expiredLogin;
+	{
+		lock_guard<mutex> lock( shard.mutex );
+		auto iterator = shard.entries.find( userId );
+		if ( iterator == shard.entries.end() ) {
+			shard.misses++;
+			return UserPtr( nullptr );
+		}
+
+		Entry & entry = iterator->second;
+		if ( entry.expiry <= Clock::now() ) {
+			expiredLogin = entry.snapshot->getLogin();
+			shard.lru.erase( entry.lruPosition );
+			shard.entries.erase( iterator );
+			shard.expirations++;
+			shard.misses++;
+		} else {
+			shard.lru.splice( shard.lru.begin(), shard.lru, entry.lruPosition );
+			snapshot = entry.snapshot;
+			shard.hits++;
+		}
+	}
+
+	if ( ! snapshot ) {
+		this->unindexLogin( expiredLogin, userId );
+		return UserPtr( nullptr );
+	}
+	// Copied outside of the lock
+	return UserPtr( new User( *snapshot ) );
+}
+
+UserPtr UserCache::getByLogin( const std::string & login ) {
+	Shard & loginShard = this->shardFor( login );
+	uint userId;
+	{
+		lock_guard<mutex> lock( loginShard.mutex );
+		auto iterator = loginShard.identifiersByLogin.find( login );
+		if ( iterator == loginShard.identifiersByLogin.end() ) {
+			loginShard.misses++;
+			return UserPtr( nullptr );
+		}
+		userId = iterator->second;
+	}
+
+	UserPtr user = this->getById( userId );
+	if ( user && user->getLogin() != login ) {
+		// The login index was stale: the user has been renamed since
+		this->unindexLogin( login, userId );
+		return UserPtr( nullptr );
+	}
+	return user;
+}
+
+void UserCache::put( const User & user, std::chrono::milliseconds timeToLive ) {
+	uint userId = user.getIdentifier();
+	shared_ptr<const User> snapshot( new User( user ) );
+	vector<pair<string, uint>> removedLogins;
+
+	Shard & shard = this->shardFor( userId );
+	{
+		lock_guard<mutex> lock( shard.mutex );
+		auto iterator = shard.entries.find( userId );
+		if ( iterator != shard.entries.end() ) {
+			if ( iterator->second.snapshot->getLogin() != user.getLogin() ) {
+				removedLogins.push_back( make_pair( iterator->second.snapshot->getLogin(), userId ) );
+			}
+			iterator->second.snapshot = snapshot;
+			iterator->second.expiry = Clock::now() + timeToLive;
+			shard.lru.splice( shard.lru.begin(), shard.lru, iterator->second.lruPosition );
+		} else {
+			shard.lru.push_front( userId );
+			shard.entries[ userId ] = Entry { snapshot, Clock::now() + timeToLive, shard.lru.begin() };
+
+			size_t capacity = this->shardCapacity;
+			while ( shard.entries.size() > capacity ) {
+				uint evictedId = shard.lru.back();
+				auto evicted = shard.entries.find( evictedId );
+				removedLogins.push_back( make_pair( evicted->second.snapshot->getLogin(), evictedId ) );
+				shard.entries.erase( evicted );
+				shard.lru.pop_back();
+				shard.evictions++;
+			}
+		}
+	}
+
+	for( auto & removedLogin : removedLogins ) this->unindexLogin( removedLogin.first, removedLogin.second );
+
+	Shard & loginShard = this->shardFor( user.getLogin() );
+	lock_guard<mutex> lock( loginShard.mutex );
+	loginShard.identifiersByLogin[ user.getLogin() ] = userId;
+}
+
+void UserCache::invalidate( uint userId ) {
+	Shard & shard = this->shardFor( userId );
+	string login;
+	{
+		lock_guard<mutex> lock( shard.mutex );
+		auto iterator = shard.entries.find( userId );
+		if ( iterator == shard.entries.end() ) return;
+		login = iterator->second.snapshot->getLogin();
+		shard.lru.erase( iterator->second.lruPosition );
+		shard.entries.erase( iterator );
+		shard.invalidations++;
+	}
+	this->unindexLogin( login, userId );
+}
+
+void UserCache::clear() {
+	for( Shard & shard : this->shards ) {
+		lock_guard<mutex> lock( shard.mutex );
+		shard.lru.clear();
+		shard.entries.clear();
+		shard.identifiersByLogin.clear();
+	}
+}
+
+void UserCache::setCapacity( size_t capacity ) {
+	size_t perShard = ( capacity + SHARD_COUNT - 1 ) / SHARD_COUNT;
+	this->shardCapacity = perShard == 0 ? 1 : perShard;
+}
+
+size_t UserCache::size() {
+	size_t result = 0;
+	for( Shard & shard : this->shards ) {
+		lock_guard<mutex> lock( shard.mutex );
+		result += shard.entries.size();
+	}
+	return result;
+}
+
+UserCache::Statistics UserCache::getStatistics() const {
+	Statistics statistics;
+	for( const Shard & shard : this->shards ) {
+		statistics.hits += shard.hits;
+		statistics.misses += shard.misses;
+		statistics.evictions += shard.evictions;
+		statistics.expirations += shard.expirations;
+		statistics.invalidations += shard.invalidations;
+	}
+	return statistics;
+}
+
+void UserCache::unindexLogin( const std::string & login, uint userId ) {
+	Shard & loginShard = this->shardFor( login );
+	lock_guard<mutex> lock( loginShard.mutex );
+	auto iterator = loginShard.identifiersByLogin.find( login );
+	if ( iterator != loginShard.identifiersByLogin.end() && iterator->second == userId ) {
+		loginShard.identifiersByLogin.erase( iterator );
+	}
+}
@@ -0,0 +1,199 @@
+/*
+ * UserCache.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_USERCACHE_H_
+#define IMPL_USERCACHE_H_
+
+#include <atomic>
+#include <chrono>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "../api/User.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * <p>
+	 *     A size-bounded LRU cache of user snapshots, indexed by identifier and by login. Each entry expires
+	 *     after its time to live. The cache is split into independently locked shards so that concurrent
+	 *     lookups rarely contend.
+	 * </p>
+	 * <p>
+	 *     The cache stores immutable snapshots: each lookup returns a new User instance that the caller can
+	 *     freely modify (and then save with UserManager::updateUser).
+	 * </p>
+	 *
+	 * @author KooR.fr
+	 */
+	class UserCache {
+	public:
+		/**
+		 * Counters describing the activity of the cache.
+		 */
+		struct Statistics {
+			unsigned long long hits = 0;
+			unsigned long long misses = 0;
+			unsigned long long evictions = 0;
+			unsigned long long expirations = 0;
+			unsigned long long invalidations = 0;
+		};
+
+		/**
+		 * The default maximum number of cached users.
+		 */
+		static const size_t DEFAULT_CAPACITY = 10000;
+
+		/**
+		 * The default time to live of a cached user.
+		 */
+		static constexpr std::chrono::milliseconds DEFAULT_TIME_TO_LIVE = std::chrono::seconds( 60 );
+
+	private:
+		static const size_t SHARD_COUNT = 16;
+
+		typedef std::chrono::steady_clock Clock;
+
+		struct Entry {
+			std::shared_ptr<const User> snapshot;
+			Clock::time_point expiry;
+			std::list<uint>::iterator lruPosition;
+		};
+
+		struct alignas(64) Shard {
+			std::mutex mutex;
+			std::list<uint> lru;
+			std::unordered_map<uint, Entry> entries;
+			std::unordered_map<std::string, uint> identifiersByLogin;
+
+			std::atomic<unsigned long long> hits { 0 };
+			std::atomic<unsigned long long> misses { 0 };
+			std::atomic<unsigned long long> evictions { 0 };
+			std::atomic<unsigned long long> expirations { 0 };
+			std::atomic<unsigned long long> invalidations { 0 };
+		};
+
+		Shard shards[ SHARD_COUNT ];
+		std::atomic<size_t> shardCapacity;
+		std::atomic<long long> timeToLive;
+
+	public:
+		/**
+		 * Class constructor.
+		 *
+		 * @param capacity		The maximum number of cached users.
+		 * @param timeToLive	The default time to live of a cached user.
+		 */
+		UserCache( size_t capacity = DEFAULT_CAPACITY, std::chrono::milliseconds timeToLive = DEFAULT_TIME_TO_LIVE );
+
+		/**
+		 * Copies are forbidden
+		 */
+		UserCache( const UserCache & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		UserCache & operator=( const UserCache & original ) = delete;
+
+		/**
+		 * Returns a copy of the cached user with the specified identifier.
+		 *
+		 * @param userId	The user identifier.
+		 * @return The user, or a null pointer if it's not cached (or has expired).
+		 */
+		UserPtr getById( uint userId );
+
+		/**
+		 * Returns a copy of the cached user with the specified login.
+		 *
+		 * @param login		The user login.
+		 * @return The user, or a null pointer if it's not cached (or has expired).
+		 */
+		UserPtr getByLogin( const std::string & login );
+
+		/**
+		 * Stores a snapshot of the specified user with the default time to live.
+		 *
+		 * @param user	The user to cache.
+		 */
+		void put( const User & user ) {
+			this->put( user, std::chrono::milliseconds( this->timeToLive.load() ) );
+		}
+
+		/**
+		 * Stores a snapshot of the specified user.
+		 *
+		 * @param user			The user to cache.
+		 * @param timeToLive	The time to live of this entry.
+		 */
+		void put( const User & user, std::chrono::milliseconds timeToLive );
+
+		/**
+		 * Removes the specified user from the cache.
+		 *
+		 * @param userId	The identifier of the user to remove.
+		 */
+		void invalidate( uint userId );
+
+		/**
+		 * Removes all the cached users.
+		 */
+		void clear();
+
+		/**
+		 * Changes the maximum number of cached users. Exceeding entries are evicted on the next insertions.
+		 *
+		 * @param capacity	The new capacity.
+		 */
+		void setCapacity( size_t capacity );
+
+		/**
+		 * Changes the default time to live of the users cached from now on.
+		 *
+		 * @param timeToLive	The new time to live.
+		 */
+		void setTimeToLive( std::chrono::milliseconds timeToLive ) {
+			this->timeToLive = timeToLive.count();
+		}
+
+		/**
+		 * Returns the number of cached users (expired entries included).
+		 *
+		 * @return The cached user count.
+		 */
+		size_t size();
+
+		/**
+		 * Returns the activity counters of this cache.
+		 *
+		 * @return The cache statistics.
+		 */
+		Statistics getStatistics() const;
+
+	private:
+
+		Shard & shardFor( uint userId ) {
+			return this->shards[ userId % SHARD_COUNT ];
+		}
+
+		Shard & shardFor( const std::string & login ) {
+			return this->shards[ std::hash<std::string>()( login ) % SHARD_COUNT ];
+		}
+
+		/**
+		 * Removes a login from the login index, if it still refers to the specified user.
+		 */
+		void unindexLogin( const std::string & login, uint userId );
+	};
+
+}
+
+#endif /* IMPL_USERCACHE_H_ */
@@ -0,0 +1,197 @@
+/*
+ * UserImporter.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <fstream>
+#include <unordered_map>
+
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QString>
+
+#include "SqlSecurityManager.h"
+#include "UserImporter.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+//--------------------------------------------------------------------------------------------
+//--- Utility functions ----------------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+/*
+ * Reads a CSV record (RFC 4180): fields may be quoted, quoted fields may contain separators, doubled
+ * quotes and line breaks. Returns false at the end of the stream.
+ */
+static bool readCsvRecord( istream & input, vector<string> & fields ) {
+	fields.clear();
+	if ( input.peek() == char_traits<char>::eof() ) return false;
+
+	string field;
+	bool quoted = false;
+	char character;
+	while ( input.get( character ) ) {
+		if ( quoted ) {
+			if ( character != '"' ) {
+				field += character;
+			} else if ( input.peek() == '"' ) {
+				field += input.get();
+			} else {
+				quoted = false;
+			}
+		} else if ( character == '"' ) {
+			quoted = true;
+		} else if ( character == ',' ) {
+			fields.push_back( move( field ) );
+			field.clear();
+		} else if ( character == '\n' ) {
+			break;
+		} else if ( character != '\r' ) {
+			field += character;
+		}
+	}
+	fields.push_back( move( field ) );
+	return true;
+}
+
+static vector<string> splitRoleNames( const string & roleNames ) {
+	vector<string> result;
+	size_t begin = 0;
+	while ( begin <= roleNames.size() ) {
+		size_t end = roleNames.find( '|', begin );
+		if ( end == string::npos ) end = roleNames.size();
+		if ( end > begin ) result.push_back( roleNames.substr( begin, end - begin ) );
+		begin = end + 1;
+	}
+	return result;
+}
+
+static bool endsWith( const string & value, const string & suffix ) {
+	return value.size() >= suffix.size() && value.compare( value.size() - suffix.size(), suffix.size(), suffix ) == 0;
+}
+
+
+//--------------------------------------------------------------------------------------------
+//--- UserImporter implementation ------------------------------------------------------------
+//--------------------------------------------------------------------------------------------
+
+UserImporter::UserImporter( SqlSecurityManager & securityManager, size_t batchSize )
+	: securityManager( securityManager ), batchSize( max( batchSize, (size_t) 1 ) ), start( chrono::steady_clock::now() ) {
+	this->pendingRecords.reserve( this->batchSize );
+}
+
+void UserImporter::add( const Record & record ) {
+	this->progress.readCount++;
+	if ( record.login.empty() || record.password.empty() ) {
+		this->reject( "Record " + to_string( this->progress.readCount ) + " has no login or no password" );
+		return;
+	}
+
+	this->pendingRecords.push_back( record );
+	if ( this->pendingRecords.size() >= this->batchSize ) this->writeBatch();
+}
+
+const UserImporter::Progress & UserImporter::finish() {
+	if ( ! this->pendingRecords.empty() ) this->writeBatch();
+	return this->progress;
+}
+
+const UserImporter::Progress & UserImporter::importCsv( std::istream & input ) {
+	vector<string> header;
+	if ( ! readCsvRecord( input, header ) ) return this->finish();
+
+	unordered_map<string, size_t> columns;
+	for( size_t i=0; i<header.size(); i++ ) columns[ header[i] ] = i;
+	if ( columns.count( "login" ) == 0 || columns.count( "password" ) == 0 ) {
+		throw SecurityManagerException( "The CSV header must name at least the login and password columns" );
+	}
+
+	auto column = [&columns]( const vector<string> & fields, const string & name ) -> string {
+		auto iterator = columns.find( name );
+		if ( iterator == columns.end() || iterator->second >= fields.size() ) return "";
+		return fields[ iterator->second ];
+	};
+
+	vector<string> fields;
+	while ( readCsvRecord( input, fields ) ) {
+		if ( fields.size() == 1 && fields[0].empty() ) continue;		// Blank line
+
+		Record record;
+		record.login = column( fields, "login" );
+		record.password = column( fields, "password" );
+		record.firstName = column( fields, "firstName" );
+		record.lastName = column( fields, "lastName" );
+		record.email = column( fields, "email" );
+		record.roleNames = splitRoleNames( column( fields, "roles" ) );
+		record.disabled = column( fields, "disabled" ) == "1";
+		this->add( record );
+	}
+	return this->finish();
+}
+
+const UserImporter::Progress & UserImporter::importJsonl( std::istream & input ) {
+	string line;
+	while ( getline( input, line ) ) {
+		if ( line.find_first_not_of( " \t\r" ) == string::npos ) continue;
+
+		QJsonParseError parseError;
+		QJsonDocument document = QJsonDocument::fromJson( QByteArray( line.data(), (int) line.size() ), &parseError );
+		if ( ! document.isObject() ) {
+			this->progress.readCount++;
+			this->reject( "Record " + to_string( this->progress.readCount ) + " is not a JSON object: "
+						  + parseError.errorString().toStdString() );
+			continue;
+		}
+
+		QJsonObject object = document.object();
+		Record record;
+		record.login = object.value( "login" ).toString().toStdString();
+		record.password = object.value( "password" ).toString().toStdString();
+		record.firstName = object.value( "firstName" ).toString().toStdString();
+		record.lastName = object.value( "lastName" ).toString().toStdString();
+		record.email = object.value( "email" ).toString().toStdString();
+		for( const QJsonValue & roleName : object.value( "roles" ).toArray() ) {
+			record.roleNames.push_back( roleName.toString().toStdString() );
+		}
+		record.disabled = object.value( "disabled" ).toBool();
+		this->add( record );
+	}
+	return this->finish();
+}
+
+const UserImporter::Progress & UserImporter::importFile( const std::string & fileName ) {
+	ifstream input( fileName, ios::binary );
+	if ( ! input ) {
+		QString errorMessage = QString( "Cannot open the file %1" ).arg( fileName.c_str() );
+		throw SecurityManagerException( errorMessage.toStdString() );
+	}
+
+	if ( endsWith( fileName, ".csv" ) ) return this->importCsv( input );
+	if ( endsWith( fileName, ".jsonl" ) || endsWith( fileName, ".json" ) ) return this->importJsonl( input );
+
+	QString errorMessage = QString( "Unsupported file format: %1" ).arg( fileName.c_str() );
+	throw SecurityManagerException( errorMessage.toStdString() );
+}
+
+void UserImporter::reject( const std::string & reason ) {
+	this->progress.rejectedCount++;
+	if ( this->rejections.size() < MAXIMUM_REJECTIONS ) this->rejections.push_back( reason );
+}
+
+void UserImporter::writeBatch() {
+	vector<string> batchRejections;
+	size_t importedCount = this->securityManager.insertUsers( this->pendingRecords, batchRejections );
+	this->pendingRecords.clear();
+
+	this->progress.importedCount += importedCount;
+	for( const string & reason : batchRejections ) this->reject( reason );
+	this->progress.elapsedSeconds = chrono::duration<double>( chrono::steady_clock::now() - this->start ).count();
+
+	if ( this->progressHandler ) this->progressHandler( this->progress );
+}
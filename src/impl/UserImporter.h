@@ -0,0 +1,199 @@
+/*
+ * UserImporter.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_USERIMPORTER_H_
+#define IMPL_USERIMPORTER_H_
+
+#include <chrono>
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "../api/Common.h"
+
+
+namespace fr::koor::security {
+
+	class SqlSecurityManager;
+
+	/**
+	 * <p>
+	 *     Imports users, and their role assignments, from CSV or JSON lines files. Records are collected in
+	 *     batches: the passwords of a batch are hashed in parallel on the hashing pool, then the batch is
+	 *     written with batched inserts in a single transaction (see SqlSecurityManager::insertUsers).
+	 * </p>
+	 * <p>
+	 *     Records whose login is already registered, or which reference an unknown role, are rejected
+	 *     without stopping the import: an interrupted import can therefore be restarted with the same file.
+	 *     Passwords which are valid encoded hashes of the password hasher are stored unchanged.
+	 * </p>
+	 * <p>
+	 *     CSV files start with a header line naming the columns: login and password are required,
+	 *     firstName, lastName, email, roles (role names separated by '|') and disabled (0 or 1) are optional.
+	 *     JSON lines files hold one object per line, with the same keys (roles being an array of names).
+	 * </p>
+	 *
+	 * @author KooR.fr
+	 */
+	class UserImporter {
+	public:
+		/**
+		 * A user to import.
+		 */
+		struct Record {
+			std::string login;
+			std::string password;
+			std::string firstName;
+			std::string lastName;
+			std::string email;
+			std::vector<std::string> roleNames;
+			bool disabled = false;
+		};
+
+		/**
+		 * The progress of an import.
+		 */
+		struct Progress {
+			size_t readCount = 0;
+			size_t importedCount = 0;
+			size_t rejectedCount = 0;
+			double elapsedSeconds = 0;
+		};
+
+		/**
+		 * Called after each written batch.
+		 */
+		typedef std::function<void( const Progress & progress )> ProgressHandler;
+
+		/**
+		 * The default number of users written per transaction.
+		 */
+		static const size_t DEFAULT_BATCH_SIZE = 1000;
+
+		/**
+		 * The maximum number of rejection messages kept by an importer.
+		 */
+		static const size_t MAXIMUM_REJECTIONS = 1000;
+
+	private:
+		SqlSecurityManager & securityManager;
+		size_t batchSize;
+		ProgressHandler progressHandler;
+
+		std::vector<Record> pendingRecords;
+		std::vector<std::string> rejections;
+		Progress progress;
+		std::chrono::steady_clock::time_point start;
+
+	public:
+		/**
+		 * Class constructor.
+		 *
+		 * @param securityManager	The security manager that stores the users.
+		 * @param batchSize			The number of users written per transaction.
+		 */
+		UserImporter( SqlSecurityManager & securityManager, size_t batchSize = DEFAULT_BATCH_SIZE );
+
+		/**
+		 * Copies are forbidden
+		 */
+		UserImporter( const UserImporter & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		UserImporter & operator=( const UserImporter & original ) = delete;
+
+		/**
+		 * Sets the handler called after each written batch.
+		 *
+		 * @param progressHandler	The progress handler.
+		 */
+		void setProgressHandler( ProgressHandler progressHandler ) {
+			this->progressHandler = progressHandler;
+		}
+
+		/**
+		 * Adds a user to import. A batch is written as soon as it is full.
+		 *
+		 * @param record	The user to import.
+		 *
+		 * @throws SecurityManagerException	Thrown if a batch cannot be written.
+		 */
+		void add( const Record & record );
+
+		/**
+		 * Writes the last, incomplete, batch.
+		 *
+		 * @return The final progress of the import.
+		 *
+		 * @throws SecurityManagerException	Thrown if the batch cannot be written.
+		 */
+		const Progress & finish();
+
+		/**
+		 * Imports the users of a CSV stream (see the format in the class description), then calls finish.
+		 *
+		 * @param input		The CSV stream.
+		 * @return The final progress of the import.
+		 *
+		 * @throws SecurityManagerException	Thrown if the stream is malformed or if a batch cannot be written.
+		 */
+		const Progress & importCsv( std::istream & input );
+
+		/**
+		 * Imports the users of a JSON lines stream (see the format in the class description), then calls finish.
+		 *
+		 * @param input		The JSON lines stream.
+		 * @return The final progress of the import.
+		 *
+		 * @throws SecurityManagerException	Thrown if a batch cannot be written.
+		 */
+		const Progress & importJsonl( std::istream & input );
+
+		/**
+		 * Imports a file: its format is chosen from its extension (.csv, .jsonl or .json).
+		 *
+		 * @param fileName	The file to import.
+		 * @return The final progress of the import.
+		 *
+		 * @throws SecurityManagerException	Thrown if the file cannot be read or if a batch cannot be written.
+		 */
+		const Progress & importFile( const std::string & fileName );
+
+		/**
+		 * Returns the current progress of the import.
+		 * @return The progress.
+		 */
+		const Progress & getProgress() const {
+			return this->progress;
+		}
+
+		/**
+		 * Returns the reasons of the first rejections (at most MAXIMUM_REJECTIONS).
+		 * @return The rejection messages.
+		 */
+		const std::vector<std::string> & getRejections() const {
+			return this->rejections;
+		}
+
+	private:
+
+		/**
+		 * Accounts a record rejected before being sent to the database.
+		 */
+		void reject( const std::string & reason );
+
+		/**
+		 * Writes the pending records and reports the progress.
+		 */
+		void writeBatch();
+	};
+
+}
+
+#endif /* IMPL_USERIMPORTER_H_ */
@@ -0,0 +1,93 @@
+/*
+ * WorkerPool.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <QtCore/QString>
+
+#include "../api/SecurityManager.h"
+#include "WorkerPool.h"
+
+using namespace std;
+
+using namespace fr::koor::security;
+
+
+// The pool the current thread works for, if any
+static thread_local const WorkerPool * currentPool = nullptr;
+
+
+WorkerPool::WorkerPool( const std::string & name, uint threadCount, size_t queueCapacity,
+						std::chrono::milliseconds submitTimeout, ThreadExitHandler threadExitHandler ) :
+		name(name), queueCapacity( queueCapacity == 0 ? 1 : queueCapacity ), submitTimeout(submitTimeout),
+		threadExitHandler(threadExitHandler) {
+	if ( threadCount == 0 ) threadCount = thread::hardware_concurrency();
+	if ( threadCount == 0 ) threadCount = 1;
+
+	this->workers.reserve( threadCount );
+	for( uint i=0; i<threadCount; i++ ) {
+		this->workers.push_back( thread( &WorkerPool::run, this ) );
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		lock_guard<mutex> lock( this->queueMutex );
+		this->stopping = true;
+	}
+	this->taskAvailable.notify_all();
+	for( thread & worker : this->workers ) worker.join();
+}
+
+bool WorkerPool::isWorkerThread() const {
+	return currentPool == this;
+}
+
+size_t WorkerPool::getQueueLength() {
+	lock_guard<mutex> lock( this->queueMutex );
+	return this->tasks.size();
+}
+
+void WorkerPool::execute( std::function<void()> task ) {
+	{
+		unique_lock<mutex> lock( this->queueMutex );
+		bool slotFound = this->slotAvailable.wait_for( lock, this->submitTimeout, [this] {
+			return this->tasks.size() < this->queueCapacity;
+		} );
+		if ( ! slotFound ) {
+			QString errorMessage = QString( "%1 saturated: %2 waiting tasks after %3 ms" )
+					.arg( this->name.c_str() ).arg( this->tasks.size() ).arg( this->submitTimeout.count() );
+			throw SecurityManagerException( errorMessage.toStdString() );
+		}
+		this->tasks.push_back( move( task ) );
+	}
+	this->taskAvailable.notify_one();
+}
+
+void WorkerPool::run() {
+	currentPool = this;
+
+	unique_lock<mutex> lock( this->queueMutex );
+	while ( true ) {
+		this->taskAvailable.wait( lock, [this] { return this->stopping || ! this->tasks.empty(); } );
+		if ( this->tasks.empty() ) break;
+
+		function<void()> task = move( this->tasks.front() );
+		this->tasks.pop_front();
+		lock.unlock();
+		this->slotAvailable.notify_one();
+
+		try {
+			task();
+		} catch ( ... ) {
+			// The tasks scheduled by submit report their exceptions through their future
+		}
+
+		lock.lock();
+	}
+	lock.unlock();
+
+	if ( this->threadExitHandler ) this->threadExitHandler();
+}
@@ -0,0 +1,136 @@
+/*
+ * WorkerPool.h
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#ifndef IMPL_WORKERPOOL_H_
+#define IMPL_WORKERPOOL_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../api/Common.h"
+#include "../api/Executor.h"
+
+
+namespace fr::koor::security {
+
+	/**
+	 * <p>
+	 *     A fixed size pool of threads executing tasks from a bounded queue. It keeps CPU bound work (password
+	 *     hashing) off the caller threads and limits the number of cores it can use. When the queue is full,
+	 *     submitters wait for a free slot during the submit timeout, then a SecurityManagerException is thrown.
+	 * </p>
+	 * <p>
+	 *     A pool is also the executor of the asynchronous methods of the SQL security manager: its threads
+	 *     then own their database connections, released by the thread exit handler.
+	 * </p>
+	 *
+	 * @author KooR.fr
+	 */
+	class WorkerPool : public Executor {
+	public:
+		/**
+		 * Called by each worker thread just before it terminates.
+		 */
+		typedef std::function<void()> ThreadExitHandler;
+
+	private:
+		std::string name;
+		size_t queueCapacity;
+		std::chrono::milliseconds submitTimeout;
+		ThreadExitHandler threadExitHandler;
+
+		std::mutex queueMutex;
+		std::condition_variable taskAvailable;
+		std::condition_variable slotAvailable;
+		std::deque<std::function<void()>> tasks;
+		bool stopping = false;
+		std::vector<std::thread> workers;
+
+	public:
+		/**
+		 * The default queue capacity.
+		 */
+		static const size_t DEFAULT_QUEUE_CAPACITY = 1024;
+
+		/**
+		 * Class constructor: starts the worker threads.
+		 *
+		 * @param name					The pool name, used in error messages.
+		 * @param threadCount			The number of worker threads (0 for the number of cores).
+		 * @param queueCapacity			The maximum number of waiting tasks.
+		 * @param submitTimeout			The maximum time a submitter waits for a free queue slot.
+		 * @param threadExitHandler		The handler called by each worker thread when it terminates.
+		 */
+		WorkerPool( const std::string & name, uint threadCount = 0, size_t queueCapacity = DEFAULT_QUEUE_CAPACITY,
+					std::chrono::milliseconds submitTimeout = std::chrono::seconds( 5 ),
+					ThreadExitHandler threadExitHandler = nullptr );
+
+		/**
+		 * Class destructor: executes the already queued tasks, then stops the worker threads.
+		 */
+		~WorkerPool();
+
+		/**
+		 * Copies are forbidden
+		 */
+		WorkerPool( const WorkerPool & original ) = delete;
+		/**
+		 * Copies are forbidden
+		 */
+		WorkerPool & operator=( const WorkerPool & original ) = delete;
+
+		/**
+		 * Adds a task to the queue, waiting for a free slot if needed. Use submit to get the task result: the
+		 * exceptions thrown by the task itself are ignored.
+		 *
+		 * @param task	The task to execute.
+		 *
+		 * @throws SecurityManagerException	Thrown if no queue slot becomes available before the submit timeout.
+		 */
+		void execute( std::function<void()> task ) override;
+
+		/**
+		 * Checks if the calling thread is one of the worker threads of this pool. Tasks running in the pool
+		 * must not wait for other tasks of the same pool.
+		 *
+		 * @return true if the calling thread belongs to this pool, false otherwise.
+		 */
+		bool isWorkerThread() const;
+
+		/**
+		 * Returns the number of worker threads.
+		 * @return The thread count.
+		 */
+		uint getThreadCount() const {
+			return (uint) this->workers.size();
+		}
+
+		/**
+		 * Returns the number of tasks waiting for a worker thread.
+		 * @return The queue length.
+		 */
+		size_t getQueueLength();
+
+	private:
+
+		/**
+		 * The worker threads main loop.
+		 */
+		void run();
+	};
+
+}
+
+#endif /* IMPL_WORKERPOOL_H_ */
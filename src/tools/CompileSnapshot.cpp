@@ -0,0 +1,45 @@
+/*
+ * CompileSnapshot.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "../impl/SnapshotCompiler.h"
+#include "../impl/SqlSecurityManager.h"
+
+using namespace std;
+using namespace fr::koor::security;
+
+
+/**
+ * Compiles the users and roles of the database in a snapshot, served by SnapshotSecurityManager.
+ * The previous snapshot is replaced atomically: the running servers map the new one at their next reload.
+ *
+ * Usage: CompileSnapshot hostname database login password snapshotFile
+ */
+int main( int argc, char * argv[] ) {
+	if ( argc != 6 ) {
+		cerr << "Usage: " << argv[0] << " hostname database login password snapshotFile" << endl;
+		return EXIT_FAILURE;
+	}
+
+	try {
+		SqlSecurityManager securityManager( argv[1], argv[2], argv[3], argv[4] );
+		securityManager.openSession();
+
+		SnapshotCompiler compiler;
+		compiler.load( securityManager );
+		compiler.write( argv[5] );
+		cout << compiler.getUserCount() << " users and " << compiler.getRoleCount() << " roles compiled in " << argv[5] << endl;
+
+		securityManager.close();
+	} catch ( const exception & exception ) {
+		cerr << "Cannot compile the snapshot: " << exception.what() << endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,54 @@
+/*
+ * ImportUsers.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <cstdlib>
+#include <iostream>
+
+#include "../impl/SqlSecurityManager.h"
+#include "../impl/UserImporter.h"
+
+using namespace std;
+using namespace fr::koor::security;
+
+
+/**
+ * Imports the users, and their role assignments, of a CSV or JSON lines file.
+ *
+ * Usage: ImportUsers hostname database login password file [batchSize]
+ */
+int main( int argc, char * argv[] ) {
+	if ( argc < 6 ) {
+		cerr << "Usage: " << argv[0] << " hostname database login password file [batchSize]" << endl;
+		return EXIT_FAILURE;
+	}
+	size_t batchSize = argc > 6 ? strtoul( argv[6], nullptr, 10 ) : UserImporter::DEFAULT_BATCH_SIZE;
+
+	try {
+		SqlSecurityManager securityManager( argv[1], argv[2], argv[3], argv[4] );
+		securityManager.openSession();
+
+		UserImporter importer( securityManager, batchSize );
+		importer.setProgressHandler( []( const UserImporter::Progress & progress ) {
+			cerr << "\r" << progress.readCount << " read, " << progress.importedCount << " imported, "
+				 << progress.rejectedCount << " rejected";
+			if ( progress.elapsedSeconds > 0 ) cerr << " (" << (size_t) ( progress.importedCount / progress.elapsedSeconds ) << " users/s)";
+			cerr << flush;
+		} );
+		const UserImporter::Progress & progress = importer.importFile( argv[5] );
+		cerr << endl;
+
+		for( const string & reason : importer.getRejections() ) cerr << "Rejected: " << reason << endl;
+		cout << progress.importedCount << " users imported, " << progress.rejectedCount << " rejected in "
+			 << progress.elapsedSeconds << " s" << endl;
+
+		securityManager.close();
+	} catch ( const exception & exception ) {
+		cerr << endl << "Cannot import users: " << exception.what() << endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
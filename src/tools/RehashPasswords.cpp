@@ -0,0 +1,50 @@
+/*
+ * RehashPasswords.cpp
+ *
+ *  Created on: 18 oct. 2026
+ *      Author: dominique
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "../impl/SqlSecurityManager.h"
+#include "../impl/Sha256MultiBuffer.h"
+
+using namespace std;
+using namespace fr::koor::security;
+
+
+/**
+ * Hashes every password still stored in clear in the T_USERS table.
+ *
+ * Usage: RehashPasswords hostname database login password [batchSize]
+ */
+int main( int argc, char * argv[] ) {
+	if ( argc < 5 ) {
+		cerr << "Usage: " << argv[0] << " hostname database login password [batchSize]" << endl;
+		return EXIT_FAILURE;
+	}
+	size_t batchSize = argc > 5 ? strtoul( argv[5], nullptr, 10 ) : 1024;
+
+	try {
+		SqlSecurityManager securityManager( argv[1], argv[2], argv[3], argv[4] );
+		securityManager.openSession();
+
+		cout << "Hashing legacy passwords with " << Sha256MultiBuffer::getLaneCount() << " SHA-256 lanes per thread" << endl;
+		auto start = chrono::steady_clock::now();
+		size_t hashedCount = securityManager.rehashLegacyPasswords( batchSize );
+		double seconds = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+
+		cout << hashedCount << " passwords hashed in " << seconds << " s";
+		if ( seconds > 0 ) cout << " (" << hashedCount / seconds << " hashes/s)";
+		cout << endl;
+
+		securityManager.close();
+	} catch ( const exception & exception ) {
+		cerr << "Cannot hash passwords: " << exception.what() << endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}